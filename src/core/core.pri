@@ -8,11 +8,17 @@ HEADERS  += qxtabstractsignalserializer.h
 HEADERS  += qxtalgorithms.h
 HEADERS  += qxtbasicfileloggerengine.h
 HEADERS  += qxtbasicstdloggerengine.h
+HEADERS  += qxtbinaryfileloggerengine.h
+HEADERS  += qxtbinarylog_p.h
+HEADERS  += qxtbinarylogreader.h
 HEADERS  += qxtboundcfunction.h
 HEADERS  += qxtboundfunction.h
+HEADERS  += qxtbufferedfileloggerengine.h
+HEADERS  += qxtbufferedfileloggerengine_p.h
 HEADERS  += qxtboundfunctionbase.h
 HEADERS  += qxtcore.h
 HEADERS  += qxtcommandoptions.h
+HEADERS  += qxtcompactsignalserializer.h
 HEADERS  += qxtcsvmodel.h
 HEADERS  += qxtdaemon.h
 HEADERS  += qxtdatastreamsignalserializer.h
@@ -20,9 +26,12 @@ HEADERS  += qxtdeplex.h
 HEADERS  += qxtdeplex_p.h
 HEADERS  += qxterror.h
 HEADERS  += qxtfifo.h
+HEADERS  += qxtflightrecorderloggerengine.h
 HEADERS  += qxtglobal.h
 HEADERS  += qxthmac.h
 HEADERS  += qxtjson.h
+HEADERS  += qxtjsonfileloggerengine.h
+HEADERS  += qxtjsonwriter_p.h
 HEADERS  += qxtjob.h
 HEADERS  += qxtjob_p.h
 HEADERS  += qxtlinesocket.h
@@ -33,6 +42,8 @@ HEADERS  += qxtlocale_data_p.h
 HEADERS  += qxtlogger.h
 HEADERS  += qxtlogger_p.h
 HEADERS  += qxtloggerengine.h
+HEADERS  += qxtlogratelimiter.h
+HEADERS  += qxtlogrecordformatter_p.h
 HEADERS  += qxtlogstream.h
 HEADERS  += qxtlogstream_p.h
 HEADERS  += qxtmetaobject.h
@@ -60,6 +71,7 @@ HEADERS  += qxttemporarydir.h
 HEADERS  += qxttemporarydir_p.h
 HEADERS  += qxttimer.h
 HEADERS  += qxttypelist.h
+HEADERS  += qxtrpcreply.h
 HEADERS  += qxtrpcservice.h
 HEADERS  += qxtrpcservice_p.h
 HEADERS  += qxtxmlfileloggerengine.h
@@ -69,22 +81,31 @@ SOURCES  += qxtabstractfileloggerengine.cpp
 SOURCES  += qxtabstractiologgerengine.cpp
 SOURCES  += qxtbasicfileloggerengine.cpp
 SOURCES  += qxtbasicstdloggerengine.cpp
+SOURCES  += qxtbinaryfileloggerengine.cpp
+SOURCES  += qxtbinarylogreader.cpp
+SOURCES  += qxtbufferedfileloggerengine.cpp
 SOURCES  += qxtcommandoptions.cpp
+SOURCES  += qxtcompactsignalserializer.cpp
 SOURCES  += qxtcsvmodel.cpp
 SOURCES  += qxtdaemon.cpp
 SOURCES  += qxtdatastreamsignalserializer.cpp
 SOURCES  += qxtdeplex.cpp
 SOURCES  += qxterror.cpp
 SOURCES  += qxtfifo.cpp
+SOURCES  += qxtflightrecorderloggerengine.cpp
 SOURCES  += qxtglobal.cpp
 SOURCES  += qxthmac.cpp
 SOURCES  += qxtlocale.cpp
 SOURCES  += qxtjson.cpp
+SOURCES  += qxtjsonfileloggerengine.cpp
+SOURCES  += qxtjsonwriter.cpp
 SOURCES  += qxtjob.cpp
 SOURCES  += qxtlinesocket.cpp
 SOURCES  += qxtlinkedtree.cpp
 SOURCES  += qxtlogger.cpp
 SOURCES  += qxtloggerengine.cpp
+SOURCES  += qxtlogratelimiter.cpp
+SOURCES  += qxtlogrecordformatter.cpp
 SOURCES  += qxtlogstream.cpp
 SOURCES  += qxtmetaobject.cpp
 SOURCES  += qxtmodelserializer.cpp
@@ -100,6 +121,7 @@ SOURCES  += qxtstdio.cpp
 SOURCES  += qxtstdstreambufdevice.cpp
 SOURCES  += qxttemporarydir.cpp
 SOURCES  += qxttimer.cpp
+SOURCES  += qxtrpcreply.cpp
 SOURCES  += qxtrpcservice.cpp
 SOURCES  += qxtxmlfileloggerengine.cpp
 
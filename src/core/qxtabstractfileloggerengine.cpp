@@ -38,10 +38,17 @@ class QxtAbstractFileLoggerEnginePrivate : public QxtPrivate<QxtAbstractFileLogg
     QXT_DECLARE_PUBLIC(QxtAbstractFileLoggerEngine)
 
 public:
+    QxtAbstractFileLoggerEnginePrivate();
+
     QString logFile;
     QIODevice::OpenMode mode;
+    const QxtLogRecord* record;     // the record being written, if any
 };
 
+QxtAbstractFileLoggerEnginePrivate::QxtAbstractFileLoggerEnginePrivate() : record(0)
+{
+}
+
 /*!
     Constructs a QxtAbstractFileLoggerEngine with \a fileName and open \a mode.
  */
@@ -111,6 +118,16 @@ bool QxtAbstractFileLoggerEngine::isInitialized() const
  */
 void QxtAbstractFileLoggerEngine::writeFormatted(QxtLogger::LogLevel level, const QList<QVariant> &messages)
 {
+    QxtAbstractFileLoggerEnginePrivate& d = qxt_d();
+    const QxtLogRecord* outer = d.record;
+    QxtLogRecord direct;
+    if (!outer)
+    {
+        // called directly rather than by writeRecord(): the messages are logged now
+        direct = QxtLogRecord(level, messages);
+        d.record = &direct;
+    }
+
     switch (level)
     {
     case QxtLogger::ErrorLevel:
@@ -138,6 +155,32 @@ void QxtAbstractFileLoggerEngine::writeFormatted(QxtLogger::LogLevel level, cons
         writeToFile(QString(), messages);
         break;
     }
+    d.record = outer;
+}
+
+/*!
+    Writes \a record with writeFormatted(). Meanwhile currentRecord() returns
+    \a record, so writeToFile() can take the time and the thread of the
+    messages from it.
+ */
+void QxtAbstractFileLoggerEngine::writeRecord(const QxtLogRecord& record)
+{
+    QxtAbstractFileLoggerEnginePrivate& d = qxt_d();
+    const QxtLogRecord* outer = d.record;
+    d.record = &record;
+    writeFormatted(record.level, record.messages);
+    d.record = outer;
+}
+
+/*!
+    Returns the record being written. Outside of writeFormatted() and
+    writeRecord() this is an empty record of the calling thread, stamped
+    with the current time.
+ */
+QxtLogRecord QxtAbstractFileLoggerEngine::currentRecord() const
+{
+    const QxtLogRecord* record = qxt_d().record;
+    return record ? *record : QxtLogRecord(QxtLogger::NoLevels, QList<QVariant>());
 }
 
 /*!
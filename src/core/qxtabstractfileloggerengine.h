@@ -31,7 +31,7 @@
 
 class QxtAbstractFileLoggerEnginePrivate;
 
-class QXT_CORE_EXPORT QxtAbstractFileLoggerEngine : public QxtAbstractIOLoggerEngine
+class QXT_CORE_EXPORT QxtAbstractFileLoggerEngine : public QxtAbstractIOLoggerEngine, public QxtLoggerEngineExtension
 {
     QXT_DECLARE_PRIVATE(QxtAbstractFileLoggerEngine)
 
@@ -44,12 +44,14 @@ public:
     virtual bool    isInitialized() const;
 
     virtual void    writeFormatted(QxtLogger::LogLevel level, const QList<QVariant> &messages);
+    virtual void    writeRecord(const QxtLogRecord& record);
 
     void    setLogFileName(const QString &fileName);
     QString logFileName() const;
 
 protected:
     virtual void writeToFile(const QString &level, const QVariantList &messages) = 0;
+    QxtLogRecord currentRecord() const;
 };
 
 #endif // QXTABSTRACTFILELOGGERENGINE_H
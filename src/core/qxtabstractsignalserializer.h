@@ -117,4 +117,62 @@ public:
     }
 };
 
+/*!
+ * \class QxtSignalSerializerExtension
+ * \inmodule QxtCore
+ * \brief The QxtSignalSerializerExtension class is an optional interface for signal serializers that parse messages
+ * in place and identify signals by number.
+ *
+ * A QxtAbstractSignalSerializer subclass that also inherits QxtSignalSerializerExtension lets QxtRPCService consume
+ * any number of received messages before the processed data is discarded once, and send each signal name only once
+ * per connection. QxtRPCService finds the extension with dynamic_cast; serializers that do not implement it are used
+ * through QxtAbstractSignalSerializer alone. QxtDataStreamSignalSerializer and QxtCompactSignalSerializer implement
+ * it.
+ */
+
+class QXT_CORE_EXPORT QxtSignalSerializerExtension
+{
+public:
+    /*!
+     * The value stored by deserialize() for a signal identified by its name.
+     */
+    enum { NoMethodId = 0xffffffff };
+
+    /*!
+     * Destroys the QxtSignalSerializerExtension.
+     */
+    virtual ~QxtSignalSerializerExtension() {}
+
+    /*!
+     * Deserializes the message starting at \a offset in \a buffer and advances \a offset past it, leaving the buffer
+     * untouched. Returns the same values as QxtAbstractSignalSerializer::deserialize().
+     *
+     * If the message identifies its signal by a numeric ID, the ID is stored in \a methodId and the name of the
+     * returned signal is empty. Otherwise NoMethodId is stored. If \a methodId is null, a numbered message is a
+     * protocol error.
+     */
+    virtual QxtAbstractSignalSerializer::DeserializedData deserialize(const QByteArray& buffer, int& offset,
+                                                                      quint32* methodId = 0) = 0;
+
+    /*!
+     * Indicates whether a complete message starts at \a offset in \a buffer.
+     */
+    virtual bool canDeserialize(const QByteArray& buffer, int offset) const = 0;
+
+    /*!
+     * Returns \c true if serialize(quint32, const QVariant&, const QVariant&, const QVariant&, const QVariant&, const QVariant&, const QVariant&, const QVariant&, const QVariant&)
+     * is supported.
+     */
+    virtual bool supportsMethodIds() const = 0;
+
+    /*!
+     * Serializes a signal identified by \a methodId, which must be less than NoMethodId. The meaning of the ID is
+     * agreed on by the communicating parties.
+     */
+    virtual QByteArray serialize(quint32 methodId, const QVariant& p1 = QVariant(), const QVariant& p2 = QVariant(),
+                                 const QVariant& p3 = QVariant(), const QVariant& p4 = QVariant(),
+                                 const QVariant& p5 = QVariant(), const QVariant& p6 = QVariant(),
+                                 const QVariant& p7 = QVariant(), const QVariant& p8 = QVariant()) const = 0;
+};
+
 #endif
@@ -24,6 +24,7 @@
  ****************************************************************************/
 
 #include "qxtbasicfileloggerengine.h"
+#include "qxtlogrecordformatter_p.h"
 #include <QDateTime>
 
 /*!
@@ -45,7 +46,7 @@ class QxtBasicFileLoggerEnginePrivate : public QxtPrivate<QxtBasicFileLoggerEngi
 {
 public:
     QXT_DECLARE_PUBLIC(QxtBasicFileLoggerEngine)
-    QString dateFormat;
+    QxtLogRecordFormatter formatter;
 };
 
 /*!
@@ -55,7 +56,6 @@ QxtBasicFileLoggerEngine::QxtBasicFileLoggerEngine(const QString &fileName)
         : QxtAbstractFileLoggerEngine(fileName, QIODevice::ReadWrite | QIODevice::Append | QIODevice::Unbuffered)
 {
     QXT_INIT_PRIVATE(QxtBasicFileLoggerEngine);
-    qxt_d().dateFormat = "hh:mm:ss.zzz";
 }
 
 /*!
@@ -64,7 +64,7 @@ QxtBasicFileLoggerEngine::QxtBasicFileLoggerEngine(const QString &fileName)
  */
 QString QxtBasicFileLoggerEngine::dateFormat() const
 {
-    return qxt_d().dateFormat;
+    return qxt_d().formatter.dateFormat();
 }
 
 /*!
@@ -73,7 +73,7 @@ QString QxtBasicFileLoggerEngine::dateFormat() const
  */
 void QxtBasicFileLoggerEngine::setDateFormat(const QString& format)
 {
-    qxt_d().dateFormat = format;
+    qxt_d().formatter.setDateFormat(format);
 }
 
 /*!
@@ -82,21 +82,12 @@ void QxtBasicFileLoggerEngine::setDateFormat(const QString& format)
 void QxtBasicFileLoggerEngine::writeToFile(const QString &level, const QVariantList &messages)
 {
     if (messages.isEmpty()) return;
-    QString header = '[' + QDateTime::currentDateTime().toString(qxt_d().dateFormat) + "] [" + level + "] ";
-    QString padding;
     QIODevice* file = device();
     Q_ASSERT(file);
-    file->write(header.toUtf8());
-    for (int i = 0; i < header.size(); i++) padding.append(" ");
-    int count = 0;
-    Q_FOREACH(const QVariant& out, messages)
-    {
-        if (!out.isNull())
-        {
-            if (count != 0) file->write(padding.toUtf8());
-            file->write(out.toString().toUtf8());
-            file->write("\n");
-        }
-        count++;
-    }
+    QByteArray record;
+    record.reserve(128);
+    const QxtLogRecord current = currentRecord();
+    const QString thread = qxtLog->isThreadTaggingEnabled() ? current.threadTag() : QString();
+    qxt_d().formatter.appendRecord(record, current.dateTime(), level, messages, thread);
+    file->write(record);
 }
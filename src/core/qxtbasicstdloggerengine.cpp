@@ -52,9 +52,10 @@ public:
     QxtBasicSTDLoggerEnginePrivate();
 
     QTextStream *errstream, *outstream;
+    const QxtLogRecord* record;     // the record being written, if any
 };
 
-QxtBasicSTDLoggerEnginePrivate::QxtBasicSTDLoggerEnginePrivate()
+QxtBasicSTDLoggerEnginePrivate::QxtBasicSTDLoggerEnginePrivate() : record(0)
 {
     errstream = new QTextStream(stderr);
     outstream = new QTextStream(stdout);
@@ -147,6 +148,16 @@ void QxtBasicSTDLoggerEngine::setLogLevelEnabled(QxtLogger::LogLevels level, boo
  */
 void QxtBasicSTDLoggerEngine::writeFormatted(QxtLogger::LogLevel level, const QList<QVariant> &msgs)
 {
+    QxtBasicSTDLoggerEnginePrivate& d = qxt_d();
+    const QxtLogRecord* outer = d.record;
+    QxtLogRecord direct;
+    if (!outer)
+    {
+        // called directly rather than by writeRecord(): the messages are logged now
+        direct = QxtLogRecord(level, msgs);
+        d.record = &direct;
+    }
+
     switch (level)
     {
     case QxtLogger::ErrorLevel:
@@ -174,6 +185,32 @@ void QxtBasicSTDLoggerEngine::writeFormatted(QxtLogger::LogLevel level, const QL
         writeToStdOut("", msgs);
         break;
     }
+    d.record = outer;
+}
+
+/*!
+    Writes \a record with writeFormatted(). Meanwhile currentRecord() returns
+    \a record, so writeToStdErr() and writeToStdOut() can take the time and
+    the thread of the messages from it.
+ */
+void QxtBasicSTDLoggerEngine::writeRecord(const QxtLogRecord& record)
+{
+    QxtBasicSTDLoggerEnginePrivate& d = qxt_d();
+    const QxtLogRecord* outer = d.record;
+    d.record = &record;
+    writeFormatted(record.level, record.messages);
+    d.record = outer;
+}
+
+/*!
+    Returns the record being written. Outside of writeFormatted() and
+    writeRecord() this is an empty record of the calling thread, stamped
+    with the current time.
+ */
+QxtLogRecord QxtBasicSTDLoggerEngine::currentRecord() const
+{
+    const QxtLogRecord* record = qxt_d().record;
+    return record ? *record : QxtLogRecord(QxtLogger::NoLevels, QList<QVariant>());
 }
 
 /*!
@@ -184,7 +221,9 @@ void QxtBasicSTDLoggerEngine::writeFormatted(QxtLogger::LogLevel level, const QL
 void QxtBasicSTDLoggerEngine::writeToStdErr(const QString &level, const QList<QVariant> &msgs)
 {
     if (msgs.isEmpty()) return;
-    QString header = '[' + QTime::currentTime().toString("hh:mm:ss.zzz") + "] [" + level + "] ";
+    const QxtLogRecord current = currentRecord();
+    QString header = '[' + current.dateTime().time().toString("hh:mm:ss.zzz") + "] [" + level + "] ";
+    if (qxtLog->isThreadTaggingEnabled()) header += '[' + current.threadTag() + "] ";
     QString padding;
     QTextStream* errstream = stdErrStream();
     Q_ASSERT(errstream);
@@ -216,7 +255,9 @@ void QxtBasicSTDLoggerEngine::writeToStdOut(const QString& level, const QList<QV
                     third message
     */
     if (msgs.isEmpty()) return;
-    QString header = '[' + QTime::currentTime().toString("hh:mm:ss.zzz") + "] [" + level + "] ";
+    const QxtLogRecord current = currentRecord();
+    QString header = '[' + current.dateTime().time().toString("hh:mm:ss.zzz") + "] [" + level + "] ";
+    if (qxtLog->isThreadTaggingEnabled()) header += '[' + current.threadTag() + "] ";
     QString padding;
     QTextStream* outstream = stdOutStream();
     Q_ASSERT(outstream);
@@ -36,7 +36,7 @@ class QxtBasicSTDLoggerEnginePrivate;
     QBasicSTDLoggerEngine
     The basic logger engine included with QxtLogger.
 *******************************************************************************/
-class QXT_CORE_EXPORT QxtBasicSTDLoggerEngine : public QxtLoggerEngine
+class QXT_CORE_EXPORT QxtBasicSTDLoggerEngine : public QxtLoggerEngine, public QxtLoggerEngineExtension
 {
     QXT_DECLARE_PRIVATE(QxtBasicSTDLoggerEngine)
 
@@ -47,6 +47,7 @@ public:
     void initLoggerEngine();
     void killLoggerEngine();
     void writeFormatted(QxtLogger::LogLevel level, const QList<QVariant> &messages);
+    void writeRecord(const QxtLogRecord& record);
     void setLogLevelEnabled(QxtLogger::LogLevels level, bool enable = true);
 
     bool isInitialized() const;
@@ -57,6 +58,7 @@ public:
 protected:
     virtual void writeToStdErr(const QString& str_level, const QList<QVariant> &msgs);
     virtual void writeToStdOut(const QString& str_level, const QList<QVariant> &msgs);
+    QxtLogRecord currentRecord() const;
 };
 
 #endif // QXTBASICSTDLOGGERENGINE_H
@@ -0,0 +1,377 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include "qxtbinaryfileloggerengine.h"
+#include "qxtbinarylog_p.h"
+#include <QDataStream>
+#include <QFile>
+#include <QHash>
+
+/*!
+    \class QxtBinaryFileLoggerEngine
+    \brief The QxtBinaryFileLoggerEngine class writes log messages as compact binary records.
+    \inmodule QxtCore
+
+    Each message is stored as a length-prefixed record holding the time in
+    milliseconds since the epoch, the level, the id of the thread that wrote
+    it and the message arguments. Short strings are interned: a string that
+    appears repeatedly, such as a constant first argument, is written out
+    once per block and referred to by number afterwards. Other arguments are
+    stored as QVariants in QDataStream format, so they keep their type.
+
+    Every blockSize() messages the engine starts a new block and records its
+    position in an index file next to the log, named indexFileName().
+    QxtBinaryLogReader uses the index to find the messages of a given time
+    without reading the whole log.
+
+    Messages keep the time they were logged at, so a message staged in a
+    batch or queued for the asynchronous writer thread may follow messages
+    logged after it. The time of a block is never earlier than any message
+    before it in the file, which is what lets the reader skip those.
+
+    Writes go through QFile's buffer; messages of one of the flushLevels()
+    are flushed to the file immediately.
+
+    \sa QxtBinaryLogReader, QxtLogger
+ */
+
+#define QXT_BINARYLOG_MAX_INTERNED_LENGTH 256
+#define QXT_BINARYLOG_MAX_INTERNED_STRINGS 4096
+
+class QxtBinaryFileLoggerEnginePrivate : public QxtPrivate<QxtBinaryFileLoggerEngine>
+{
+    QXT_DECLARE_PUBLIC(QxtBinaryFileLoggerEngine)
+
+public:
+    QxtBinaryFileLoggerEnginePrivate();
+
+    bool prepareFile();
+    qint64 latestTime(QIODevice* file, qint64 offset) const;
+    void startBlock(QByteArray& out, qint64 time);
+    void appendMessage(QByteArray& out, QByteArray& definitions, const QVariant& message);
+
+    QFile index;
+    QHash<QString, quint32> strings;
+    qint64 fileSize;    // including what is still in QFile's buffer
+    int blockSize;
+    int blockEntries;
+    qint64 maxTime;     // latest time in the file
+    QxtLogger::LogLevels flushLevels;
+};
+
+QxtBinaryFileLoggerEnginePrivate::QxtBinaryFileLoggerEnginePrivate()
+        : fileSize(0), blockSize(1024), blockEntries(0), maxTime(0),
+        flushLevels(QxtLogger::ErrorLevel | QxtLogger::CriticalLevel | QxtLogger::FatalLevel)
+{
+}
+
+/*******************************************************************************
+Writes the header to a new file, or checks the header of an existing one and
+finds the latest time in it, and opens the index. The first message always
+starts a new block, since the string table of a file we append to is not
+known.
+*******************************************************************************/
+bool QxtBinaryFileLoggerEnginePrivate::prepareFile()
+{
+    QxtBinaryFileLoggerEngine& p = qxt_p();
+    QIODevice* file = p.device();
+    if (!file) return false;
+
+    if (file->size() == 0)
+    {
+        QByteArray header(QxtBinaryLog::Magic, sizeof QxtBinaryLog::Magic);
+        QxtBinaryLog::appendInt(header, QxtBinaryLog::Version, 4);
+        QxtBinaryLog::appendInt(header, 0, 4);
+        file->write(header);
+        file->seek(file->size());
+    }
+    else
+    {
+        file->seek(0);
+        const QByteArray header = file->read(QxtBinaryLog::HeaderSize);
+        file->seek(file->size());
+        if (header.size() != QxtBinaryLog::HeaderSize
+                || !header.startsWith(QByteArray(QxtBinaryLog::Magic, sizeof QxtBinaryLog::Magic)))
+        {
+            qxtLog->warning(QString(" is not a binary log file.").prepend(p.logFileName()));
+            p.killLoggerEngine();
+            return false;
+        }
+    }
+
+    fileSize = file->size();
+    maxTime = 0;
+    if (fileSize > QxtBinaryLog::HeaderSize)
+    {
+        // no entry before the last block indexed is later than that block
+        qint64 offset = QxtBinaryLog::HeaderSize;
+        QFile existing(p.indexFileName());
+        if (existing.open(QIODevice::ReadOnly) && existing.size() >= QxtBinaryLog::IndexEntrySize)
+        {
+            existing.seek(existing.size() / QxtBinaryLog::IndexEntrySize * QxtBinaryLog::IndexEntrySize
+                          - QxtBinaryLog::IndexEntrySize);
+            const QByteArray entry = existing.read(QxtBinaryLog::IndexEntrySize);
+            if (entry.size() == QxtBinaryLog::IndexEntrySize)
+            {
+                const qint64 last = qint64(QxtBinaryLog::readInt(reinterpret_cast<const uchar*>(entry.constData()) + 8, 8));
+                if (last > offset && last + 5 <= fileSize && file->seek(last)
+                        && file->read(5).endsWith(char(QxtBinaryLog::BlockRecord)))
+                    offset = last;
+            }
+        }
+        maxTime = latestTime(file, offset);
+    }
+
+    index.close();
+    index.setFileName(p.indexFileName());
+    if (!index.open(QIODevice::WriteOnly | QIODevice::Append))   // the log stays readable without it
+        qxtLog->warning(QString(" could not be opened; the log is written without an index.").prepend(p.indexFileName()));
+    strings.clear();
+    blockEntries = blockSize;
+    return true;
+}
+
+/*******************************************************************************
+Returns the latest time of the blocks and entries from offset to the end of
+the file, reading only the record headers.
+*******************************************************************************/
+qint64 QxtBinaryFileLoggerEnginePrivate::latestTime(QIODevice* file, qint64 offset) const
+{
+    qint64 latest = 0;
+    const qint64 size = file->size();
+    while (offset + 4 + 9 <= size)
+    {
+        file->seek(offset);
+        const QByteArray head = file->read(4 + 9);
+        if (head.size() != 4 + 9) break;
+        const uchar* data = reinterpret_cast<const uchar*>(head.constData());
+        const qint64 length = qint64(QxtBinaryLog::readInt(data, 4));
+        if (length < 1 || offset + 4 + length > size) break;
+        if ((data[4] == QxtBinaryLog::BlockRecord || data[4] == QxtBinaryLog::EntryRecord) && length >= 9)
+            latest = qMax(latest, qint64(QxtBinaryLog::readInt(data + 5, 8)));
+        offset += 4 + length;
+    }
+    file->seek(size);
+    return latest;
+}
+
+void QxtBinaryFileLoggerEnginePrivate::startBlock(QByteArray& out, qint64 time)
+{
+    const qint64 offset = fileSize + out.size();
+    QxtBinaryLog::appendInt(out, 1 + 8, 4);
+    out.append(char(QxtBinaryLog::BlockRecord));
+    QxtBinaryLog::appendInt(out, time, 8);
+
+    if (index.isOpen())
+    {
+        QByteArray entry;
+        QxtBinaryLog::appendInt(entry, time, 8);
+        QxtBinaryLog::appendInt(entry, offset, 8);
+        index.write(entry);
+    }
+    strings.clear();
+    blockEntries = 0;
+}
+
+void QxtBinaryFileLoggerEnginePrivate::appendMessage(QByteArray& out, QByteArray& definitions, const QVariant& message)
+{
+    if (message.type() == QVariant::String)
+    {
+        const QString& text = *reinterpret_cast<const QString*>(message.constData());
+        if (text.size() <= QXT_BINARYLOG_MAX_INTERNED_LENGTH)
+        {
+            QHash<QString, quint32>::const_iterator it = strings.constFind(text);
+            if (it == strings.constEnd() && strings.size() < QXT_BINARYLOG_MAX_INTERNED_STRINGS)
+            {
+                const QByteArray utf8 = text.toUtf8();
+                const quint32 id = strings.size();
+                QxtBinaryLog::appendInt(definitions, 1 + 4 + utf8.size(), 4);
+                definitions.append(char(QxtBinaryLog::StringRecord));
+                QxtBinaryLog::appendInt(definitions, id, 4);
+                definitions.append(utf8);
+                it = strings.insert(text, id);
+            }
+            if (it != strings.constEnd())
+            {
+                out.append(char(QxtBinaryLog::InternedMessage));
+                QxtBinaryLog::appendInt(out, it.value(), 4);
+                return;
+            }
+        }
+        const QByteArray utf8 = text.toUtf8();
+        out.append(char(QxtBinaryLog::TextMessage));
+        QxtBinaryLog::appendInt(out, utf8.size(), 4);
+        out.append(utf8);
+        return;
+    }
+
+    out.append(char(QxtBinaryLog::VariantMessage));
+    QDataStream stream(&out, QIODevice::WriteOnly | QIODevice::Append);
+    stream.setVersion(QDataStream::Qt_4_3);
+    stream << message;
+}
+
+/*!
+    Constructs a binary file logger engine writing to \a fileName.
+ */
+QxtBinaryFileLoggerEngine::QxtBinaryFileLoggerEngine(const QString& fileName)
+        : QxtAbstractFileLoggerEngine(fileName, QIODevice::ReadWrite | QIODevice::Append)
+{
+    QXT_INIT_PRIVATE(QxtBinaryFileLoggerEngine);
+    qxt_d().prepareFile();
+}
+
+/*!
+    Destructs the engine.
+ */
+QxtBinaryFileLoggerEngine::~QxtBinaryFileLoggerEngine()
+{
+    killLoggerEngine();
+}
+
+/*!
+    \reimp
+ */
+void QxtBinaryFileLoggerEngine::initLoggerEngine()
+{
+    QxtAbstractFileLoggerEngine::initLoggerEngine();
+    qxt_d().prepareFile();
+}
+
+/*!
+    \reimp
+ */
+void QxtBinaryFileLoggerEngine::killLoggerEngine()
+{
+    qxt_d().index.close();
+    QxtAbstractFileLoggerEngine::killLoggerEngine();
+}
+
+/*!
+    \reimp
+ */
+void QxtBinaryFileLoggerEngine::writeFormatted(QxtLogger::LogLevel level, const QList<QVariant>& messages)
+{
+    QxtBinaryFileLoggerEnginePrivate& d = qxt_d();
+    QIODevice* file = device();
+    if (!file || messages.isEmpty()) return;
+
+    const QxtLogRecord current = currentRecord();
+    const qint64 time = current.time;
+    QByteArray out;
+    out.reserve(128);
+    if (d.blockEntries >= d.blockSize) d.startBlock(out, qMax(time, d.maxTime));
+    d.blockEntries++;
+    if (time > d.maxTime) d.maxTime = time;
+
+    QByteArray entry;
+    entry.reserve(96);
+    entry.append(char(QxtBinaryLog::EntryRecord));
+    QxtBinaryLog::appendInt(entry, time, 8);
+    entry.append(char(level));
+    QxtBinaryLog::appendInt(entry, current.threadId, 8);
+    QxtBinaryLog::appendInt(entry, qMin(messages.size(), 0xffff), 2);
+    int count = 0;
+    Q_FOREACH(const QVariant& message, messages)
+    {
+        if (++count > 0xffff) break;
+        d.appendMessage(entry, out, message);
+    }
+
+    // string definitions precede the entry that uses them
+    QxtBinaryLog::appendInt(out, entry.size(), 4);
+    out.append(entry);
+    if (file->write(out) == out.size())
+    {
+        d.fileSize += out.size();
+    }
+    else
+    {
+        d.fileSize = file->size();
+        d.blockEntries = d.blockSize;   // interned strings may not have made it
+    }
+
+    if (d.flushLevels & level)
+    {
+        static_cast<QFile*>(file)->flush();
+        d.index.flush();
+    }
+}
+
+/*!
+    \reimp
+
+    Not used; messages are encoded by writeFormatted().
+ */
+void QxtBinaryFileLoggerEngine::writeToFile(const QString& level, const QVariantList& messages)
+{
+    Q_UNUSED(level);
+    Q_UNUSED(messages);
+}
+
+/*!
+    Returns the number of messages per block. The default is 1024.
+
+    Smaller blocks make seeking by time more precise, at the cost of a
+    larger index and of writing interned strings more often.
+ */
+int QxtBinaryFileLoggerEngine::blockSize() const
+{
+    return qxt_d().blockSize;
+}
+
+/*!
+    Sets the number of messages per block to \a entries.
+ */
+void QxtBinaryFileLoggerEngine::setBlockSize(int entries)
+{
+    qxt_d().blockSize = qMax(1, entries);
+}
+
+/*!
+    Returns the levels that are flushed to the file immediately. The default
+    is ErrorLevel, CriticalLevel and FatalLevel.
+ */
+QxtLogger::LogLevels QxtBinaryFileLoggerEngine::flushLevels() const
+{
+    return qxt_d().flushLevels;
+}
+
+/*!
+    Sets the flush \a levels.
+ */
+void QxtBinaryFileLoggerEngine::setFlushLevels(QxtLogger::LogLevels levels)
+{
+    qxt_d().flushLevels = levels;
+}
+
+/*!
+    Returns the name of the index file, which is logFileName() with
+    \c .idx appended.
+ */
+QString QxtBinaryFileLoggerEngine::indexFileName() const
+{
+    return logFileName() + ".idx";
+}
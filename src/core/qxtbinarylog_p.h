@@ -0,0 +1,113 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTBINARYLOG_P_H
+#define QXTBINARYLOG_P_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QDateTime>
+
+#ifndef QXT_DOXYGEN_RUN
+
+/*******************************************************************************
+    Binary log file layout, shared by QxtBinaryFileLoggerEngine and
+    QxtBinaryLogReader. Fixed size fields are little endian.
+
+    file    := header record*
+    header  := "QXTBLOG\0" version:u32 reserved:u32
+    record  := length:u32 type:u8 body            (length counts type + body)
+
+    Block   (type 1) := time:i64
+        Starts a block. The string table is empty at the start of every
+        block, so a reader can begin decoding at any block. The offsets of
+        the blocks are also listed in the index file, <name>.idx, as
+        (time:i64, offset:i64) pairs. Entries are in the order they were
+        written, not the order of their times; the time of a block is the
+        latest time of its first entry and all entries before it, so no
+        entry before a block is later than the block.
+    String  (type 2) := id:u32 utf8
+        Defines string id for the rest of the block.
+    Entry   (type 3) := time:i64 level:u8 thread:u64 count:u16 message*
+
+    message := Variant  (tag 0) QVariant in QDataStream::Qt_4_3 format
+             | Interned (tag 1) id:u32
+             | Text     (tag 2) size:u32 utf8
+*******************************************************************************/
+
+namespace QxtBinaryLog
+{
+    static const char Magic[8] = { 'Q', 'X', 'T', 'B', 'L', 'O', 'G', 0 };
+    enum { Version = 1, HeaderSize = 16, IndexEntrySize = 16 };
+    enum RecordType { BlockRecord = 1, StringRecord = 2, EntryRecord = 3 };
+    enum MessageTag { VariantMessage = 0, InternedMessage = 1, TextMessage = 2 };
+
+    inline void appendInt(QByteArray& out, quint64 value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+            out.append(char(value >> (8 * i)));
+    }
+
+    inline quint64 readInt(const uchar* in, int bytes)
+    {
+        quint64 value = 0;
+        for (int i = bytes - 1; i >= 0; i--)
+            value = (value << 8) | in[i];
+        return value;
+    }
+
+    inline qint64 currentMSecsSinceEpoch()
+    {
+#if QT_VERSION >= 0x040700
+        return QDateTime::currentMSecsSinceEpoch();
+#else
+        const QDateTime now = QDateTime::currentDateTime().toUTC();
+        return qint64(now.toTime_t()) * 1000 + now.time().msec();
+#endif
+    }
+
+    inline QDateTime fromMSecsSinceEpoch(qint64 msecs)
+    {
+#if QT_VERSION >= 0x040700
+        return QDateTime::fromMSecsSinceEpoch(msecs);
+#else
+        QDateTime time = QDateTime::fromTime_t(uint(msecs / 1000));
+        return time.addMSecs(msecs % 1000);
+#endif
+    }
+
+    inline qint64 toMSecsSinceEpoch(const QDateTime& time)
+    {
+#if QT_VERSION >= 0x040700
+        return time.toMSecsSinceEpoch();
+#else
+        return qint64(time.toTime_t()) * 1000 + time.time().msec();
+#endif
+    }
+}
+
+#endif // QXT_DOXYGEN_RUN
+
+#endif // QXTBINARYLOG_P_H
@@ -0,0 +1,451 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include "qxtbinarylogreader.h"
+#include "qxtbinarylog_p.h"
+#include <QDataStream>
+#include <QFile>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+#include <string.h>
+
+/*!
+    \class QxtBinaryLogReader
+    \brief The QxtBinaryLogReader class reads log files written by QxtBinaryFileLoggerEngine.
+    \inmodule QxtCore
+
+    The log file is memory mapped and decoded one message at a time, so
+    even very large logs can be read without loading them. seek() uses the
+    index written next to the log to jump to the last block that only
+    follows earlier messages, then reads forward to the first message at or
+    after a point in time. Without an index
+    file, the reader builds the same sparse index by walking the record
+    headers once when the file is opened.
+
+    \code
+    QxtBinaryLogReader reader("app.blog");
+    reader.seek(QDateTime::currentDateTime().addSecs(-3600));
+    while (reader.readNext())
+    {
+        if (reader.level() >= QxtLogger::WarningLevel)
+            qDebug() << reader.toString();
+    }
+    \endcode
+
+    Messages are read in the order they were written. A message staged in a
+    batch or queued for the asynchronous writer thread of QxtLogger can be
+    written after messages logged later, so timestamp() does not always
+    increase; to read the messages of a time range, check timestamp() of
+    every message up to the end of the log.
+
+    A message that is still being written when the file is opened, or that
+    was cut short by a crash, ends the log.
+
+    \sa QxtBinaryFileLoggerEngine
+ */
+
+class QxtBinaryLogReaderPrivate : public QxtPrivate<QxtBinaryLogReader>
+{
+    QXT_DECLARE_PUBLIC(QxtBinaryLogReader)
+
+public:
+    QxtBinaryLogReaderPrivate();
+
+    void loadIndex();
+    void buildIndex();
+    bool next();
+    bool decodeEntry(const uchar* body, int size);
+
+    QFile file;
+    const uchar* data;
+    qint64 size;
+    qint64 pos;
+    bool pending;
+    QString error;
+    QVector<QPair<qint64, qint64> > index;  // block time, block offset
+    QVector<QString> strings;
+
+    qint64 time;
+    QxtLogger::LogLevel level;
+    quint64 thread;
+    QList<QVariant> messages;
+};
+
+QxtBinaryLogReaderPrivate::QxtBinaryLogReaderPrivate()
+        : data(0), size(0), pos(0), pending(false), time(0), level(QxtLogger::NoLevels), thread(0)
+{
+}
+
+void QxtBinaryLogReaderPrivate::loadIndex()
+{
+    index.clear();
+    QFile indexFile(file.fileName() + ".idx");
+    if (indexFile.open(QIODevice::ReadOnly))
+    {
+        const QByteArray raw = indexFile.readAll();
+        const uchar* entry = reinterpret_cast<const uchar*>(raw.constData());
+        qint64 last = 0;
+        for (int i = 0; i + QxtBinaryLog::IndexEntrySize <= raw.size(); i += QxtBinaryLog::IndexEntrySize)
+        {
+            const qint64 blockTime = qint64(QxtBinaryLog::readInt(entry + i, 8));
+            const qint64 offset = qint64(QxtBinaryLog::readInt(entry + i + 8, 8));
+            // ignore anything that does not point at a block of this file
+            if (offset <= last || offset + 5 > size || data[offset + 4] != QxtBinaryLog::BlockRecord)
+                continue;
+            index.append(qMakePair(blockTime, offset));
+            last = offset;
+        }
+    }
+    if (index.isEmpty()) buildIndex();
+}
+
+void QxtBinaryLogReaderPrivate::buildIndex()
+{
+    qint64 at = QxtBinaryLog::HeaderSize;
+    while (at + 5 <= size)
+    {
+        const qint64 length = qint64(QxtBinaryLog::readInt(data + at, 4));
+        if (length < 1 || at + 4 + length > size) break;
+        if (data[at + 4] == QxtBinaryLog::BlockRecord && length >= 9)
+            index.append(qMakePair(qint64(QxtBinaryLog::readInt(data + at + 5, 8)), at));
+        at += 4 + length;
+    }
+}
+
+bool QxtBinaryLogReaderPrivate::next()
+{
+    while (data && pos + 5 <= size)
+    {
+        const qint64 length = qint64(QxtBinaryLog::readInt(data + pos, 4));
+        if (length < 1 || pos + 4 + length > size) break;     // cut short
+        const uchar* body = data + pos + 4;
+        pos += 4 + length;
+
+        switch (body[0])
+        {
+        case QxtBinaryLog::BlockRecord:
+            strings.clear();
+            break;
+        case QxtBinaryLog::StringRecord:
+            if (length >= 5)
+            {
+                const int id = int(QxtBinaryLog::readInt(body + 1, 4));
+                if (id >= strings.size()) strings.resize(id + 1);
+                strings[id] = QString::fromUtf8(reinterpret_cast<const char*>(body + 5), int(length - 5));
+            }
+            break;
+        case QxtBinaryLog::EntryRecord:
+            if (decodeEntry(body + 1, int(length - 1))) return true;
+            error = QxtBinaryLogReader::tr("Skipped a corrupt record at offset %1").arg(pos - 4 - length);
+            break;
+        default:
+            break;  // unknown record type from a newer writer
+        }
+    }
+    return false;
+}
+
+bool QxtBinaryLogReaderPrivate::decodeEntry(const uchar* body, int length)
+{
+    if (length < 19) return false;
+    time = qint64(QxtBinaryLog::readInt(body, 8));
+    level = QxtLogger::LogLevel(body[8]);
+    thread = QxtBinaryLog::readInt(body + 9, 8);
+    const int count = int(QxtBinaryLog::readInt(body + 17, 2));
+    messages.clear();
+
+    int at = 19;
+    for (int i = 0; i < count; i++)
+    {
+        if (at >= length) return false;
+        const uchar tag = body[at++];
+        if (tag == QxtBinaryLog::InternedMessage)
+        {
+            if (at + 4 > length) return false;
+            messages.append(strings.value(int(QxtBinaryLog::readInt(body + at, 4))));
+            at += 4;
+        }
+        else if (tag == QxtBinaryLog::TextMessage)
+        {
+            if (at + 4 > length) return false;
+            const int textSize = int(QxtBinaryLog::readInt(body + at, 4));
+            at += 4;
+            if (textSize < 0 || at + textSize > length) return false;
+            messages.append(QString::fromUtf8(reinterpret_cast<const char*>(body + at), textSize));
+            at += textSize;
+        }
+        else if (tag == QxtBinaryLog::VariantMessage)
+        {
+            const QByteArray raw = QByteArray::fromRawData(reinterpret_cast<const char*>(body + at), length - at);
+            QDataStream stream(raw);
+            stream.setVersion(QDataStream::Qt_4_3);
+            QVariant value;
+            stream >> value;
+            if (stream.status() != QDataStream::Ok) return false;
+            messages.append(value);
+            at += int(stream.device()->pos());
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+    Constructs a reader without a file.
+ */
+QxtBinaryLogReader::QxtBinaryLogReader()
+{
+    QXT_INIT_PRIVATE(QxtBinaryLogReader);
+}
+
+/*!
+    Constructs a reader and opens \a fileName.
+ */
+QxtBinaryLogReader::QxtBinaryLogReader(const QString& fileName)
+{
+    QXT_INIT_PRIVATE(QxtBinaryLogReader);
+    open(fileName);
+}
+
+/*!
+    Destructs the reader.
+ */
+QxtBinaryLogReader::~QxtBinaryLogReader()
+{
+    close();
+}
+
+/*!
+    Opens and maps the log \a fileName and positions the reader before its
+    first message. Returns \c true on success.
+
+    \sa errorString()
+ */
+bool QxtBinaryLogReader::open(const QString& fileName)
+{
+    QxtBinaryLogReaderPrivate& d = qxt_d();
+    close();
+    d.file.setFileName(fileName);
+    if (!d.file.open(QIODevice::ReadOnly))
+    {
+        d.error = d.file.errorString();
+        return false;
+    }
+    d.size = d.file.size();
+    if (d.size < QxtBinaryLog::HeaderSize)
+    {
+        d.error = tr("%1 is not a binary log file").arg(fileName);
+        close();
+        return false;
+    }
+    d.data = d.file.map(0, d.size);
+    if (!d.data)
+    {
+        d.error = d.file.errorString();
+        close();
+        return false;
+    }
+    if (memcmp(d.data, QxtBinaryLog::Magic, sizeof QxtBinaryLog::Magic) != 0
+            || QxtBinaryLog::readInt(d.data + 8, 4) > QxtBinaryLog::Version)
+    {
+        d.error = tr("%1 is not a binary log file").arg(fileName);
+        close();
+        return false;
+    }
+    d.error.clear();
+    d.loadIndex();
+    rewind();
+    return true;
+}
+
+/*!
+    Unmaps and closes the log file.
+ */
+void QxtBinaryLogReader::close()
+{
+    QxtBinaryLogReaderPrivate& d = qxt_d();
+    if (d.data) d.file.unmap(const_cast<uchar*>(d.data));
+    d.data = 0;
+    d.size = 0;
+    d.pos = 0;
+    d.pending = false;
+    d.index.clear();
+    d.strings.clear();
+    d.messages.clear();
+    d.file.close();
+}
+
+/*!
+    Returns \c true if a log file is open.
+ */
+bool QxtBinaryLogReader::isOpen() const
+{
+    return qxt_d().data != 0;
+}
+
+/*!
+    Returns the name of the log file.
+ */
+QString QxtBinaryLogReader::fileName() const
+{
+    return qxt_d().file.fileName();
+}
+
+/*!
+    Returns a description of the last error.
+ */
+QString QxtBinaryLogReader::errorString() const
+{
+    return qxt_d().error;
+}
+
+/*!
+    Positions the reader before the first message.
+ */
+void QxtBinaryLogReader::rewind()
+{
+    QxtBinaryLogReaderPrivate& d = qxt_d();
+    d.pos = QxtBinaryLog::HeaderSize;
+    d.pending = false;
+    d.strings.clear();
+}
+
+/*!
+    Positions the reader so that the next call to readNext() returns the
+    first message in the file logged at or after \a time. Returns \c false
+    if there is no such message.
+
+    Messages read after it may have been logged before \a time; see the
+    class description.
+ */
+bool QxtBinaryLogReader::seek(const QDateTime& time)
+{
+    QxtBinaryLogReaderPrivate& d = qxt_d();
+    if (!d.data) return false;
+    const qint64 target = QxtBinaryLog::toMSecsSinceEpoch(time);
+
+    // last block before the target; nothing before it is later than its time
+    int first = 0, last = d.index.size();
+    while (first < last)
+    {
+        const int middle = (first + last) / 2;
+        if (d.index.at(middle).first < target)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    rewind();
+    if (first > 0) d.pos = d.index.at(first - 1).second;
+
+    while (d.next())
+    {
+        if (d.time >= target)
+        {
+            d.pending = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+    Reads the next message. Returns \c false at the end of the log.
+ */
+bool QxtBinaryLogReader::readNext()
+{
+    QxtBinaryLogReaderPrivate& d = qxt_d();
+    if (d.pending)
+    {
+        d.pending = false;
+        return true;
+    }
+    return d.next();
+}
+
+/*!
+    Returns the time of the current message in milliseconds since
+    1970-01-01T00:00:00 UTC.
+ */
+qint64 QxtBinaryLogReader::msecsSinceEpoch() const
+{
+    return qxt_d().time;
+}
+
+/*!
+    Returns the time of the current message.
+ */
+QDateTime QxtBinaryLogReader::timestamp() const
+{
+    return QxtBinaryLog::fromMSecsSinceEpoch(qxt_d().time);
+}
+
+/*!
+    Returns the level of the current message.
+ */
+QxtLogger::LogLevel QxtBinaryLogReader::level() const
+{
+    return qxt_d().level;
+}
+
+/*!
+    Returns the id of the thread that logged the current message.
+ */
+quint64 QxtBinaryLogReader::threadId() const
+{
+    return qxt_d().thread;
+}
+
+/*!
+    Returns the arguments of the current message.
+ */
+QList<QVariant> QxtBinaryLogReader::messages() const
+{
+    return qxt_d().messages;
+}
+
+/*!
+    Returns the current message as a line of text:
+    \code
+    2009-05-14 22:38:33.159 [Error] [0x7f2a1c000b40] Unknown error
+    \endcode
+ */
+QString QxtBinaryLogReader::toString() const
+{
+    const QxtBinaryLogReaderPrivate& d = qxt_d();
+    QString name = QxtLogger::logLevelToString(d.level);
+    if (name.endsWith("Level")) name.chop(5);
+    QStringList parts;
+    Q_FOREACH(const QVariant& message, d.messages)
+        parts.append(message.toString());
+    return QString("%1 [%2] [0x%3] %4")
+           .arg(timestamp().toString("yyyy-MM-dd hh:mm:ss.zzz"))
+           .arg(name)
+           .arg(d.thread, 0, 16)
+           .arg(parts.join(" "));
+}
@@ -0,0 +1,70 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTBINARYLOGREADER_H
+#define QXTBINARYLOGREADER_H
+
+#include <QCoreApplication>     // for Q_DECLARE_TR_FUNCTIONS
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include <QVariant>
+#include "qxtglobal.h"
+#include "qxtlogger.h"
+
+class QxtBinaryLogReaderPrivate;
+
+class QXT_CORE_EXPORT QxtBinaryLogReader
+{
+    QXT_DECLARE_PRIVATE(QxtBinaryLogReader)
+    Q_DECLARE_TR_FUNCTIONS(QxtBinaryLogReader)
+
+public:
+    QxtBinaryLogReader();
+    explicit QxtBinaryLogReader(const QString& fileName);
+    ~QxtBinaryLogReader();
+
+    bool open(const QString& fileName);
+    void close();
+    bool isOpen() const;
+    QString fileName() const;
+    QString errorString() const;
+
+    void rewind();
+    bool seek(const QDateTime& time);
+    bool readNext();
+
+    qint64 msecsSinceEpoch() const;
+    QDateTime timestamp() const;
+    QxtLogger::LogLevel level() const;
+    quint64 threadId() const;
+    QList<QVariant> messages() const;
+    QString toString() const;
+
+private:
+    Q_DISABLE_COPY(QxtBinaryLogReader)
+};
+
+#endif // QXTBINARYLOGREADER_H
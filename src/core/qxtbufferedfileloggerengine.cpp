@@ -0,0 +1,598 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include "qxtbufferedfileloggerengine.h"
+#include "qxtbufferedfileloggerengine_p.h"
+#include <QFile>
+#include <QMutexLocker>
+
+#if defined(Q_OS_UNIX)
+#   include <stdio.h>
+#   include <unistd.h>
+#elif defined(Q_OS_WIN)
+#   include <qt_windows.h>
+#   include <io.h>
+#endif
+
+/*!
+    \class QxtBufferedFileLoggerEngine
+    \brief The QxtBufferedFileLoggerEngine class provides a buffered, rotating file logger engine.
+    \inmodule QxtCore
+
+    QxtBufferedFileLoggerEngine writes the same format as QxtBasicFileLoggerEngine,
+    but collects messages in memory and writes them to the file in one call
+    when the buffer is full, when flushInterval() has passed, or when a
+    message of one of the flushLevels() arrives.
+
+    The log file is rotated when it reaches maximumFileSize() or at the
+    start of each rotationPeriod(): \c app.log becomes \c app.log.1,
+    \c app.log.1 becomes \c app.log.2 and so on, up to backupCount() files.
+    Rotated files are renamed atomically and, if compressBackups() is set,
+    gzipped by a background thread to \c app.log.1.gz.
+
+    How often the file is forced to disk is controlled by syncPolicy().
+
+    \code
+    QxtBufferedFileLoggerEngine* engine = new QxtBufferedFileLoggerEngine("app.log");
+    engine->setMaximumFileSize(16 * 1024 * 1024);
+    engine->setCompressBackups(true);
+    qxtLog->addLoggerEngine("file", engine);
+    \endcode
+
+    The flush interval is driven by a timer running in the thread that
+    created the engine. If that thread has no event loop, the interval is
+    only checked when the next message is written.
+
+    \sa QxtLogger, QxtBasicFileLoggerEngine
+ */
+
+static bool qxtReplaceFile(const QString& from, const QString& to)
+{
+#if defined(Q_OS_UNIX)
+    return ::rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+#elif defined(Q_OS_WIN)
+    return MoveFileExW(reinterpret_cast<const wchar_t*>(from.utf16()),
+                       reinterpret_cast<const wchar_t*>(to.utf16()),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    QFile::remove(to);
+    return QFile::rename(from, to);
+#endif
+}
+
+class QxtCrc32Table
+{
+public:
+    QxtCrc32Table()
+    {
+        for (quint32 i = 0; i < 256; i++)
+        {
+            quint32 c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+    }
+    quint32 table[256];
+};
+
+static quint32 qxtCrc32(const char* data, int size)
+{
+    static const QxtCrc32Table crc;
+    quint32 c = 0xffffffffu;
+    const uchar* p = reinterpret_cast<const uchar*>(data);
+    for (int i = 0; i < size; i++)
+        c = crc.table[(c ^ p[i]) & 0xff] ^ (c >> 8);
+    return c ^ 0xffffffffu;
+}
+
+/*******************************************************************************
+Writes one gzip (RFC 1952) member holding data. qCompress() produces a zlib
+stream behind a four byte length; the raw deflate data inside it is wrapped in
+a gzip header and trailer so that the result can be read with standard tools.
+*******************************************************************************/
+static bool qxtWriteGzipMember(QIODevice* out, const char* data, int size)
+{
+    static const char header[10] = { 0x1f, char(0x8b), 8, 0, 0, 0, 0, 0, 0, char(0xff) };
+    if (out->write(header, sizeof header) != sizeof header) return false;
+
+    if (size > 0)
+    {
+        const QByteArray zlib = qCompress(reinterpret_cast<const uchar*>(data), size, 6);
+        if (zlib.size() < 10) return false;
+        const int deflated = zlib.size() - 10;      // length, zlib header / adler32
+        if (out->write(zlib.constData() + 6, deflated) != deflated) return false;
+    }
+    else
+    {
+        if (out->write("\x03\x00", 2) != 2) return false;    // a single empty final block
+    }
+
+    const quint32 crc = qxtCrc32(data, size);
+    char trailer[8];
+    for (int i = 0; i < 4; i++)
+    {
+        trailer[i] = char(crc >> (8 * i));
+        trailer[i + 4] = char(quint32(size) >> (8 * i));
+    }
+    return out->write(trailer, sizeof trailer) == sizeof trailer;
+}
+
+QxtLogCompressor::QxtLogCompressor(const QString& fileName) : fileName(fileName)
+{
+}
+
+void QxtLogCompressor::run()
+{
+    const QString target = fileName + ".gz";
+    const QString temporary = target + ".tmp";
+    if (gzipFile(fileName, temporary) && qxtReplaceFile(temporary, target))
+        QFile::remove(fileName);
+    else
+        QFile::remove(temporary);
+}
+
+/*******************************************************************************
+Writes a gzip copy of source. The file is compressed ChunkSize bytes at a time,
+each chunk as a gzip member of its own, so memory use does not grow with the
+size of the file. gzip readers decompress concatenated members as one stream.
+*******************************************************************************/
+bool QxtLogCompressor::gzipFile(const QString& source, const QString& target)
+{
+    QFile in(source);
+    if (!in.open(QIODevice::ReadOnly)) return false;
+    QFile out(target);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    QByteArray chunk;
+    chunk.resize(ChunkSize);
+    qint64 size;
+    do
+    {
+        size = in.read(chunk.data(), ChunkSize);
+        if (size < 0 || !qxtWriteGzipMember(&out, chunk.constData(), int(size))) return false;
+    }
+    while (size > 0 && !in.atEnd());
+    out.close();
+    return out.error() == QFile::NoError;
+}
+
+QxtBufferedFileLoggerEnginePrivate::QxtBufferedFileLoggerEnginePrivate()
+        : bufferSize(64 * 1024), flushInterval(1000),
+        flushLevels(QxtLogger::ErrorLevel | QxtLogger::CriticalLevel | QxtLogger::FatalLevel),
+        fileSize(0), maximumFileSize(0), rotationPeriod(QxtBufferedFileLoggerEngine::NoRotation),
+        backupCount(5), compressBackups(false), syncPolicy(QxtBufferedFileLoggerEngine::SyncOnRotate),
+        compressor(0), mutex(QMutex::Recursive)
+{
+    buffer.reserve(bufferSize);
+    lastFlush.start();
+    connect(&timer, SIGNAL(timeout()), this, SLOT(timeout()));
+}
+
+QxtBufferedFileLoggerEnginePrivate::~QxtBufferedFileLoggerEnginePrivate()
+{
+    waitForCompressor();
+}
+
+void QxtBufferedFileLoggerEnginePrivate::flushBuffer(bool sync)
+{
+    QIODevice* file = qxt_p().device();
+    if (!buffer.isEmpty() && file)
+    {
+        const qint64 written = file->write(buffer);
+        if (written > 0) fileSize += written;
+    }
+    buffer.resize(0);
+    const int keep = qMax(bufferSize, 4096);
+    if (buffer.capacity() > 4 * keep)
+        buffer.squeeze();       // give back the memory of an unusually large burst
+    buffer.reserve(keep);
+    if (sync) syncFile();
+    lastFlush.restart();
+}
+
+void QxtBufferedFileLoggerEnginePrivate::syncFile()
+{
+    QFile* file = static_cast<QFile*>(qxt_p().device());
+    if (!file || !file->isOpen()) return;
+    file->flush();
+#if defined(Q_OS_UNIX)
+    ::fsync(file->handle());
+#elif defined(Q_OS_WIN)
+    ::_commit(file->handle());
+#endif
+}
+
+bool QxtBufferedFileLoggerEnginePrivate::needsRotation(const QDateTime& now) const
+{
+    const qint64 size = fileSize + buffer.size();
+    if (maximumFileSize > 0 && size >= maximumFileSize && size > 0) return true;
+    return nextRotation.isValid() && now >= nextRotation;
+}
+
+void QxtBufferedFileLoggerEnginePrivate::scheduleNextRotation()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    switch (rotationPeriod)
+    {
+    case QxtBufferedFileLoggerEngine::RotateHourly:
+        nextRotation = QDateTime(now.date(), QTime(now.time().hour(), 0)).addSecs(3600);
+        break;
+    case QxtBufferedFileLoggerEngine::RotateDaily:
+        nextRotation = QDateTime(now.date().addDays(1), QTime(0, 0));
+        break;
+    default:
+        nextRotation = QDateTime();
+        break;
+    }
+}
+
+QString QxtBufferedFileLoggerEnginePrivate::backupName(int index, bool compressed) const
+{
+    QString name = qxt_p().logFileName() + '.' + QString::number(index);
+    if (compressed) name += ".gz";
+    return name;
+}
+
+void QxtBufferedFileLoggerEnginePrivate::waitForCompressor()
+{
+    if (!compressor) return;
+    compressor->wait();
+    delete compressor;
+    compressor = 0;
+}
+
+/*******************************************************************************
+Closes the log file, shifts the backups up by one and starts a new file.
+Renames replace their target atomically, so a reader always finds either the
+old or the new file under each name.
+*******************************************************************************/
+void QxtBufferedFileLoggerEnginePrivate::rotateFile()
+{
+    QxtBufferedFileLoggerEngine& p = qxt_p();
+    if (!p.device()) return;
+    flushBuffer(syncPolicy >= QxtBufferedFileLoggerEngine::SyncOnRotate);
+    p.QxtAbstractFileLoggerEngine::killLoggerEngine();
+
+    // the previous backup must be complete before the names move
+    waitForCompressor();
+
+    const QString fileName = p.logFileName();
+    for (int i = backupCount; i >= 1; --i)
+    {
+        for (int compressed = 0; compressed < 2; compressed++)
+        {
+            const QString from = backupName(i, compressed);
+            if (!QFile::exists(from)) continue;
+            if (i == backupCount)
+                QFile::remove(from);
+            else
+                qxtReplaceFile(from, backupName(i + 1, compressed));
+        }
+    }
+
+    if (backupCount > 0 && qxtReplaceFile(fileName, backupName(1, false)))
+    {
+        if (compressBackups)
+        {
+            compressor = new QxtLogCompressor(backupName(1, false));
+            compressor->start(QThread::LowPriority);
+        }
+    }
+    else
+    {
+        QFile::remove(fileName);
+    }
+
+    reopen();
+}
+
+bool QxtBufferedFileLoggerEnginePrivate::reopen()
+{
+    QxtBufferedFileLoggerEngine& p = qxt_p();
+    QFile* file = new QFile(p.logFileName());
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered))
+    {
+        delete file;
+        return false;
+    }
+    p.setDevice(file);
+    fileSize = file->size();
+    scheduleNextRotation();
+    return true;
+}
+
+void QxtBufferedFileLoggerEnginePrivate::timeout()
+{
+    QMutexLocker lock(&mutex);
+    if (!buffer.isEmpty()) flushBuffer(syncPolicy == QxtBufferedFileLoggerEngine::SyncOnFlush);
+}
+
+/*!
+    Constructs a buffered file logger engine with \a fileName.
+*/
+QxtBufferedFileLoggerEngine::QxtBufferedFileLoggerEngine(const QString &fileName)
+        : QxtAbstractFileLoggerEngine(fileName, QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)
+{
+    QXT_INIT_PRIVATE(QxtBufferedFileLoggerEngine);
+    if (device())
+    {
+        qxt_d().fileSize = device()->size();
+        qxt_d().scheduleNextRotation();
+    }
+    qxt_d().timer.start(qxt_d().flushInterval);
+}
+
+/*!
+    Destructs the engine, writing any buffered messages.
+*/
+QxtBufferedFileLoggerEngine::~QxtBufferedFileLoggerEngine()
+{
+    killLoggerEngine();
+}
+
+/*!
+    \reimp
+ */
+void QxtBufferedFileLoggerEngine::initLoggerEngine()
+{
+    // not under the engine lock: enabling the engine calls back into QxtLogger
+    QxtAbstractFileLoggerEngine::initLoggerEngine();
+
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().fileSize = device() ? device()->size() : 0;
+    qxt_d().scheduleNextRotation();
+}
+
+/*!
+    \reimp
+ */
+void QxtBufferedFileLoggerEngine::killLoggerEngine()
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().flushBuffer(qxt_d().syncPolicy >= SyncOnRotate);
+    QxtAbstractFileLoggerEngine::killLoggerEngine();
+}
+
+/*!
+    \reimp
+ */
+void QxtBufferedFileLoggerEngine::writeFormatted(QxtLogger::LogLevel level, const QList<QVariant> &messages)
+{
+    QxtBufferedFileLoggerEnginePrivate& d = qxt_d();
+    QMutexLocker lock(&d.mutex);
+    if (!device()) return;
+
+    QxtAbstractFileLoggerEngine::writeFormatted(level, messages);
+
+    if (d.flushLevels & level)
+        d.flushBuffer(d.syncPolicy >= SyncOnFlushLevel);
+    else if (d.buffer.size() >= d.bufferSize || (d.flushInterval > 0 && d.lastFlush.elapsed() >= d.flushInterval))
+        d.flushBuffer(d.syncPolicy == SyncOnFlush);
+}
+
+/*!
+    \reimp
+ */
+void QxtBufferedFileLoggerEngine::writeToFile(const QString &level, const QVariantList &messages)
+{
+    if (messages.isEmpty()) return;
+    QxtBufferedFileLoggerEnginePrivate& d = qxt_d();
+    const QxtLogRecord current = currentRecord();
+    const QDateTime now = current.dateTime();
+    if (d.needsRotation(now)) d.rotateFile();
+
+    const QString thread = qxtLog->isThreadTaggingEnabled() ? current.threadTag() : QString();
+    d.formatter.appendRecord(d.buffer, now, level, messages, thread);
+}
+
+/*!
+    Writes all buffered messages to the file now.
+ */
+void QxtBufferedFileLoggerEngine::flush()
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().flushBuffer(qxt_d().syncPolicy == SyncOnFlush);
+}
+
+/*!
+    Rotates the log file now, regardless of its size and the rotation period.
+ */
+void QxtBufferedFileLoggerEngine::rotate()
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().rotateFile();
+}
+
+/*!
+    Returns the date format in use by this logger engine.
+    \sa QDateTime::toString()
+ */
+QString QxtBufferedFileLoggerEngine::dateFormat() const
+{
+    return qxt_d().formatter.dateFormat();
+}
+
+/*!
+    Sets the date \a format used by this logger engine.
+    \sa QDateTime::toString()
+ */
+void QxtBufferedFileLoggerEngine::setDateFormat(const QString& format)
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().formatter.setDateFormat(format);
+}
+
+/*!
+    Returns the number of bytes collected before they are written to the file.
+    The default is 64 KiB.
+ */
+int QxtBufferedFileLoggerEngine::bufferSize() const
+{
+    return qxt_d().bufferSize;
+}
+
+/*!
+    Sets the buffer size to \a bytes. A size of 0 writes every message
+    immediately.
+ */
+void QxtBufferedFileLoggerEngine::setBufferSize(int bytes)
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().bufferSize = qMax(0, bytes);
+    if (qxt_d().buffer.size() >= qxt_d().bufferSize) qxt_d().flushBuffer(qxt_d().syncPolicy == SyncOnFlush);
+    qxt_d().buffer.reserve(qxt_d().bufferSize);
+}
+
+/*!
+    Returns the longest time, in milliseconds, that a message stays in the
+    buffer. The default is 1000.
+ */
+int QxtBufferedFileLoggerEngine::flushInterval() const
+{
+    return qxt_d().flushInterval;
+}
+
+/*!
+    Sets the flush interval to \a msecs. An interval of 0 disables time
+    based flushing. This function must be called from the thread that
+    created the engine.
+ */
+void QxtBufferedFileLoggerEngine::setFlushInterval(int msecs)
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().flushInterval = qMax(0, msecs);
+    if (qxt_d().flushInterval > 0)
+        qxt_d().timer.start(qxt_d().flushInterval);
+    else
+        qxt_d().timer.stop();
+}
+
+/*!
+    Returns the levels that cause the buffer to be written immediately.
+    The default is ErrorLevel, CriticalLevel and FatalLevel.
+ */
+QxtLogger::LogLevels QxtBufferedFileLoggerEngine::flushLevels() const
+{
+    return qxt_d().flushLevels;
+}
+
+/*!
+    Sets the flush \a levels.
+ */
+void QxtBufferedFileLoggerEngine::setFlushLevels(QxtLogger::LogLevels levels)
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().flushLevels = levels;
+}
+
+/*!
+    Returns the size in bytes at which the log file is rotated, or 0 if it
+    is not rotated by size. The default is 0.
+ */
+qint64 QxtBufferedFileLoggerEngine::maximumFileSize() const
+{
+    return qxt_d().maximumFileSize;
+}
+
+/*!
+    Sets the maximum file size to \a bytes.
+ */
+void QxtBufferedFileLoggerEngine::setMaximumFileSize(qint64 bytes)
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().maximumFileSize = qMax(qint64(0), bytes);
+}
+
+/*!
+    Returns the period at which the log file is rotated. The default is
+    NoRotation.
+ */
+QxtBufferedFileLoggerEngine::RotationPeriod QxtBufferedFileLoggerEngine::rotationPeriod() const
+{
+    return qxt_d().rotationPeriod;
+}
+
+/*!
+    Sets the rotation \a period.
+ */
+void QxtBufferedFileLoggerEngine::setRotationPeriod(RotationPeriod period)
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().rotationPeriod = period;
+    qxt_d().scheduleNextRotation();
+}
+
+/*!
+    Returns the number of rotated files kept. The default is 5.
+ */
+int QxtBufferedFileLoggerEngine::backupCount() const
+{
+    return qxt_d().backupCount;
+}
+
+/*!
+    Sets the number of rotated files kept to \a count. With a count of 0 the
+    log file is truncated instead of rotated.
+ */
+void QxtBufferedFileLoggerEngine::setBackupCount(int count)
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().backupCount = qMax(0, count);
+}
+
+/*!
+    Returns \c true if rotated files are gzipped. The default is \c false.
+ */
+bool QxtBufferedFileLoggerEngine::compressBackups() const
+{
+    return qxt_d().compressBackups;
+}
+
+/*!
+    Sets whether rotated files are gzipped in the background to \a enable.
+ */
+void QxtBufferedFileLoggerEngine::setCompressBackups(bool enable)
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().compressBackups = enable;
+}
+
+/*!
+    Returns when the log file is forced to disk. The default is SyncOnRotate.
+ */
+QxtBufferedFileLoggerEngine::SyncPolicy QxtBufferedFileLoggerEngine::syncPolicy() const
+{
+    return qxt_d().syncPolicy;
+}
+
+/*!
+    Sets the sync \a policy.
+ */
+void QxtBufferedFileLoggerEngine::setSyncPolicy(SyncPolicy policy)
+{
+    QMutexLocker lock(&qxt_d().mutex);
+    qxt_d().syncPolicy = policy;
+}
@@ -0,0 +1,95 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTBUFFEREDFILELOGGERENGINE_H
+#define QXTBUFFEREDFILELOGGERENGINE_H
+
+#include "qxtabstractfileloggerengine.h"
+
+/*******************************************************************************
+    QxtBufferedFileLoggerEngine
+    A file logger engine that batches writes and rotates its file.
+*******************************************************************************/
+
+class QxtBufferedFileLoggerEnginePrivate;
+class QXT_CORE_EXPORT QxtBufferedFileLoggerEngine : public QxtAbstractFileLoggerEngine
+{
+public:
+    enum RotationPeriod
+    {
+        NoRotation,         /**< Only rotate by size */
+        RotateHourly,       /**< Rotate at the start of every hour */
+        RotateDaily         /**< Rotate at midnight */
+    };
+
+    enum SyncPolicy
+    {
+        NoSync,             /**< Leave it to the operating system to write the data to disk */
+        SyncOnRotate,       /**< Sync before a file is rotated or closed */
+        SyncOnFlushLevel,   /**< Also sync after messages of a flush level */
+        SyncOnFlush         /**< Sync after every flush */
+    };
+
+    QxtBufferedFileLoggerEngine(const QString &fileName = QString());
+    ~QxtBufferedFileLoggerEngine();
+
+    virtual void    initLoggerEngine();
+    virtual void    killLoggerEngine();
+    virtual void    writeFormatted(QxtLogger::LogLevel level, const QList<QVariant> &messages);
+
+    void flush();
+
+    QString dateFormat() const;
+    void setDateFormat(const QString& format);
+
+    int bufferSize() const;
+    void setBufferSize(int bytes);
+    int flushInterval() const;
+    void setFlushInterval(int msecs);
+    QxtLogger::LogLevels flushLevels() const;
+    void setFlushLevels(QxtLogger::LogLevels levels);
+
+    qint64 maximumFileSize() const;
+    void setMaximumFileSize(qint64 bytes);
+    RotationPeriod rotationPeriod() const;
+    void setRotationPeriod(RotationPeriod period);
+    int backupCount() const;
+    void setBackupCount(int count);
+    bool compressBackups() const;
+    void setCompressBackups(bool enable);
+
+    SyncPolicy syncPolicy() const;
+    void setSyncPolicy(SyncPolicy policy);
+
+    void rotate();
+
+protected:
+    virtual void writeToFile(const QString &level, const QVariantList &messages);
+
+private:
+    QXT_DECLARE_PRIVATE(QxtBufferedFileLoggerEngine)
+};
+
+#endif // QXTBUFFEREDFILELOGGERENGINE_H
@@ -0,0 +1,101 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTBUFFEREDFILELOGGERENGINE_P_H
+#define QXTBUFFEREDFILELOGGERENGINE_P_H
+
+#include "qxtbufferedfileloggerengine.h"
+#include "qxtlogrecordformatter_p.h"
+#include <QByteArray>
+#include <QDateTime>
+#include <QMutex>
+#include <QThread>
+#include <QTime>
+#include <QTimer>
+
+#ifndef QXT_DOXYGEN_RUN
+
+/*******************************************************************************
+    QxtLogCompressor
+    Gzips a rotated log file in the background and replaces it with the
+    compressed copy.
+*******************************************************************************/
+class QxtLogCompressor : public QThread
+{
+public:
+    QxtLogCompressor(const QString& fileName);
+
+    enum { ChunkSize = 1024 * 1024 };
+    static bool gzipFile(const QString& source, const QString& target);
+
+protected:
+    virtual void run();
+
+private:
+    QString fileName;
+};
+
+class QxtBufferedFileLoggerEnginePrivate : public QObject, public QxtPrivate<QxtBufferedFileLoggerEngine>
+{
+    Q_OBJECT
+    QXT_DECLARE_PUBLIC(QxtBufferedFileLoggerEngine)
+
+public:
+    QxtBufferedFileLoggerEnginePrivate();
+    ~QxtBufferedFileLoggerEnginePrivate();
+
+    void flushBuffer(bool sync);
+    void syncFile();
+    bool needsRotation(const QDateTime& now) const;
+    void rotateFile();
+    bool reopen();
+    void scheduleNextRotation();
+    QString backupName(int index, bool compressed) const;
+    void waitForCompressor();
+
+    QByteArray buffer;  // unwritten records, formatted in place
+    QxtLogRecordFormatter formatter;
+    int bufferSize;
+    int flushInterval;
+    QTime lastFlush;
+    QxtLogger::LogLevels flushLevels;
+    qint64 fileSize;
+    qint64 maximumFileSize;
+    QxtBufferedFileLoggerEngine::RotationPeriod rotationPeriod;
+    QDateTime nextRotation;
+    int backupCount;
+    bool compressBackups;
+    QxtBufferedFileLoggerEngine::SyncPolicy syncPolicy;
+    QxtLogCompressor* compressor;
+    QTimer timer;
+    QMutex mutex;
+
+public Q_SLOTS:
+    void timeout();
+};
+
+#endif // QXT_DOXYGEN_RUN
+
+#endif // QXTBUFFEREDFILELOGGERENGINE_P_H
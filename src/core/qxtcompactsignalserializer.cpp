@@ -0,0 +1,450 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include <qxtcompactsignalserializer.h>
+#include <QIODevice>
+#include <QDataStream>
+#include <QtGlobal>
+#include <qendian.h>
+#include <string.h>
+
+/*
+ * A message is a frame: the length of the body as a variable-length integer, followed by the body. The body starts
+ * with a kind byte. A named signal continues with the length of the name and the name in UTF-8; a numbered signal
+ * continues with the method ID. Then follow the number of arguments in one byte and the arguments, each a tag byte
+ * and the value.
+ *
+ * Variable-length integers store 7 bits per byte, least significant first, with the high bit set on all but the last
+ * byte. Signed integers are zigzag encoded so that small negative numbers stay short.
+ */
+
+enum QxtCompactKind
+{
+    CompactNamed = 0,
+    CompactNumbered = 1
+};
+
+enum QxtCompactTag
+{
+    TagInvalid = 0,
+    TagFalse,
+    TagTrue,
+    TagInt,             // zigzag varint
+    TagUInt,            // varint
+    TagLongLong,        // zigzag varint
+    TagULongLong,       // varint
+    TagDouble,          // 8 bytes, little-endian
+    TagFloat,           // 4 bytes, little-endian
+    TagString,          // varint length, UTF-8
+    TagNullString,
+    TagByteArray,       // varint length, bytes
+    TagNullByteArray,
+    TagStreamed         // varint length, QVariant in QDataStream format
+};
+
+// A length prefix covers frames of up to 2^31 bytes.
+static const int maxPrefix = 5;
+
+static inline quint64 zigzag(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+static inline qint64 unzigzag(quint64 value)
+{
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+static inline int encodeVarint(uchar* out, quint64 value)
+{
+    int n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = uchar(value) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = uchar(value);
+    return n;
+}
+
+static inline void putRaw(QByteArray& out, const void* data, int size)
+{
+    const int pos = out.size();
+    out.resize(pos + size);
+    memcpy(out.data() + pos, data, size);
+}
+
+static inline void putVarint(QByteArray& out, quint64 value)
+{
+    uchar buffer[10];
+    putRaw(out, buffer, encodeVarint(buffer, value));
+}
+
+static inline void putBytes(QByteArray& out, const QByteArray& bytes)
+{
+    putVarint(out, bytes.size());
+    putRaw(out, bytes.constData(), bytes.size());
+}
+
+static void putValue(QByteArray& out, const QVariant& value)
+{
+    switch (value.userType())
+    {
+    case QVariant::Invalid:
+        out += char(TagInvalid);
+        break;
+    case QVariant::Bool:
+        out += char(value.toBool() ? TagTrue : TagFalse);
+        break;
+    case QVariant::Int:
+        out += char(TagInt);
+        putVarint(out, zigzag(value.toInt()));
+        break;
+    case QVariant::UInt:
+        out += char(TagUInt);
+        putVarint(out, value.toUInt());
+        break;
+    case QVariant::LongLong:
+        out += char(TagLongLong);
+        putVarint(out, zigzag(value.toLongLong()));
+        break;
+    case QVariant::ULongLong:
+        out += char(TagULongLong);
+        putVarint(out, value.toULongLong());
+        break;
+    case QVariant::Double:
+    {
+        const double d = value.toDouble();
+        quint64 bits;
+        memcpy(&bits, &d, sizeof(bits));
+        uchar buffer[8];
+        qToLittleEndian(bits, buffer);
+        out += char(TagDouble);
+        putRaw(out, buffer, 8);
+        break;
+    }
+    case QMetaType::Float:
+    {
+        const float f = value.value<float>();
+        quint32 bits;
+        memcpy(&bits, &f, sizeof(bits));
+        uchar buffer[4];
+        qToLittleEndian(bits, buffer);
+        out += char(TagFloat);
+        putRaw(out, buffer, 4);
+        break;
+    }
+    case QVariant::String:
+    {
+        const QString s = value.toString();
+        if (s.isNull())
+        {
+            out += char(TagNullString);
+            break;
+        }
+        out += char(TagString);
+        putBytes(out, s.toUtf8());
+        break;
+    }
+    case QVariant::ByteArray:
+    {
+        const QByteArray bytes = value.toByteArray();
+        if (bytes.isNull())
+        {
+            out += char(TagNullByteArray);
+            break;
+        }
+        out += char(TagByteArray);
+        putBytes(out, bytes);
+        break;
+    }
+    default:
+    {
+        QByteArray streamed;
+        QDataStream str(&streamed, QIODevice::WriteOnly);
+        str << value;
+        out += char(TagStreamed);
+        putBytes(out, streamed);
+        break;
+    }
+    }
+}
+
+static QByteArray frame(const QString* fn, quint32 methodId, const QVariant* const* args)
+{
+    QByteArray out;
+    out.reserve(64);
+    // Leave room for the longest length prefix; the unused part is removed at the end.
+    out.resize(maxPrefix);
+
+    if (fn)
+    {
+        out += char(CompactNamed);
+        putBytes(out, fn->toUtf8());
+    }
+    else
+    {
+        out += char(CompactNumbered);
+        putVarint(out, methodId);
+    }
+
+    int count = 0;
+    while (count < 8 && args[count]->isValid()) count++;
+    out += char(count);
+    for (int i = 0; i < count; i++)
+        putValue(out, *args[i]);
+
+    uchar prefix[maxPrefix];
+    const int n = encodeVarint(prefix, quint32(out.size() - maxPrefix));
+    memcpy(out.data() + maxPrefix - n, prefix, n);
+    out.remove(0, maxPrefix - n);
+    return out;
+}
+
+// Reads the frame length at offset. Returns the size of the prefix, 0 if the prefix is incomplete, or -1 if it is
+// malformed.
+static int framePrefix(const QByteArray& buffer, int offset, quint32& length)
+{
+    const uchar* data = reinterpret_cast<const uchar*>(buffer.constData()) + offset;
+    const int available = buffer.size() - offset;
+    quint64 value = 0;
+    for (int i = 0; i < maxPrefix; i++)
+    {
+        if (i >= available) return 0;
+        value |= quint64(data[i] & 0x7f) << (7 * i);
+        if (!(data[i] & 0x80))
+        {
+            if (value > 0x7fffffff) return -1;
+            length = quint32(value);
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Bounds-checked access to a frame body. A read past the end clears ok instead of failing immediately, so a message
+ * is checked once after it has been decoded.
+ */
+struct QxtCompactReader
+{
+    QxtCompactReader(const char* data, int size)
+        : p(reinterpret_cast<const uchar*>(data)), end(p + size), ok(true) {}
+
+    uchar byte()
+    {
+        if (p == end)
+        {
+            ok = false;
+            return 0;
+        }
+        return *p++;
+    }
+
+    quint64 varint(int maxBytes = 10)
+    {
+        quint64 value = 0;
+        for (int i = 0; i < maxBytes && p != end; i++)
+        {
+            const uchar b = *p++;
+            value |= quint64(b & 0x7f) << (7 * i);
+            if (!(b & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    const char* bytes(quint64 size)
+    {
+        if (quint64(end - p) < size)
+        {
+            ok = false;
+            return 0;
+        }
+        const char* rv = reinterpret_cast<const char*>(p);
+        p += size;
+        return rv;
+    }
+
+    const uchar* p;
+    const uchar* end;
+    bool ok;
+};
+
+static QVariant getValue(QxtCompactReader& r)
+{
+    switch (r.byte())
+    {
+    case TagInvalid:
+        return QVariant();
+    case TagFalse:
+        return QVariant(false);
+    case TagTrue:
+        return QVariant(true);
+    case TagInt:
+        return QVariant(int(unzigzag(r.varint())));
+    case TagUInt:
+        return QVariant(uint(r.varint()));
+    case TagLongLong:
+        return QVariant(qlonglong(unzigzag(r.varint())));
+    case TagULongLong:
+        return QVariant(qulonglong(r.varint()));
+    case TagDouble:
+    {
+        const char* data = r.bytes(8);
+        if (!data) return QVariant();
+        const quint64 bits = qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(data));
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        return QVariant(d);
+    }
+    case TagFloat:
+    {
+        const char* data = r.bytes(4);
+        if (!data) return QVariant();
+        const quint32 bits = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data));
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        return qVariantFromValue(f);
+    }
+    case TagString:
+    {
+        const quint64 size = r.varint();
+        const char* data = r.bytes(size);
+        if (!data) return QVariant();
+        return QVariant(QString::fromUtf8(data, int(size)));
+    }
+    case TagNullString:
+        return QVariant(QString());
+    case TagByteArray:
+    {
+        const quint64 size = r.varint();
+        const char* data = r.bytes(size);
+        if (!data) return QVariant();
+        return QVariant(QByteArray(data, int(size)));
+    }
+    case TagNullByteArray:
+        return QVariant(QByteArray());
+    case TagStreamed:
+    {
+        const quint64 size = r.varint();
+        const char* data = r.bytes(size);
+        if (!data) return QVariant();
+        QDataStream str(QByteArray::fromRawData(data, int(size)));
+        QVariant value;
+        str >> value;
+        if (str.status() != QDataStream::Ok) r.ok = false;
+        return value;
+    }
+    default:
+        r.ok = false;
+        return QVariant();
+    }
+}
+
+QByteArray QxtCompactSignalSerializer::serialize(const QString& fn, const QVariant& p1, const QVariant& p2, const QVariant& p3,
+        const QVariant& p4, const QVariant& p5, const QVariant& p6, const QVariant& p7, const QVariant& p8) const
+{
+    const QVariant* const args[8] = { &p1, &p2, &p3, &p4, &p5, &p6, &p7, &p8 };
+    return frame(&fn, 0, args);
+}
+
+bool QxtCompactSignalSerializer::supportsMethodIds() const
+{
+    return true;
+}
+
+QByteArray QxtCompactSignalSerializer::serialize(quint32 methodId, const QVariant& p1, const QVariant& p2, const QVariant& p3,
+        const QVariant& p4, const QVariant& p5, const QVariant& p6, const QVariant& p7, const QVariant& p8) const
+{
+    const QVariant* const args[8] = { &p1, &p2, &p3, &p4, &p5, &p6, &p7, &p8 };
+    return frame(0, methodId, args);
+}
+
+QxtAbstractSignalSerializer::DeserializedData QxtCompactSignalSerializer::deserialize(QByteArray& data)
+{
+    int offset = 0;
+    DeserializedData rv = deserialize(data, offset);
+    data.remove(0, offset);
+    return rv;
+}
+
+QxtAbstractSignalSerializer::DeserializedData QxtCompactSignalSerializer::deserialize(const QByteArray& buffer, int& offset,
+        quint32* methodId)
+{
+    if (methodId) *methodId = NoMethodId;
+    if (!canDeserialize(buffer, offset)) return ProtocolError();
+    quint32 length = 0;
+    const int prefix = framePrefix(buffer, offset, length);
+    if (prefix < 0) return ProtocolError();
+    QxtCompactReader r(buffer.constData() + offset + prefix, int(length));
+    offset += prefix + int(length);
+    if (length == 0) return NoOp();
+
+    const uchar kind = r.byte();
+    QString signal;
+    quint32 id = 0;
+    if (kind == CompactNamed)
+    {
+        const quint64 size = r.varint();
+        const char* name = r.bytes(size);
+        if (name) signal = QString::fromUtf8(name, int(size));
+    }
+    else if (kind == CompactNumbered)
+    {
+        // Numbered messages only reach callers that asked for them.
+        const quint64 value = r.varint(maxPrefix);
+        if (!methodId || value >= quint64(NoMethodId)) return ProtocolError();
+        id = quint32(value);
+    }
+    else
+    {
+        return ProtocolError();
+    }
+
+    const int argCount = r.byte();
+    QList<QVariant> v;
+    for (int i = 0; i < argCount && r.ok; i++)
+        v << getValue(r);
+    if (!r.ok) return ProtocolError();
+
+    if (kind == CompactNumbered) *methodId = id;
+    return qMakePair(signal, v);
+}
+
+bool QxtCompactSignalSerializer::canDeserialize(const QByteArray& buffer) const
+{
+    return canDeserialize(buffer, 0);
+}
+
+bool QxtCompactSignalSerializer::canDeserialize(const QByteArray& buffer, int offset) const
+{
+    if (offset < 0 || offset > buffer.size()) return false;
+    quint32 length = 0;
+    const int prefix = framePrefix(buffer, offset, length);
+    if (prefix == 0) return false;  // the length prefix is incomplete
+    if (prefix < 0) return true;    // malformed; deserialize() reports the error
+    return qint64(length) <= qint64(buffer.size()) - offset - prefix;
+}
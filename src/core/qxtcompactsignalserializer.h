@@ -0,0 +1,89 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTCOMPACTSIGNALSERIALIZER_H
+#define QXTCOMPACTSIGNALSERIALIZER_H
+
+#include <qxtglobal.h>
+#include <qxtabstractsignalserializer.h>
+
+/*!
+ * \class QxtCompactSignalSerializer
+ * \inmodule QxtCore
+ * \brief The QxtCompactSignalSerializer class converts signals to a compact tagged binary form.
+ *
+ * QxtCompactSignalSerializer is an alternative to QxtDataStreamSignalSerializer for connections that carry many small
+ * messages. Each message is a frame prefixed by its length as a variable-length integer. Integers are written as
+ * variable-length integers, doubles as 8 little-endian bytes, and strings as UTF-8, each behind a one-byte tag and
+ * without a type name. Values of other types fall back to the QDataStream format, so they need stream operators
+ * registered with qRegisterMetaTypeStreamOperators just as with QxtDataStreamSignalSerializer.
+ *
+ * Both ends of a connection must use the same serializer.
+ */
+
+class QXT_CORE_EXPORT QxtCompactSignalSerializer : public QxtAbstractSignalSerializer, public QxtSignalSerializerExtension
+{
+public:
+    /*!
+     * Serializes a signal into a form suitable for sending to an I/O device.
+     */
+    virtual QByteArray serialize(const QString& fn, const QVariant& p1 = QVariant(), const QVariant& p2 = QVariant(), const QVariant& p3 = QVariant(),
+                                 const QVariant& p4 = QVariant(), const QVariant& p5 = QVariant(), const QVariant& p6 = QVariant(),
+                                 const QVariant& p7 = QVariant(), const QVariant& p8 = QVariant()) const;
+
+    /*!
+     * Deserializes binary data into a signal name and a list of parameters.
+     */
+    virtual DeserializedData deserialize(QByteArray& data);
+
+    /*!
+     * Indicates whether the data currently in the buffer can be deserialized.
+     */
+    virtual bool canDeserialize(const QByteArray& buffer) const;
+
+    /*!
+     * Deserializes the message at \a offset in \a buffer and advances \a offset past it.
+     */
+    virtual DeserializedData deserialize(const QByteArray& buffer, int& offset, quint32* methodId = 0);
+
+    /*!
+     * Indicates whether a complete message starts at \a offset in \a buffer.
+     */
+    virtual bool canDeserialize(const QByteArray& buffer, int offset) const;
+
+    /*!
+     * Returns \c true; a signal identified by an ID is encoded with the ID in place of the name.
+     */
+    virtual bool supportsMethodIds() const;
+
+    /*!
+     * Serializes a signal identified by \a methodId.
+     */
+    virtual QByteArray serialize(quint32 methodId, const QVariant& p1 = QVariant(), const QVariant& p2 = QVariant(), const QVariant& p3 = QVariant(),
+                                 const QVariant& p4 = QVariant(), const QVariant& p5 = QVariant(), const QVariant& p6 = QVariant(),
+                                 const QVariant& p7 = QVariant(), const QVariant& p8 = QVariant()) const;
+};
+
+#endif
@@ -32,10 +32,14 @@
 #include "qxtalgorithms.h"
 #include "qxtbasicfileloggerengine.h"
 #include "qxtbasicstdloggerengine.h"
+#include "qxtbinaryfileloggerengine.h"
+#include "qxtbinarylogreader.h"
 #include "qxtboundcfunction.h"
 #include "qxtboundfunction.h"
 #include "qxtboundfunctionbase.h"
+#include "qxtbufferedfileloggerengine.h"
 #include "qxtcommandoptions.h"
+#include "qxtcompactsignalserializer.h"
 #include "qxtcsvmodel.h"
 #include "qxtdaemon.h"
 #include "qxtdatastreamsignalserializer.h"
@@ -43,14 +47,17 @@
 #include "qxterror.h"
 #include "qxtfifo.h"
 #include "qxtfilelock.h"
+#include "qxtflightrecorderloggerengine.h"
 #include "qxtglobal.h"
 #include "qxthmac.h"
 #include "qxtjson.h"
+#include "qxtjsonfileloggerengine.h"
 #include "qxtjob.h"
 #include "qxtlinesocket.h"
 #include "qxtlinkedtree.h"
 #include "qxtlogger.h"
 #include "qxtloggerengine.h"
+#include "qxtlogratelimiter.h"
 #include "qxtlogstream.h"
 #include "qxtlocale.h"
 #include "qxtmetaobject.h"
@@ -64,6 +71,7 @@
 #include "qxtpimpl.h"
 #include "qxtpipe.h"
 #include "qxtpointerlist.h"
+#include "qxtrpcreply.h"
 #include "qxtrpcservice.h"
 #include "qxtsharedprivate.h"
 #include "qxtsignalgroup.h"
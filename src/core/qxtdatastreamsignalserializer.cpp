@@ -30,12 +30,13 @@
 #include <QtDebug>
 #include <qendian.h>
 
-QByteArray QxtDataStreamSignalSerializer::serialize(const QString& fn, const QVariant& p1, const QVariant& p2, const QVariant& p3,
-        const QVariant& p4, const QVariant& p5, const QVariant& p6, const QVariant& p7, const QVariant& p8) const
+// Marks a message that carries a method ID instead of a name. QDataStream writes a QString as its length in bytes,
+// which is even, or as 0xFFFFFFFF for a null string, so an odd length cannot start a named message.
+static const quint32 methodIdMarker = 0xFFFFFFFE;
+
+static void writeArguments(QDataStream& str, const QVariant& p1, const QVariant& p2, const QVariant& p3, const QVariant& p4,
+        const QVariant& p5, const QVariant& p6, const QVariant& p7, const QVariant& p8)
 {
-    QByteArray rv;
-    QDataStream str(&rv, QIODevice::WriteOnly);
-    str << fn;
     unsigned char ct = 8;
     if (!p1.isValid()) ct = 0;
     else if (!p2.isValid()) ct = 1;
@@ -54,27 +55,80 @@ QByteArray QxtDataStreamSignalSerializer::serialize(const QString& fn, const QVa
     if (ct-- > 0) str << p6;
     if (ct-- > 0) str << p7;
     if (ct-- > 0) str << p8;
+}
+
+static QByteArray withLengthHeader(const QByteArray& body)
+{
     char sizeData[4];
-    qToLittleEndian(quint32(rv.size()), (uchar*)sizeData);
-    return QByteArray(sizeData, 4) + rv;
+    qToLittleEndian(quint32(body.size()), (uchar*)sizeData);
+    return QByteArray(sizeData, 4) + body;
+}
+
+QByteArray QxtDataStreamSignalSerializer::serialize(const QString& fn, const QVariant& p1, const QVariant& p2, const QVariant& p3,
+        const QVariant& p4, const QVariant& p5, const QVariant& p6, const QVariant& p7, const QVariant& p8) const
+{
+    QByteArray rv;
+    QDataStream str(&rv, QIODevice::WriteOnly);
+    str << fn;
+    writeArguments(str, p1, p2, p3, p4, p5, p6, p7, p8);
+    return withLengthHeader(rv);
+}
+
+bool QxtDataStreamSignalSerializer::supportsMethodIds() const
+{
+    return true;
+}
+
+QByteArray QxtDataStreamSignalSerializer::serialize(quint32 methodId, const QVariant& p1, const QVariant& p2, const QVariant& p3,
+        const QVariant& p4, const QVariant& p5, const QVariant& p6, const QVariant& p7, const QVariant& p8) const
+{
+    QByteArray rv;
+    QDataStream str(&rv, QIODevice::WriteOnly);
+    str << methodIdMarker << methodId;
+    writeArguments(str, p1, p2, p3, p4, p5, p6, p7, p8);
+    return withLengthHeader(rv);
 }
 
 QxtAbstractSignalSerializer::DeserializedData QxtDataStreamSignalSerializer::deserialize(QByteArray& data)
 {
-    QByteArray cmd;
-    quint32 len = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data.constData()));
+    int offset = 0;
+    DeserializedData rv = deserialize(data, offset);
+    data.remove(0, offset);
+    return rv;
+}
 
-    cmd = data.mid(4, len);
-    data = data.mid(len + 4);
+QxtAbstractSignalSerializer::DeserializedData QxtDataStreamSignalSerializer::deserialize(const QByteArray& buffer, int& offset,
+        quint32* methodId)
+{
+    if (methodId) *methodId = NoMethodId;
+    if (!canDeserialize(buffer, offset)) return ProtocolError();
+    const quint32 len = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData() + offset));
+    // The body is parsed where it is; fromRawData() shares the buffer instead of copying it.
+    const QByteArray cmd = QByteArray::fromRawData(buffer.constData() + offset + 4, int(len));
+    offset += int(len) + 4;
     if (cmd.length() == 0) return NoOp();
 
     QDataStream str(cmd);
 
     QString signal;
+    quint32 id = 0;
+    const bool numbered = cmd.size() >= 8
+                          && qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(cmd.constData())) == methodIdMarker;
+    if (numbered)
+    {
+        // Numbered messages only reach callers that asked for them.
+        quint32 marker;
+        str >> marker >> id;
+        if (!methodId || id == quint32(NoMethodId)) return ProtocolError();
+    }
+    else
+    {
+        str >> signal;
+    }
     unsigned char argCount;
     QList<QVariant> v;
     QVariant t;
-    str >> signal >> argCount;
+    str >> argCount;
 
     if (str.status() == QDataStream::ReadCorruptData) return ProtocolError();
 
@@ -83,12 +137,19 @@ QxtAbstractSignalSerializer::DeserializedData QxtDataStreamSignalSerializer::des
         str >> t;
         v << t;
     }
+    if (numbered) *methodId = id;
     return qMakePair(signal, v);
 }
 
 bool QxtDataStreamSignalSerializer::canDeserialize(const QByteArray& buffer) const
 {
-    int headerLen = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData()));
-    int bodyLen = quint32(buffer.length() - 4);
-    return headerLen <= bodyLen;
+    return canDeserialize(buffer, 0);
+}
+
+bool QxtDataStreamSignalSerializer::canDeserialize(const QByteArray& buffer, int offset) const
+{
+    const qint64 available = qint64(buffer.size()) - offset - 4;
+    if (offset < 0 || available < 0) return false;  // the length header is incomplete
+    const quint32 len = qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(buffer.constData() + offset));
+    return qint64(len) <= available;
 }
@@ -29,7 +29,7 @@
 #include <qxtglobal.h>
 #include <qxtabstractsignalserializer.h>
 
-class QXT_CORE_EXPORT QxtDataStreamSignalSerializer : public QxtAbstractSignalSerializer
+class QXT_CORE_EXPORT QxtDataStreamSignalSerializer : public QxtAbstractSignalSerializer, public QxtSignalSerializerExtension
 {
 public:
     /*!
@@ -48,6 +48,28 @@ public:
      * Indicates whether the data currently in the buffer can be deserialized.
      */
     virtual bool canDeserialize(const QByteArray& buffer) const;
+
+    /*!
+     * Deserializes the message at \a offset in \a buffer without copying it and advances \a offset past it.
+     */
+    virtual DeserializedData deserialize(const QByteArray& buffer, int& offset, quint32* methodId = 0);
+
+    /*!
+     * Indicates whether a complete message starts at \a offset in \a buffer.
+     */
+    virtual bool canDeserialize(const QByteArray& buffer, int offset) const;
+
+    /*!
+     * Returns \c true; see serialize(quint32, const QVariant&, const QVariant&, const QVariant&, const QVariant&, const QVariant&, const QVariant&, const QVariant&, const QVariant&).
+     */
+    virtual bool supportsMethodIds() const;
+
+    /*!
+     * Serializes a signal identified by \a methodId. The name is replaced by a 4-byte marker and the ID.
+     */
+    virtual QByteArray serialize(quint32 methodId, const QVariant& p1 = QVariant(), const QVariant& p2 = QVariant(), const QVariant& p3 = QVariant(),
+                                 const QVariant& p4 = QVariant(), const QVariant& p5 = QVariant(), const QVariant& p6 = QVariant(),
+                                 const QVariant& p7 = QVariant(), const QVariant& p8 = QVariant()) const;
 };
 
 #endif
@@ -0,0 +1,409 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include "qxtflightrecorderloggerengine.h"
+#include "qxtbinarylog_p.h"
+#include "qxtlogrecordformatter_p.h"
+#include <QFile>
+#include <string.h>
+
+/*!
+    \class QxtFlightRecorderLoggerEngine
+    \brief The QxtFlightRecorderLoggerEngine class keeps the most recent log messages in a memory mapped ring.
+    \inmodule QxtCore
+
+    The engine maps a file of fixed size() into memory and copies every
+    message into it, overwriting the oldest messages once the ring is full.
+    Writing a message is a memory copy: there is no system call on the
+    write path, so it is cheap enough to record trace level detail all the
+    time. Because the mapping is shared with the page cache, the data
+    survives a crash of the process and can be decoded afterwards with
+    dump() or the binlog-tool utility.
+
+    \code
+    QxtFlightRecorderLoggerEngine* recorder = new QxtFlightRecorderLoggerEngine("app.flight");
+    qxtLog->addLoggerEngine("flight", recorder);
+    qxtLog->enableAllLogLevels("flight");   // the other engines keep their levels
+    \endcode
+
+    A restarted application continues in the same ring, so the messages
+    from before a crash stay available until they are overwritten. Messages
+    larger than a quarter of the ring are not recorded.
+
+    The file holds native endian data and is meant to be decoded on the
+    machine that wrote it.
+
+    \sa QxtLogger
+ */
+
+#define QXT_FLIGHTRECORDER_VERSION 1
+
+struct QxtFlightRecorderHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 headerSize;
+    quint64 capacity;
+    volatile quint64 head;  // virtual offset just past the newest record
+    volatile quint64 tail;  // virtual offset of the oldest record
+    quint64 records;
+    char reserved[16];
+};
+
+/*******************************************************************************
+Records are aligned to 8 bytes and never wrap around the end of the ring. A
+record length of 0 marks the unused rest of the ring before it wraps.
+Message arguments follow the record header, each as size:u32 utf8.
+*******************************************************************************/
+struct QxtFlightRecord
+{
+    quint32 length;
+    quint8 level;
+    quint8 reserved;
+    quint16 count;
+    qint64 time;
+    quint64 thread;
+};
+
+static const char qxt_flightrecorder_magic[8] = { 'Q', 'X', 'T', 'F', 'L', 'R', 'E', 'C' };
+
+static inline quint64 qxtAlign8(quint64 size)
+{
+    return (size + 7) & ~quint64(7);
+}
+
+/*******************************************************************************
+Returns the space taken by the record at virtual offset at, or 0 if the ring
+holds something that is not a record.
+*******************************************************************************/
+static quint64 qxtFlightRecordSize(const uchar* ring, quint64 capacity, quint64 at)
+{
+    const quint64 offset = at % capacity;
+    const quint64 remaining = capacity - offset;
+    quint32 length;
+    memcpy(&length, ring + offset, sizeof length);
+    if (length == 0) return remaining;
+    if (length < sizeof(QxtFlightRecord) || length > remaining || length % 8) return 0;
+    return length;
+}
+
+class QxtFlightRecorderLoggerEnginePrivate : public QxtPrivate<QxtFlightRecorderLoggerEngine>
+{
+    QXT_DECLARE_PUBLIC(QxtFlightRecorderLoggerEngine)
+
+public:
+    QxtFlightRecorderLoggerEnginePrivate();
+
+    bool map();
+    void unmap();
+    void makeRoom(quint64 end);
+
+    qint64 capacity;
+    uchar* memory;
+    QxtFlightRecorderHeader* header;
+    uchar* ring;
+};
+
+QxtFlightRecorderLoggerEnginePrivate::QxtFlightRecorderLoggerEnginePrivate()
+        : capacity(0), memory(0), header(0), ring(0)
+{
+}
+
+/*******************************************************************************
+Maps the open log file. A file with a matching header is continued, anything
+else is replaced by an empty ring.
+*******************************************************************************/
+bool QxtFlightRecorderLoggerEnginePrivate::map()
+{
+    unmap();
+    QFile* file = static_cast<QFile*>(qxt_p().device());
+    if (!file || capacity <= 0) return false;
+
+    const qint64 total = sizeof(QxtFlightRecorderHeader) + capacity;
+    bool reuse = false;
+    if (file->size() == total)
+    {
+        QxtFlightRecorderHeader existing;
+        file->seek(0);
+        if (file->read(reinterpret_cast<char*>(&existing), sizeof existing) == sizeof existing)
+        {
+            reuse = memcmp(existing.magic, qxt_flightrecorder_magic, sizeof existing.magic) == 0
+                    && existing.version == QXT_FLIGHTRECORDER_VERSION
+                    && existing.headerSize == sizeof(QxtFlightRecorderHeader)
+                    && existing.capacity == quint64(capacity)
+                    && existing.tail <= existing.head
+                    && existing.head - existing.tail <= existing.capacity;
+        }
+    }
+    if (!reuse && !file->resize(0)) return false;
+    if (!reuse && !file->resize(total)) return false;
+
+    memory = file->map(0, total);
+    if (!memory) return false;
+    header = reinterpret_cast<QxtFlightRecorderHeader*>(memory);
+    ring = memory + sizeof(QxtFlightRecorderHeader);
+    if (!reuse)
+    {
+        memset(header, 0, sizeof(QxtFlightRecorderHeader));
+        memcpy(header->magic, qxt_flightrecorder_magic, sizeof header->magic);
+        header->version = QXT_FLIGHTRECORDER_VERSION;
+        header->headerSize = sizeof(QxtFlightRecorderHeader);
+        header->capacity = capacity;
+    }
+    return true;
+}
+
+void QxtFlightRecorderLoggerEnginePrivate::unmap()
+{
+    QFile* file = static_cast<QFile*>(qxt_p().device());
+    if (memory && file) file->unmap(memory);
+    memory = 0;
+    header = 0;
+    ring = 0;
+}
+
+/*******************************************************************************
+Drops the oldest records until the ring has room up to virtual offset end.
+The tail is moved before the records are overwritten, so after a crash the
+header never points at a half overwritten record.
+*******************************************************************************/
+void QxtFlightRecorderLoggerEnginePrivate::makeRoom(quint64 end)
+{
+    quint64 tail = header->tail;
+    while (tail + capacity < end)
+    {
+        const quint64 size = qxtFlightRecordSize(ring, capacity, tail);
+        if (size == 0)
+        {
+            tail = header->head;    // damaged ring, start over
+            break;
+        }
+        tail += size;
+    }
+    header->tail = tail;
+}
+
+/*!
+    Constructs a flight recorder writing to \a fileName, keeping the last
+    \a size bytes of messages.
+ */
+QxtFlightRecorderLoggerEngine::QxtFlightRecorderLoggerEngine(const QString& fileName, qint64 size)
+        : QxtAbstractFileLoggerEngine(fileName, QIODevice::ReadWrite)
+{
+    QXT_INIT_PRIVATE(QxtFlightRecorderLoggerEngine);
+    qxt_d().capacity = qxtAlign8(qMax(size, qint64(4096)));
+    if (device() && !qxt_d().map()) QxtAbstractFileLoggerEngine::killLoggerEngine();
+}
+
+/*!
+    Destructs the engine. The messages stay in the file.
+ */
+QxtFlightRecorderLoggerEngine::~QxtFlightRecorderLoggerEngine()
+{
+    killLoggerEngine();
+}
+
+/*!
+    \reimp
+ */
+void QxtFlightRecorderLoggerEngine::initLoggerEngine()
+{
+    QxtAbstractFileLoggerEngine::initLoggerEngine();
+    if (device() && !qxt_d().map()) QxtAbstractFileLoggerEngine::killLoggerEngine();
+}
+
+/*!
+    \reimp
+ */
+void QxtFlightRecorderLoggerEngine::killLoggerEngine()
+{
+    qxt_d().unmap();
+    QxtAbstractFileLoggerEngine::killLoggerEngine();
+}
+
+/*!
+    \reimp
+ */
+bool QxtFlightRecorderLoggerEngine::isInitialized() const
+{
+    return qxt_d().memory != 0;
+}
+
+/*!
+    \reimp
+ */
+void QxtFlightRecorderLoggerEngine::writeFormatted(QxtLogger::LogLevel level, const QList<QVariant>& messages)
+{
+    QxtFlightRecorderLoggerEnginePrivate& d = qxt_d();
+    if (!d.header) return;
+
+    const QxtLogRecord current = currentRecord();
+    QxtFlightRecord record;
+    record.length = 0;
+    record.level = quint8(level);
+    record.reserved = 0;
+    record.count = quint16(qMin(messages.size(), 0xffff));
+    record.time = current.time;
+    record.thread = current.threadId;
+
+    QByteArray bytes;
+    bytes.reserve(128);
+    bytes.append(QByteArray::fromRawData(reinterpret_cast<const char*>(&record), sizeof record));
+    for (int i = 0; i < record.count; i++)
+    {
+        const int start = bytes.size();
+        bytes.append(QByteArray(4, 0));
+        QxtLogRecordFormatter::appendVariant(bytes, messages.at(i));
+        const quint32 size = bytes.size() - start - 4;
+        memcpy(bytes.data() + start, &size, sizeof size);
+    }
+    const quint64 length = qxtAlign8(bytes.size());
+    if (length > quint64(d.capacity / 4)) return;
+    record.length = quint32(length);
+    memcpy(bytes.data(), &record.length, sizeof record.length);
+
+    quint64 head = d.header->head;
+    const quint64 remaining = d.capacity - head % d.capacity;
+    if (remaining < length)
+    {
+        // mark the rest of the ring unused and continue at its start
+        d.makeRoom(head + remaining);
+        memset(d.ring + head % d.capacity, 0, sizeof(quint32));
+        head += remaining;
+        d.header->head = head;
+    }
+    d.makeRoom(head + length);
+    uchar* target = d.ring + head % d.capacity;
+    memcpy(target, bytes.constData(), bytes.size());
+    memset(target + bytes.size(), 0, length - bytes.size());
+    d.header->records++;
+    d.header->head = head + length;
+}
+
+/*!
+    \reimp
+
+    Not used; messages are encoded by writeFormatted().
+ */
+void QxtFlightRecorderLoggerEngine::writeToFile(const QString& level, const QVariantList& messages)
+{
+    Q_UNUSED(level);
+    Q_UNUSED(messages);
+}
+
+/*!
+    Returns the number of bytes kept for messages. The default is 8 MiB.
+ */
+qint64 QxtFlightRecorderLoggerEngine::size() const
+{
+    return qxt_d().capacity;
+}
+
+/*!
+    Sets the number of bytes kept for messages to \a bytes. Changing the
+    size discards the recorded messages.
+ */
+void QxtFlightRecorderLoggerEngine::setSize(qint64 bytes)
+{
+    const qint64 capacity = qxtAlign8(qMax(bytes, qint64(4096)));
+    if (capacity == qxt_d().capacity) return;
+    qxt_d().capacity = capacity;
+    if (device()) initLoggerEngine();
+}
+
+/*!
+    Returns \c true if \a fileName was written by a flight recorder engine.
+ */
+bool QxtFlightRecorderLoggerEngine::isFlightRecorderFile(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    return file.read(sizeof qxt_flightrecorder_magic) == QByteArray(qxt_flightrecorder_magic, sizeof qxt_flightrecorder_magic);
+}
+
+/*!
+    Writes the messages recorded in \a fileName, oldest first, to \a output
+    as lines of text. Only messages of the given \a levels are written.
+    Returns \c false if the file could not be read.
+
+    \code
+    2009-05-14 22:38:33.159 [Trace] [0x7f2a1c000b40] entering parse()
+    \endcode
+ */
+bool QxtFlightRecorderLoggerEngine::dump(const QString& fileName, QIODevice* output, QxtLogger::LogLevels levels)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(QxtFlightRecorderHeader))) return false;
+    const uchar* memory = file.map(0, file.size());
+    if (!memory) return false;
+
+    QxtFlightRecorderHeader header;
+    memcpy(&header, memory, sizeof header);
+    const quint64 capacity = header.capacity;
+    if (memcmp(header.magic, qxt_flightrecorder_magic, sizeof header.magic) != 0
+            || header.headerSize != sizeof(QxtFlightRecorderHeader)
+            || capacity == 0 || quint64(file.size()) != header.headerSize + capacity
+            || header.tail > header.head || header.head - header.tail > capacity)
+    {
+        file.unmap(const_cast<uchar*>(memory));
+        return false;
+    }
+    const uchar* ring = memory + header.headerSize;
+
+    QByteArray line;
+    for (quint64 at = header.tail; at < header.head;)
+    {
+        const quint64 size = qxtFlightRecordSize(ring, capacity, at);
+        if (size == 0) break;
+        const uchar* data = ring + at % capacity;
+        at += size;
+
+        QxtFlightRecord record;
+        memcpy(&record, data, sizeof record);
+        if (record.length == 0 || !(levels & record.level)) continue;
+
+        QString name = QxtLogger::logLevelToString(QxtLogger::LogLevel(record.level));
+        if (name.endsWith("Level")) name.chop(5);
+        line = QString("%1 [%2] [0x%3]")
+               .arg(QxtBinaryLog::fromMSecsSinceEpoch(record.time).toString("yyyy-MM-dd hh:mm:ss.zzz"))
+               .arg(name)
+               .arg(record.thread, 0, 16).toUtf8();
+        quint64 offset = sizeof record;
+        for (int i = 0; i < record.count && offset + 4 <= record.length; i++)
+        {
+            quint32 length;
+            memcpy(&length, data + offset, sizeof length);
+            offset += 4;
+            if (offset + length > record.length) break;
+            line.append(' ');
+            line.append(QByteArray::fromRawData(reinterpret_cast<const char*>(data + offset), length));
+            offset += length;
+        }
+        line.append('\n');
+        output->write(line);
+    }
+    file.unmap(const_cast<uchar*>(memory));
+    return true;
+}
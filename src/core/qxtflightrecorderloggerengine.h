@@ -0,0 +1,56 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTFLIGHTRECORDERLOGGERENGINE_H
+#define QXTFLIGHTRECORDERLOGGERENGINE_H
+
+#include "qxtabstractfileloggerengine.h"
+
+class QxtFlightRecorderLoggerEnginePrivate;
+
+class QXT_CORE_EXPORT QxtFlightRecorderLoggerEngine : public QxtAbstractFileLoggerEngine
+{
+    QXT_DECLARE_PRIVATE(QxtFlightRecorderLoggerEngine)
+
+public:
+    QxtFlightRecorderLoggerEngine(const QString& fileName = QString(), qint64 size = 8 * 1024 * 1024);
+    ~QxtFlightRecorderLoggerEngine();
+
+    virtual void initLoggerEngine();
+    virtual void killLoggerEngine();
+    virtual bool isInitialized() const;
+    virtual void writeFormatted(QxtLogger::LogLevel level, const QList<QVariant>& messages);
+
+    qint64 size() const;
+    void setSize(qint64 bytes);
+
+    static bool isFlightRecorderFile(const QString& fileName);
+    static bool dump(const QString& fileName, QIODevice* output, QxtLogger::LogLevels levels = QxtLogger::AllLevels);
+
+protected:
+    virtual void writeToFile(const QString& level, const QVariantList& messages);
+};
+
+#endif // QXTFLIGHTRECORDERLOGGERENGINE_H
@@ -38,271 +38,601 @@
     \row  \o object \o QVariantMap/QVariantHash
     \row  \o array \o QVariantList/QStringList
     \row  \o string \o QString
-    \row  \o number \o int,double
+    \row  \o number \o int,qlonglong,double
     \row  \o true \o bool
     \row  \o false \o bool
     \row  \o null \o QVariant()
 
     \endtable
 
+    Parsing turns an integer into an int if it fits, into a qlonglong if it fits into 64 bits and into a double
+    otherwise. Numbers with a fraction or an exponent are always parsed into a double.
+
+    For large documents, parseUtf8() and stringifyUtf8() avoid converting between UTF-8 and QString, and write()
+    streams the JSON text to a QIODevice as it is produced.
+
+*/
+
+/*!
+    \enum QxtJSON::Format
+
+    This enum describes the layout of the JSON text written by stringifyUtf8() and write().
+
+    \value Compact     No whitespace at all.
+    \value Indented    Every array element and object member on a line of its own, indented by four spaces per
+                        level of nesting.
 */
 
 #include "qxtjson.h"
+#include "qxtjsonwriter_p.h"
 #include <QVariant>
 #include <QDebug>
-#include <QTextStream>
 #include <QStringList>
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QXT_JSON_SSE2
+#include <emmintrin.h>
+#endif
+
+/*!
+    Returns the JSON text for \a v.
 
+    This is a convenience wrapper around stringifyUtf8().
+ */
 QString QxtJSON::stringify(QVariant v){
-    if (v.isNull()){
-        return "null";
-    }
-    int t = v.type();
-    if (t == QVariant::String){
-        return "\""+v.toString()+"\"";
+    return QString::fromUtf8(stringifyUtf8(v));
+}
+
+/*!
+    Returns the UTF-8 encoded JSON text for \a v, laid out according to \a format.
+
+    Strings are escaped as needed, integers are written exactly and doubles with as many digits as it takes to read
+    back the same value. NaN and infinity, which JSON cannot represent, are written as null, as are null QVariants.
+    Types without a JSON counterpart are written as their QVariant::toString() text. Lists and maps nested more than
+    1024 levels deep are written as null.
+ */
+QByteArray QxtJSON::stringifyUtf8(const QVariant& v, Format format){
+    QByteArray out;
+    write(v, &out, format);
+    return out;
+}
+
+/*!
+    Appends the UTF-8 encoded JSON text for \a v to \a out, laid out according to \a format.
+    \sa stringifyUtf8()
+ */
+void QxtJSON::write(const QVariant& v, QByteArray* out, Format format){
+    QxtJSONWriter writer(out, 0, format);
+    writer.putValue(v, 0);
+    writer.finish();
+}
+
+/*!
+    \overload
+
+    Writes the UTF-8 encoded JSON text for \a v to \a device as it is produced, in chunks of a few kilobytes.
+    Returns \c false if \a device did not accept all of it, or if \a v contains lists or maps nested more than 1024
+    levels deep, which are written as null.
+ */
+bool QxtJSON::write(const QVariant& v, QIODevice* device, Format format){
+    QByteArray buffer;
+    QxtJSONWriter writer(&buffer, device, format);
+    writer.putValue(v, 0);
+    return writer.finish();
+}
+
+// Documents are parsed by recursive descent, so the nesting depth is limited to keep the stack from overflowing.
+static const int maxDepth = 1024;
+
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+#ifdef QXT_JSON_SSE2
+static inline int firstBit(uint mask)
+{
+#if defined(Q_CC_GNU)
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        i++;
     }
-    else if (t == QVariant::Bool){
-        return v.toBool()?"true":"false";
-    }else if (t ==  QVariant::Int){
-        return QString::number(v.toInt());
-    }else if (t ==  QVariant::Double){
-        return QString::number(v.toDouble());
-    }else if (t == QVariant::Map){
-        QString r="{";
-        QMap<QString, QVariant> map = v.toMap();
-        QMapIterator<QString, QVariant> i(map);
-        while (i.hasNext()){
-            i.next();
-            r+="\""+i.key()+"\":"+stringify(i.value())+",";
-        }
-        if(r.length()>1)
-            r.chop(1);
-        r+="}";
-        return r;
-#if QT_VERSION >= 0x040500
-    }else if (t == QVariant::Hash){
-        QString r="{";
-        QHash<QString, QVariant> map = v.toHash();
-        QHashIterator<QString, QVariant> i(map);
-        while (i.hasNext()){
-            i.next();
-            r+="\""+i.key()+"\":"+stringify(i.value())+",";
-        }
-        if(r.length()>1)
-            r.chop(1);
-        r+="}";
-        return r;
+    return i;
 #endif
-    }else if (t == QVariant::StringList){
-        QString r="[";
-        QStringList l = v.toStringList();
-        foreach(QString i, l){
-            r+="\""+i+"\",";
-        }
-        if(r.length()>1)
-            r.chop(1);
-        r+="]";
-        return r;
-    }else if (t == QVariant::List){
-        QString r="[";
-        QVariantList l = v.toList();
-        foreach(QVariant i, l){
-            r+=stringify(i)+",";
-        }
-        if(r.length()>1)
-            r.chop(1);
-        r+="]";
-        return r;
+}
+#endif
+
+// Parses UTF-8 input where it is. Each function starts at the first character of its token and leaves p behind it;
+// on failure the first error is recorded along with where it was found.
+class QxtJSONParser
+{
+public:
+    QxtJSONParser(const char* data, int size)
+            : begin(data), p(data), end(data + size), depth(0), message(0), errorAt(0) {}
+
+    bool parseDocument(QVariant* value);
+    int errorOffset() const { return message ? int(errorAt - begin) : -1; }
+    QString errorString() const;
+
+private:
+    bool parseValue(QVariant* value);
+    bool parseObject(QVariant* value);
+    bool parseArray(QVariant* value);
+    bool parseString(QString* string);
+    bool parseEscape(QString* string);
+    bool parseNumber(QVariant* value);
+    bool parseLiteral(const char* literal, int length);
+    bool readHex(uint* code);
+    bool fail(const char* why, const char* at);
+
+    // Most tokens are separated by a single blank at most, so the wide scan is kept for indentation.
+    inline void skipWhiteSpace()
+    {
+        if (p < end && isSpace(*p) && ++p < end && isSpace(*p))
+            p = skipSpaces(p);
     }
+    const char* skipSpaces(const char* from) const;
+    const char* scanString(const char* from) const;
 
-    return QString();
+    const char* begin;
+    const char* p;
+    const char* end;
+    int depth;
+    const char* message;
+    const char* errorAt;
+};
+
+// Returns the first character from \a from on that is not whitespace.
+const char* QxtJSONParser::skipSpaces(const char* from) const
+{
+#ifdef QXT_JSON_SSE2
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+    while (end - from >= 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+        const __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, lf)),
+                                           _mm_or_si128(_mm_cmpeq_epi8(chunk, cr), _mm_cmpeq_epi8(chunk, tab)));
+        const uint mask = uint(_mm_movemask_epi8(blank)) ^ 0xFFFF;
+        if (mask)
+            return from + firstBit(mask);
+        from += 16;
+    }
+#endif
+    while (from < end && isSpace(*from))
+        from++;
+    return from;
 }
 
-static QVariant parseValue(QTextStream &s,bool & error);
-static QVariantMap parseObject (QTextStream & s,bool & error);
-static QVariantList parseArray (QTextStream & s,bool & error);
-static QString parseString (QTextStream & s,bool & error);
-static QVariant parseLiteral (QTextStream & s,bool & error);
+// Returns the first character from \a from on that ends a plain run of string characters: a quote, a backslash, a
+// control character or a byte that is not ASCII.
+const char* QxtJSONParser::scanString(const char* from) const
+{
+#ifdef QXT_JSON_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x20);
+    while (end - from >= 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+        // The comparison is signed, so bytes of 0x80 and above are found along with the control characters.
+        const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                             _mm_cmplt_epi8(chunk, control));
+        const uint mask = uint(_mm_movemask_epi8(special));
+        if (mask)
+            return from + firstBit(mask);
+        from += 16;
+    }
+#endif
+    while (from < end)
+    {
+        const uchar c = uchar(*from);
+        if (c == '"' || c == '\\' || c < 0x20 || c >= 0x80)
+            return from;
+        from++;
+    }
+    return from;
+}
 
-QVariant QxtJSON::parse(QString string){
-    QTextStream s(&string);
-    bool error=false;
-    QVariant v=parseValue(s,error);
-    if(error)
-        return QVariant();
-    return v;
+bool QxtJSONParser::fail(const char* why, const char* at)
+{
+    if (!message)
+    {
+        message = at == end ? "unexpected end of input" : why;
+        errorAt = at;
+    }
+    return false;
 }
 
+QString QxtJSONParser::errorString() const
+{
+    if (!message)
+        return QString();
+    int line = 1;
+    const char* lineStart = begin;
+    for (const char* c = begin; c < errorAt; c++)
+    {
+        if (*c == '\n')
+        {
+            line++;
+            lineStart = c + 1;
+        }
+    }
+    return QString("%1 at line %2, column %3").arg(QLatin1String(message)).arg(line).arg(int(errorAt - lineStart) + 1);
+}
 
+bool QxtJSONParser::parseDocument(QVariant* value)
+{
+    // A byte order mark is allowed in front of the document.
+    if (end - p >= 3 && uchar(p[0]) == 0xEF && uchar(p[1]) == 0xBB && uchar(p[2]) == 0xBF)
+        p += 3;
+    skipWhiteSpace();
+    if (!parseValue(value))
+        return false;
+    skipWhiteSpace();
+    if (p != end)
+        return fail("unexpected data after the document", p);
+    return true;
+}
 
-static QVariant parseValue(QTextStream &s,bool & error){
-    s.skipWhiteSpace();
-    QChar c;
-    while(!s.atEnd() && !error){
-        s>>c;
-        if (c=='{'){
-            return parseObject(s,error);
-        } else if (c=='"'){
-            return parseString(s,error);
-        } else if (c=='['){
-            return parseArray(s,error);
-        } else {
-            return parseLiteral(s,error);
-        }
-        s.skipWhiteSpace();
+bool QxtJSONParser::parseValue(QVariant* value)
+{
+    if (p == end)
+        return fail("unexpected end of input", p);
+    switch (*p)
+    {
+    case '{':
+        return parseObject(value);
+    case '[':
+        return parseArray(value);
+    case '"':
+    {
+        QString string;
+        if (!parseString(&string))
+            return false;
+        *value = string;
+        return true;
+    }
+    case 't':
+        if (!parseLiteral("true", 4))
+            return false;
+        *value = true;
+        return true;
+    case 'f':
+        if (!parseLiteral("false", 5))
+            return false;
+        *value = false;
+        return true;
+    case 'n':
+        if (!parseLiteral("null", 4))
+            return false;
+        *value = QVariant();
+        return true;
+    case '-': case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+        return parseNumber(value);
+    default:
+        return fail("unexpected character", p);
     }
-    return QVariant();
 }
 
-static QVariantMap parseObject (QTextStream & s,bool & error){
-    s.skipWhiteSpace();
-    QVariantMap o;
-    QString key;
-    bool atVal=false;
-
-    QChar c;
-    while(!s.atEnd() && !error){
-        s>>c;
-        if (c=='}'){
-            return o;
-        } else if (c==',' || c==':'){
-            /*
-              They're syntactic sugar, since key:value come in bundles anyway
-              Could check for error handling. too lazy.
-            */
-        } else if (c=='"'){
-            if(atVal){
-                o[key]=parseString(s,error);
-                atVal=false;
-            }else{
-                key=parseString(s,error);
-                atVal=true;
-            }
-        } else if (c=='['){
-            if(atVal){
-                o[key]=parseArray(s,error);
-                atVal=false;
-            }else{
-                error=true;
-                return QVariantMap();
-            }
-        } else if (c=='{'){
-            if(atVal){
-                o[key]=parseObject(s,error);
-                atVal=false;
-            }else{
-                error=true;
-                return QVariantMap();
-            }
-        } else {
-            if(atVal){
-                o[key]=parseLiteral(s,error);
-                atVal=false;
-            }else{
-                error=true;
-                return QVariantMap();
-            }
+bool QxtJSONParser::parseObject(QVariant* value)
+{
+    if (++depth > maxDepth)
+        return fail("document nested too deeply", p);
+    QVariantMap map;
+    p++;
+    skipWhiteSpace();
+    if (p < end && *p == '}')
+    {
+        p++;
+    }
+    else forever
+    {
+        if (p == end || *p != '"')
+            return fail("expected a string as member name", p);
+        QString key;
+        if (!parseString(&key))
+            return false;
+        skipWhiteSpace();
+        if (p == end || *p != ':')
+            return fail("expected ':' after member name", p);
+        p++;
+        skipWhiteSpace();
+        // A later member with the same name replaces the earlier one.
+        if (!parseValue(&map[key]))
+            return false;
+        skipWhiteSpace();
+        if (p < end && *p == ',')
+        {
+            p++;
+            skipWhiteSpace();
+            continue;
         }
-        s.skipWhiteSpace();
+        if (p < end && *p == '}')
+        {
+            p++;
+            break;
+        }
+        return fail("expected ',' or '}' in object", p);
     }
-    error=true;
-    return QVariantMap();
+    depth--;
+    *value = map;
+    return true;
 }
-static QVariantList parseArray (QTextStream & s,bool & error){
-    s.skipWhiteSpace();
-    QVariantList l;
-    QChar c;
-    while(!s.atEnd() && !error){
-        s>>c;
-        if (c==']'){
-            return l;
-        } else if (c==','){
-        } else if (c=='"'){
-            l.append(parseString(s,error));
-        } else if (c=='['){
-            l.append(parseArray(s,error));
-        } else if (c=='{'){
-            l.append(parseObject(s,error));
-        } else {
-            l.append(parseLiteral(s,error));
+
+bool QxtJSONParser::parseArray(QVariant* value)
+{
+    if (++depth > maxDepth)
+        return fail("document nested too deeply", p);
+    QVariantList list;
+    p++;
+    skipWhiteSpace();
+    if (p < end && *p == ']')
+    {
+        p++;
+    }
+    else forever
+    {
+        list.append(QVariant());
+        if (!parseValue(&list.last()))
+            return false;
+        skipWhiteSpace();
+        if (p < end && *p == ',')
+        {
+            p++;
+            skipWhiteSpace();
+            continue;
+        }
+        if (p < end && *p == ']')
+        {
+            p++;
+            break;
         }
-        s.skipWhiteSpace();
+        return fail("expected ',' or ']' in array", p);
     }
-    error=true;
-    return QVariantList();
+    depth--;
+    *value = list;
+    return true;
 }
-static QString parseString (QTextStream & s,bool & error){
-    QString str;
-    QChar c;
-    while(!s.atEnd() && !error){
-        s>>c;
-        if(c=='"'){
-            return str;
-        }else if(c=='\\'){
-            s>>c;
-            if(c=='b'){
-                str.append('\b');
-            }else if(c=='f'){
-                str.append('\f');
-            }else if(c=='n'){
-                str.append('\n');
-            }else if(c=='r'){
-                str.append('\r');
-            }else if(c=='t'){
-                str.append('\t');
-            }else if(c=='f'){
-                str.append('\f');
-            }else if(c=='u'){
-                short u;
-                s>>u;
-                str.append(QChar(u));
-            }else{
-                str.append(c);
+
+bool QxtJSONParser::parseString(QString* string)
+{
+    const char* start = ++p;
+    const char* chunk = start;      // the start of the characters not yet appended to string
+    bool escaped = false;
+    bool ascii = true;
+    forever
+    {
+        const char* s = scanString(p);
+        if (s == end)
+            return fail("unterminated string", start - 1);
+        const uchar c = uchar(*s);
+        if (c >= 0x80)
+        {
+            ascii = false;
+            p = s + 1;
+        }
+        else if (c == '"')
+        {
+            if (!escaped)
+                *string = ascii ? QString::fromLatin1(start, int(s - start)) : QString::fromUtf8(start, int(s - start));
+            else if (s != chunk)
+                string->append(QString::fromUtf8(chunk, int(s - chunk)));
+            p = s + 1;
+            return true;
+        }
+        else if (c == '\\')
+        {
+            if (!escaped)
+            {
+                string->clear();
+                string->reserve(int(s - start) + 16);
+                escaped = true;
             }
-        }else{
-            str.append(c);
+            if (s != chunk)
+                string->append(QString::fromUtf8(chunk, int(s - chunk)));
+            p = s;
+            if (!parseEscape(string))
+                return false;
+            chunk = p;
+        }
+        else
+        {
+            return fail("unescaped control character in string", s);
         }
     }
-    error=true;
-    return QString();
 }
-static QVariant parseLiteral (QTextStream & s,bool & error){
-    s.seek(s.pos()-1);
-    QChar c;
-    while(!s.atEnd() && !error){
-        s>>c;
-        if (c=='t'){
-            s>>c;//r
-            s>>c;//u
-            s>>c;//e
-            return true;
-        } else if (c=='f'){
-            s>>c;//a
-            s>>c;//l
-            s>>c;//s
-            s>>c;//e
+
+bool QxtJSONParser::parseEscape(QString* string)
+{
+    const char* escape = p;
+    if (end - p < 2)
+        return fail("unterminated string", end);
+    const char c = p[1];
+    p += 2;
+    switch (c)
+    {
+    case '"': case '\\': case '/':
+        string->append(QLatin1Char(c));
+        return true;
+    case 'b':
+        string->append(QLatin1Char('\b'));
+        return true;
+    case 'f':
+        string->append(QLatin1Char('\f'));
+        return true;
+    case 'n':
+        string->append(QLatin1Char('\n'));
+        return true;
+    case 'r':
+        string->append(QLatin1Char('\r'));
+        return true;
+    case 't':
+        string->append(QLatin1Char('\t'));
+        return true;
+    case 'u':
+    {
+        uint code;
+        if (!readHex(&code))
+            return fail("invalid \\u escape sequence", escape);
+        string->append(QChar(ushort(code)));
+        return true;
+    }
+    default:
+        return fail("invalid escape sequence", escape);
+    }
+}
+
+bool QxtJSONParser::readHex(uint* code)
+{
+    if (end - p < 4)
+        return false;
+    uint value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        const char c = p[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9')
+            value |= c - '0';
+        else if (c >= 'a' && c <= 'f')
+            value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            value |= c - 'A' + 10;
+        else
             return false;
-        }else if (c=='n'){
-            s>>c;//u
-            s>>c;//l
-            s>>c;//l
-            return QVariant();
-        }else if (c=='-' || c.isDigit()){
-            QString n;
-            while(( c.isDigit()  || (c=='.') || (c=='E') || (c=='e') || (c=='-') || (c=='+') )){
-                n.append(c);
-                if(s.atEnd() ||  error)
-                    break;
-                s>>c;
-            }
-            s.seek(s.pos()-1);
-            if(n.contains('.')){
-                return n.toDouble();
-            }else{
-                return n.toInt();
-            }
+    }
+    p += 4;
+    *code = value;
+    return true;
+}
+
+bool QxtJSONParser::parseNumber(QVariant* value)
+{
+    const char* start = p;
+    const bool negative = *p == '-';
+    if (negative)
+        p++;
+    if (p == end || !isDigit(*p))
+        return fail("invalid number", start);
+
+    // The integer part is accumulated on the way, which is all that is needed unless it turns out to be a double.
+    quint64 magnitude = 0;
+    bool overflow = false;
+    if (*p == '0')
+    {
+        p++;
+    }
+    else
+    {
+        for (; p < end && isDigit(*p); p++)
+        {
+            const uint digit = *p - '0';
+            if (magnitude > (Q_UINT64_C(0xFFFFFFFFFFFFFFFF) - digit) / 10)
+                overflow = true;
+            else
+                magnitude = magnitude * 10 + digit;
+        }
+    }
+    bool integral = true;
+    if (p < end && *p == '.')
+    {
+        integral = false;
+        p++;
+        if (p == end || !isDigit(*p))
+            return fail("invalid number", start);
+        while (p < end && isDigit(*p))
+            p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        integral = false;
+        p++;
+        if (p < end && (*p == '+' || *p == '-'))
+            p++;
+        if (p == end || !isDigit(*p))
+            return fail("invalid number", start);
+        while (p < end && isDigit(*p))
+            p++;
+    }
+
+    if (integral && !overflow)
+    {
+        if (magnitude <= (negative ? Q_UINT64_C(0x80000000) : Q_UINT64_C(0x7FFFFFFF)))
+        {
+            *value = negative ? int(0 - qint64(magnitude)) : int(magnitude);
+            return true;
+        }
+        if (magnitude <= (negative ? Q_UINT64_C(0x8000000000000000) : Q_UINT64_C(0x7FFFFFFFFFFFFFFF)))
+        {
+            *value = negative ? qlonglong(Q_UINT64_C(0) - magnitude) : qlonglong(magnitude);
+            return true;
         }
     }
-    error=true;
-    return QVariant();
+
+    // Fractions, exponents and integers too large for 64 bits. QByteArray::toDouble() ignores the locale.
+    bool ok;
+    const double number = QByteArray::fromRawData(start, int(p - start)).toDouble(&ok);
+    if (!ok)
+        return fail("number out of range", start);
+    *value = number;
+    return true;
+}
+
+bool QxtJSONParser::parseLiteral(const char* literal, int length)
+{
+    if (end - p < length || memcmp(p, literal, length) != 0)
+        return fail("invalid literal", p);
+    p += length;
+    return true;
+}
+
+/*!
+    Parses the JSON document in \a string and returns its value. Returns a null QVariant if \a string is not a valid
+    JSON document.
+
+    This is a convenience wrapper around parseUtf8().
+ */
+QVariant QxtJSON::parse(QString string){
+    return parseUtf8(string.toUtf8());
+}
+
+/*!
+    Parses the UTF-8 encoded JSON document in \a json and returns its value.
+
+    Returns a null QVariant if \a json is not a valid JSON document. In that case, if \a errorOffset is not null, it
+    is set to the byte offset of the error in \a json, and if \a errorString is not null, it is set to a description
+    of the error with its line and column. Otherwise \a errorOffset is set to -1 and \a errorString is cleared.
+ */
+QVariant QxtJSON::parseUtf8(const QByteArray& json, int* errorOffset, QString* errorString){
+    return parseUtf8(json.constData(), json.size(), errorOffset, errorString);
+}
+
+/*!
+    \overload
+
+    Parses the \a size bytes of UTF-8 encoded JSON at \a json. If \a size is negative, \a json is read up to its
+    terminating '\\0' character.
+ */
+QVariant QxtJSON::parseUtf8(const char* json, int size, int* errorOffset, QString* errorString){
+    if (size < 0)
+        size = json ? int(qstrlen(json)) : 0;
+    QxtJSONParser parser(json, size);
+    QVariant value;
+    const bool ok = parser.parseDocument(&value);
+    if (errorOffset)
+        *errorOffset = parser.errorOffset();
+    if (errorString)
+        *errorString = parser.errorString();
+    return ok ? value : QVariant();
 }
@@ -29,10 +29,20 @@
 #include "qxtglobal.h"
 #include <QVariant>
 #include <QString>
+#include <QByteArray>
+
+QT_FORWARD_DECLARE_CLASS(QIODevice)
 
 class QXT_CORE_EXPORT QxtJSON {
 public:
+    enum Format { Compact, Indented };
+
     static QVariant parse     (QString string);
+    static QVariant parseUtf8 (const QByteArray& json, int* errorOffset = 0, QString* errorString = 0);
+    static QVariant parseUtf8 (const char* json, int size, int* errorOffset = 0, QString* errorString = 0);
     static QString  stringify (QVariant v);
+    static QByteArray stringifyUtf8 (const QVariant& v, Format format = Compact);
+    static void     write     (const QVariant& v, QByteArray* out, Format format = Compact);
+    static bool     write     (const QVariant& v, QIODevice* device, Format format = Compact);
 };
 #endif
@@ -0,0 +1,167 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include "qxtjsonfileloggerengine.h"
+#include "qxtbinarylog_p.h"
+#include "qxtjsonwriter_p.h"
+
+/*!
+    \class QxtJsonFileLoggerEngine
+    \brief The QxtJsonFileLoggerEngine class writes log records as JSON lines.
+    \inmodule QxtCore
+
+    Each record is written as one JSON object on a line of its own, the
+    format expected by most log indexers:
+    \code
+    {"time":"2010-05-17T22:38:33.159Z","level":"Error","thread":"0x7f3a","messages":["Unknown error",42]}
+    {"time":"2010-05-17T22:51:43.488Z","level":"Debug","thread":"worker","messages":["What's going on?",{"id":7,"ok":true}]}
+    \endcode
+
+    The time is given in UTC. The thread is QxtLogRecord::threadTag().
+    Messages keep their JSON type: numbers, booleans and null are written as
+    such, QVariantList and QStringList become arrays, QVariantMap and
+    QVariantHash become objects, and any other value is written as its
+    QVariant::toString() text.
+
+    Records are encoded straight into a reusable UTF-8 buffer by the same
+    encoder as QxtJSON::stringifyUtf8(), so structured logging costs about as
+    much as QxtBasicFileLoggerEngine.
+
+    \sa QxtLogger, QxtBasicFileLoggerEngine
+ */
+
+class QxtJsonFileLoggerEnginePrivate : public QxtPrivate<QxtJsonFileLoggerEngine>
+{
+public:
+    QXT_DECLARE_PUBLIC(QxtJsonFileLoggerEngine)
+    QxtJsonFileLoggerEnginePrivate();
+
+    void writeRecord(const char* level, int levelSize, const QList<QVariant>& messages);   // level is JSON-escaped
+    void putTime(qint64 msecs);
+
+    QByteArray line;        // reused for every record; never shrinks
+    QxtJSONWriter json;     // writes into line
+    qint64 cachedSecond;
+    QByteArray secondText;  // "yyyy-MM-ddThh:mm:ss" of cachedSecond
+};
+
+QxtJsonFileLoggerEnginePrivate::QxtJsonFileLoggerEnginePrivate() : json(&line), cachedSecond(-1)
+{
+}
+
+void QxtJsonFileLoggerEnginePrivate::writeRecord(const char* level, int levelSize, const QList<QVariant>& messages)
+{
+    QIODevice* file = qxt_p().device();
+    if (!file) return;
+    const QxtLogRecord current = qxt_p().currentRecord();
+    json.clear();
+    json.put("{\"time\":\"", 9);
+    putTime(current.time);
+    json.put("\",\"level\":\"", 11);
+    json.put(level, levelSize);
+    json.put("\",\"thread\":", 11);
+    json.putString(current.threadTag());
+    json.put(",\"messages\":[", 13);
+    for (int i = 0; i < messages.count(); i++)
+    {
+        if (i) json.put(',');
+        json.putValue(messages.at(i));
+    }
+    json.put("]}\n", 3);
+    file->write(line.constData(), json.size());
+}
+
+/*******************************************************************************
+ISO 8601 in UTC. The date and time up to the seconds are rendered through
+QDateTime only when the second changes.
+*******************************************************************************/
+void QxtJsonFileLoggerEnginePrivate::putTime(qint64 msecs)
+{
+    const qint64 second = msecs / 1000;
+    if (second != cachedSecond)
+    {
+        cachedSecond = second;
+        secondText = QxtBinaryLog::fromMSecsSinceEpoch(second * 1000).toUTC().toString("yyyy-MM-dd'T'hh:mm:ss").toLatin1();
+    }
+    json.put(secondText.constData(), secondText.size());
+    const int ms = int(msecs % 1000);
+    const char fraction[5] = { '.', char('0' + ms / 100), char('0' + ms / 10 % 10), char('0' + ms % 10), 'Z' };
+    json.put(fraction, sizeof fraction);
+}
+
+/*!
+    Constructs a JSON lines logger engine with \a fileName.
+ */
+QxtJsonFileLoggerEngine::QxtJsonFileLoggerEngine(const QString& fileName)
+        : QxtAbstractFileLoggerEngine(fileName, QIODevice::ReadWrite | QIODevice::Append | QIODevice::Unbuffered)
+{
+    QXT_INIT_PRIVATE(QxtJsonFileLoggerEngine);
+}
+
+/*!
+    \reimp
+ */
+void QxtJsonFileLoggerEngine::writeFormatted(QxtLogger::LogLevel level, const QList<QVariant>& messages)
+{
+    switch (level)
+    {
+    case QxtLogger::ErrorLevel:
+        qxt_d().writeRecord("Error", 5, messages);
+        break;
+    case QxtLogger::WarningLevel:
+        qxt_d().writeRecord("Warning", 7, messages);
+        break;
+    case QxtLogger::CriticalLevel:
+        qxt_d().writeRecord("Critical", 8, messages);
+        break;
+    case QxtLogger::FatalLevel:
+        qxt_d().writeRecord("Fatal", 5, messages);
+        break;
+    case QxtLogger::TraceLevel:
+        qxt_d().writeRecord("Trace", 5, messages);
+        break;
+    case QxtLogger::DebugLevel:
+        qxt_d().writeRecord("Debug", 5, messages);
+        break;
+    case QxtLogger::InfoLevel:
+        qxt_d().writeRecord("Info", 4, messages);
+        break;
+    default:
+        qxt_d().writeRecord("", 0, messages);
+        break;
+    }
+}
+
+/*!
+    \reimp
+ */
+void QxtJsonFileLoggerEngine::writeToFile(const QString& level, const QVariantList& messages)
+{
+    QxtJsonFileLoggerEnginePrivate& d = qxt_d();
+    d.json.clear();
+    d.json.putString(level);
+    const QByteArray escaped(d.line.constData() + 1, d.json.size() - 2);  // without the quotes
+    d.writeRecord(escaped.constData(), escaped.size(), messages);
+}
@@ -0,0 +1,268 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include "qxtjsonwriter_p.h"
+#include <QIODevice>
+#include <QStringList>
+
+void QxtJSONWriter::grow(int size)
+{
+    if (device && used > 0 && used + size > chunkSize)
+    {
+        ok = device->write(out->constData(), used) == used && ok;
+        used = 0;
+    }
+    if (used + size > out->size())
+        out->resize(qMax(qMax(out->size() * 2, used + size), 256));
+}
+
+bool QxtJSONWriter::finish()
+{
+    if (device)
+    {
+        if (used > 0)
+            ok = device->write(out->constData(), used) == used && ok;
+        used = 0;
+    }
+    out->resize(used);
+    return ok;
+}
+
+void QxtJSONWriter::putNewLine(int depth)
+{
+    char* s = reserve(depth * 4 + 1);
+    *s++ = '\n';
+    memset(s, ' ', depth * 4);
+    used += depth * 4 + 1;
+}
+
+// Escapes and encodes a string in one pass over its UTF-16 data. A UTF-16 unit needs at most six bytes ("\u001f"),
+// so room is reserved for a chunk of units at a time; reserving for the whole string at once would overflow for
+// strings of a few hundred million characters. A surrogate pair may end one unit past its chunk, but takes only four
+// bytes for two units. Unpaired surrogates are written as \u escapes to keep the output valid UTF-8.
+void QxtJSONWriter::putString(const QString& text)
+{
+    static const char hex[] = "0123456789abcdef";
+    enum { unitsPerChunk = chunkSize / 6 };
+    const ushort* s = text.utf16();
+    const int size = text.size();
+    put('"');
+    int i = 0;
+    while (i < size)
+    {
+        const int end = i + qMin(size - i, int(unitsPerChunk));
+        char* o = reserve((end - i) * 6);
+        char* const begin = o;
+        for (; i < end; i++)
+        {
+            const ushort c = s[i];
+            if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\')
+            {
+                *o++ = char(c);
+            }
+            else if (c < 0x80)
+            {
+                *o++ = '\\';
+                switch (c)
+                {
+                case '"': *o++ = '"'; break;
+                case '\\': *o++ = '\\'; break;
+                case '\n': *o++ = 'n'; break;
+                case '\r': *o++ = 'r'; break;
+                case '\t': *o++ = 't'; break;
+                case '\b': *o++ = 'b'; break;
+                case '\f': *o++ = 'f'; break;
+                default:
+                    *o++ = 'u';
+                    *o++ = '0';
+                    *o++ = '0';
+                    *o++ = hex[c >> 4];
+                    *o++ = hex[c & 0xf];
+                }
+            }
+            else if (c < 0x800)
+            {
+                *o++ = char(0xc0 | (c >> 6));
+                *o++ = char(0x80 | (c & 0x3f));
+            }
+            else if (c >= 0xd800 && c < 0xdc00 && i + 1 < size && s[i + 1] >= 0xdc00 && s[i + 1] < 0xe000)
+            {
+                const uint u = 0x10000 + ((uint(c) - 0xd800) << 10) + (s[++i] - 0xdc00);
+                *o++ = char(0xf0 | (u >> 18));
+                *o++ = char(0x80 | ((u >> 12) & 0x3f));
+                *o++ = char(0x80 | ((u >> 6) & 0x3f));
+                *o++ = char(0x80 | (u & 0x3f));
+            }
+            else if (c >= 0xd800 && c < 0xe000)
+            {
+                *o++ = '\\';
+                *o++ = 'u';
+                *o++ = hex[c >> 12];
+                *o++ = hex[(c >> 8) & 0xf];
+                *o++ = hex[(c >> 4) & 0xf];
+                *o++ = hex[c & 0xf];
+            }
+            else
+            {
+                *o++ = char(0xe0 | (c >> 12));
+                *o++ = char(0x80 | ((c >> 6) & 0x3f));
+                *o++ = char(0x80 | (c & 0x3f));
+            }
+        }
+        used += int(o - begin);
+    }
+    put('"');
+}
+
+void QxtJSONWriter::putInteger(qlonglong value)
+{
+    if (value < 0)
+    {
+        put('-');
+        putUnsigned(qulonglong(-(value + 1)) + 1);
+    }
+    else
+    {
+        putUnsigned(qulonglong(value));
+    }
+}
+
+void QxtJSONWriter::putUnsigned(qulonglong value)
+{
+    char digits[20];
+    int n = sizeof digits;
+    do { digits[--n] = char('0' + value % 10); value /= 10; } while (value);
+    put(digits + n, sizeof digits - n);
+}
+
+// The shorter of %.15g and %.17g that reads back as the same value. printf follows LC_NUMERIC, which
+// QCoreApplication sets from the environment, so a decimal comma is turned back into a point. JSON has no NaN or
+// infinity, so they are written as null.
+void QxtJSONWriter::putDouble(double value)
+{
+    if (value != value || value - value != 0)
+    {
+        put("null", 4);
+        return;
+    }
+    char text[32];
+    int size = qsnprintf(text, sizeof text, "%.15g", value);
+    char* comma = static_cast<char*>(memchr(text, ',', size));
+    if (comma) *comma = '.';
+    if (QByteArray::fromRawData(text, size).toDouble() != value)
+    {
+        size = qsnprintf(text, sizeof text, "%.17g", value);
+        comma = static_cast<char*>(memchr(text, ',', size));
+        if (comma) *comma = '.';
+    }
+    put(text, size);
+}
+
+template <typename List>
+void QxtJSONWriter::putArray(const List& list, int depth)
+{
+    put('[');
+    for (int i = 0; i < list.count(); i++)
+    {
+        if (i) put(',');
+        if (indented) putNewLine(depth + 1);
+        putElement(list.at(i), depth + 1);
+    }
+    if (indented && !list.isEmpty()) putNewLine(depth);
+    put(']');
+}
+
+template <typename Object>
+void QxtJSONWriter::putObject(const Object& object, int depth)
+{
+    put('{');
+    for (typename Object::const_iterator it = object.constBegin(); it != object.constEnd(); ++it)
+    {
+        if (it != object.constBegin()) put(',');
+        if (indented) putNewLine(depth + 1);
+        putString(it.key());
+        if (indented) put(": ", 2);
+        else put(':');
+        putValue(it.value(), depth + 1);
+    }
+    if (indented && !object.isEmpty()) putNewLine(depth);
+    put('}');
+}
+
+// Containers are visited where they are stored in the QVariant instead of through copies. Containers nested more
+// than maxDepth levels deep are not followed, so that a cyclic or hostile value cannot overflow the stack.
+void QxtJSONWriter::putValue(const QVariant& value, int depth)
+{
+    if (value.isNull())
+    {
+        put("null", 4);
+        return;
+    }
+    switch (int(value.type()))
+    {
+    case QVariant::String:
+        putString(*reinterpret_cast<const QString*>(value.constData()));
+        return;
+    case QVariant::Bool:
+        if (value.toBool()) put("true", 4);
+        else put("false", 5);
+        return;
+    case QVariant::Int:
+    case QVariant::LongLong:
+        putInteger(value.toLongLong());
+        return;
+    case QVariant::UInt:
+    case QVariant::ULongLong:
+        putUnsigned(value.toULongLong());
+        return;
+    case QVariant::Double:
+    case QMetaType::Float:
+        putDouble(value.toDouble());
+        return;
+    case QVariant::List:
+        if (depth >= maxDepth) break;
+        putArray(*reinterpret_cast<const QVariantList*>(value.constData()), depth);
+        return;
+    case QVariant::StringList:
+        putArray(*reinterpret_cast<const QStringList*>(value.constData()), depth);
+        return;
+    case QVariant::Map:
+        if (depth >= maxDepth) break;
+        putObject(*reinterpret_cast<const QVariantMap*>(value.constData()), depth);
+        return;
+#if QT_VERSION >= 0x040500
+    case QVariant::Hash:
+        if (depth >= maxDepth) break;
+        putObject(*reinterpret_cast<const QVariantHash*>(value.constData()), depth);
+        return;
+#endif
+    default:
+        putString(value.toString());
+        return;
+    }
+    // Only reached for a container nested too deeply.
+    ok = false;
+    put("null", 4);
+}
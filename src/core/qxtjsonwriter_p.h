@@ -0,0 +1,94 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTJSONWRITER_P_H
+#define QXTJSONWRITER_P_H
+
+#include "qxtjson.h"
+#include <QByteArray>
+#include <QVariant>
+#include <string.h>
+
+#ifndef QXT_DOXYGEN_RUN
+
+/*******************************************************************************
+    QxtJSONWriter
+    Encodes JSON as UTF-8 into a byte buffer, starting at its current end.
+
+    Strings are escaped in a single pass over their UTF-16 data and numbers
+    are formatted without going through QString. With a device, the output
+    is written to it whenever chunkSize bytes have collected, so that a large
+    document is never held in memory as a whole. Used by QxtJSON and by
+    QxtJsonFileLoggerEngine, which composes records from the put functions
+    and reuses one buffer for all of them.
+*******************************************************************************/
+class QxtJSONWriter
+{
+public:
+    explicit QxtJSONWriter(QByteArray* out, QIODevice* device = 0, QxtJSON::Format format = QxtJSON::Compact)
+            : out(out), device(device), indented(format == QxtJSON::Indented), used(out->size()), ok(true) {}
+
+    enum { chunkSize = 16384 };
+    enum { maxDepth = 1024 };   // deeper containers are written as null and make finish() return false
+
+    void putValue(const QVariant& value, int depth = 0);
+    void putString(const QString& text);
+    void putInteger(qlonglong value);
+    void putUnsigned(qulonglong value);
+    void putDouble(double value);
+    inline void put(char c) { *reserve(1) = c; used++; }
+    inline void put(const char* data, int size) { memcpy(reserve(size), data, size); used += size; }
+
+    // The number of bytes written to the buffer; clear() starts over at its beginning without freeing it. finish()
+    // returns false if the device did not take all of the output or a value was nested too deeply.
+    inline int size() const { return used; }
+    inline void clear() { used = 0; }
+    bool finish();
+
+private:
+    inline char* reserve(int size)
+    {
+        if (used + size > out->size())
+            grow(size);
+        return out->data() + used;
+    }
+
+    void grow(int size);
+    void putNewLine(int depth);
+    inline void putElement(const QVariant& value, int depth) { putValue(value, depth); }
+    inline void putElement(const QString& text, int) { putString(text); }
+    template <typename List> void putArray(const List& list, int depth);
+    template <typename Object> void putObject(const Object& object, int depth);
+
+    QByteArray* out;
+    QIODevice* device;
+    bool indented;
+    int used;
+    bool ok;
+};
+
+#endif // QXT_DOXYGEN_RUN
+
+#endif // QXTJSONWRITER_P_H
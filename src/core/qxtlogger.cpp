@@ -126,16 +126,128 @@
 #include "qxtlogger_p.h"
 #include "qxtlogstream.h"
 #include "qxtbasicstdloggerengine.h"
+#include "qxtbinarylog_p.h"
 #include <QtDebug>
 #include <QMutex>
 #include <QMutexLocker>
 
+static inline int qxtLoadAcquire(QAtomicInt& value)
+{
+    return value.fetchAndAddAcquire(0);
+}
+
+/*******************************************************************************
+Bounded MPSC ring buffer, after Dmitry Vyukov's bounded queue. Each cell
+carries a sequence number: a producer may fill the cell at position p once
+its sequence equals p, and the consumer may take it once it equals p + 1.
+*******************************************************************************/
+QxtLogRingBuffer::QxtLogRingBuffer(int capacity) : enqueuePos(0), dequeuePos(0)
+{
+    int size = 2;
+    while (size < capacity) size <<= 1;
+    mask = size - 1;
+    cells = new Cell[size];
+    for (int i = 0; i < size; i++)
+        cells[i].sequence = i;
+}
+
+QxtLogRingBuffer::~QxtLogRingBuffer()
+{
+    delete[] cells;
+}
+
+bool QxtLogRingBuffer::enqueue(const QxtLogRecord& record)
+{
+    Cell* cell;
+    int pos = qxtLoadAcquire(enqueuePos);
+    forever
+    {
+        cell = &cells[pos & mask];
+        int diff = int(uint(qxtLoadAcquire(cell->sequence)) - uint(pos));
+        if (diff == 0)
+        {
+            if (enqueuePos.testAndSetRelaxed(pos, int(uint(pos) + 1))) break;
+        }
+        else if (diff < 0)
+        {
+            return false;   // full
+        }
+        pos = qxtLoadAcquire(enqueuePos);
+    }
+    cell->record = record;
+    cell->sequence.fetchAndStoreRelease(int(uint(pos) + 1));
+    return true;
+}
+
+bool QxtLogRingBuffer::dequeue(QxtLogRecord& record)
+{
+    Cell* cell = &cells[dequeuePos & mask];
+    if (int(uint(qxtLoadAcquire(cell->sequence)) - (uint(dequeuePos) + 1)) < 0)
+        return false;       // empty
+    record = cell->record;
+    cell->record.messages = QList<QVariant>();
+    cell->record.threadName = QString();
+    cell->sequence.fetchAndStoreRelease(int(uint(dequeuePos) + uint(mask) + 1));
+    dequeuePos = int(uint(dequeuePos) + 1);
+    return true;
+}
+
+bool QxtLogRingBuffer::isEmpty()
+{
+    Cell* cell = &cells[dequeuePos & mask];
+    return int(uint(qxtLoadAcquire(cell->sequence)) - (uint(dequeuePos) + 1)) < 0;
+}
+
+/*******************************************************************************
+Writer thread for asynchronous logging
+*******************************************************************************/
+QxtLoggerWriterThread::QxtLoggerWriterThread(QxtLoggerPrivate* logger) : logger(logger)
+{
+}
+
+void QxtLoggerWriterThread::stop()
+{
+    logger->writerMutex.lock();
+    logger->stopWriter = true;
+    logger->writerWake.wakeAll();
+    logger->writerMutex.unlock();
+    wait();
+}
+
+void QxtLoggerWriterThread::run()
+{
+    forever
+    {
+        logger->drain();
+        QMutexLocker lock(&logger->writerMutex);
+        logger->drained.wakeAll();
+        if (logger->queue->isEmpty())
+        {
+            if (logger->stopWriter) break;
+            // Producers only take writerMutex when they see this flag, so the
+            // common case of logging while the writer is busy stays lock-free.
+            logger->writerSleeping.fetchAndStoreOrdered(1);
+            if (logger->queue->isEmpty())
+                logger->writerWake.wait(&logger->writerMutex, 100);
+            logger->writerSleeping.fetchAndStoreOrdered(0);
+        }
+    }
+}
+
 /*******************************************************************************
 Constructor for QxtLogger's private data
 *******************************************************************************/
 QxtLoggerPrivate::QxtLoggerPrivate()
+        : enabledLevels(QxtLogger::NoLevels), async(0), asyncUsers(0), overflowPolicy(QxtLogger::BlockOnOverflow), queue(0), writer(0),
+        dropped(0), writerSleeping(0), enqueued(0), written(0), stopWriter(false)
 {
     mut_lock = new QMutex(QMutex::Recursive);
+    batchSize = 1;
+    batchInterval = 1000;
+    connect(&batchTimer, SIGNAL(timeout()), this, SLOT(flushAllBatches()));
+    threadTagging = false;
+    recordThreadId = 0;
+    qRegisterMetaType<QxtLogRecord>("QxtLogRecord");
 }
 
 /*******************************************************************************
@@ -143,6 +255,15 @@ Destructor for QxtLogger's private data
 *******************************************************************************/
 QxtLoggerPrivate::~QxtLoggerPrivate()
 {
+    flushAllBatches();
+    contextLock.lock();
+    Q_FOREACH(QxtLogThreadContext* context, contextList)
+        context->logger = 0;
+    contextList.clear();
+    contextLock.unlock();
+    stopAsync();
+    delete queue;
+    queue = 0;
     Q_FOREACH(QxtLoggerEngine *eng, map_logEngineMap)
     {
         if (eng)
@@ -155,15 +276,262 @@ QxtLoggerPrivate::~QxtLoggerPrivate()
     mut_lock = NULL;
 }
 
-void QxtLoggerPrivate::log(QxtLogger::LogLevel level, const QList<QVariant>& msgList)
+void QxtLoggerPrivate::log(const QxtLogRecord& record)
+{
+    QMutexLocker lock(mut_lock);
+    // engines may log themselves; restore the outer record's identity afterwards
+    const quint64 outerId = recordThreadId;
+    const QString outerName = recordThreadName;
+    recordThreadId = record.threadId;
+    recordThreadName = record.threadName;
+    Q_FOREACH(QxtLoggerEngine *eng, map_logEngineMap)
+    {
+        if (eng && eng->isInitialized() && eng->isLoggingEnabled() && eng->isLogLevelEnabled(record.level))
+        {
+            if (QxtLoggerEngineExtension* extension = dynamic_cast<QxtLoggerEngineExtension*>(eng))
+                extension->writeRecord(record);
+            else
+                eng->writeFormatted(record.level, record.messages);
+        }
+    }
+    recordThreadId = outerId;
+    recordThreadName = outerName;
+}
+
+/*******************************************************************************
+Per-thread logging state
+*******************************************************************************/
+QxtLogThreadContext::QxtLogThreadContext(QxtLoggerPrivate* logger) : logger(logger)
+{
+    id = quint64(quintptr(QThread::currentThreadId()));
+    if (QThread* thread = QThread::currentThread())
+        name = thread->objectName();
+}
+
+QxtLogThreadContext::~QxtLogThreadContext()
+{
+    // logger is cleared when the logger goes first, at application exit
+    if (!logger) return;
+    logger->flushBatch(this);
+    QMutexLocker lock(&logger->contextLock);
+    logger->contextList.removeAll(this);
+}
+
+QxtLogThreadContext* QxtLoggerPrivate::threadContext()
+{
+    QxtLogThreadContext* context = contexts.localData();
+    if (!context)
+    {
+        context = new QxtLogThreadContext(this);
+        contexts.setLocalData(context);
+        QMutexLocker lock(&contextLock);
+        contextList.append(context);
+    }
+    return context;
+}
+
+QxtLogRecord QxtLoggerPrivate::makeRecord(QxtLogger::LogLevel level, const QList<QVariant>& messages)
+{
+    const QxtLogThreadContext* context = threadContext();
+    QxtLogRecord record;
+    record.level = level;
+    record.messages = messages;
+    record.time = QxtBinaryLog::currentMSecsSinceEpoch();
+    record.threadId = context->id;
+    record.threadName = context->name;
+    return record;
+}
+
+/*******************************************************************************
+Hands a record to the engines, through the asynchronous queue if it is enabled.
+*******************************************************************************/
+void QxtLoggerPrivate::submit(const QxtLogRecord& record)
+{
+    if (beginAsync())
+    {
+        enqueue(record);
+        endAsync();
+        return;
+    }
+    QMutexLocker lock(mut_lock);
+    QMetaObject::invokeMethod(this, "log", Qt::AutoConnection, Q_ARG(QxtLogRecord, record));
+}
+
+/*******************************************************************************
+Submits the records staged by one thread. The batch is taken under the
+context's own mutex, so the global lock is acquired once per batch rather
+than once per record.
+*******************************************************************************/
+void QxtLoggerPrivate::flushBatch(QxtLogThreadContext* context)
+{
+    context->mutex.lock();
+    const QList<QxtLogRecord> records = context->batch;
+    context->batch.clear();
+    context->mutex.unlock();
+    if (records.isEmpty()) return;
+
+    if (beginAsync())
+    {
+        Q_FOREACH(const QxtLogRecord& record, records)
+            enqueue(record);
+        endAsync();
+        return;
+    }
+    QMutexLocker lock(mut_lock);
+    Q_FOREACH(const QxtLogRecord& record, records)
+        QMetaObject::invokeMethod(this, "log", Qt::AutoConnection, Q_ARG(QxtLogRecord, record));
+}
+
+/*******************************************************************************
+Submits the records staged by every thread. The batches are collected first
+and submitted after contextLock is released, because an engine may log from
+a thread that has no context yet.
+*******************************************************************************/
+void QxtLoggerPrivate::flushAllBatches()
 {
+    QList<QxtLogRecord> records;
+    contextLock.lock();
+    Q_FOREACH(QxtLogThreadContext* context, contextList)
+    {
+        QMutexLocker lock(&context->mutex);
+        records += context->batch;
+        context->batch.clear();
+    }
+    contextLock.unlock();
+    Q_FOREACH(const QxtLogRecord& record, records)
+        submit(record);
+}
+
+/*******************************************************************************
+Runs the batch timer while batching is enabled. Called through the event loop
+when the batch settings are changed from another thread, since a timer can
+only be started from its own thread.
+*******************************************************************************/
+void QxtLoggerPrivate::updateBatchTimer()
+{
+    if (batchSize > 1 && batchInterval > 0)
+        batchTimer.start(batchInterval);
+    else
+        batchTimer.stop();
+}
+
+/*******************************************************************************
+Registers the calling thread as a user of the asynchronous pipeline and
+returns true if asynchronous mode is on; the caller must then call endAsync().
+The count is raised before the mode is read, and stopAsync() clears the mode
+before it reads the count, so either this returns false or stopAsync() waits.
+*******************************************************************************/
+bool QxtLoggerPrivate::beginAsync()
+{
+    asyncUsers.ref();
+    if (async.fetchAndAddOrdered(0)) return true;
+    asyncUsers.deref();
+    return false;
+}
+
+/*******************************************************************************
+Switches asynchronous mode off. The writer thread keeps running until every
+thread that saw the mode on has queued its messages, so that a thread blocked
+on a full queue can finish, and everything queued is written before return.
+*******************************************************************************/
+void QxtLoggerPrivate::stopAsync()
+{
+    if (!writer) return;
+    async.fetchAndStoreOrdered(0);
+    while (asyncUsers.fetchAndAddOrdered(0) != 0)
+        QThread::yieldCurrentThread();
+    writer->stop();
+    delete writer;
+    writer = 0;
+    drain();
+}
+
+/*******************************************************************************
+Places a message in the asynchronous queue, applying the overflow policy if
+the queue is full. Fatal messages are flushed before returning.
+*******************************************************************************/
+void QxtLoggerPrivate::enqueue(const QxtLogRecord& record)
+{
+    const QxtLogger::LogLevel level = record.level;
+    while (!queue->enqueue(record))
+    {
+        if (overflowPolicy == QxtLogger::DropOnOverflow
+                || (overflowPolicy == QxtLogger::DropDebugOnOverflow && (level & (QxtLogger::TraceLevel | QxtLogger::DebugLevel))))
+        {
+            dropped.fetchAndAddRelaxed(1);
+            return;
+        }
+        if (QThread::currentThread() == writer)
+        {
+            // an engine is logging; waiting for ourselves would never end
+            log(record);
+            return;
+        }
+        wakeWriter();
+        QThread::yieldCurrentThread();
+    }
+    enqueued.fetchAndAddRelease(1);
+    if (qxtLoadAcquire(writerSleeping)) wakeWriter();
+    if (level == QxtLogger::FatalLevel) waitUntilDrained();
+}
+
+void QxtLoggerPrivate::wakeWriter()
+{
+    QMutexLocker lock(&writerMutex);
+    writerWake.wakeOne();
+}
+
+/*******************************************************************************
+Passes every queued message to the engines. Only the writer thread calls this,
+except while asynchronous mode is being switched off.
+*******************************************************************************/
+int QxtLoggerPrivate::drain()
+{
+    QxtLogRecord record;
+    int count = 0;
+    QMutexLocker lock(mut_lock);
+    while (queue->dequeue(record))
+    {
+        log(record);
+        record.messages.clear();
+        count++;
+        written.fetchAndAddRelease(1);
+    }
+    int lost = dropped.fetchAndStoreRelaxed(0);
+    if (lost > 0)
+        log(makeRecord(QxtLogger::WarningLevel, QList<QVariant>() << QString("QxtLogger: %1 messages dropped, asynchronous queue full").arg(lost)));
+    return count;
+}
+
+void QxtLoggerPrivate::waitUntilDrained()
+{
+    if (!writer || QThread::currentThread() == writer) return;
+    int target = qxtLoadAcquire(enqueued);
+    QMutexLocker lock(&writerMutex);
+    while (int(uint(qxtLoadAcquire(written)) - uint(target)) < 0 && writer->isRunning())
+    {
+        writerWake.wakeOne();
+        drained.wait(&writerMutex, 100);
+    }
+}
+
+/*******************************************************************************
+Recomputes the union of the levels wanted by the enabled engines. Called with
+mut_lock held whenever an engine is added, removed, enabled or disabled, or
+changes its levels.
+*******************************************************************************/
+void QxtLoggerPrivate::updateEnabledLevels()
+{
+    int levels = QxtLogger::NoLevels;
     Q_FOREACH(QxtLoggerEngine *eng, map_logEngineMap)
     {
-        if (eng && eng->isInitialized() && eng->isLoggingEnabled() && eng->isLogLevelEnabled(level))
+        if (!eng || !eng->isLoggingEnabled()) continue;
+        for (int level = QxtLogger::TraceLevel; level <= QxtLogger::WriteLevel; level <<= 1)
         {
-            eng->writeFormatted(level, msgList);
+            if (eng->isLogLevelEnabled(QxtLogger::LogLevel(level))) levels |= level;
         }
     }
+    enabledLevels.fetchAndStoreRelease(levels);
 }
 
 void QxtLoggerPrivate::setQxtLoggerEngineMinimumLevel(QxtLoggerEngine *eng, QxtLogger::LogLevel level)
@@ -284,7 +652,7 @@ QxtLogStream QxtLogger::write()
 */
 void QxtLogger::info(const QVariant &message, const QVariant &msg1, const QVariant &msg2, const QVariant &msg3, const QVariant &msg4, const QVariant &msg5, const QVariant &msg6, const QVariant &msg7, const QVariant &msg8 , const QVariant &msg9)
 {
-    QMutexLocker lock(qxt_d().mut_lock);
+    if (!isLevelEnabled(QxtLogger::InfoLevel)) return;
     QList<QVariant> args;
     args.push_back(message);
     if (!msg1.isNull()) args.push_back(msg1);
@@ -308,7 +676,7 @@ void QxtLogger::info(const QVariant &message, const QVariant &msg1, const QVaria
 */
 void QxtLogger::trace(const QVariant &message, const QVariant &msg1 , const QVariant &msg2 , const QVariant &msg3 , const QVariant &msg4 , const QVariant &msg5 , const QVariant &msg6 , const QVariant &msg7 , const QVariant &msg8 , const QVariant &msg9)
 {
-    QMutexLocker lock(qxt_d().mut_lock);
+    if (!isLevelEnabled(QxtLogger::TraceLevel)) return;
     QList<QVariant> args;
     args.push_back(message);
     if (!msg1.isNull()) args.push_back(msg1);
@@ -331,7 +699,7 @@ void QxtLogger::trace(const QVariant &message, const QVariant &msg1 , const QVar
 */
 void QxtLogger::warning(const QVariant &message, const QVariant &msg1 , const QVariant &msg2 , const QVariant &msg3 , const QVariant &msg4 , const QVariant &msg5 , const QVariant &msg6 , const QVariant &msg7 , const QVariant &msg8 , const QVariant &msg9)
 {
-    QMutexLocker lock(qxt_d().mut_lock);
+    if (!isLevelEnabled(QxtLogger::WarningLevel)) return;
     QList<QVariant> args;
     args.push_back(message);
     if (!msg1.isNull()) args.push_back(msg1);
@@ -354,7 +722,7 @@ void QxtLogger::warning(const QVariant &message, const QVariant &msg1 , const QV
 */
 void QxtLogger::error(const QVariant &message, const QVariant &msg1 , const QVariant &msg2 , const QVariant &msg3 , const QVariant &msg4 , const QVariant &msg5 , const QVariant &msg6 , const QVariant &msg7 , const QVariant &msg8 , const QVariant &msg9)
 {
-    QMutexLocker lock(qxt_d().mut_lock);
+    if (!isLevelEnabled(QxtLogger::ErrorLevel)) return;
     QList<QVariant> args;
     args.push_back(message);
     if (!msg1.isNull()) args.push_back(msg1);
@@ -377,7 +745,7 @@ void QxtLogger::error(const QVariant &message, const QVariant &msg1 , const QVar
 */
 void QxtLogger::debug(const QVariant &message, const QVariant &msg1 , const QVariant &msg2 , const QVariant &msg3 , const QVariant &msg4 , const QVariant &msg5 , const QVariant &msg6 , const QVariant &msg7 , const QVariant &msg8 , const QVariant &msg9)
 {
-    QMutexLocker lock(qxt_d().mut_lock);
+    if (!isLevelEnabled(QxtLogger::DebugLevel)) return;
     QList<QVariant> args;
     args.push_back(message);
     if (!msg1.isNull()) args.push_back(msg1);
@@ -400,7 +768,7 @@ void QxtLogger::debug(const QVariant &message, const QVariant &msg1 , const QVar
 */
 void QxtLogger::write(const QVariant &message, const QVariant &msg1 , const QVariant &msg2, const QVariant &msg3 , const QVariant &msg4 , const QVariant &msg5 , const QVariant &msg6 , const QVariant &msg7 , const QVariant &msg8 , const QVariant &msg9)
 {
-    QMutexLocker lock(qxt_d().mut_lock);
+    if (!isLevelEnabled(QxtLogger::WriteLevel)) return;
     QList<QVariant> args;
     args.push_back(message);
     if (!msg1.isNull()) args.push_back(msg1);
@@ -423,7 +791,7 @@ void QxtLogger::write(const QVariant &message, const QVariant &msg1 , const QVar
 */
 void QxtLogger::critical(const QVariant &message, const QVariant &msg1 , const QVariant &msg2 , const QVariant &msg3 , const QVariant &msg4 , const QVariant &msg5 , const QVariant &msg6 , const QVariant &msg7 , const QVariant &msg8 , const QVariant &msg9)
 {
-    QMutexLocker lock(qxt_d().mut_lock);
+    if (!isLevelEnabled(QxtLogger::CriticalLevel)) return;
     QList<QVariant> args;
     args.push_back(message);
     if (!msg1.isNull()) args.push_back(msg1);
@@ -446,7 +814,7 @@ void QxtLogger::critical(const QVariant &message, const QVariant &msg1 , const Q
 */
 void QxtLogger::fatal(const QVariant &message, const QVariant &msg1 , const QVariant &msg2 , const QVariant &msg3 , const QVariant &msg4 , const QVariant &msg5 , const QVariant &msg6 , const QVariant &msg7 , const QVariant &msg8 , const QVariant &msg9)
 {
-    QMutexLocker lock(qxt_d().mut_lock);
+    if (!isLevelEnabled(QxtLogger::FatalLevel)) return;
     QList<QVariant> args;
     args.push_back(message);
     if (!msg1.isNull()) args.push_back(msg1);
@@ -540,11 +908,279 @@ void QxtLogger::write(const QList<QVariant> &args)
 */
 void QxtLogger::log(LogLevel level, const QList<QVariant>& args)
 {
-    /*
-    QMutexLocker lock(qxt_d().mut_lock);
-    qxt_d().log(level, msgList);
-    */
-    QMetaObject::invokeMethod(&qxt_d(), "log", Qt::AutoConnection, Q_ARG(QxtLogger::LogLevel, level), Q_ARG(QList<QVariant>, args));
+    if (!isLevelEnabled(level)) return;
+    QxtLoggerPrivate& d = qxt_d();
+    const QxtLogRecord record = d.makeRecord(level, args);
+    if (d.batchSize > 1)
+    {
+        QxtLogThreadContext* context = d.threadContext();
+        if (level & (TraceLevel | DebugLevel | InfoLevel))
+        {
+            context->mutex.lock();
+            context->batch.append(record);
+            const bool due = context->batch.count() >= d.batchSize
+                             || (d.batchInterval > 0 && record.time - context->batch.first().time >= d.batchInterval);
+            context->mutex.unlock();
+            if (due) d.flushBatch(context);
+            return;
+        }
+        d.flushBatch(context);  // keep the thread's records in order
+    }
+    d.submit(record);
+}
+
+/*!
+    Enables or disables asynchronous logging according to \a enable.
+
+    In asynchronous mode the logging functions place each message in a
+    lock-free queue of \a queueCapacity entries (rounded up to a power of two)
+    and return immediately. A dedicated writer thread takes the messages from
+    the queue and passes them to the logger engines, so a slow disk or a
+    blocked console no longer stalls the threads that are logging.
+
+    What happens when the queue is full is controlled by overflowPolicy().
+    FatalLevel messages are always flushed to the engines before the logging
+    call returns.
+
+    Modes may be switched while other threads are logging. Disabling
+    asynchronous mode waits for the threads that are queueing messages and
+    writes all queued messages before returning.
+
+    \sa flush(), setOverflowPolicy()
+ */
+void QxtLogger::setAsynchronous(bool enable, int queueCapacity)
+{
+    QxtLoggerPrivate& d = qxt_d();
+    QMutexLocker switchLock(&d.asyncSwitch);
+    if (enable)
+    {
+        QMutexLocker lock(d.mut_lock);
+        if (d.async) return;
+        if (d.queue && d.queue->capacity() < queueCapacity)
+        {
+            delete d.queue;
+            d.queue = 0;
+        }
+        if (!d.queue) d.queue = new QxtLogRingBuffer(queueCapacity);
+        d.stopWriter = false;
+        d.writer = new QxtLoggerWriterThread(&d);
+        d.writer->start();
+        d.async.fetchAndStoreOrdered(1);
+    }
+    else
+    {
+        d.stopAsync();
+    }
+}
+
+/*!
+    Returns \c true if messages are written by a background thread.
+
+    \sa setAsynchronous()
+ */
+bool QxtLogger::isAsynchronous() const
+{
+    return qxt_d().async;
+}
+
+/*!
+    Sets the \a policy applied when the asynchronous queue is full.
+
+    The default is QxtLogger::BlockOnOverflow, which never loses messages but
+    makes logging threads wait for the writer thread. DropOnOverflow and
+    DropDebugOnOverflow count discarded messages; the writer thread reports
+    the number as a warning once there is room again.
+
+    \sa droppedMessageCount()
+ */
+void QxtLogger::setOverflowPolicy(OverflowPolicy policy)
+{
+    qxt_d().overflowPolicy = policy;
+}
+
+/*!
+    Returns the policy applied when the asynchronous queue is full.
+ */
+QxtLogger::OverflowPolicy QxtLogger::overflowPolicy() const
+{
+    return qxt_d().overflowPolicy;
+}
+
+/*!
+    Returns the number of messages discarded because the asynchronous queue
+    was full and that have not been reported by the writer thread yet.
+ */
+int QxtLogger::droppedMessageCount() const
+{
+    return qxt_d().dropped;
+}
+
+/*!
+    Submits the messages staged by every thread and, in asynchronous mode,
+    blocks until every message queued so far has been passed to the logger
+    engines.
+
+    \sa setBatchSize(), setAsynchronous()
+ */
+void QxtLogger::flush()
+{
+    QxtLoggerPrivate& d = qxt_d();
+    d.flushAllBatches();
+    if (d.beginAsync())
+    {
+        d.waitUntilDrained();
+        d.endAsync();
+    }
+}
+
+/*!
+    Sets the number of trace, debug and info messages each thread collects
+    before handing them to the engines to \a size.
+
+    With a batch size greater than one, these messages are staged in a buffer
+    owned by the logging thread and submitted together, so the global logger
+    lock is taken once per batch instead of once per message. Messages of any
+    other level first submit the thread's staged messages and are then written
+    immediately, preserving the order of each thread's messages. Staged
+    messages are also submitted after batchInterval(), by flush() and when
+    their thread finishes.
+
+    Engines see batched messages only when the batch is submitted; the
+    messages keep the time they were logged at. The default of 1 disables
+    batching. Like setAsynchronous(), this should be set while no other thread
+    is logging.
+
+    \sa flush(), setBatchInterval()
+ */
+void QxtLogger::setBatchSize(int size)
+{
+    qxt_d().flushAllBatches();
+    qxt_d().batchSize = qMax(1, size);
+    QMetaObject::invokeMethod(&qxt_d(), "updateBatchTimer", Qt::AutoConnection);
+}
+
+/*!
+    Returns the number of messages each thread collects before handing them
+    to the engines.
+
+    \sa setBatchSize()
+ */
+int QxtLogger::batchSize() const
+{
+    return qxt_d().batchSize;
+}
+
+/*!
+    Sets the longest time, in milliseconds, that a batched message stays
+    staged to \a msecs. The default is 1000; 0 keeps messages staged until
+    the batch is full.
+
+    The interval is checked when the thread logs its next message and by a
+    timer running in the thread that created the logger, which submits the
+    messages of threads that have stopped logging. If that thread has no
+    event loop, the interval is only checked when the next message is logged.
+
+    \sa setBatchSize()
+ */
+void QxtLogger::setBatchInterval(int msecs)
+{
+    qxt_d().batchInterval = qMax(0, msecs);
+    QMetaObject::invokeMethod(&qxt_d(), "updateBatchTimer", Qt::AutoConnection);
+}
+
+/*!
+    Returns the longest time, in milliseconds, that a batched message stays
+    staged.
+
+    \sa setBatchInterval()
+ */
+int QxtLogger::batchInterval() const
+{
+    return qxt_d().batchInterval;
+}
+
+/*!
+    Sets the \a name recorded with the messages logged by the calling thread.
+
+    By default a thread is known by the objectName() of its QThread, or by its
+    id if that is empty.
+
+    \sa recordThreadName(), setThreadTaggingEnabled()
+ */
+void QxtLogger::setThreadName(const QString& name)
+{
+    qxt_d().threadContext()->name = name;
+}
+
+/*!
+    Returns the name recorded with the messages logged by the calling thread.
+ */
+QString QxtLogger::threadName() const
+{
+    // the calling thread's context is created on first use
+    return const_cast<QxtLoggerPrivate&>(qxt_d()).threadContext()->name;
+}
+
+/*!
+    Enables or disables a thread field in the output of the text logger
+    engines according to \a enable. The field holds QxtLogRecord::threadTag().
+    It is disabled by default.
+ */
+void QxtLogger::setThreadTaggingEnabled(bool enable)
+{
+    qxt_d().threadTagging = enable;
+}
+
+/*!
+    Returns \c true if the text logger engines write the thread of each
+    message.
+
+    \sa setThreadTaggingEnabled()
+ */
+bool QxtLogger::isThreadTaggingEnabled() const
+{
+    return qxt_d().threadTagging;
+}
+
+/*!
+    Returns the id of the thread that logged the message being written.
+
+    Every message carries the identity of the thread that logged it, even
+    when a batch or the asynchronous writer thread passes it to the engines.
+    This function is meant to be called by logger engines from
+    QxtLoggerEngine::writeFormatted(); elsewhere its value is unspecified.
+    Engines that implement QxtLoggerEngineExtension find the thread in each
+    QxtLogRecord instead.
+
+    \sa recordThreadName(), recordThreadTag()
+ */
+quint64 QxtLogger::recordThreadId() const
+{
+    return qxt_d().recordThreadId;
+}
+
+/*!
+    Returns the name of the thread that logged the message being written.
+
+    \sa recordThreadId(), setThreadName()
+ */
+QString QxtLogger::recordThreadName() const
+{
+    return qxt_d().recordThreadName;
+}
+
+/*!
+    Returns the name of the thread that logged the message being written, or
+    its id in hexadecimal if the thread has no name.
+
+    \sa recordThreadId(), recordThreadName()
+ */
+QString QxtLogger::recordThreadTag() const
+{
+    QxtLogRecord record;
+    record.threadId = qxt_d().recordThreadId;
+    record.threadName = qxt_d().recordThreadName;
+    return record.threadTag();
 }
 
 /*******************************************************************************
@@ -957,6 +1593,8 @@ void QxtLogger::addLoggerEngine(const QString &engineName, QxtLoggerEngine *engi
     if (!qxt_d().map_logEngineMap.contains(engineName) && engine)
     {
         qxt_d().map_logEngineMap.insert(engineName, engine);
+        engine->setLogger(this);
+        qxt_d().updateEnabledLevels();
         emit loggerEngineAdded(engineName);
     }
 }
@@ -1028,6 +1666,8 @@ QxtLoggerEngine *QxtLogger::takeLoggerEngine(const QString &engineName)
     QMutexLocker lock(qxt_d().mut_lock);
     QxtLoggerEngine *eng = qxt_d().map_logEngineMap.take(engineName);
     if (!eng) return NULL;
+    if (!qxt_d().map_logEngineMap.values().contains(eng)) eng->setLogger(0);
+    qxt_d().updateEnabledLevels();
     emit loggerEngineRemoved(engineName);
     return eng;
 }
@@ -1107,3 +1747,38 @@ bool QxtLogger::isLoggerEngineEnabled(const QString &engineName) const
     QMutexLocker lock(qxt_d().mut_lock);
     return (qxt_d().map_logEngineMap.contains(engineName) && qxt_d().map_logEngineMap.value(engineName)->isLoggingEnabled());
 }
+
+/*! \brief Checks if any enabled Engine wants messages of the given level.
+    This check does not lock and is meant to be done before a message is put
+    together; the logging functions and QxtLogStream do it themselves. Use the
+    qxtLogEnabled() and qxtLogStream() macros to also skip evaluating the
+    arguments of a message nobody would see.
+    \code
+    if (qxtLog->isLevelEnabled(QxtLogger::DebugLevel))
+        qxtLog->debug(expensiveDump());
+    \endcode
+    \sa enabledLevels()
+*/
+bool QxtLogger::isLevelEnabled(LogLevel level) const
+{
+    return (int(qxt_d().enabledLevels) & level);
+}
+
+/*! \brief Returns the union of the LogLevels enabled on all enabled Engines.
+    \sa isLevelEnabled()
+*/
+QxtLogger::LogLevels QxtLogger::enabledLevels() const
+{
+    return LogLevels(int(qxt_d().enabledLevels));
+}
+
+/*!
+    \internal
+    Called by QxtLoggerEngine when the levels or the enabled state of an engine
+    owned by this logger change.
+*/
+void QxtLogger::updateEnabledLevels()
+{
+    QMutexLocker lock(qxt_d().mut_lock);
+    qxt_d().updateEnabledLevels();
+}
@@ -48,6 +48,10 @@ class QXT_CORE_EXPORT QxtLogger : public QObject
     QxtLogger();
     ~QxtLogger();
 
+    friend class QxtLoggerEngine;
+    friend struct QxtLogRecord;
+    void updateEnabledLevels();
+
 public:
     /*******************************************************************************
     Defines for a bitmask to enable/disable logging levels.
@@ -68,6 +72,16 @@ public:
     };
     Q_DECLARE_FLAGS(LogLevels, LogLevel)
 
+    /*******************************************************************************
+    What to do when the asynchronous queue is full.
+    *******************************************************************************/
+    enum OverflowPolicy
+    {
+        BlockOnOverflow,        /**< Wait until the writer thread has made room */
+        DropOnOverflow,         /**< Discard the message */
+        DropDebugOnOverflow     /**< Discard trace and debug messages, wait for all others */
+    };
+
     /* Sone useful things */
     static QString logLevelToString(LogLevel level);
     static QxtLogger::LogLevel stringToLogLevel(const QString& level);
@@ -94,6 +108,8 @@ public:
     QStringList allDisabledLoggerEngines() const;
 
     bool   isLogLevelEnabled(const QString& engineName, LogLevel level) const;
+    bool   isLevelEnabled(LogLevel level) const;
+    LogLevels enabledLevels() const;
     bool   isLoggerEngine(const QString& engineName) const;
     bool   isLoggerEngineEnabled(const QString& engineName) const;
 
@@ -129,6 +145,31 @@ public:
     void setMinimumLevel(LogLevel level);
     void setMinimumLevel(const QString& engineName, LogLevel level);
 
+    /*******************************************************************************
+    Asynchronous logging: messages are queued and written by a background thread.
+    *******************************************************************************/
+    void setAsynchronous(bool enable, int queueCapacity = 8192);
+    bool isAsynchronous() const;
+    void setOverflowPolicy(OverflowPolicy policy);
+    OverflowPolicy overflowPolicy() const;
+    int droppedMessageCount() const;
+    void flush();
+    void setBatchSize(int size);
+    int batchSize() const;
+    void setBatchInterval(int msecs);
+    int batchInterval() const;
+
+    /*******************************************************************************
+    Thread identity: every record carries the thread that logged it.
+    *******************************************************************************/
+    void setThreadName(const QString& name);
+    QString threadName() const;
+    void setThreadTaggingEnabled(bool enable);
+    bool isThreadTaggingEnabled() const;
+    quint64 recordThreadId() const;
+    QString recordThreadName() const;
+    QString recordThreadTag() const;
+
 public Q_SLOTS:
     /*******************************************************************************
     Logging Functions: what the QxtLogger is all about.
@@ -203,6 +244,32 @@ Q_DECLARE_METATYPE(QxtLogger::LogLevels)
 
 #define qxtLog QxtLogger::getInstance()
 
+/*******************************************************************************
+Level-checked logging: the message arguments are only evaluated if an enabled
+engine wants the level, e.g. qxtLogStream(QxtLogger::DebugLevel) << dump();
+*******************************************************************************/
+#define qxtLogEnabled(level) (qxtLog->isLevelEnabled(level))
+#define qxtLogStream(level) if (!qxtLogEnabled(level)) {} else qxtLog->stream(level)
+#define qxtLogTrace() qxtLogStream(QxtLogger::TraceLevel)
+#define qxtLogDebug() qxtLogStream(QxtLogger::DebugLevel)
+#define qxtLogInfo() qxtLogStream(QxtLogger::InfoLevel)
+#define qxtLogWarning() qxtLogStream(QxtLogger::WarningLevel)
+#define qxtLogError() qxtLogStream(QxtLogger::ErrorLevel)
+#define qxtLogCritical() qxtLogStream(QxtLogger::CriticalLevel)
+
+/*******************************************************************************
+Rate-limited logging: each call site owns a token bucket allowing perSecond
+messages on average and bursts of up to burst messages. Suppressed messages
+are not evaluated; their number is reported once the site may log again, e.g.
+qxtLogStreamLimited(QxtLogger::WarningLevel, 10, 20) << "retrying" << host;
+*******************************************************************************/
+#define qxtLogStreamLimited(level, perSecond, burst) \
+    if (!qxtLogEnabled(level)) {} else \
+    for (bool qxt_log_once = true; qxt_log_once; qxt_log_once = false) \
+    for (static QxtLogRateLimiter qxt_log_limiter(level, perSecond, burst, __FILE__, __LINE__); qxt_log_once; qxt_log_once = false) \
+        if (!qxt_log_limiter.tryAcquire()) {} else qxtLog->stream(level)
+
 #include "qxtlogstream.h"
+#include "qxtlogratelimiter.h"
 
 #endif // QXTLOGGER_H
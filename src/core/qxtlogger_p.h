@@ -27,14 +27,90 @@
 #define QXTLOGGERPRIVATE_H
 
 #include "qxtlogger.h"
+#include "qxtloggerengine.h"
 #include <QHash>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <QThreadStorage>
+#include <QTimer>
+#include <QMetaType>
+
+/*******************************************************************************
+    QxtLogThreadContext
+    Per-thread logging state: the identity stamped on the thread's records
+    and the staging buffer that collects streamed records until a batch is
+    complete. Owned by QThreadStorage and deleted when the thread finishes,
+    which hands any staged records to the logger.
+*******************************************************************************/
+class QxtLoggerPrivate;
+class QxtLogThreadContext
+{
+public:
+    QxtLogThreadContext(QxtLoggerPrivate* logger);
+    ~QxtLogThreadContext();
+
+    QxtLoggerPrivate* logger;
+    quint64 id;
+    QString name;
+    QMutex mutex;                   // guards batch against flush() from other threads
+    QList<QxtLogRecord> batch;
+};
+
+/*******************************************************************************
+    QxtLogRingBuffer
+    A bounded multi-producer, single-consumer queue of log records. Producers
+    claim a cell with a single compare-and-swap on the enqueue position and
+    publish it through the cell's sequence number, so logging threads never
+    take a lock. Only the writer thread dequeues.
+*******************************************************************************/
+class QxtLogRingBuffer
+{
+public:
+    explicit QxtLogRingBuffer(int capacity);
+    ~QxtLogRingBuffer();
+
+    bool enqueue(const QxtLogRecord& record);
+    bool dequeue(QxtLogRecord& record);
+    bool isEmpty();
+    inline int capacity() const { return mask + 1; }
+
+private:
+    struct Cell
+    {
+        QAtomicInt sequence;
+        QxtLogRecord record;
+    };
+
+    Cell* cells;
+    int mask;
+    QAtomicInt enqueuePos;
+    int dequeuePos;     // only touched by the consumer
+};
+
+/*******************************************************************************
+    QxtLoggerWriterThread
+    Drains the ring buffer into the installed engines.
+*******************************************************************************/
+class QxtLoggerWriterThread : public QThread
+{
+public:
+    QxtLoggerWriterThread(QxtLoggerPrivate* logger);
+    void stop();
+
+protected:
+    virtual void run();
+
+private:
+    QxtLoggerPrivate* logger;
+};
 
 /*******************************************************************************
     QxtLoggerPrivate
     This is the d_ptr private class containing the actual data this library
     works with.
 *******************************************************************************/
-QT_FORWARD_DECLARE_CLASS(QMutex)
 class QxtLoggerPrivate : public QObject, public QxtPrivate<QxtLogger>
 {
     Q_OBJECT
@@ -43,11 +119,58 @@ public:
     QxtLoggerPrivate();
     ~QxtLoggerPrivate();
     void setQxtLoggerEngineMinimumLevel(QxtLoggerEngine *engine, QxtLogger::LogLevel level);
+    void updateEnabledLevels();
     QHash<QString, QxtLoggerEngine*> map_logEngineMap;
     QMutex* mut_lock;
+    QAtomicInt enabledLevels;
+
+    // Thread identity and stream batching
+    QxtLogThreadContext* threadContext();
+    QxtLogRecord makeRecord(QxtLogger::LogLevel level, const QList<QVariant>& messages);
+    void submit(const QxtLogRecord& record);
+    void flushBatch(QxtLogThreadContext* context);
+
+    QThreadStorage<QxtLogThreadContext*> contexts;
+    QList<QxtLogThreadContext*> contextList;
+    QMutex contextLock;
+    int batchSize;
+    int batchInterval;
+    QTimer batchTimer;              // submits batches of idle threads
+    bool threadTagging;
+    quint64 recordThreadId;         // identity of the record being written,
+    QString recordThreadName;       // valid while mut_lock is held
+
+    // Asynchronous pipeline. A thread uses the queue and the writer thread
+    // only between beginAsync() and endAsync(); stopAsync() switches the mode
+    // off and waits for those threads before it stops the writer thread, so
+    // no message is queued after the last drain.
+    bool beginAsync();
+    inline void endAsync() { asyncUsers.deref(); }
+    void stopAsync();
+    void enqueue(const QxtLogRecord& record);
+    void wakeWriter();
+    int drain();
+    void waitUntilDrained();
+
+    QAtomicInt async;
+    QAtomicInt asyncUsers;
+    QMutex asyncSwitch;             // serializes setAsynchronous()
+    QxtLogger::OverflowPolicy overflowPolicy;
+    QxtLogRingBuffer* queue;
+    QxtLoggerWriterThread* writer;
+    QAtomicInt dropped;
+    QAtomicInt writerSleeping;
+    QAtomicInt enqueued;
+    QAtomicInt written;
+    QMutex writerMutex;
+    QWaitCondition writerWake;
+    QWaitCondition drained;
+    volatile bool stopWriter;
 
 public Q_SLOTS:
-    void log(QxtLogger::LogLevel, const QList<QVariant>&);
+    void log(const QxtLogRecord& record);
+    void updateBatchTimer();
+    void flushAllBatches();
 };
 
 #endif // QXTLOGGERPRIVATE_H
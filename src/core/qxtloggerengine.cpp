@@ -24,6 +24,8 @@
  ****************************************************************************/
 
 #include "qxtloggerengine.h"
+#include "qxtlogger_p.h"
+#include "qxtbinarylog_p.h"
 
 /*! \class QxtLoggerEngine
     \brief The QxtLoggerEngine class is the parent class of all extended Engine Plugins.
@@ -44,10 +46,11 @@ public:
 
     QxtLogger::LogLevels    bm_logLevel;
     bool                    b_isLogging;
+    QxtLogger*              logger;
 };
 
 QxtLoggerEnginePrivate::QxtLoggerEnginePrivate()
-        : bm_logLevel(QxtLogger::AllLevels), b_isLogging(true)
+        : bm_logLevel(QxtLogger::AllLevels), b_isLogging(true), logger(0)
 {
 }
 
@@ -97,6 +100,8 @@ QxtLoggerEngine::~QxtLoggerEngine()
     Writes formatted \a messages with given \a level.
 
     This function is called by QxtLogger. Reimplement this function when creating a subclass of QxtLoggerEngine.
+
+    QxtLogger calls QxtLoggerEngineExtension::writeRecord() instead if the engine implements it.
  */
 
 /*!
@@ -129,6 +134,7 @@ void QxtLoggerEngine::disableLogging()
 void QxtLoggerEngine::setLoggingEnabled(bool enable)
 {
     qxt_d().b_isLogging = enable;
+    if (qxt_d().logger) qxt_d().logger->updateEnabledLevels();
 }
 
 /*!
@@ -144,6 +150,7 @@ void QxtLoggerEngine::setLogLevelsEnabled(QxtLogger::LogLevels levels, bool enab
     {
         qxt_d().bm_logLevel &= ~levels;
     }
+    if (qxt_d().logger) qxt_d().logger->updateEnabledLevels();
 }
 
 /*!
@@ -169,3 +176,86 @@ bool QxtLoggerEngine::isLogLevelEnabled(QxtLogger::LogLevel level) const
 {
     return (qxt_d().bm_logLevel & level);
 }
+
+/*!
+    \internal
+    Sets the \a logger that owns this engine and has to be told when its
+    levels change.
+ */
+void QxtLoggerEngine::setLogger(QxtLogger* logger)
+{
+    qxt_d().logger = logger;
+}
+
+/*! \class QxtLogRecord
+    \brief The QxtLogRecord class holds a single logged message.
+    \inmodule QxtCore
+
+    A record is made by the thread that logs it and carries that thread's
+    identity and the time of the call to the engines, even when a batch or
+    the asynchronous writer thread passes it on later.
+
+    \sa QxtLoggerEngineExtension
+*/
+
+/*!
+    Constructs an empty record.
+ */
+QxtLogRecord::QxtLogRecord() : level(QxtLogger::NoLevels), time(0), threadId(0)
+{
+}
+
+/*!
+    Constructs a record of \a messages with given \a level, logged by the
+    calling thread at the current time.
+ */
+QxtLogRecord::QxtLogRecord(QxtLogger::LogLevel level, const QList<QVariant>& messages)
+{
+    *this = qxtLog->qxt_d().makeRecord(level, messages);
+}
+
+/*!
+    Returns the local time the record was logged.
+ */
+QDateTime QxtLogRecord::dateTime() const
+{
+    return QxtBinaryLog::fromMSecsSinceEpoch(time);
+}
+
+/*!
+    Returns the name of the thread that logged the record, or its id in
+    hexadecimal if the thread has no name.
+
+    \sa QxtLogger::setThreadName()
+ */
+QString QxtLogRecord::threadTag() const
+{
+    if (!threadName.isEmpty()) return threadName;
+    return "0x" + QString::number(threadId, 16);
+}
+
+/*! \class QxtLoggerEngineExtension
+    \brief The QxtLoggerEngineExtension class is an optional interface for logger engines that write whole records.
+    \inmodule QxtCore
+
+    A QxtLoggerEngine subclass that also inherits QxtLoggerEngineExtension is
+    passed every message as a QxtLogRecord, with the time it was logged and
+    the thread that logged it. QxtLogger finds the extension with
+    dynamic_cast; engines that do not implement it are passed the level and
+    the messages through QxtLoggerEngine::writeFormatted() alone. All
+    engines included with QxtLogger implement it.
+*/
+
+/*!
+    \fn QxtLoggerEngineExtension::~QxtLoggerEngineExtension()
+
+    Destroys the QxtLoggerEngineExtension.
+ */
+
+/*!
+    \fn virtual void QxtLoggerEngineExtension::writeRecord(const QxtLogRecord& record) = 0
+
+    Writes \a record.
+
+    This function is called by QxtLogger instead of QxtLoggerEngine::writeFormatted().
+ */
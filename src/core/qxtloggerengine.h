@@ -30,8 +30,26 @@
 #include <QVariant>
 #include <QIODevice>
 #include <QFile>
+#include <QDateTime>
+#include <QMetaType>
 #include "qxtlogger.h"
 
+struct QXT_CORE_EXPORT QxtLogRecord
+{
+    QxtLogRecord();
+    QxtLogRecord(QxtLogger::LogLevel level, const QList<QVariant>& messages);
+
+    QxtLogger::LogLevel level;
+    QList<QVariant> messages;
+    qint64 time;                    // milliseconds since the epoch
+    quint64 threadId;
+    QString threadName;
+
+    QDateTime dateTime() const;
+    QString threadTag() const;
+};
+Q_DECLARE_METATYPE(QxtLogRecord)
+
 class QxtLoggerEnginePrivate;
 
 class QXT_CORE_EXPORT QxtLoggerEngine
@@ -57,6 +75,18 @@ public:
     bool            isLogLevelEnabled(QxtLogger::LogLevel level) const;
     void            enableLogLevels(QxtLogger::LogLevels levels);
     void            disableLogLevels(QxtLogger::LogLevels levels);
+
+private:
+    friend class QxtLogger;
+    void            setLogger(QxtLogger* logger);
+};
+
+class QXT_CORE_EXPORT QxtLoggerEngineExtension
+{
+public:
+    virtual ~QxtLoggerEngineExtension() {}
+
+    virtual void    writeRecord(const QxtLogRecord& record) = 0;
 };
 
 #endif // QXTLOGGERENGINE_H
@@ -0,0 +1,179 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include "qxtlogratelimiter.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTime>
+
+/*!
+    \class QxtLogRateLimiter
+    \inmodule QxtCore
+    \brief The QxtLogRateLimiter class limits how often a call site logs.
+
+    A message logged in a tight loop can swamp the disk and bury everything
+    else in the log. QxtLogRateLimiter is a token bucket: it holds up to
+    burst() tokens and gains rate() tokens per second. Each message allowed
+    by tryAcquire() takes a token; while the bucket is empty, messages are
+    counted and suppressed. The next message that gets through is preceded by
+    a message at the same level reporting how many were suppressed.
+
+    The limiter is meant to be a static object at the call site, which the
+    qxtLogStreamLimited() macro declares for you:
+    \code
+    qxtLogStreamLimited(QxtLogger::WarningLevel, 10, 20) << "cannot reach" << host;
+    \endcode
+    Or by hand:
+    \code
+    static QxtLogRateLimiter limiter(QxtLogger::WarningLevel, 10, 20, __FILE__, __LINE__);
+    if (limiter.tryAcquire())
+        qxtLog->warning("cannot reach", host);
+    \endcode
+
+    QxtLogRateLimiter is thread-safe; threads logging from the same call site
+    share its bucket.
+
+    \sa QxtLogger
+ */
+
+class QxtLogRateLimiterPrivate : public QxtPrivate<QxtLogRateLimiter>
+{
+public:
+    QXT_DECLARE_PUBLIC(QxtLogRateLimiter)
+    QxtLogRateLimiterPrivate();
+
+    QMutex mutex;
+    QxtLogger::LogLevel level;
+    int rate;
+    int burst;
+    const char* file;
+    int line;
+    QTime clock;
+    int last;           // clock.elapsed() at the previous refill
+    qint64 credit;      // thousandths of a token
+    int suppressed;
+};
+
+QxtLogRateLimiterPrivate::QxtLogRateLimiterPrivate()
+        : level(QxtLogger::InfoLevel), rate(0), burst(0), file(0), line(0), last(0), credit(0), suppressed(0)
+{
+}
+
+/*!
+    Constructs a limiter for messages at \a level that allows \a perSecond
+    messages per second on average and bursts of up to \a burst messages. If
+    \a burst is less than one, it defaults to \a perSecond.
+
+    \a file and \a line identify the call site in the report of suppressed
+    messages; \a file must stay valid for the lifetime of the limiter, as
+    __FILE__ does.
+ */
+QxtLogRateLimiter::QxtLogRateLimiter(QxtLogger::LogLevel level, int perSecond, int burst, const char* file, int line)
+{
+    QXT_INIT_PRIVATE(QxtLogRateLimiter);
+    QXT_D(QxtLogRateLimiter);
+    d.level = level;
+    d.rate = qMax(0, perSecond);
+    d.burst = burst > 0 ? burst : qMax(1, d.rate);
+    d.file = file;
+    d.line = line;
+    d.credit = qint64(d.burst) * 1000;
+    d.clock.start();
+}
+
+/*!
+    Takes a token and returns \c true if the caller may log a message now.
+    Returns \c false and counts the message as suppressed otherwise.
+
+    When a token is available after messages have been suppressed, their
+    number is logged before returning \c true.
+ */
+bool QxtLogRateLimiter::tryAcquire()
+{
+    QXT_D(QxtLogRateLimiter);
+    d.mutex.lock();
+    int now = d.clock.elapsed();
+    if (now < d.last)
+    {
+        // the clock was set back or QTime wrapped after a day
+        d.clock.start();
+        now = 0;
+        d.last = 0;
+    }
+    d.credit = qMin(d.credit + qint64(now - d.last) * d.rate, qint64(d.burst) * 1000);
+    d.last = now;
+    if (d.credit < 1000)
+    {
+        d.suppressed++;
+        d.mutex.unlock();
+        return false;
+    }
+    d.credit -= 1000;
+    const int suppressed = d.suppressed;
+    d.suppressed = 0;
+    d.mutex.unlock();
+
+    if (suppressed > 0)
+    {
+        QString report = QString("QxtLogger: suppressed %1 messages").arg(suppressed);
+        if (d.file) report += QString(" from %1:%2").arg(QString::fromLocal8Bit(d.file)).arg(d.line);
+        qxtLog->log(d.level, QList<QVariant>() << report);
+    }
+    return true;
+}
+
+/*!
+    Returns the level of the limited messages.
+ */
+QxtLogger::LogLevel QxtLogRateLimiter::level() const
+{
+    return qxt_d().level;
+}
+
+/*!
+    Returns the number of messages allowed per second on average.
+ */
+int QxtLogRateLimiter::rate() const
+{
+    return qxt_d().rate;
+}
+
+/*!
+    Returns the number of messages allowed in a burst.
+ */
+int QxtLogRateLimiter::burst() const
+{
+    return qxt_d().burst;
+}
+
+/*!
+    Returns the number of messages suppressed since the last one that was
+    allowed.
+ */
+int QxtLogRateLimiter::suppressedCount() const
+{
+    QMutexLocker lock(&const_cast<QxtLogRateLimiterPrivate&>(qxt_d()).mutex);
+    return qxt_d().suppressed;
+}
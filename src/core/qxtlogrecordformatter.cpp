@@ -0,0 +1,217 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include "qxtlogrecordformatter_p.h"
+
+QxtLogRecordFormatter::QxtLogRecordFormatter(const QString& dateFormat) : cachedSecond(-1), renderWhole(false)
+{
+    setDateFormat(dateFormat);
+}
+
+/*******************************************************************************
+Splits format at every millisecond token outside of quoted text. QDateTime
+reads a run of 'z' as "zzz" as long as three are left, then as single "z".
+A piece without the AM/PM marker would render 12-hour hours in 24-hour form,
+so a format using both is not split but rendered whole for every record.
+*******************************************************************************/
+void QxtLogRecordFormatter::setDateFormat(const QString& dateFormat)
+{
+    format = dateFormat;
+    parts.clear();
+    paddedMillis.clear();
+    rendered.clear();
+    cachedSecond = -1;
+    renderWhole = false;
+
+    QString part;
+    bool quoted = false;
+    bool amPm = false;
+    int i = 0;
+    while (i < format.size())
+    {
+        const QChar c = format.at(i);
+        if (c == QLatin1Char('\''))
+        {
+            quoted = !quoted;
+        }
+        else if (c == QLatin1Char('z') && !quoted)
+        {
+            const bool padded = format.mid(i, 3) == QLatin1String("zzz");
+            parts.append(part);
+            paddedMillis.append(padded);
+            part.clear();
+            i += padded ? 3 : 1;
+            continue;
+        }
+        else if ((c == QLatin1Char('a') || c == QLatin1Char('A')) && !quoted)
+        {
+            amPm = true;
+        }
+        part.append(c);
+        i++;
+    }
+    parts.append(part);
+
+    if (amPm && !paddedMillis.isEmpty())
+    {
+        parts = QStringList(format);
+        paddedMillis.clear();
+        renderWhole = true;
+    }
+}
+
+void QxtLogRecordFormatter::appendTimestamp(QByteArray& out, const QDateTime& now)
+{
+    if (renderWhole)
+    {
+        appendUtf8(out, now.toString(format));
+        return;
+    }
+
+    const QTime time = now.time();
+    const qint64 second = qint64(now.date().toJulianDay()) * 86400
+                          + time.hour() * 3600 + time.minute() * 60 + time.second();
+    if (second != cachedSecond)
+    {
+        const QDateTime whole(now.date(), QTime(time.hour(), time.minute(), time.second()));
+        rendered.clear();
+        Q_FOREACH(const QString& part, parts)
+            rendered.append(part.isEmpty() ? QByteArray() : whole.toString(part).toUtf8());
+        cachedSecond = second;
+    }
+
+    const int msec = time.msec();
+    for (int i = 0; i < rendered.size(); i++)
+    {
+        out.append(rendered.at(i));
+        if (i == paddedMillis.size()) break;
+        char digits[3];
+        int n = 0;
+        if (paddedMillis.at(i) || msec >= 100) digits[n++] = char('0' + msec / 100);
+        if (paddedMillis.at(i) || msec >= 10) digits[n++] = char('0' + msec / 10 % 10);
+        digits[n++] = char('0' + msec % 10);
+        out.append(QByteArray::fromRawData(digits, n));
+    }
+}
+
+/*******************************************************************************
+Appends "[time] [level] message" with further messages on their own lines,
+indented to the first one; the layout of QxtBasicFileLoggerEngine. A non-empty
+thread adds a "[thread]" field after the level.
+*******************************************************************************/
+void QxtLogRecordFormatter::appendRecord(QByteArray& out, const QDateTime& now, const QString& level, const QList<QVariant>& messages, const QString& thread)
+{
+    const int start = out.size();
+    out.append('[');
+    appendTimestamp(out, now);
+    out.append("] [");
+    appendUtf8(out, level);
+    if (!thread.isEmpty())
+    {
+        out.append("] [");
+        appendUtf8(out, thread);
+    }
+    out.append("] ");
+
+    // indent by characters, not bytes
+    int width = 0;
+    for (int i = start; i < out.size(); i++)
+        if ((uchar(out.at(i)) & 0xc0) != 0x80) width++;
+
+    int count = 0;
+    Q_FOREACH(const QVariant& message, messages)
+    {
+        if (!message.isNull())
+        {
+            if (count != 0) appendPadding(out, width);
+            appendVariant(out, message);
+            out.append('\n');
+        }
+        count++;
+    }
+}
+
+void QxtLogRecordFormatter::appendUtf8(QByteArray& out, const QString& text)
+{
+    const ushort* s = text.utf16();
+    const int size = text.size();
+    int i = 0;
+    while (i < size && s[i] < 0x80) i++;
+    if (i == size)
+    {
+        // plain ASCII, by far the common case
+        const int pos = out.size();
+        out.resize(pos + size);
+        char* dst = out.data() + pos;
+        for (int k = 0; k < size; k++) dst[k] = char(s[k]);
+        return;
+    }
+    out.append(text.toUtf8());
+}
+
+void QxtLogRecordFormatter::appendVariant(QByteArray& out, const QVariant& value)
+{
+    char digits[24];
+    switch (value.type())
+    {
+    case QVariant::String:
+        appendUtf8(out, *reinterpret_cast<const QString*>(value.constData()));
+        return;
+    case QVariant::Int:
+    case QVariant::LongLong:
+    {
+        qlonglong v = value.toLongLong();
+        qulonglong u = v < 0 ? qulonglong(-(v + 1)) + 1 : qulonglong(v);
+        int n = sizeof digits;
+        do { digits[--n] = char('0' + u % 10); u /= 10; } while (u);
+        if (v < 0) digits[--n] = '-';
+        out.append(QByteArray::fromRawData(digits + n, sizeof digits - n));
+        return;
+    }
+    case QVariant::UInt:
+    case QVariant::ULongLong:
+    {
+        qulonglong u = value.toULongLong();
+        int n = sizeof digits;
+        do { digits[--n] = char('0' + u % 10); u /= 10; } while (u);
+        out.append(QByteArray::fromRawData(digits + n, sizeof digits - n));
+        return;
+    }
+    case QVariant::Bool:
+        out.append(value.toBool() ? "true" : "false");
+        return;
+    default:
+        appendUtf8(out, value.toString());
+        return;
+    }
+}
+
+void QxtLogRecordFormatter::appendPadding(QByteArray& out, int count)
+{
+    if (count <= 0) return;
+    const int pos = out.size();
+    out.resize(pos + count);
+    memset(out.data() + pos, ' ', count);
+}
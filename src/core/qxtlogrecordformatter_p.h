@@ -0,0 +1,73 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTLOGRECORDFORMATTER_P_H
+#define QXTLOGRECORDFORMATTER_P_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#ifndef QXT_DOXYGEN_RUN
+
+/*******************************************************************************
+    QxtLogRecordFormatter
+    Renders log record headers and payloads into a UTF-8 byte buffer.
+
+    The date format is split once into the parts around its millisecond
+    tokens. The parts are rendered with QDateTime::toString() only when the
+    second changes; in between, only the milliseconds are formatted. Formats
+    with both milliseconds and an AM/PM marker are rendered whole each time.
+*******************************************************************************/
+class QxtLogRecordFormatter
+{
+public:
+    explicit QxtLogRecordFormatter(const QString& dateFormat = QString("hh:mm:ss.zzz"));
+
+    void setDateFormat(const QString& format);
+    inline QString dateFormat() const { return format; }
+
+    void appendTimestamp(QByteArray& out, const QDateTime& now);
+    void appendRecord(QByteArray& out, const QDateTime& now, const QString& level, const QList<QVariant>& messages, const QString& thread = QString());
+
+    static void appendUtf8(QByteArray& out, const QString& text);
+    static void appendVariant(QByteArray& out, const QVariant& value);
+    static void appendPadding(QByteArray& out, int count);
+
+private:
+    QString format;
+    QStringList parts;          // date format pieces between millisecond tokens
+    QList<bool> paddedMillis;   // "zzz" (true) or "z" (false) after each piece but the last
+    QList<QByteArray> rendered; // parts rendered for cachedSecond
+    qint64 cachedSecond;
+    bool renderWhole;           // AM/PM format with milliseconds; not split
+};
+
+#endif // QXT_DOXYGEN_RUN
+
+#endif // QXTLOGRECORDFORMATTER_P_H
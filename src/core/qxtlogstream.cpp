@@ -35,14 +35,14 @@
     \sa QxtLogger
  */
 
-QxtLogStreamPrivate::QxtLogStreamPrivate(QxtLogger *owner, QxtLogger::LogLevel level, const QList<QVariant> &data) : owner(owner), level(level), refcount(1), data(data)
+QxtLogStreamPrivate::QxtLogStreamPrivate(QxtLogger *owner, QxtLogger::LogLevel level, const QList<QVariant> &data) : owner(owner), level(level), enabled(owner->isLevelEnabled(level)), refcount(1), data(data)
 {
     // Nothing to see here.
 }
 
 QxtLogStreamPrivate::~QxtLogStreamPrivate()
 {
-    owner->log(level, data);
+    if (enabled) owner->log(level, data);
 }
 
 /*!
@@ -76,6 +76,6 @@ QxtLogStream::~QxtLogStream()
  */
 QxtLogStream& QxtLogStream::operator<< (const QVariant &value)
 {
-    d->data.append(value);
+    if (d->enabled) d->data.append(value);
     return *this;
 }
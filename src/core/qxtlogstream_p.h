@@ -39,6 +39,7 @@ public:
 
     QxtLogger *owner;
     QxtLogger::LogLevel level;
+    bool enabled;   // no engine wants the level: collect nothing, log nothing
     int refcount;   // Unfortunately, QExplicitlySharedDataPointer was introduced in Qt 4.4, and we have to work with Qt 4.2 ;_;
     QList<QVariant> data;
 };
@@ -0,0 +1,190 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include "qxtrpcreply.h"
+#include "qxtsignalwaiter.h"
+#include <QTimerEvent>
+
+/*!
+ * \class QxtRPCReply
+ * \inmodule QxtCore
+ * \brief The QxtRPCReply class tracks a call made with QxtRPCService::callWithReply()
+ *
+ * A QxtRPCReply is created by QxtRPCService::callWithReply() for each call that expects a reply. The call is
+ * identified on the connection by a correlation ID, so any number of calls can be outstanding at the same time and
+ * their replies may arrive in any order.
+ *
+ * When the reply arrives, result() holds the value returned by the slot attached on the receiving end, and
+ * finished() is emitted. If no reply arrives within QxtRPCService::replyTimeout(), or the connection is closed, the
+ * call fails with the corresponding error() and finished() is emitted as well.
+ *
+ * The reply is a child of the QxtRPCService that created it. Delete it, for instance with deleteLater(), once it is
+ * no longer needed.
+ */
+
+/*!
+ * \enum QxtRPCReply::Error
+ *
+ * \value NoError The reply has arrived, or has not finished yet.
+ * \value TimeoutError No reply arrived in time.
+ * \value DisconnectedError The connection was closed before the reply arrived, or there was no connection.
+ * \value NotHandledError The peer has no slot attached to the called function, or none of the attached slots could be
+ *        invoked with the arguments of the call.
+ * \value DroppedError The call was discarded unsent because its connection was congested.
+ * \sa QxtRPCService::setCongestionPolicy()
+ */
+
+/*!
+ * \fn QxtRPCReply::finished()
+ *
+ * This signal is emitted when the reply has arrived or the call has failed.
+ */
+
+/*!
+ * \fn QxtRPCReply::timedOut()
+ *
+ * This signal is emitted before finished() when no reply arrived in time.
+ */
+
+class QxtRPCReplyPrivate : public QxtPrivate<QxtRPCReply>
+{
+public:
+    QXT_DECLARE_PUBLIC(QxtRPCReply)
+
+    quint64 correlationId;
+    quint64 client;
+    bool toServer;
+    bool finished;
+    QxtRPCReply::Error error;
+    QxtRPCReply::Error pendingError;
+    QVariant result;
+    int timerId;
+};
+
+QxtRPCReply::QxtRPCReply(quint64 correlationId, bool toServer, quint64 client, int timeout, QObject* parent)
+        : QObject(parent)
+{
+    QXT_INIT_PRIVATE(QxtRPCReply);
+    qxt_d().correlationId = correlationId;
+    qxt_d().client = client;
+    qxt_d().toServer = toServer;
+    qxt_d().finished = false;
+    qxt_d().error = NoError;
+    qxt_d().pendingError = TimeoutError;
+    qxt_d().timerId = timeout > 0 ? startTimer(timeout) : 0;
+}
+
+/*!
+ * Destroys the reply. A reply that arrives later is ignored.
+ */
+QxtRPCReply::~QxtRPCReply()
+{
+}
+
+/*!
+ * Returns the ID that identifies the call on its connection.
+ */
+quint64 QxtRPCReply::correlationId() const
+{
+    return qxt_d().correlationId;
+}
+
+/*!
+ * Returns \c true if the reply has arrived or the call has failed.
+ */
+bool QxtRPCReply::isFinished() const
+{
+    return qxt_d().finished;
+}
+
+/*!
+ * Returns the reason the call failed, or NoError.
+ */
+QxtRPCReply::Error QxtRPCReply::error() const
+{
+    return qxt_d().error;
+}
+
+/*!
+ * Returns the value returned by the slot on the receiving end. The result is invalid until the reply has arrived,
+ * and if the slot returns \c void or could not return a value because it was invoked through a queued connection.
+ */
+QVariant QxtRPCReply::result() const
+{
+    return qxt_d().result;
+}
+
+/*!
+ * Processes events until the reply has finished or \a msecs milliseconds have passed. Returns \c true if the reply
+ * has finished.
+ */
+bool QxtRPCReply::waitForFinished(int msecs)
+{
+    if (!qxt_d().finished)
+        QxtSignalWaiter::wait(this, SIGNAL(finished()), msecs);
+    return qxt_d().finished;
+}
+
+/*!
+ * \reimp
+ */
+void QxtRPCReply::timerEvent(QTimerEvent* event)
+{
+    if (event->timerId() != qxt_d().timerId)
+    {
+        QObject::timerEvent(event);
+        return;
+    }
+    const Error error = qxt_d().pendingError;
+    if (error == TimeoutError)
+        emit timedOut();
+    finish(error);
+}
+
+bool QxtRPCReply::isFor(bool toServer, quint64 client) const
+{
+    return qxt_d().toServer == toServer && (toServer || qxt_d().client == client);
+}
+
+void QxtRPCReply::finish(Error error, const QVariant& result)
+{
+    if (qxt_d().finished) return;
+    if (qxt_d().timerId)
+        killTimer(qxt_d().timerId);
+    qxt_d().timerId = 0;
+    qxt_d().finished = true;
+    qxt_d().error = error;
+    qxt_d().result = result;
+    emit finished();
+}
+
+void QxtRPCReply::finishLater(Error error)
+{
+    // The caller has not had a chance to connect to finished() yet.
+    if (qxt_d().timerId)
+        killTimer(qxt_d().timerId);
+    qxt_d().pendingError = error;
+    qxt_d().timerId = startTimer(0);
+}
@@ -0,0 +1,73 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtCore module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTRPCREPLY_H
+#define QXTRPCREPLY_H
+
+#include <QObject>
+#include <QVariant>
+#include <qxtglobal.h>
+
+class QxtRPCReplyPrivate;
+class QXT_CORE_EXPORT QxtRPCReply : public QObject
+{
+    Q_OBJECT
+public:
+    enum Error
+    {
+        NoError,
+        TimeoutError,
+        DisconnectedError,
+        NotHandledError,
+        DroppedError
+    };
+
+    virtual ~QxtRPCReply();
+
+    quint64 correlationId() const;
+    bool isFinished() const;
+    Error error() const;
+    QVariant result() const;
+
+    bool waitForFinished(int msecs = 30000);
+
+Q_SIGNALS:
+    void finished();
+    void timedOut();
+
+protected:
+    virtual void timerEvent(QTimerEvent* event);
+
+private:
+    friend class QxtRPCServicePrivate;
+    QxtRPCReply(quint64 correlationId, bool toServer, quint64 client, int timeout, QObject* parent);
+    bool isFor(bool toServer, quint64 client) const;
+    void finish(Error error, const QVariant& result = QVariant());
+    void finishLater(Error error);
+
+    QXT_DECLARE_PRIVATE(QxtRPCReply)
+};
+
+#endif // QXTRPCREPLY_H
@@ -39,9 +39,26 @@
 #include <QString>
 #include <QByteArray>
 #include <QPair>
+#include <QVector>
+#include <QThread>
+#include <QTime>
+#include <qendian.h>
 
 static bool qxt_rpcservice_debug = false;
 
+// Messages used by QxtRPCService itself. A peer that does not know them ignores them like any unattached function.
+static const char qxt_rpc_reserved_prefix[] = "_qxt_rpc_";
+static const char qxt_rpc_method_ids[] = "_qxt_rpc_method_ids";
+static const char qxt_rpc_define_method[] = "_qxt_rpc_define_method";
+static const char qxt_rpc_compression[] = "_qxt_rpc_compression";
+static const char qxt_rpc_compressed[] = "_qxt_rpc_compressed";
+static const char qxt_rpc_expect_reply[] = "_qxt_rpc_expect_reply";
+static const char qxt_rpc_reply[] = "_qxt_rpc_reply";
+// Method IDs are limited, which also bounds the bits kept for IDs the peer defines for functions without slots.
+static const quint32 qxt_rpc_max_method_ids = 65536;
+// A compressed message may not claim to expand beyond this size.
+static const quint32 qxt_rpc_max_inflated = 64 * 1024 * 1024;
+
 /*!
  * \class QxtRPCService
  * \inmodule QxtCore
@@ -62,6 +79,35 @@ static bool qxt_rpcservice_debug = false;
  * Due to a restriction of Qt's signals and slots mechanism, the number of parameters that can be passed to call() and
  * its related functions, as well as the number of parameters to any signal or slot attached to QxtRPCService, is
  * limited to 8.
+ *
+ * If the serializer supports it through QxtSignalSerializerExtension, as QxtDataStreamSignalSerializer and
+ * QxtCompactSignalSerializer do, QxtRPCService sends the name of each RPC function only once per connection and
+ * identifies the function by a number afterwards. The numbers are negotiated automatically when a connection is
+ * established; a peer that does not support them keeps receiving names. Function names beginning with \c _qxt_rpc_
+ * are reserved for the messages QxtRPCService uses for this and for compression.
+ *
+ * By default every call is written to the device immediately. When many small calls are made in a row, for instance
+ * by signals emitted in a loop, setCorked() collects them and writes them together once control returns to the event
+ * loop, which saves a write and usually a network packet per message. Use flush() to send collected calls right away.
+ *
+ * For links where bandwidth is scarcer than processor time, setCompressionEnabled() compresses large messages with
+ * qCompress(). Every QxtRPCService can receive compressed messages, and tells its peers so when a connection is
+ * established; messages to peers that do not support it are sent uncompressed.
+ *
+ * call() does not wait for anything to happen on the receiving end. callWithReply() sends the same message, marked
+ * with a correlation ID, and returns a QxtRPCReply that receives the return value of the slot attached on the
+ * receiving end. Any number of such calls can be outstanding on a connection.
+ *
+ * A peer that reads more slowly than calls are made to it makes the data waiting to be written to its device grow
+ * without bound. setWatermarks() limits it: a connection with more than highWatermark() bytes waiting is congested,
+ * which is announced by the congested() signal, until it has drained to lowWatermark() bytes. The congestionPolicy()
+ * decides whether calls to a congested connection wait for it, replace the oldest calls held back for it, or close
+ * it. With setSkipCongested(), calls to all clients, including those made by attached signals, leave out congested
+ * clients instead.
+ *
+ * A QxtRPCService can be moved to another thread with QObject::moveToThread() along with its device or connection
+ * manager, for instance to serve one of the I/O threads of a QxtTcpConnectionManager. Slots attached with
+ * Qt::AutoConnection to objects living in other threads are then invoked through queued connections.
  */
 
 /*
@@ -248,7 +294,10 @@ int QxtRPCServiceIntrospector::qt_metacall(QMetaObject::Call _c, int _id, void *
 }
 
 QxtRPCServicePrivate::QxtRPCServicePrivate()
-: QObject(NULL), manager(NULL), serializer(new QxtDataStreamSignalSerializer), device(NULL)
+: QObject(NULL), manager(NULL), serializer(new QxtDataStreamSignalSerializer), device(NULL),
+  extension(dynamic_cast<QxtSignalSerializerExtension*>(serializer)), corked(false), corkThreshold(16384), flushScheduled(false), compression(false), compressionThreshold(1024), nextCorrelation(1),
+  replyTimeout(30000), lowWatermark(0), highWatermark(0), policy(QxtRPCService::Block), skipCongested(false),
+  congestionTimeout(1000)
 {
     // initializers only
     // As you can see, the default serializer is a QxtDataStreamSerializer.
@@ -259,12 +308,15 @@ void QxtRPCServicePrivate::clientConnected(QIODevice* dev, quint64 id)
     // QxtMetaObject::bind() is a nice piece of magic that allows parameters to a slot to be defined in the connection.
     QxtMetaObject::connect(dev, SIGNAL(readyRead()),
                            QxtMetaObject::bind(this, SLOT(clientData(quint64)), Q_ARG(quint64, id)));
+    QxtMetaObject::connect(dev, SIGNAL(bytesWritten(qint64)),
+                           QxtMetaObject::bind(this, SLOT(clientWritten(quint64)), Q_ARG(quint64, id)));
 
     // Inform other objects that a new client has connected.
     emit qxt_p().clientConnected(id);
 
-    // Initialize a new buffer for this connection.
-    buffers[id] = QByteArray();
+    // Initialize the state for this connection. Method IDs are offered to the client once the connection is used.
+    connections[id] = Connection();
+    connections[id].client = id;
 
     // If there's any unread data in the device, go ahead and process it up front.
     if(dev->bytesAvailable() > 0)
@@ -277,8 +329,9 @@ void QxtRPCServicePrivate::clientDisconnected(QIODevice* dev, quint64 id)
     QObject::disconnect(dev, 0, this, 0);
     QObject::disconnect(dev, 0, &qxt_p(), 0);
 
-    // ... remove its buffer object...
-    buffers.remove(id);
+    // ... remove its connection state, failing the calls waiting for a reply from it...
+    connections.remove(id);
+    failReplies(false, id);
 
     // ... and inform other objects that the disconnection has happened.
     emit qxt_p().clientDisconnected(id);
@@ -288,35 +341,67 @@ void QxtRPCServicePrivate::clientData(quint64 id)
 {
     // Get the device from the connection manager.
     QIODevice* dev = manager->client(id);
-
-    // Cache a reference to the buffer.
-    QByteArray& buf = buffers[id]; 
+    if(!dev || !connections.contains(id))
+        return;
 
     // Read all available data on the device.
-    buf.append(dev->readAll());
+    announce(dev, connections[id]);
+    connections[id].data.append(dev->readAll());
+
+    forever {
+        // Look the buffer up again for every message: a slot invoked by the dispatcher may disconnect the client,
+        // or process events and consume messages itself. The offset lives in the connection for the same reason.
+        QHash<quint64, Connection>::iterator conn = connections.find(id);
+        if(conn == connections.end())
+            return;
+        if(!canDeserialize(conn->data, conn->offset)) {
+            // Discard everything that has been processed in one go.
+            conn->compact();
+            return;
+        }
 
-    while(serializer->canDeserialize(buf)) {
         // Extract one deserialized signal from the buffer.
-        QxtAbstractSignalSerializer::DeserializedData data = serializer->deserialize(buf);
+        quint32 methodId;
+        QxtAbstractSignalSerializer::DeserializedData data = deserialize(conn->data, conn->offset, &methodId);
+        const bool named = methodId == quint32(QxtSignalSerializerExtension::NoMethodId);
 
         // Check to see if it's a blank command.
-        if(serializer->isNoOp(data))
+        if(named && serializer->isNoOp(data))
             continue;
 
-        // Check for protocol errors.
-        if(serializer->isProtocolError(data)) {
+        // Check for protocol errors, and find the attached slots.
+        const int method = named && serializer->isProtocolError(data) ? int(ProtocolViolation)
+                                                                      : resolve(*conn, methodId, data);
+        if(method == ProtocolViolation) {
             qWarning() << "QxtRPCService: Invalid data received; disconnecting";
             qxt_p().disconnectClient(id);
             return;
         }
+        if(method == NoMethod)
+            continue;
+
+        // A call that expects a reply has been announced just before it.
+        const bool wantsReply = conn->expectsReply;
+        const quint64 correlation = conn->replyTo;
+        conn->expectsReply = false;
 
         // Pad the arguments to 8, because that's what dispatchFromClient() expects.
         while(data.second.count() < 8)
             data.second << QVariant();
 
         // And finally, invoke the dispatcher.
-        dispatchFromClient(id, data.first, data.second[0], data.second[1], data.second[2], data.second[3],
-                data.second[4], data.second[5], data.second[6], data.second[7]);
+        QVariant result;
+        const bool handled = method != Unattached && dispatchFromClient(id, method, wantsReply ? &result : 0,
+                data.second[0], data.second[1], data.second[2], data.second[3], data.second[4], data.second[5],
+                data.second[6], data.second[7]);
+
+        if(wantsReply) {
+            // The slot may have disconnected the client.
+            conn = connections.find(id);
+            dev = manager->client(id);
+            if(conn != connections.end() && dev)
+                sendReply(dev, &*conn, correlation, handled, result);
+        }
     }
 }
 
@@ -324,87 +409,644 @@ void QxtRPCServicePrivate::serverData()
 {
     // This function does the same thing as clientData() except there's only one server connection instead of
     // multiple client connections.
+    if(!device)
+        return;
 
     // Read all available data on the device.
-    serverBuffer.append(device->readAll());
+    announce(device, serverConnection);
+    serverConnection.data.append(device->readAll());
+
+    forever {
+        // A slot may have disconnected from the server while the last message was dispatched.
+        if(!device)
+            return;
+        if(!canDeserialize(serverConnection.data, serverConnection.offset)) {
+            serverConnection.compact();
+            return;
+        }
 
-    while(serializer->canDeserialize(serverBuffer)) {
         // Extract one deserialized signal from the buffer.
-        QxtAbstractSignalSerializer::DeserializedData data = serializer->deserialize(serverBuffer);
+        quint32 methodId;
+        QxtAbstractSignalSerializer::DeserializedData data = deserialize(serverConnection.data,
+                serverConnection.offset, &methodId);
+        const bool named = methodId == quint32(QxtSignalSerializerExtension::NoMethodId);
 
         // Check to see if it's a blank command.
-        if(serializer->isNoOp(data))
+        if(named && serializer->isNoOp(data))
             continue;
 
-        // Check for protocol errors.
-        if(serializer->isProtocolError(data)) {
+        // Check for protocol errors, and find the attached slots.
+        const int method = named && serializer->isProtocolError(data) ? int(ProtocolViolation)
+                                                                      : resolve(serverConnection, methodId, data);
+        if(method == ProtocolViolation) {
             qWarning() << "QxtRPCService: Invalid data received; disconnecting";
             qxt_p().disconnectServer();
             return;
         }
+        if(method == NoMethod)
+            continue;
+
+        // A call that expects a reply has been announced just before it.
+        const bool wantsReply = serverConnection.expectsReply;
+        const quint64 correlation = serverConnection.replyTo;
+        serverConnection.expectsReply = false;
 
         // Pad the arguments to 8, because that's what dispatchFromServer() expects.
         while(data.second.count() < 8)
             data.second << QVariant();
 
         // And finally, invoke the dispatcher.
-        dispatchFromServer(data.first, data.second[0], data.second[1], data.second[2], data.second[3], data.second[4],
-                data.second[5], data.second[6], data.second[7]);
+        QVariant result;
+        const bool handled = method != Unattached && dispatchFromServer(method, wantsReply ? &result : 0,
+                data.second[0], data.second[1], data.second[2], data.second[3], data.second[4], data.second[5],
+                data.second[6], data.second[7]);
+
+        if(wantsReply && device)
+            sendReply(device, &serverConnection, correlation, handled, result);
     }
 }
 
-// Constructing a QGenericArgument object is generally done with a Q_ARG macro; this macro is a convenience that
-// does basically the same thing but dramatically shortens the call to invokeMethod().
-#define QXT_ARG(i) ((numParams>i)?QGenericArgument(p ## i .typeName(), p ## i.constData()):QGenericArgument())
+int QxtRPCServicePrivate::methodFor(const QString& name)
+{
+    QHash<QString, int>::const_iterator pos = methodIndex.constFind(name);
+    if(pos != methodIndex.constEnd())
+        return *pos;
+    Method method;
+    method.name = name;
+    methods.append(method);
+    methodIndex.insert(name, methods.count() - 1);
+    return methods.count() - 1;
+}
 
-void QxtRPCServicePrivate::dispatchFromServer(const QString& fn, const QVariant& p0, const QVariant& p1,
-        const QVariant& p2, const QVariant& p3, const QVariant& p4, const QVariant& p5, const QVariant& p6,
-        const QVariant& p7) const
+bool QxtRPCServicePrivate::canDeserialize(const QByteArray& buffer, int offset) const
 {
-    // If the received message is not connected to any slots, ignore it.
-    if(!connectedSlots.contains(fn)) return;
+    if(extension)
+        return extension->canDeserialize(buffer, offset);
+    return serializer->canDeserialize(buffer);
+}
 
-    foreach(const SlotDef& slot, connectedSlots.value(fn)) {
-        // Look up the parameters for each slot based on its metamethod definition.
-        MetaMethodDef method = qMakePair(slot.recv->metaObject(), slot.slot);
-        const QList<QByteArray>& params = slotParameters.value(method);
-        int numParams = params.count();
+QxtAbstractSignalSerializer::DeserializedData QxtRPCServicePrivate::deserialize(QByteArray& buffer, int& offset,
+        quint32* methodId)
+{
+    if(extension)
+        return extension->deserialize(buffer, offset, methodId);
+    *methodId = QxtSignalSerializerExtension::NoMethodId;
+    return serializer->deserialize(buffer);
+}
 
-        // Invoke the specified slot on the receiver object using the arguments passed to the function. The
-        // QGenericArgument stuff is done here for safety, as it's not inconceivable (but it IS dangerous) for
-        // different slots to have different parameter lists.
-        if(qxt_rpcservice_debug) 
-            qDebug() << "QxtRPCService: received" << fn << "- invoking" << slot.recv << slot.slot.constData() << slot.type << p0 << p1 << p2 << p3 << p4 << p5 << p6 << p7;
-        if(!QMetaObject::invokeMethod(slot.recv, slot.slot.constData(), slot.type, QXT_ARG(0), QXT_ARG(1), QXT_ARG(2),
-                    QXT_ARG(3), QXT_ARG(4), QXT_ARG(5), QXT_ARG(6), QXT_ARG(7))) {
-            qWarning() << "QxtRPCService: invokeMethod for " << slot.recv << "::" << slot.slot << " failed";
+int QxtRPCServicePrivate::resolve(Connection& conn, quint32 methodId,
+        const QxtAbstractSignalSerializer::DeserializedData& data)
+{
+    // A numbered message must use an ID that the peer has defined on this connection.
+    if(methodId != quint32(QxtSignalSerializerExtension::NoMethodId)) {
+        QHash<quint32, int>::const_iterator known = conn.incoming.constFind(methodId);
+        if(known != conn.incoming.constEnd())
+            return *known;
+        if(methodId < quint32(conn.unattachedIds.size()) && conn.unattachedIds.testBit(methodId))
+            return Unattached;
+        return ProtocolViolation;
+    }
+
+    const QString& fn = data.first;
+    if(fn.startsWith(QLatin1String(qxt_rpc_reserved_prefix))) {
+        if(fn == QLatin1String(qxt_rpc_method_ids)) {
+            // The peer can decode numbered messages.
+            conn.acceptsIds = true;
+            return NoMethod;
+        }
+        if(fn == QLatin1String(qxt_rpc_define_method)) {
+            bool ok = false;
+            const quint32 defined = data.second.value(0).toUInt(&ok);
+            const QString name = data.second.value(1).toString();
+            if(!ok || defined >= qxt_rpc_max_method_ids || name.isEmpty() || conn.incoming.contains(defined)
+                    || (defined < quint32(conn.unattachedIds.size()) && conn.unattachedIds.testBit(defined)))
+                return ProtocolViolation;
+            const int method = methodIndex.value(name, NoMethod);
+            if(method == NoMethod) {
+                // Calls to a function without slots are ignored; their name is not needed.
+                if(defined >= quint32(conn.unattachedIds.size()))
+                    conn.unattachedIds.resize(defined + 1);
+                conn.unattachedIds.setBit(defined);
+                return NoMethod;
+            }
+            // A peer defines each function once, so it never needs more IDs than there are functions attached here.
+            if(conn.incoming.count() >= methods.count())
+                return ProtocolViolation;
+            conn.incoming.insert(defined, method);
+            return NoMethod;
+        }
+        if(fn == QLatin1String(qxt_rpc_compression)) {
+            conn.acceptsCompression = true;
+            return NoMethod;
+        }
+        if(fn == QLatin1String(qxt_rpc_compressed)) {
+            // qCompress() puts the uncompressed size in front of the data; check it before anything is allocated.
+            const QByteArray packed = data.second.value(0).toByteArray();
+            if(packed.size() < 4 || qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(packed.constData()))
+                    > qxt_rpc_max_inflated)
+                return ProtocolViolation;
+            const QByteArray message = qUncompress(packed);
+            if(message.isEmpty())
+                return ProtocolViolation;
+            // Put the original messages where the compressed one was, so they are read next, in order.
+            conn.data.replace(0, conn.offset, message);
+            conn.offset = 0;
+            return NoMethod;
+        }
+        if(fn == QLatin1String(qxt_rpc_expect_reply)) {
+            conn.expectsReply = true;
+            conn.replyTo = data.second.value(0).toULongLong();
+            return NoMethod;
+        }
+        if(fn == QLatin1String(qxt_rpc_reply)) {
+            // Ignore replies that arrive too late, and replies from a peer the call was not sent to. The entry of a
+            // reply that has been deleted is not needed any more.
+            QHash<quint64, QPointer<QxtRPCReply> >::iterator pending =
+                replies.find(data.second.value(0).toULongLong());
+            if(pending == replies.end())
+                return NoMethod;
+            if(!*pending) {
+                replies.erase(pending);
+                return NoMethod;
+            }
+            if(!(*pending)->isFor(&conn == &serverConnection, conn.client))
+                return NoMethod;
+            QxtRPCReply* reply = *pending;
+            replies.erase(pending);
+            if(data.second.value(1).toInt() == 0)
+                reply->finish(QxtRPCReply::NoError, data.second.value(2));
+            else
+                reply->finish(QxtRPCReply::NotHandledError);
+            return NoMethod;
         }
     }
+    return methodIndex.value(fn, Unattached);
+}
+
+void QxtRPCServicePrivate::announce(QIODevice* dev, Connection& conn)
+{
+    // Tell the peer what can be sent to us; the parameter is the version of the negotiation. This goes ahead of
+    // anything else written to the connection, in the serializer in use at that time.
+    if(conn.announced)
+        return;
+    conn.announced = true;
+    QByteArray message;
+    if(supportsMethodIds())
+        message = serializer->serialize(QString::fromLatin1(qxt_rpc_method_ids), 1);
+    message += serializer->serialize(QString::fromLatin1(qxt_rpc_compression), 1);
+    write(dev, &conn, message);
 }
 
-void QxtRPCServicePrivate::dispatchFromClient(quint64 id, const QString& fn, const QVariant& p0, const QVariant& p1,
+const QByteArray& QxtRPCServicePrivate::compressed(const QByteArray& message, QByteArray& cache) const
+{
+    // The cache holds the compressed message, or the message itself if compressing it did not make it smaller.
+    if(cache.isNull()) {
+        cache = serializer->serialize(QString::fromLatin1(qxt_rpc_compressed), qCompress(message));
+        if(cache.size() >= message.size())
+            cache = message;
+    }
+    return cache;
+}
+
+void QxtRPCServicePrivate::send(QIODevice* dev, Connection* conn, const QString& fn, const QVariant* args,
+        Outgoing& out, quint64 correlation)
+{
+    // The serialized message is cached by the caller, so a call to many clients is serialized at most once in each
+    // form.
+    const bool compress = compression && conn && conn->acceptsCompression;
+    const QByteArray* message = 0;
+    QByteArray* cache = 0;
+    if(conn && conn->acceptsIds && supportsMethodIds()) {
+        QHash<QString, quint32>::const_iterator known = outgoingIds.constFind(fn);
+        if(known == outgoingIds.constEnd() && quint32(outgoingIds.count()) < qxt_rpc_max_method_ids)
+            known = outgoingIds.insert(fn, outgoingIds.count());
+        if(known != outgoingIds.constEnd()) {
+            const quint32 methodId = *known;
+            // Define the ID on this connection the first time it is used.
+            if(methodId >= quint32(conn->sentIds.size()))
+                conn->sentIds.resize(methodId + 1);
+            if(!conn->sentIds.testBit(methodId)) {
+                write(dev, conn, serializer->serialize(QString::fromLatin1(qxt_rpc_define_method), methodId, fn));
+                conn->sentIds.setBit(methodId);
+            }
+            if(out.numbered.isNull())
+                out.numbered = extension->serialize(methodId, args[0], args[1], args[2], args[3], args[4], args[5],
+                                                    args[6], args[7]);
+            message = &out.numbered;
+            cache = &out.compressedNumbered;
+        }
+    }
+    if(!message) {
+        if(out.named.isNull())
+            out.named = serializer->serialize(fn, args[0], args[1], args[2], args[3], args[4], args[5], args[6],
+                                              args[7]);
+        message = &out.named;
+        cache = &out.compressedNamed;
+    }
+
+    // The correlation ID goes right before the call it belongs to, and is dropped along with it.
+    const QByteArray& payload = compress && message->size() >= compressionThreshold ? compressed(*message, *cache)
+                                                                                     : *message;
+    if(correlation)
+        write(dev, conn, serializer->serialize(QString::fromLatin1(qxt_rpc_expect_reply), correlation) + payload, true,
+              correlation);
+    else
+        write(dev, conn, payload, true);
+}
+
+QxtRPCReply* QxtRPCServicePrivate::callWithReply(QIODevice* dev, Connection* conn, bool toServer, quint64 client,
+        const QString& fn, const QVariant* args)
+{
+    QxtRPCReply* reply = new QxtRPCReply(nextCorrelation++, toServer, client, replyTimeout, &qxt_p());
+    if(!dev || !conn) {
+        reply->finishLater(QxtRPCReply::DisconnectedError);
+        return reply;
+    }
+    replies.insert(reply->correlationId(), reply);
+    QObject::connect(reply, SIGNAL(timedOut()), this, SLOT(replyTimedOut()));
+    Outgoing out;
+    send(dev, conn, fn, args, out, reply->correlationId());
+    return reply;
+}
+
+void QxtRPCServicePrivate::sendReply(QIODevice* dev, Connection* conn, quint64 correlation, bool handled,
+        const QVariant& result)
+{
+    write(dev, conn, serializer->serialize(QString::fromLatin1(qxt_rpc_reply), correlation, handled ? 0 : 1, result));
+}
+
+void QxtRPCServicePrivate::failReplies(bool toServer, quint64 client)
+{
+    QList<QPointer<QxtRPCReply> > failed;
+    QHash<quint64, QPointer<QxtRPCReply> >::iterator pending = replies.begin();
+    while(pending != replies.end()) {
+        if(!*pending) {
+            pending = replies.erase(pending);
+        } else if((*pending)->isFor(toServer, client)) {
+            failed << *pending;
+            pending = replies.erase(pending);
+        } else {
+            ++pending;
+        }
+    }
+    // Emit finished() only once the table is consistent, since a slot may make new calls.
+    foreach(const QPointer<QxtRPCReply>& reply, failed) {
+        if(reply)
+            reply->finish(QxtRPCReply::DisconnectedError);
+    }
+}
+
+void QxtRPCServicePrivate::replyTimedOut()
+{
+    QxtRPCReply* reply = qobject_cast<QxtRPCReply*>(sender());
+    if(reply)
+        replies.remove(reply->correlationId());
+}
+
+void QxtRPCServicePrivate::write(QIODevice* dev, Connection* conn, const QByteArray& data, bool droppable,
+        quint64 correlation)
+{
+    if(conn && !conn->announced)
+        announce(dev, *conn);
+
+    // Collecting messages for a congested connection gains nothing, and they have to stay apart to be dropped.
+    if(!corked || !conn || conn->congested) {
+        deliver(dev, conn, data, droppable, correlation);
+        return;
+    }
+
+    conn->pending.append(data);
+    if(conn->pending.size() >= corkThreshold) {
+        flushConnection(dev, *conn);
+    } else if(!flushScheduled) {
+        // Everything collected until control returns to the event loop goes out together.
+        flushScheduled = true;
+        QMetaObject::invokeMethod(this, "flushPending", Qt::QueuedConnection);
+    }
+}
+
+void QxtRPCServicePrivate::flushConnection(QIODevice* dev, Connection& conn)
+{
+    if(conn.pending.isEmpty())
+        return;
+    if(dev)
+        deliver(dev, &conn, conn.pending, false);
+    conn.pending.clear();
+}
+
+void QxtRPCServicePrivate::flushPending()
+{
+    flushScheduled = false;
+    if(device)
+        flushConnection(device, serverConnection);
+    if(!manager)
+        return;
+    QHash<quint64, Connection>::iterator conn = connections.begin();
+    for(; conn != connections.end(); ++conn)
+        flushConnection(manager->client(conn.key()), *conn);
+}
+
+void QxtRPCServicePrivate::deliver(QIODevice* dev, Connection* conn, const QByteArray& data, bool droppable,
+        quint64 correlation)
+{
+    if(conn && !conn->congested && highWatermark > 0 && policy != QxtRPCService::Block
+            && dev->bytesToWrite() + data.size() > highWatermark)
+        setCongested(conn, true);
+    if(!conn || !conn->congested) {
+        dev->write(data);
+        return;
+    }
+
+    // The connection is closed once control returns to the event loop; nothing more is written to it.
+    if(policy == QxtRPCService::Disconnect)
+        return;
+
+    // Make room by dropping the oldest calls that have not been written yet. The message just written is kept, so
+    // the newest call always gets through.
+    conn->backlog.append(Held(data, droppable, correlation));
+    conn->backlogSize += data.size();
+    const qint64 room = highWatermark - dev->bytesToWrite();
+    for(int i = 0; i < conn->backlog.count() - 1 && conn->backlogSize > room; ) {
+        if(conn->backlog.at(i).droppable) {
+            const quint64 dropped = conn->backlog.at(i).correlation;
+            conn->backlogSize -= conn->backlog.at(i).data.size();
+            conn->backlog.removeAt(i);
+            // A dropped call is never answered, so its reply does not wait for the timeout.
+            if(dropped) {
+                QPointer<QxtRPCReply> reply = replies.take(dropped);
+                if(reply)
+                    reply->finishLater(QxtRPCReply::DroppedError);
+            }
+        } else {
+            i++;
+        }
+    }
+    drain(dev, *conn);
+}
+
+void QxtRPCServicePrivate::setCongested(Connection* conn, bool congested)
+{
+    if(conn->congested == congested)
+        return;
+    conn->congested = congested;
+
+    // Congestion is noticed in the middle of writing a call, so the signals are delivered from the event loop.
+    QMetaObject::invokeMethod(&qxt_p(), congested ? "congested" : "decongested", Qt::QueuedConnection,
+                              Q_ARG(quint64, conn->client));
+    if(congested && policy == QxtRPCService::Disconnect)
+        QMetaObject::invokeMethod(this, "disconnectCongested", Qt::QueuedConnection);
+}
+
+void QxtRPCServicePrivate::drain(QIODevice* dev, Connection& conn)
+{
+    if(!conn.congested || dev->bytesToWrite() > lowWatermark)
+        return;
+
+    // The backlog is kept to the high watermark, so all of it can be written at once.
+    const QList<Held> backlog = conn.backlog;
+    conn.backlog.clear();
+    conn.backlogSize = 0;
+    setCongested(&conn, false);
+    for(int i = 0; i < backlog.count(); i++)
+        dev->write(backlog.at(i).data);
+}
+
+void QxtRPCServicePrivate::release(QIODevice* dev, Connection& conn)
+{
+    // A device that is about to be closed or handed over gets everything held back for it, congested or not.
+    if(dev) {
+        for(int i = 0; i < conn.backlog.count(); i++)
+            dev->write(conn.backlog.at(i).data);
+        if(!conn.pending.isEmpty())
+            dev->write(conn.pending);
+    }
+    conn.backlog.clear();
+    conn.backlogSize = 0;
+    conn.pending.clear();
+}
+
+QxtRPCServicePrivate::Connection* QxtRPCServicePrivate::connectionOf(QIODevice* dev, quint64 id)
+{
+    if(id == 0)
+        return dev && dev == device ? &serverConnection : 0;
+    QHash<quint64, Connection>::iterator conn = connections.find(id);
+    if(conn == connections.end() || !manager || manager->client(id) != dev)
+        return 0;
+    return &*conn;
+}
+
+void QxtRPCServicePrivate::waitForRoom(QIODevice* dev, quint64 id)
+{
+    if(policy != QxtRPCService::Block || highWatermark <= 0 || dev->bytesToWrite() <= highWatermark)
+        return;
+    // A connection that has already failed to drain in time does not hold up any more calls.
+    Connection* conn = connectionOf(dev, id);
+    if(conn && conn->congested)
+        return;
+
+    // No connection state is held while waiting: data may be received and dispatched, and the device closed.
+    QMetaObject::invokeMethod(&qxt_p(), "congested", Qt::QueuedConnection, Q_ARG(quint64, id));
+    QPointer<QIODevice> guard(dev);
+    QTime clock;
+    clock.start();
+    while(guard && guard->bytesToWrite() > lowWatermark) {
+        int left = -1;
+        if(congestionTimeout >= 0) {
+            left = congestionTimeout - clock.elapsed();
+            if(left <= 0)
+                break;
+        }
+        if(!guard->waitForBytesWritten(left))
+            break;
+    }
+    if(guard && guard->bytesToWrite() > lowWatermark) {
+        // The peer has stopped reading. Its calls are held back until it drains, and drain() announces that.
+        conn = connectionOf(guard, id);
+        if(conn) {
+            conn->congested = true;
+            return;
+        }
+    }
+    QMetaObject::invokeMethod(&qxt_p(), "decongested", Qt::QueuedConnection, Q_ARG(quint64, id));
+}
+
+bool QxtRPCServicePrivate::isCongested(QIODevice* dev, const Connection& conn) const
+{
+    return conn.congested || (highWatermark > 0 && dev && dev->bytesToWrite() > highWatermark);
+}
+
+QList<quint64> QxtRPCServicePrivate::uncongested(const QList<quint64>& ids) const
+{
+    if(!skipCongested)
+        return ids;
+    QList<quint64> rv;
+    foreach(quint64 id, ids) {
+        QHash<quint64, Connection>::const_iterator conn = connections.constFind(id);
+        if(conn == connections.constEnd() || !isCongested(manager->client(id), *conn))
+            rv << id;
+    }
+    return rv;
+}
+
+void QxtRPCServicePrivate::clientWritten(quint64 id)
+{
+    QIODevice* dev = manager ? manager->client(id) : 0;
+    QHash<quint64, Connection>::iterator conn = connections.find(id);
+    if(dev && conn != connections.end())
+        drain(dev, *conn);
+}
+
+void QxtRPCServicePrivate::serverWritten()
+{
+    if(device)
+        drain(device, serverConnection);
+}
+
+void QxtRPCServicePrivate::disconnectCongested()
+{
+    if(policy != QxtRPCService::Disconnect)
+        return;
+    if(device && serverConnection.congested)
+        qxt_p().disconnectServer();
+    if(!manager)
+        return;
+    QList<quint64> ids;
+    QHash<quint64, Connection>::const_iterator conn = connections.constBegin();
+    for(; conn != connections.constEnd(); ++conn) {
+        if(conn->congested)
+            ids << conn.key();
+    }
+    foreach(quint64 id, ids)
+        qxt_p().disconnectClient(id);
+}
+
+int QxtRPCServicePrivate::typeOf(const QByteArray& typeName)
+{
+    if(typeName == "QVariant")
+        return VariantType;
+    const int type = QMetaType::type(typeName.constData());
+    return type > 0 ? type : 0;
+}
+
+bool QxtRPCServicePrivate::invoke(const SlotDef& slot, const quint64* id, const QVariant* const* args,
+        QVariant* result) const
+{
+    // Nothing more is wanted once a slot has returned a value.
+    const bool wantsResult = result && !result->isValid() && slot.returnType != 0;
+    QVariant returned;
+    if(wantsResult && slot.returnType != VariantType)
+        returned = QVariant(slot.returnType, static_cast<const void*>(0));
+
+    if(slot.type == Qt::DirectConnection
+            || (slot.type == Qt::AutoConnection && slot.recv->thread() == QThread::currentThread())) {
+        // Call the slot through its metaobject with pointers to the deserialized values, just like a direct signal
+        // emission does. Values of a different type are converted first.
+        void* argv[10];
+        QVariant converted[9];
+        argv[0] = 0;
+        if(wantsResult)
+            argv[0] = slot.returnType == VariantType ? &returned : returned.data();
+        const int count = slot.parameterTypes.count();
+        int next = 0;
+        for(int i = 0; i < count; i++) {
+            const int type = slot.parameterTypes.at(i);
+            if(i == 0 && id) {
+                if(type != QMetaType::ULongLong)
+                    return false;
+                argv[1] = const_cast<quint64*>(id);
+                continue;
+            }
+            if(next >= 8)
+                return false;
+            const QVariant* value = args[next++];
+            if(type == VariantType) {
+                argv[i + 1] = const_cast<QVariant*>(value);
+            } else if(value->userType() == type) {
+                argv[i + 1] = const_cast<void*>(value->constData());
+            } else {
+                converted[i] = *value;
+                if(!converted[i].convert(QVariant::Type(type)))
+                    return false;
+                argv[i + 1] = converted[i].data();
+            }
+        }
+        QMetaObject::metacall(slot.recv, QMetaObject::InvokeMetaMethod, slot.index, argv);
+    } else {
+        // Queued invocations copy their arguments, which invokeMethod() takes care of. Only a blocking one can
+        // return a value.
+        QGenericArgument argv[9];
+        int count = 0;
+        if(id)
+            argv[count++] = Q_ARG(quint64, *id);
+        for(int next = 0; count < slot.parameterTypes.count() && next < 8; next++, count++) {
+            if(slot.parameterTypes.at(count) == VariantType)
+                argv[count] = Q_ARG(QVariant, *args[next]);
+            else
+                argv[count] = QGenericArgument(args[next]->typeName(), args[next]->constData());
+        }
+        QGenericReturnArgument ret;
+        if(wantsResult && slot.type == Qt::BlockingQueuedConnection) {
+            if(slot.returnType == VariantType)
+                ret = Q_RETURN_ARG(QVariant, returned);
+            else
+                ret = QGenericReturnArgument(slot.returnTypeName.constData(), returned.data());
+        }
+        if(!QMetaObject::invokeMethod(slot.recv, slot.slot.constData(), slot.type, ret, argv[0], argv[1], argv[2],
+                    argv[3], argv[4], argv[5], argv[6], argv[7], argv[8]))
+            return false;
+        if(!ret.data())
+            return true;
+    }
+
+    if(wantsResult)
+        *result = returned;
+    return true;
+}
+
+bool QxtRPCServicePrivate::dispatchFromServer(int method, QVariant* result, const QVariant& p0, const QVariant& p1,
         const QVariant& p2, const QVariant& p3, const QVariant& p4, const QVariant& p5, const QVariant& p6,
         const QVariant& p7) const
 {
-    // If the received message is not connected to any slots, ignore it.
-    if(!connectedSlots.contains(fn)) return; 
+    // Copy the entry, since a slot may attach further functions and reallocate the table.
+    const Method entry = methods.at(method);
+    const QString& fn = entry.name;
+    const QVariant* const args[8] = { &p0, &p1, &p2, &p3, &p4, &p5, &p6, &p7 };
+    bool handled = false;
+
+    foreach(const SlotDef& slot, entry.receivers) {
+        // Invoke the specified slot on the receiver object using the arguments passed to the function. The types
+        // were looked up when the slot was attached.
+        if(qxt_rpcservice_debug) 
+            qDebug() << "QxtRPCService: received" << fn << "- invoking" << slot.recv << slot.slot.constData() << slot.type << p0 << p1 << p2 << p3 << p4 << p5 << p6 << p7;
+        if(invoke(slot, 0, args, result))
+            handled = true;
+        else
+            qWarning() << "QxtRPCService: invokeMethod for " << slot.recv << "::" << slot.slot << " failed";
+    }
+    return handled;
+}
 
-    foreach(const SlotDef& slot, connectedSlots.value(fn))
-    {
-        // Look up the parameters for each slot based on its metamethod definition.
-        MetaMethodDef method = qMakePair(slot.recv->metaObject(), slot.slot);
-        const QList<QByteArray>& params = slotParameters.value(method);
-        int numParams = params.count();
+bool QxtRPCServicePrivate::dispatchFromClient(quint64 id, int method, QVariant* result, const QVariant& p0,
+        const QVariant& p1, const QVariant& p2, const QVariant& p3, const QVariant& p4, const QVariant& p5,
+        const QVariant& p6, const QVariant& p7) const
+{
+    // See dispatchFromServer() for why the entry is copied.
+    const Method entry = methods.at(method);
+    const QString& fn = entry.name;
+    const QVariant* const args[8] = { &p0, &p1, &p2, &p3, &p4, &p5, &p6, &p7 };
+    bool handled = false;
 
-        // Invoke the specified slot on the receiver object using the arguments passed to the function.
-        // See dispatchFromServer() for a discussion of the safety of QXT_ARG here.
+    foreach(const SlotDef& slot, entry.receivers)
+    {
+        // The client ID is passed in front of the arguments.
         if(qxt_rpcservice_debug) 
             qDebug() << "QxtRPCService: received" << fn << "- invoking" << slot.recv << slot.slot.constData() << slot.type << id << p0 << p1 << p2 << p3 << p4 << p5 << p6 << p7;
-        if(!QMetaObject::invokeMethod(slot.recv, slot.slot.constData(), slot.type, Q_ARG(quint64, id), QXT_ARG(0),
-                    QXT_ARG(1), QXT_ARG(2), QXT_ARG(3), QXT_ARG(4), QXT_ARG(5), QXT_ARG(6), QXT_ARG(7))) {
+        if(invoke(slot, &id, args, result))
+            handled = true;
+        else
             qWarning() << "QxtRPCService: invokeMethod for " << slot.recv << "::" << slot.slot << " failed";
-        }
     }
+    return handled;
 }
 
 /*!
@@ -415,6 +1057,8 @@ QxtRPCService::QxtRPCService(QObject* parent) : QObject(parent)
     // Every QxtRPCService object has two private worker objects.
     // QxtRPCServicePrivate is responsible for most of the heavy lifting.
     QXT_INIT_PRIVATE(QxtRPCService);
+    // It is a child so that it follows the service to another thread. It is still deleted by the private interface.
+    qxt_d().setParent(this);
     // QxtRPCServiceIntrospector is responsible for capturing and processing incoming signals.
     qxt_d().introspector = new QxtRPCServiceIntrospector(this);
 
@@ -430,6 +1074,7 @@ QxtRPCService::QxtRPCService(QObject* parent) : QObject(parent)
 QxtRPCService::QxtRPCService(QIODevice* device, QObject* parent) : QObject(parent)
 {
     QXT_INIT_PRIVATE(QxtRPCService);
+    qxt_d().setParent(this);
     qxt_d().introspector = new QxtRPCServiceIntrospector(this);
     setDevice(device);
 }
@@ -482,6 +1127,11 @@ void QxtRPCService::disconnectClient(quint64 id)
         return;
     }
 
+    // Send what has been collected for the client before it goes away.
+    QHash<quint64, QxtRPCServicePrivate::Connection>::iterator conn = qxt_d().connections.find(id);
+    if(conn != qxt_d().connections.end())
+        qxt_d().release(qxt_d().manager->client(id), *conn);
+
     // Ask the manager to disconnect the client. QxtAbstractConnectionManager will emit disconnected(), which is chained
     // to QxtRPCService::clientDisconnected(), so that signal is not explicitly emitted here.
     qxt_d().manager->disconnect(id);
@@ -559,15 +1209,22 @@ QIODevice* QxtRPCService::device() const
 void QxtRPCService::setDevice(QIODevice* dev)
 {
     // First, delete the old device if one is set.
-    if(qxt_d().device)
+    if(qxt_d().device) {
+        qxt_d().release(qxt_d().device, qxt_d().serverConnection);
         delete qxt_d().device;
+        qxt_d().failReplies(true, 0);
+    }
 
     // Then set the device and claim ownership of it.
     qxt_d().device = dev;
     dev->setParent(this);
 
+    // Start over with the new server. Method IDs are offered to it once the connection is used.
+    qxt_d().serverConnection = QxtRPCServicePrivate::Connection();
+
     // Listen for data arriving on the device.
     QObject::connect(dev, SIGNAL(readyRead()), &qxt_d(), SLOT(serverData()));
+    QObject::connect(dev, SIGNAL(bytesWritten(qint64)), &qxt_d(), SLOT(serverWritten()));
 
     // If there's already data available on the device, process it.
     if(dev->bytesAvailable() > 0)
@@ -584,11 +1241,15 @@ QIODevice* QxtRPCService::takeDevice()
 {
     QIODevice* oldDevice = qxt_d().device;
     if(oldDevice) {
+        // Calls made before the device is released still belong to it.
+        qxt_d().release(oldDevice, qxt_d().serverConnection);
+
         // Make sure all signals from the device are disconnected before releasing it so that we don't get spurious
         // signals firing off where we don't want them.
         QObject::disconnect(oldDevice, 0, this, 0);
         QObject::disconnect(oldDevice, 0, &qxt_d(), 0);
         qxt_d().device = NULL;
+        qxt_d().failReplies(true, 0);
     }
     return oldDevice;
 }
@@ -604,12 +1265,16 @@ QxtAbstractSignalSerializer* QxtRPCService::serializer() const
 
 /*!
  * Sets the signal \a serializer used to encode signals before transmission. The existing serializer will be deleted.
+ *
+ * Both ends of a connection must use the same kind of serializer. The serializer can be changed until a connection
+ * first sends or receives a message; QxtRPCService does not write anything to a device before that.
  * \sa serializer()
  */
 void QxtRPCService::setSerializer(QxtAbstractSignalSerializer* serializer)
 {
     delete qxt_d().serializer;
     qxt_d().serializer = serializer;
+    qxt_d().extension = dynamic_cast<QxtSignalSerializerExtension*>(serializer);
 }
 
 /*!
@@ -643,6 +1308,216 @@ void QxtRPCService::setConnectionManager(QxtAbstractConnectionManager* manager)
                      &qxt_d(), SLOT(clientDisconnected(QIODevice*, quint64)));
 }
 
+/*!
+ * Returns \c true if calls are collected and written together.
+ * \sa setCorked()
+ */
+bool QxtRPCService::isCorked() const
+{
+    return qxt_d().corked;
+}
+
+/*!
+ * Enables or disables collecting calls. When \a enable is \c true, messages are not written to the device as soon
+ * as they are serialized. They are held back for each connection and written in one piece when control returns to
+ * the event loop, when corkThreshold() bytes are waiting for a connection, or when flush() is called. Disabling it
+ * writes all held back messages. It is disabled by default.
+ * \sa isCorked(), flush()
+ */
+void QxtRPCService::setCorked(bool enable)
+{
+    qxt_d().corked = enable;
+    if(!enable)
+        flush();
+}
+
+/*!
+ * Returns the number of bytes that can be held back for a connection before they are written.
+ * \sa setCorkThreshold()
+ */
+int QxtRPCService::corkThreshold() const
+{
+    return qxt_d().corkThreshold;
+}
+
+/*!
+ * Sets the number of \a bytes that can be held back for a connection before they are written while corked. The
+ * default is 16384.
+ * \sa corkThreshold(), setCorked()
+ */
+void QxtRPCService::setCorkThreshold(int bytes)
+{
+    qxt_d().corkThreshold = bytes;
+}
+
+/*!
+ * Writes all calls held back while corked to their devices immediately. Call this after a call that should not wait
+ * for the event loop.
+ * \sa setCorked()
+ */
+void QxtRPCService::flush()
+{
+    qxt_d().flushPending();
+}
+
+/*!
+ * Returns \c true if large messages are compressed.
+ * \sa setCompressionEnabled()
+ */
+bool QxtRPCService::isCompressionEnabled() const
+{
+    return qxt_d().compression;
+}
+
+/*!
+ * Enables or disables compressing messages of at least compressionThreshold() bytes. A message is only compressed
+ * for peers that announced that they accept it, and only if that makes it smaller. It is disabled by default.
+ * \sa isCompressionEnabled()
+ */
+void QxtRPCService::setCompressionEnabled(bool enable)
+{
+    qxt_d().compression = enable;
+}
+
+/*!
+ * Returns the size in bytes from which messages are compressed.
+ * \sa setCompressionThreshold()
+ */
+int QxtRPCService::compressionThreshold() const
+{
+    return qxt_d().compressionThreshold;
+}
+
+/*!
+ * Sets the size in \a bytes from which messages are compressed. Smaller messages rarely get smaller. The default
+ * is 1024.
+ * \sa compressionThreshold(), setCompressionEnabled()
+ */
+void QxtRPCService::setCompressionThreshold(int bytes)
+{
+    qxt_d().compressionThreshold = bytes;
+}
+
+/*!
+ * Returns the number of bytes a congested connection has to drain to before it is no longer congested.
+ * \sa setWatermarks()
+ */
+qint64 QxtRPCService::lowWatermark() const
+{
+    return qxt_d().lowWatermark;
+}
+
+/*!
+ * Returns the number of bytes that can be waiting to be written to a connection before it is congested.
+ * \sa setWatermarks()
+ */
+qint64 QxtRPCService::highWatermark() const
+{
+    return qxt_d().highWatermark;
+}
+
+/*!
+ * Sets the watermarks applied to each connection. A connection is congested once more than \a high bytes are
+ * waiting to be written to it, counting those held back by QxtRPCService as well as QIODevice::bytesToWrite(), and
+ * stays congested until it has drained to \a low bytes. A \a high watermark of 0 or less, the default, lets
+ * connections grow without bound.
+ *
+ * Only devices that buffer their writes and emit QIODevice::bytesWritten(), such as QTcpSocket, can become
+ * congested.
+ * \sa lowWatermark(), highWatermark(), setCongestionPolicy(), congested()
+ */
+void QxtRPCService::setWatermarks(qint64 low, qint64 high)
+{
+    qxt_d().lowWatermark = qMin(low, high);
+    qxt_d().highWatermark = high;
+}
+
+/*!
+ * Returns what is done with calls to a congested connection.
+ * \sa setCongestionPolicy()
+ */
+QxtRPCService::CongestionPolicy QxtRPCService::congestionPolicy() const
+{
+    return qxt_d().policy;
+}
+
+/*!
+ * Sets what is done with calls to a congested connection to \a policy:
+ *
+ * \list
+ * \o Block: A call waits for the connection to drain to lowWatermark() bytes before it is written. This is the
+ *    default. Messages received while waiting may be processed, so slots may be invoked from within the call. If
+ *    the connection has not drained within congestionTimeout(), calls to it are treated as with DropOldest until
+ *    it has.
+ * \o DropOldest: Calls are held back until the connection has drained, and the oldest of them are discarded
+ *    to keep the connection at highWatermark() bytes. The newest call is always kept. The reply to a call
+ *    discarded by callWithReply() finishes with QxtRPCReply::DroppedError once control returns to the event loop,
+ *    without waiting for replyTimeout().
+ * \o Disconnect: The congested connection is closed once control returns to the event loop, and calls to it are
+ *    discarded until then.
+ * \endlist
+ *
+ * Replies to callWithReply() and the messages QxtRPCService uses to negotiate the protocol are never discarded.
+ * \sa congestionPolicy(), setWatermarks()
+ */
+void QxtRPCService::setCongestionPolicy(CongestionPolicy policy)
+{
+    qxt_d().policy = policy;
+}
+
+/*!
+ * Returns \c true if calls to all clients leave out congested clients.
+ * \sa setSkipCongested()
+ */
+bool QxtRPCService::skipCongested() const
+{
+    return qxt_d().skipCongested;
+}
+
+/*!
+ * When \a enable is \c true, call() without client IDs, callExcept(), and attached signals do not send anything to
+ * connections that are congested, whatever the congestionPolicy(). Calls to specific clients are not affected. It
+ * is disabled by default.
+ * \sa skipCongested(), isCongested()
+ */
+void QxtRPCService::setSkipCongested(bool enable)
+{
+    qxt_d().skipCongested = enable;
+}
+
+/*!
+ * Returns the number of milliseconds a call waits for a congested connection with the Block policy.
+ * \sa setCongestionTimeout()
+ */
+int QxtRPCService::congestionTimeout() const
+{
+    return qxt_d().congestionTimeout;
+}
+
+/*!
+ * Sets the number of milliseconds a call waits for a congested connection to drain with the Block policy to
+ * \a msecs. Since the thread waits with it, a peer that stops reading would otherwise hold up every other connection
+ * as well. A connection that has not drained in time stays congested, and calls to it are held back and discarded
+ * as with DropOldest until it has drained. A negative value waits without a time limit. The default is 1000.
+ * \sa congestionTimeout(), setCongestionPolicy()
+ */
+void QxtRPCService::setCongestionTimeout(int msecs)
+{
+    qxt_d().congestionTimeout = msecs;
+}
+
+/*!
+ * Returns \c true if the connection to the client \a id, or to the server if \a id is 0, is congested.
+ * \sa setWatermarks()
+ */
+bool QxtRPCService::isCongested(quint64 id) const
+{
+    if(id == 0)
+        return isClient() && qxt_d().isCongested(qxt_d().device, qxt_d().serverConnection);
+    QHash<quint64, QxtRPCServicePrivate::Connection>::const_iterator conn = qxt_d().connections.constFind(id);
+    return conn != qxt_d().connections.constEnd() && qxt_d().isCongested(qxt_d().manager->client(id), *conn);
+}
+
 /*!
  * Attaches the given signal.
  *
@@ -669,49 +1544,47 @@ bool QxtRPCService::attachSignal(QObject* sender, const char* signal, const QStr
  * \bold {Note:} When acting like a server, the first parameter of the slot must be <b>quint64 id</b>. The parameters 
  * of the incoming signal follow. For example, SIGNAL(mySignal(QString)) from the client connects to
  * SLOT(mySlot(quint64, QString)) on the server.
+ *
+ * Attach slots before connections are established. If the serializer supports method IDs, a connection keeps
+ * ignoring an RPC function that the peer called through it before a slot was attached to the function.
  */
 bool QxtRPCService::attachSlot(const QString& rpcFunction, QObject* recv, const char* slot, Qt::ConnectionType type)
 {
+    // Look the method up once; every message is dispatched through the index and types stored here.
     const QMetaObject* meta = recv->metaObject();
-    QByteArray name = QxtMetaObject::methodName(slot);
-    QxtRPCServicePrivate::MetaMethodDef info = qMakePair(meta, name);
+    QByteArray norm = QxtMetaObject::methodSignature(slot);
+    int methodID = meta->indexOfMethod(norm.constData());
+    if(methodID < 0) {
+        // indexOfMethod() returns -1 if the method was not found, so report a warning and return an error.
+        qWarning() << "QxtRPCService::attachSlot: " << recv << "::" << norm << " does not exist";
+        return false;
+    }
+    const QMetaMethod metaMethod = meta->method(methodID);
 
-    if(!qxt_d().slotParameters.count(info)) {
-        // This method hasn't been encountered before, so read the metaobject and cache the results.
-        QByteArray norm = QxtMetaObject::methodSignature(slot);
-        int methodID = meta->indexOfMethod(norm.constData());
-        if(methodID < 0) {
-            // indexOfMethod() returns -1 if the method was not found, so report a warning and return an error.
-            qWarning() << "QxtRPCService::attachSlot: " << recv << "::" << norm << " does not exist";
+    // Construct a slot definition, ensuring that each parameter is queueable.
+    QxtRPCServicePrivate::SlotDef slotDef;
+    slotDef.recv = recv;
+    slotDef.slot = QxtMetaObject::methodName(slot);
+    slotDef.type = type;
+    slotDef.index = methodID;
+    foreach(const QByteArray& typeName, metaMethod.parameterTypes()) {
+        const int typeID = QxtRPCServicePrivate::typeOf(typeName);
+        if(!typeID) {
+            qWarning() << "QxtRPCService::attachSlot: cannot queue arguments of type " << typeName;
             return false;
         }
-
-        // Look up the method's parameter list, ensure each parameter is queueable, and cache the type IDs.
-        QList<QByteArray> types = meta->method(methodID).parameterTypes();
-        int ct = types.count();
-        for(int i = 0; i < ct; i++) {
-            int typeID = QMetaType::type(types.value(i).constData());
-            if(typeID <= 0) {
-                qWarning() << "QxtRPCService::attachSlot: cannot queue arguments of type " << types.value(i);
-                return false;
-            }
-        }
-        
-        // Cache the looked-up parameter list.
-        qxt_d().slotParameters[info] = types;
+        slotDef.parameterTypes.append(typeID);
     }
+    slotDef.returnTypeName = metaMethod.typeName();
+    slotDef.returnType = slotDef.returnTypeName.isEmpty() ? 0 : QxtRPCServicePrivate::typeOf(slotDef.returnTypeName);
 
     // If the RPC function name appears to be a signal or slot, normalize the signature.
     QString rpcFunc = rpcFunction;
     if(QxtMetaObject::isSignalOrSlot(rpcFunction.toAscii().constData()))
         rpcFunc = QxtMetaObject::methodSignature(rpcFunction.toAscii().constData());
 
-    // Construct a slot definition and associate it with the RPC function name.
-    QxtRPCServicePrivate::SlotDef slotDef;
-    slotDef.recv = recv;
-    slotDef.slot = name;
-    slotDef.type = type;
-    qxt_d().connectedSlots[rpcFunc].append(slotDef);
+    // Associate the slot definition with the RPC function name.
+    qxt_d().methods[qxt_d().methodFor(rpcFunc)].receivers.append(slotDef);
 
     return true;
 }
@@ -738,12 +1611,13 @@ void QxtRPCService::detachSignals(QObject* obj)
  */
 void QxtRPCService::detachSlots(QObject* obj)
 {
-    foreach(const QString& name, qxt_d().connectedSlots.keys()) {
+    QVector<QxtRPCServicePrivate::Method>& methods = qxt_d().methods;
+    for(int i = 0; i < methods.count(); i++) {
         // Iterate over all connected slots.
-        foreach(const QxtRPCServicePrivate::SlotDef& slot, qxt_d().connectedSlots.value(name)) {
+        foreach(const QxtRPCServicePrivate::SlotDef& slot, methods.at(i).receivers) {
             // Skip slots on other objects.
             if(slot.recv != obj) continue;
-            qxt_d().connectedSlots[name].removeAll(slot);
+            methods[i].receivers.removeAll(slot);
         }
     }
 }
@@ -752,7 +1626,7 @@ void QxtRPCService::detachSlots(QObject* obj)
  * Sends the signal \a fn with the given parameter list to the server, or to all connected clients.
  *
  * The receiver is not obligated to act upon the signal. If no clients are connected, and if not communicating with a
- * server, this function does nothing.
+ * server, this function does nothing. Congested connections are left out if skipCongested() is \c true.
  */
 void QxtRPCService::call(QString fn, const QVariant& p1, const QVariant& p2, const QVariant& p3, const QVariant& p4,
                          const QVariant& p5, const QVariant& p6, const QVariant& p7, const QVariant& p8)
@@ -765,15 +1639,91 @@ void QxtRPCService::call(QString fn, const QVariant& p1, const QVariant& p2, con
         if(QxtMetaObject::isSignalOrSlot(fn.toAscii().constData()))
             fn = QxtMetaObject::methodSignature(fn.toAscii().constData());
 
-        // Serialize the parameters and write the result to the device.
-        QByteArray data = qxt_d().serializer->serialize(fn, p1, p2, p3, p4, p5, p6, p7, p8);
-        qxt_d().device->write(data);
+        // Serialize the parameters and write the result to the device, unless it is to be left out.
+        if(!qxt_d().skipCongested || !isCongested(0)) {
+            const QVariant args[8] = { p1, p2, p3, p4, p5, p6, p7, p8 };
+            QxtRPCServicePrivate::Outgoing out;
+            qxt_d().waitForRoom(qxt_d().device, 0);
+            if(qxt_d().device)
+                qxt_d().send(qxt_d().device, &qxt_d().serverConnection, fn, args, out);
+        }
     }
 
     if(isServer()) {
         // Delegate the call to the other overload of call().
-        call(clients(), fn, p1, p2, p3, p4, p5, p6, p7, p8);
+        call(qxt_d().uncongested(clients()), fn, p1, p2, p3, p4, p5, p6, p7, p8);
+    }
+}
+
+/*!
+ * Sends the signal \a fn with the given parameter list to the server and returns a QxtRPCReply that receives the
+ * value returned by the slot attached to it on the server.
+ *
+ * The reply is a child of the QxtRPCService; delete it once it has finished. If not connected to a server, the reply
+ * finishes with QxtRPCReply::DisconnectedError once control returns to the event loop.
+ * \sa replyTimeout()
+ */
+QxtRPCReply* QxtRPCService::callWithReply(QString fn, const QVariant& p1, const QVariant& p2, const QVariant& p3,
+        const QVariant& p4, const QVariant& p5, const QVariant& p6, const QVariant& p7, const QVariant& p8)
+{
+    if(qxt_rpcservice_debug)
+        qDebug() << "QxtRPCService: calling" << fn << "on peer with reply and parameters" << p1 << p2 << p3 << p4 << p5 << p6 << p7 << p8;
+
+    // Normalize the function name if it has the form of a signal or slot.
+    if(QxtMetaObject::isSignalOrSlot(fn.toAscii().constData()))
+        fn = QxtMetaObject::methodSignature(fn.toAscii().constData());
+
+    const QVariant args[8] = { p1, p2, p3, p4, p5, p6, p7, p8 };
+    if(isClient())
+        qxt_d().waitForRoom(qxt_d().device, 0);
+    QIODevice* dev = isClient() ? qxt_d().device : 0;
+    return qxt_d().callWithReply(dev, &qxt_d().serverConnection, true, 0, fn, args);
+}
+
+/*!
+ * Sends the signal \a fn with the given parameter list to the client \a id and returns a QxtRPCReply that receives
+ * the value returned by the slot attached to it on the client.
+ *
+ * If no client with the given ID is connected, the reply finishes with QxtRPCReply::DisconnectedError once control
+ * returns to the event loop.
+ * \sa replyTimeout()
+ */
+QxtRPCReply* QxtRPCService::callWithReply(quint64 id, QString fn, const QVariant& p1, const QVariant& p2,
+        const QVariant& p3, const QVariant& p4, const QVariant& p5, const QVariant& p6, const QVariant& p7,
+        const QVariant& p8)
+{
+    if(qxt_rpcservice_debug)
+        qDebug() << "QxtRPCService: calling" << fn << "on" << id << "with reply and parameters" << p1 << p2 << p3 << p4 << p5 << p6 << p7 << p8;
+
+    const QVariant args[8] = { p1, p2, p3, p4, p5, p6, p7, p8 };
+    QIODevice* dev = qxt_d().manager ? qxt_d().manager->client(id) : 0;
+    if(dev) {
+        // Waiting may take long enough for the client to go away.
+        qxt_d().waitForRoom(dev, id);
+        dev = qxt_d().manager ? qxt_d().manager->client(id) : 0;
     }
+    QHash<quint64, QxtRPCServicePrivate::Connection>::iterator conn = qxt_d().connections.find(id);
+    return qxt_d().callWithReply(dev, conn == qxt_d().connections.end() ? 0 : &*conn, false, id, fn, args);
+}
+
+/*!
+ * Returns the number of milliseconds a QxtRPCReply waits for its reply before it fails with
+ * QxtRPCReply::TimeoutError.
+ * \sa setReplyTimeout()
+ */
+int QxtRPCService::replyTimeout() const
+{
+    return qxt_d().replyTimeout;
+}
+
+/*!
+ * Sets the number of milliseconds a QxtRPCReply created by callWithReply() waits for its reply to \a msecs. A value
+ * of 0 or less waits until the connection is closed. The default is 30000.
+ * \sa replyTimeout()
+ */
+void QxtRPCService::setReplyTimeout(int msecs)
+{
+    qxt_d().replyTimeout = msecs;
 }
 
 /*!
@@ -788,8 +1738,9 @@ void QxtRPCService::call(QList<quint64> ids, QString fn, const QVariant& p1, con
     if(qxt_rpcservice_debug) 
         qDebug() << "QxtRPCService: calling" << fn << "on" << ids << "with parameters" << p1 << p2 << p3 << p4 << p5 << p6 << p7 << p8;
 
-    // Serialize the parameters first.
-    QByteArray data = qxt_d().serializer->serialize(fn, p1, p2, p3, p4, p5, p6, p7, p8);
+    // The parameters are serialized by the first client that needs them and reused for the others.
+    const QVariant args[8] = { p1, p2, p3, p4, p5, p6, p7, p8 };
+    QxtRPCServicePrivate::Outgoing out;
 
     foreach(quint64 id, ids) {
         // Find the specified client.
@@ -799,8 +1750,13 @@ void QxtRPCService::call(QList<quint64> ids, QString fn, const QVariant& p1, con
             continue;
         }
 
-        // Transmit the data to the client.
-        dev->write(data);
+        // Transmit the data to the client. Waiting for a congested client may take long enough for it to go away.
+        qxt_d().waitForRoom(dev, id);
+        dev = qxt_d().manager ? qxt_d().manager->client(id) : 0;
+        if(!dev)
+            continue;
+        QHash<quint64, QxtRPCServicePrivate::Connection>::iterator conn = qxt_d().connections.find(id);
+        qxt_d().send(dev, conn == qxt_d().connections.end() ? 0 : &*conn, fn, args, out);
     }
 }
 
@@ -821,13 +1777,14 @@ void QxtRPCService::call(quint64 id, QString fn, const QVariant& p1, const QVari
  * Sends the signal \a fn with the given parameter list to all connected clients except for the client specified.
  *
  * The receiver is not obligated to act upon the signal. This function is useful for rebroadcasting a signal from one
- * client to all other connected clients. If acting as a client, this function does nothing.
+ * client to all other connected clients. If acting as a client, this function does nothing. Congested clients are
+ * left out if skipCongested() is \c true.
  */
 void QxtRPCService::callExcept(quint64 id, QString fn, const QVariant& p1, const QVariant& p2, const QVariant& p3,
         const QVariant& p4, const QVariant& p5, const QVariant& p6, const QVariant& p7, const QVariant& p8)
 {
     // Get the list of clients and remove the exception, then delegate the call to the appropriate overload of call().
-    QList<quint64> ids = clients();
+    QList<quint64> ids = qxt_d().uncongested(clients());
     ids.removeAll(id);
     call(ids, fn, p1, p2, p3, p4, p5, p6, p7, p8);
 }
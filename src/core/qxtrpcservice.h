@@ -36,12 +36,20 @@
 QT_FORWARD_DECLARE_CLASS(QIODevice)
 class QxtAbstractConnectionManager;
 class QxtAbstractSignalSerializer;
+class QxtRPCReply;
 
 class QxtRPCServicePrivate;
 class QXT_CORE_EXPORT QxtRPCService : public QObject
 {
 Q_OBJECT
 public:
+    enum CongestionPolicy
+    {
+        Block,
+        DropOldest,
+        Disconnect
+    };
+
     QxtRPCService(QObject* parent = 0);
     explicit QxtRPCService(QIODevice* device, QObject* parent = 0);
     virtual ~QxtRPCService();
@@ -60,6 +68,26 @@ public:
     QxtAbstractConnectionManager* connectionManager() const;
     void setConnectionManager(QxtAbstractConnectionManager* manager);
 
+    bool isCorked() const;
+    void setCorked(bool enable);
+    int corkThreshold() const;
+    void setCorkThreshold(int bytes);
+    bool isCompressionEnabled() const;
+    void setCompressionEnabled(bool enable);
+    int compressionThreshold() const;
+    void setCompressionThreshold(int bytes);
+
+    qint64 lowWatermark() const;
+    qint64 highWatermark() const;
+    void setWatermarks(qint64 low, qint64 high);
+    CongestionPolicy congestionPolicy() const;
+    void setCongestionPolicy(CongestionPolicy policy);
+    bool skipCongested() const;
+    void setSkipCongested(bool enable);
+    int congestionTimeout() const;
+    void setCongestionTimeout(int msecs);
+    bool isCongested(quint64 id = 0) const;
+
     bool attachSignal(QObject* sender, const char* signal, const QString& rpcFunction = QString());
     bool attachSlot(const QString& rpcFunction, QObject* recv, const char* slot,
             Qt::ConnectionType type = Qt::AutoConnection);
@@ -67,11 +95,24 @@ public:
     void detachSlots(QObject* obj);
     void detachObject(QObject* obj);
 
+    QxtRPCReply* callWithReply(QString fn, const QVariant& p1 = QVariant(), const QVariant& p2 = QVariant(),
+                               const QVariant& p3 = QVariant(), const QVariant& p4 = QVariant(),
+                               const QVariant& p5 = QVariant(), const QVariant& p6 = QVariant(),
+                               const QVariant& p7 = QVariant(), const QVariant& p8 = QVariant());
+    QxtRPCReply* callWithReply(quint64 id, QString fn, const QVariant& p1 = QVariant(), const QVariant& p2 = QVariant(),
+                               const QVariant& p3 = QVariant(), const QVariant& p4 = QVariant(),
+                               const QVariant& p5 = QVariant(), const QVariant& p6 = QVariant(),
+                               const QVariant& p7 = QVariant(), const QVariant& p8 = QVariant());
+    int replyTimeout() const;
+    void setReplyTimeout(int msecs);
+
 public Q_SLOTS:
     void disconnectClient(quint64 id);
     void disconnectServer();
     void disconnectAll();
 
+    void flush();
+
     void call(QString fn, const QVariant& p1 = QVariant(), const QVariant& p2 = QVariant(),
               const QVariant& p3 = QVariant(), const QVariant& p4 = QVariant(), const QVariant& p5 = QVariant(),
               const QVariant& p6 = QVariant(), const QVariant& p7 = QVariant(), const QVariant& p8 = QVariant());
@@ -100,6 +141,20 @@ Q_SIGNALS:
      */
     void clientDisconnected(quint64 id);
 
+    /*!
+     * This signal is emitted when more than highWatermark() bytes are waiting to be written to the client \a id, or
+     * to the server if \a id is 0.
+     * \sa setWatermarks()
+     */
+    void congested(quint64 id);
+
+    /*!
+     * This signal is emitted when a congested connection to the client \a id, or to the server if \a id is 0, has
+     * drained to lowWatermark() bytes.
+     * \sa setWatermarks()
+     */
+    void decongested(quint64 id);
+
 private:
     QXT_DECLARE_PRIVATE(QxtRPCService)
 };
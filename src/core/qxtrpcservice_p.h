@@ -27,11 +27,16 @@
 #define QXTRPCSERVICE_P_H
 
 #include "qxtrpcservice.h"
+#include "qxtabstractsignalserializer.h"
+#include "qxtrpcreply.h"
 #include <QPointer>
 #include <QHash>
 #include <QByteArray>
 #include <QString>
 #include <QPair>
+#include <QVector>
+#include <QBitArray>
+#include <QList>
 
 class QxtRPCServiceIntrospector;
 class QxtRPCServicePrivate : public QObject, public QxtPrivate<QxtRPCService>
@@ -46,9 +51,54 @@ public:
     QxtAbstractSignalSerializer* serializer;
     QPointer<QIODevice> device;
 
-    // One buffer is needed for the "server" connection, and one buffer is needed for each connected client.
-    QByteArray serverBuffer;
-    QHash<quint64, QByteArray> buffers;
+    // The serializer's optional interface for parsing in place and for method IDs, or null. Messages are taken from
+    // the front of the buffer when it is missing, so the offset of a connection stays 0.
+    QxtSignalSerializerExtension* extension;
+    bool supportsMethodIds() const { return extension && extension->supportsMethodIds(); }
+    bool canDeserialize(const QByteArray& buffer, int offset) const;
+    QxtAbstractSignalSerializer::DeserializedData deserialize(QByteArray& buffer, int& offset, quint32* methodId);
+
+    // A message held back while its connection is congested: whether it may be dropped, and the correlation ID of
+    // the reply it asks for, which is finished when the call is dropped.
+    struct Held
+    {
+        QByteArray data;
+        bool droppable;
+        quint64 correlation;
+        Held(const QByteArray& data = QByteArray(), bool droppable = false, quint64 correlation = 0)
+            : data(data), droppable(droppable), correlation(correlation) {}
+    };
+
+    // State kept for each connection. Incoming messages are consumed by advancing the offset; the processed data is
+    // discarded once per readyRead() instead of once per message. The rest is the method ID table negotiated with the
+    // peer: whether we have announced what we accept, whether the peer accepts numbered messages, which of our IDs it
+    // has been told about, and the IDs it has defined for us. Only IDs of functions attached here are resolved to
+    // their entry in methods, so the peer cannot make the table larger than methods; the others are only marked.
+    struct Connection
+    {
+        QByteArray data;
+        int offset;
+        quint64 client;             // the client ID; unused for the server connection
+        bool expectsReply;          // the next call carries replyTo
+        quint64 replyTo;
+        bool announced;
+        bool acceptsIds;
+        bool acceptsCompression;
+        QByteArray pending;         // messages held back while corked
+        bool congested;
+        QList<Held> backlog;        // messages held back while congested
+        qint64 backlogSize;
+        QBitArray sentIds;
+        QHash<quint32, int> incoming;
+        QBitArray unattachedIds;
+        Connection() : offset(0), client(0), expectsReply(false), replyTo(0), announced(false), acceptsIds(false),
+                       acceptsCompression(false), congested(false), backlogSize(0) {}
+        inline void compact() { data.remove(0, offset); offset = 0; }
+    };
+
+    // One connection is needed for the "server", and one connection is needed for each connected client.
+    Connection serverConnection;
+    QHash<quint64, Connection> connections;
 
     // A Qt invokable, such as a signal or slot, can be identified by the metaobject containing its description plus
     // its signature or name. It is worth noting that QxtRPCService uses the same structure for both signals and slots,
@@ -59,12 +109,17 @@ public:
     typedef QPair<const QMetaObject*, QByteArray> MetaMethodDef;
 
     // A slot connection can be identified by the object receiving it and the name of the function. Additionally, a
-    // connection can be Direct, Queued, or BlockingQueued.
+    // connection can be Direct, Queued, or BlockingQueued. The method index and the type IDs of the parameters and
+    // the return value are resolved when the slot is attached, so that dispatching needs no lookups.
     struct SlotDef
     {
         QObject* recv;
         QByteArray slot;
         Qt::ConnectionType type;
+        int index;
+        QVector<int> parameterTypes;
+        QByteArray returnTypeName;  // empty for void
+        int returnType;             // 0 for void
         inline bool operator==(const SlotDef& other) const {
             // Two slots are equivalent only if they refer to the same slot on the same object with the same
             // connection type.
@@ -72,30 +127,113 @@ public:
         }
     };
 
-    // Maps an RPC function name to a list of slot connections.
-    QHash<QString, QList<SlotDef> > connectedSlots;
+    // An RPC function and the slots attached to it. Entries are never removed, so an index into methods stays valid
+    // for the lifetime of the service and can be cached per connection.
+    struct Method
+    {
+        QString name;
+        QList<SlotDef> receivers;
+    };
+    QVector<Method> methods;
+    QHash<QString, int> methodIndex;
+    int methodFor(const QString& name);
 
-    // Maps a slot's metamethod to an array of parameter type names.
-    QHash<MetaMethodDef, QList<QByteArray> > slotParameters;
+    // Method IDs assigned to outgoing RPC functions. The same ID is used on every connection.
+    QHash<QString, quint32> outgoingIds;
+
+    // Type ID used for QVariant parameters, which receive the deserialized value itself. typeOf() returns 0 for a
+    // type that cannot be queued.
+    enum { VariantType = -1 };
+    static int typeOf(const QByteArray& typeName);
+    bool invoke(const SlotDef& slot, const quint64* id, const QVariant* const* args, QVariant* result) const;
 
     // As described in the main class's documentation, QMetaObject::invokeMethod is limited to 10 parameters, so
     // QxtRPCService is limited to 8.
-    void dispatchFromServer(const QString& fn, const QVariant& p0 = QVariant(), const QVariant& p1 = QVariant(),
-                            const QVariant& p2 = QVariant(), const QVariant& p3 = QVariant(),
-                            const QVariant& p4 = QVariant(), const QVariant& p5 = QVariant(),
-                            const QVariant& p6 = QVariant(), const QVariant& p7 = QVariant()) const;
-    void dispatchFromClient(quint64 id, const QString& fn, const QVariant& p0 = QVariant(), 
+    // The dispatchers return false if no attached slot could be invoked. If result is not null, it receives the value
+    // returned by the first slot that returns one.
+    bool dispatchFromServer(int method, QVariant* result, const QVariant& p0 = QVariant(),
+                            const QVariant& p1 = QVariant(), const QVariant& p2 = QVariant(),
+                            const QVariant& p3 = QVariant(), const QVariant& p4 = QVariant(),
+                            const QVariant& p5 = QVariant(), const QVariant& p6 = QVariant(),
+                            const QVariant& p7 = QVariant()) const;
+    bool dispatchFromClient(quint64 id, int method, QVariant* result, const QVariant& p0 = QVariant(),
                             const QVariant& p1 = QVariant(), const QVariant& p2 = QVariant(),
                             const QVariant& p3 = QVariant(), const QVariant& p4 = QVariant(),
                             const QVariant& p5 = QVariant(), const QVariant& p6 = QVariant(),
                             const QVariant& p7 = QVariant()) const;
 
+    // Write coalescing. While corked, messages are collected per connection and written once per event loop
+    // iteration, or as soon as a connection has corkThreshold bytes waiting.
+    bool corked;
+    int corkThreshold;
+    bool flushScheduled;
+    void write(QIODevice* dev, Connection* conn, const QByteArray& data, bool droppable = false,
+               quint64 correlation = 0);
+    void flushConnection(QIODevice* dev, Connection& conn);
+
+    // Backpressure. Messages reach the device through deliver(). A connection with more than highWatermark bytes
+    // waiting is congested until it has drained to lowWatermark bytes. With the Block policy the callers wait for
+    // that in waitForRoom() before serializing a call, since slots may run and connections may close meanwhile;
+    // otherwise deliver() holds back or discards what is written to a congested connection. A connection that does
+    // not drain within congestionTimeout is marked congested, and is then treated as with DropOldest until it has
+    // drained. Only whole calls are droppable; replies and the messages that negotiate the protocol are not.
+    qint64 lowWatermark;
+    qint64 highWatermark;
+    QxtRPCService::CongestionPolicy policy;
+    bool skipCongested;
+    int congestionTimeout;
+    Connection* connectionOf(QIODevice* dev, quint64 id);
+    void deliver(QIODevice* dev, Connection* conn, const QByteArray& data, bool droppable, quint64 correlation = 0);
+    void setCongested(Connection* conn, bool congested);
+    void drain(QIODevice* dev, Connection& conn);
+    void release(QIODevice* dev, Connection& conn);
+    void waitForRoom(QIODevice* dev, quint64 id);
+    bool isCongested(QIODevice* dev, const Connection& conn) const;
+    QList<quint64> uncongested(const QList<quint64>& ids) const;
+
+    // Compression. Messages of at least compressionThreshold bytes are sent compressed to peers that accept it.
+    bool compression;
+    int compressionThreshold;
+    const QByteArray& compressed(const QByteArray& message, QByteArray& cache) const;
+
+    // A call serialized for one connection, kept for the other connections it is sent to.
+    struct Outgoing
+    {
+        QByteArray named;
+        QByteArray numbered;
+        QByteArray compressedNamed;
+        QByteArray compressedNumbered;
+    };
+
+    // Negotiation of method IDs and compression. resolve() returns an index into methods, NoMethod for a message
+    // handled by QxtRPCService itself, or Unattached for a call without an entry. announce() runs when a connection
+    // first writes or reads, so the serializer can still be changed after the device is set.
+    enum { NoMethod = -1, ProtocolViolation = -2, Unattached = -3 };
+    int resolve(Connection& conn, quint32 methodId, const QxtAbstractSignalSerializer::DeserializedData& data);
+    void announce(QIODevice* dev, Connection& conn);
+    void send(QIODevice* dev, Connection* conn, const QString& fn, const QVariant* args, Outgoing& out,
+              quint64 correlation = 0);
+
+    // Calls that expect a reply, by correlation ID.
+    QHash<quint64, QPointer<QxtRPCReply> > replies;
+    quint64 nextCorrelation;
+    int replyTimeout;
+    QxtRPCReply* callWithReply(QIODevice* dev, Connection* conn, bool toServer, quint64 client, const QString& fn,
+                               const QVariant* args);
+    void sendReply(QIODevice* dev, Connection* conn, quint64 correlation, bool handled, const QVariant& result);
+    void failReplies(bool toServer, quint64 client);
+
 public Q_SLOTS:
     void clientConnected(QIODevice* dev, quint64 id);
     void clientDisconnected(QIODevice* dev, quint64 id);
     void clientData(quint64 id);
+    void clientWritten(quint64 id);
 
     void serverData();
+    void serverWritten();
+    void flushPending();
+    void disconnectCongested();
+    void replyTimedOut();
 };
 
 #endif
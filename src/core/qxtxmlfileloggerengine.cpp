@@ -24,7 +24,8 @@
  ****************************************************************************/
 
 #include "qxtxmlfileloggerengine.h"
-#include <QTime>
+#include "qxtlogrecordformatter_p.h"
+#include <QDateTime>
 
 /*!
     \class QxtXmlFileLoggerEngine
@@ -54,14 +55,41 @@ class QxtXmlFileLoggerEnginePrivate : public QxtPrivate<QxtXmlFileLoggerEngine>
 
 public:
     QxtXmlFileLoggerEnginePrivate();
-    QString tab;
+    QxtLogRecordFormatter formatter;
 };
 
 QxtXmlFileLoggerEnginePrivate::QxtXmlFileLoggerEnginePrivate()
-        : tab("    ")
+        : formatter("hh:mm:ss.zzzz")
 {
 }
 
+/*******************************************************************************
+Appends value to out with the XML reserved characters replaced by entities.
+*******************************************************************************/
+static void qxtAppendXmlEscaped(QByteArray& out, const QVariant& value)
+{
+    const int start = out.size();
+    QxtLogRecordFormatter::appendVariant(out, value);
+    int i = start;
+    while (i < out.size())
+    {
+        const char* entity;
+        switch (out.at(i))
+        {
+        case '&':  entity = "&amp;";  break;
+        case '<':  entity = "&lt;";   break;
+        case '>':  entity = "&gt;";   break;
+        case '\'': entity = "&apos;"; break;
+        case '"':  entity = "&quot;"; break;
+        default:
+            i++;
+            continue;
+        }
+        out.replace(i, 1, entity);
+        i += qstrlen(entity);
+    }
+}
+
 /*!
     Constructs an XML file logger engine with \a fileName.
 */
@@ -117,27 +145,23 @@ void QxtXmlFileLoggerEngine::writeToFile(const QString &level, const QVariantLis
 {
     QIODevice* ptr_fileTarget = device();
     Q_ASSERT(ptr_fileTarget);
-    ptr_fileTarget->seek(ptr_fileTarget->size() - 6);
-    ptr_fileTarget->write(qxt_d().tab.toUtf8());
-    ptr_fileTarget->write("<entry type=\"");
-    ptr_fileTarget->write(level.toUtf8());
-    ptr_fileTarget->write("\" time=\"");
-    ptr_fileTarget->write(QTime::currentTime().toString("hh:mm:ss.zzzz").toUtf8());
-    ptr_fileTarget->write("\">");
-    ptr_fileTarget->write("\n");
+    QByteArray entry;
+    entry.reserve(128);
+    entry.append("    <entry type=\"");
+    QxtLogRecordFormatter::appendUtf8(entry, level);
+    entry.append("\" time=\"");
+    qxt_d().formatter.appendTimestamp(entry, currentRecord().dateTime());
+    entry.append("\">\n");
     Q_FOREACH(const QVariant& m, messages)
     {
-        ptr_fileTarget->write(qxt_d().tab.toUtf8());
-        ptr_fileTarget->write(qxt_d().tab.toUtf8());
-        ptr_fileTarget->write("<message>");
-        ptr_fileTarget->write(toXmlSafeString(m.toString()).toUtf8());
-        ptr_fileTarget->write("</message>\n");
+        entry.append("        <message>");
+        qxtAppendXmlEscaped(entry, m);
+        entry.append("</message>\n");
     }
+    entry.append("    </entry>\n</log>");
 
-    ptr_fileTarget->write(qxt_d().tab.toUtf8());
-    ptr_fileTarget->write("</entry>");
-    ptr_fileTarget->write("\n");
-    ptr_fileTarget->write("</log>");
+    ptr_fileTarget->seek(ptr_fileTarget->size() - 6);
+    ptr_fileTarget->write(entry);
 }
 
 /*!
@@ -2,6 +2,8 @@ INCLUDEPATH += $$PWD
 DEPENDPATH += $$PWD
 HEADERS += qxtjsonrpccall.h
 HEADERS += qxtjsonrpcclient.h
+HEADERS += qxtlocalconnectionmanager.h
+HEADERS += qxtlocalconnectionmanager_p.h
 HEADERS += qxtnetwork.h
 HEADERS += qxtmail_p.h
 HEADERS += qxtsmtp.h
@@ -9,6 +11,8 @@ HEADERS += qxtsmtp_p.h
 HEADERS += qxtmailattachment.h
 HEADERS += qxtmailmessage.h
 HEADERS += qxtrpcpeer.h
+HEADERS += qxtsharedmemorydevice.h
+HEADERS += qxtsharedmemorydevice_p.h
 HEADERS += qxttcpconnectionmanager.h
 HEADERS += qxttcpconnectionmanager_p.h
 HEADERS += qxtxmlrpccall.h
@@ -26,9 +30,11 @@ HEADERS += qxtsslconnectionmanager.h
 
 SOURCES += qxtjsonrpccall.cpp
 SOURCES += qxtjsonrpcclient.cpp
+SOURCES += qxtlocalconnectionmanager.cpp
 SOURCES += qxtmailattachment.cpp
 SOURCES += qxtmailmessage.cpp
 SOURCES += qxtrpcpeer.cpp
+SOURCES += qxtsharedmemorydevice.cpp
 SOURCES += qxtsmtp.cpp
 SOURCES += qxttcpconnectionmanager.cpp
 SOURCES += qxtxmlrpccall.cpp
@@ -128,7 +128,7 @@ void QxtJSONRpcCallPrivate::d_finished()
 {
     if (!reply->error())
     {
-        QVariant m_=QxtJSON::parse(QString::fromUtf8(reply->readAll()));
+        QVariant m_=QxtJSON::parseUtf8(reply->readAll());
         if(m_.isNull()){
             qWarning("QxtJSONRpcCall: invalid JSON received");
         }
@@ -0,0 +1,268 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtNetwork module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include "qxtlocalconnectionmanager.h"
+#include "qxtlocalconnectionmanager_p.h"
+#include "qxtsharedmemorydevice.h"
+#include "qxtsharedmemorydevice_p.h"
+#include <QLocalSocket>
+#include <QTimer>
+#include <QtDebug>
+
+static const int qxt_shm_hello_timeout = 10000;
+
+/*!
+ * \class QxtLocalConnectionManager
+ * \inmodule QxtNetwork
+ * \brief The QxtLocalConnectionManager class accepts local socket connections and maintains a connection pool
+ *
+ * QxtLocalConnectionManager is a standardized interface for accepting and tracking connections from processes on
+ * the same host, using QLocalServer: a Unix domain socket on Unix and a named pipe on Windows. It avoids the
+ * overhead of the TCP stack for connections that never leave the host, and is used just like
+ * QxtTcpConnectionManager. Clients connect with a QLocalSocket.
+ *
+ * If shared memory is enabled with setSharedMemoryEnabled(), clients connect with a QxtSharedMemoryDevice instead,
+ * and the data is exchanged through shared memory, with the local socket only used to wake up the other side.
+ * All clients of a manager have to use the same kind of connection. A client that has not set up shared memory
+ * within 10 seconds of connecting is disconnected.
+ *
+ * Each incoming connection is assigned an arbitrary, opaque client ID number, and you may override the
+ * incomingConnection() function to change the handling of new connections.
+ *
+ * \sa QLocalServer, QxtTcpConnectionManager, QxtSharedMemoryDevice
+ */
+
+/*!
+ * Constructs a new QxtLocalConnectionManager object with the specified \a parent.
+ */
+QxtLocalConnectionManager::QxtLocalConnectionManager(QObject* parent) : QxtAbstractConnectionManager(parent)
+{
+    QXT_INIT_PRIVATE(QxtLocalConnectionManager);
+}
+
+QxtLocalConnectionManagerPrivate::QxtLocalConnectionManagerPrivate() : QLocalServer(0), sharedMemory(false)
+{
+    QObject::connect(&mapper, SIGNAL(mapped(QObject*)), this, SLOT(socketDisconnected(QObject*)));
+    QObject::connect(&helloMapper, SIGNAL(mapped(QObject*)), this, SLOT(helloReceived(QObject*)));
+    QObject::connect(&helloTimeouts, SIGNAL(mapped(QObject*)), this, SLOT(helloTimedOut(QObject*)));
+}
+
+void QxtLocalConnectionManagerPrivate::incomingConnection(quintptr socketDescriptor)
+{
+    QIODevice* device = qxt_p().incomingConnection(socketDescriptor);
+    if (!device)
+        return;
+    if (!device->parent())
+        device->setParent(&qxt_p());
+    if (!sharedMemory)
+    {
+        manage(device);
+        return;
+    }
+
+    // The client asks for a shared memory segment first; the connection is only managed once it has been created.
+    QLocalSocket* sock = qobject_cast<QLocalSocket*>(device);
+    if (!sock)
+    {
+        qWarning() << "QxtLocalConnectionManager: shared memory connections need a QLocalSocket";
+        delete device;
+        return;
+    }
+    helloMapper.setMapping(sock, sock);
+    QObject::connect(sock, SIGNAL(readyRead()), &helloMapper, SLOT(map()));
+    QObject::connect(sock, SIGNAL(disconnected()), sock, SLOT(deleteLater()));
+    QTimer* timer = new QTimer(sock);
+    timer->setSingleShot(true);
+    helloTimeouts.setMapping(timer, sock);
+    QObject::connect(timer, SIGNAL(timeout()), &helloTimeouts, SLOT(map()));
+    timer->start(qxt_shm_hello_timeout);
+    if (sock->bytesAvailable() > 0)
+        helloReceived(sock);
+}
+
+void QxtLocalConnectionManagerPrivate::helloReceived(QObject* client)
+{
+    QLocalSocket* sock = qobject_cast<QLocalSocket*>(client);
+    if (!sock)
+        return;
+    if (!sock->canReadLine())
+    {
+        if (sock->bytesAvailable() > qxt_shm_max_hello)
+        {
+            qWarning() << "QxtLocalConnectionManager: invalid shared memory request; disconnecting";
+            sock->disconnectFromServer();
+        }
+        return;
+    }
+
+    QObject::disconnect(sock, SIGNAL(readyRead()), &helloMapper, SLOT(map()));
+    QObject::disconnect(sock, SIGNAL(disconnected()), sock, SLOT(deleteLater()));
+    helloMapper.removeMappings(sock);
+    delete helloTimeouts.mapping(sock);
+
+    const QByteArray hello = sock->readLine(qxt_shm_max_hello).trimmed();
+    bool ok = false;
+    const quint32 ringSize = hello.startsWith(qxt_shm_hello) ? hello.mid(sizeof(qxt_shm_hello) - 1).toUInt(&ok) : 0;
+    QxtSharedMemoryDevice* device = new QxtSharedMemoryDevice(&qxt_p());
+    if (!ok || !device->accept(sock, ringSize))
+    {
+        qWarning() << "QxtLocalConnectionManager: cannot create shared memory:" << device->errorString();
+        delete device;
+        sock->disconnectFromServer();
+        sock->deleteLater();
+        return;
+    }
+    manage(device);
+}
+
+void QxtLocalConnectionManagerPrivate::helloTimedOut(QObject* client)
+{
+    QLocalSocket* sock = qobject_cast<QLocalSocket*>(client);
+    if (!sock)
+        return;
+    qWarning() << "QxtLocalConnectionManager: no shared memory request in time; disconnecting";
+    sock->disconnectFromServer();
+}
+
+void QxtLocalConnectionManagerPrivate::manage(QIODevice* device)
+{
+    qxt_p().addConnection(device, (quint64)static_cast<QObject*>(device));
+    mapper.setMapping(device, device);
+    QObject::connect(device, SIGNAL(destroyed()), &mapper, SLOT(map()));
+    if (qobject_cast<QLocalSocket*>(device))
+    {
+        QObject::connect(device, SIGNAL(error(QLocalSocket::LocalSocketError)), &mapper, SLOT(map()));
+        QObject::connect(device, SIGNAL(disconnected()), &mapper, SLOT(map()));
+    }
+    else if (qobject_cast<QxtSharedMemoryDevice*>(device))
+    {
+        QObject::connect(device, SIGNAL(disconnected()), &mapper, SLOT(map()));
+    }
+}
+
+/*!
+ * Listens for connections to the server \a name. On Unix, a socket file left behind by a process that has crashed
+ * makes this fail; QLocalServer::removeServer() removes it.
+ *
+ * Returns \c true on success; otherwise returns \c false.
+ */
+bool QxtLocalConnectionManager::listen(const QString& name)
+{
+    return qxt_d().listen(name);
+}
+
+/*!
+ * Stops listening for connections. Any connections still open will remain connected.
+ */
+void QxtLocalConnectionManager::stopListening()
+{
+    if (!qxt_d().isListening())
+    {
+        qWarning() << "QxtLocalConnectionManager: Not listening";
+        return;
+    }
+    qxt_d().close();
+}
+
+/*!
+ * \reimp
+ */
+bool QxtLocalConnectionManager::isAcceptingConnections() const
+{
+    return qxt_d().isListening();
+}
+
+/*!
+ * Returns the name of the server if listening; otherwise returns an empty string.
+ */
+QString QxtLocalConnectionManager::serverName() const
+{
+    return qxt_d().serverName();
+}
+
+/*!
+ * Enables or disables exchanging data with clients through shared memory. When \a enable is \c true, clients must
+ * connect with QxtSharedMemoryDevice::connectToServer(), and the devices given to newConnection() are
+ * QxtSharedMemoryDevice objects. It is disabled by default. Connections already established are not affected.
+ */
+void QxtLocalConnectionManager::setSharedMemoryEnabled(bool enable)
+{
+    qxt_d().sharedMemory = enable;
+}
+
+/*!
+ * Returns \c true if data is exchanged with clients through shared memory.
+ * \sa setSharedMemoryEnabled()
+ */
+bool QxtLocalConnectionManager::isSharedMemoryEnabled() const
+{
+    return qxt_d().sharedMemory;
+}
+
+/*!
+ * This function is called when a new local connection becomes available. The parameter is the native
+ * \a socketDescriptor for the connection, suitable for use in QLocalSocket::setSocketDescriptor.
+ *
+ * The default implementation returns a new QLocalSocket with the specified descriptor. If shared memory is enabled,
+ * the device returned must be a QLocalSocket. As with QxtTcpConnectionManager::incomingConnection(), the returned
+ * device must not have a parent; it is owned by the manager.
+ */
+QIODevice* QxtLocalConnectionManager::incomingConnection(quintptr socketDescriptor)
+{
+    QLocalSocket* device = new QLocalSocket;
+    device->setSocketDescriptor(socketDescriptor);
+    return device;
+}
+
+/*!
+ * \reimp
+ */
+void QxtLocalConnectionManager::removeConnection(QIODevice* device, quint64 clientID)
+{
+    Q_UNUSED(clientID);
+    if (device)
+    {
+        QLocalSocket* sock = qobject_cast<QLocalSocket*>(device);
+        if (sock) sock->disconnectFromServer();
+        device->close();
+        device->deleteLater();
+    }
+}
+
+void QxtLocalConnectionManagerPrivate::socketDisconnected(QObject* client)
+{
+    QLocalSocket* sock = qobject_cast<QLocalSocket*>(client);
+    if (sock)
+    {
+        QObject::disconnect(sock, SIGNAL(error(QLocalSocket::LocalSocketError)), &mapper, SLOT(map()));
+        QObject::disconnect(sock, SIGNAL(disconnected()), &mapper, SLOT(map()));
+    }
+    else if (qobject_cast<QxtSharedMemoryDevice*>(client))
+    {
+        QObject::disconnect(client, SIGNAL(disconnected()), &mapper, SLOT(map()));
+    }
+    if (qxt_p().client((quint64)(client)))
+        qxt_p().disconnect((quint64)(client));
+}
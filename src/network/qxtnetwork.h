@@ -27,6 +27,7 @@
 
 #include "qxtjsonrpccall.h"
 #include "qxtjsonrpcclient.h"
+#include "qxtlocalconnectionmanager.h"
 #include "qxtmailattachment.h"
 #include "qxtmailmessage.h"
 #include "qxtpop3.h"
@@ -35,6 +36,7 @@
 #include "qxtpop3retrreply.h"
 #include "qxtpop3statreply.h"
 #include "qxtrpcpeer.h"
+#include "qxtsharedmemorydevice.h"
 #include "qxtsmtp.h"
 #ifdef HAVE_OPENSSL
 #include "qxtsshchannel.h"
@@ -0,0 +1,520 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtNetwork module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#include "qxtsharedmemorydevice.h"
+#include "qxtsharedmemorydevice_p.h"
+#include <QTime>
+#include <QUuid>
+#include <QtDebug>
+#include <string.h>
+
+/*!
+ * \class QxtSharedMemoryDevice
+ * \inmodule QxtNetwork
+ * \brief The QxtSharedMemoryDevice class exchanges data with another process on the same host through shared memory
+ *
+ * QxtSharedMemoryDevice is a QIODevice for connections between processes on the same host, for instance for a
+ * QxtRPCService talking to worker processes. The data does not go through the kernel: each direction of the
+ * connection is a ring buffer in a QSharedMemory segment, written and read without locks. A QLocalSocket connection
+ * serves as a doorbell that wakes the other side's event loop, and it is only used when the other side has run out
+ * of data to read or of room to write, so a busy connection does not make a system call per message.
+ *
+ * Use connectToServer() to connect to a QxtLocalConnectionManager that has shared memory enabled:
+ *
+ * \code
+ * QxtSharedMemoryDevice* device = new QxtSharedMemoryDevice;
+ * if (device->connectToServer("worker"))
+ *     service->setDevice(device);
+ * \endcode
+ *
+ * Writing never blocks. Data that does not fit into the ring waits in the device, as reported by bytesToWrite(),
+ * until the peer has made room; bytesWritten() is emitted once it has been moved into the ring.
+ *
+ * \sa QxtLocalConnectionManager
+ */
+
+QxtSharedMemoryDevicePrivate::QxtSharedMemoryDevicePrivate()
+: socket(0), in(0), out(0), inData(0), outData(0), size(0), notifyScheduled(false)
+{
+    // initializers only
+}
+
+bool QxtSharedMemoryDevicePrivate::setup(QLocalSocket* sock, bool server)
+{
+    QxtSharedRingHeader* header = reinterpret_cast<QxtSharedRingHeader*>(memory.data());
+    const quint32 ringSize = header->size;
+    if (header->magic != qxt_shm_magic || ringSize == 0 || (ringSize & (ringSize - 1)) != 0
+            || quint64(memory.size()) < sizeof(QxtSharedRingHeader) + 2 * quint64(ringSize))
+        return false;
+
+    socket = sock;
+    socket->setParent(&qxt_p());
+    size = ringSize;
+    char* data = reinterpret_cast<char*>(header + 1);
+    in = &header->rings[server ? 0 : 1];
+    out = &header->rings[server ? 1 : 0];
+    inData = data + (server ? 0 : size);
+    outData = data + (server ? size : 0);
+    QObject::connect(socket, SIGNAL(readyRead()), this, SLOT(doorbell()));
+    QObject::connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+    qxt_p().QIODevice::open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+
+    // The peer may have written, and rung, before this side was ready.
+    socket->readAll();
+    arm();
+    return true;
+}
+
+void QxtSharedMemoryDevicePrivate::release()
+{
+    in = out = 0;
+    inData = outData = 0;
+    pending.clear();
+    if (memory.isAttached())
+        memory.detach();
+    if (socket)
+    {
+        QObject::disconnect(socket, 0, this, 0);
+        socket->disconnectFromServer();
+        socket->deleteLater();
+        socket = 0;
+    }
+}
+
+quint32 QxtSharedMemoryDevicePrivate::available() const
+{
+    if (!in)
+        return 0;
+    // Only this side moves the tail; the head has to be read after the data it covers has been written. A ring the
+    // peer has broken looks empty until readData() or doorbell() notices.
+    const quint32 used = quint32(in->head.fetchAndAddAcquire(0)) - quint32(int(in->tail));
+    return used > size ? 0 : used;
+}
+
+bool QxtSharedMemoryDevicePrivate::isValid(QxtSharedRing* ring) const
+{
+    return quint32(int(ring->head)) - quint32(int(ring->tail)) <= size;
+}
+
+void QxtSharedMemoryDevicePrivate::protocolViolation()
+{
+    // Stop using the segment at once; the device is closed once control returns to the event loop.
+    qWarning() << "QxtSharedMemoryDevice: Invalid ring state in shared memory; disconnecting";
+    in = out = 0;
+    inData = outData = 0;
+    pending.clear();
+    QMetaObject::invokeMethod(this, "closeBroken", Qt::QueuedConnection);
+}
+
+void QxtSharedMemoryDevicePrivate::closeBroken()
+{
+    if (!qxt_p().isOpen())
+        return;
+    qxt_p().setErrorString(QxtSharedMemoryDevice::tr("Invalid data in shared memory"));
+    qxt_p().close();
+    socketDisconnected();
+}
+
+qint64 QxtSharedMemoryDevicePrivate::push(const char* data, qint64 len)
+{
+    const quint32 head = quint32(int(out->head));
+    const quint32 used = head - quint32(out->tail.fetchAndAddAcquire(0));
+    if (used > size)
+    {
+        protocolViolation();
+        return -1;
+    }
+    const quint32 room = size - used;
+    const quint32 count = quint32(qMin(len, qint64(room)));
+    if (count == 0)
+        return 0;
+
+    const quint32 start = head & (size - 1);
+    const quint32 first = qMin(count, size - start);
+    memcpy(outData + start, data, first);
+    memcpy(outData, data + first, count - first);
+
+    // Publish the data before looking at the flag, so that either the reader sees it or the doorbell rings.
+    out->head.fetchAndStoreOrdered(int(head + count));
+    if (out->readerWaiting.testAndSetOrdered(1, 0))
+        ring();
+    return count;
+}
+
+qint64 QxtSharedMemoryDevicePrivate::flush()
+{
+    qint64 moved = 0;
+    bool announced = false;
+    while (out && !pending.isEmpty())
+    {
+        const qint64 count = push(pending.constData(), pending.size());
+        if (count < 0)
+            break;
+        pending.remove(0, int(count));
+        moved += count;
+        if (count == 0)
+        {
+            if (announced)
+                break;
+            // Ask the reader to ring once it has made room, then look again in case it already has.
+            out->writerWaiting.fetchAndStoreOrdered(1);
+            announced = true;
+        }
+    }
+    return moved;
+}
+
+void QxtSharedMemoryDevicePrivate::ring()
+{
+    // The content of the doorbell does not matter. It is sent right away; waiting for the event loop would add
+    // latency to every wakeup.
+    socket->putChar(0);
+    socket->flush();
+}
+
+void QxtSharedMemoryDevicePrivate::arm()
+{
+    if (!in)
+        return;
+    // Ask the writer to ring the doorbell, then look again in case data arrived meanwhile.
+    in->readerWaiting.fetchAndStoreOrdered(1);
+    if (available() && !notifyScheduled)
+    {
+        notifyScheduled = true;
+        QMetaObject::invokeMethod(this, "notify", Qt::QueuedConnection);
+    }
+}
+
+void QxtSharedMemoryDevicePrivate::doorbell()
+{
+    if (!socket)
+        return;
+    socket->readAll();
+    if ((in && !isValid(in)) || (out && !isValid(out)))
+    {
+        protocolViolation();
+        return;
+    }
+    const qint64 moved = flush();
+    if (moved)
+        emit qxt_p().bytesWritten(moved);
+    notify();
+}
+
+void QxtSharedMemoryDevicePrivate::notify()
+{
+    notifyScheduled = false;
+    if (available())
+        emit qxt_p().readyRead();
+    // Data left unread is picked up by the next read; the doorbell is only needed once the ring is empty.
+    if (!available())
+        arm();
+}
+
+void QxtSharedMemoryDevicePrivate::socketDisconnected()
+{
+    emit qxt_p().readChannelFinished();
+    emit qxt_p().disconnected();
+}
+
+/*!
+ * Constructs a new QxtSharedMemoryDevice object with the specified \a parent.
+ */
+QxtSharedMemoryDevice::QxtSharedMemoryDevice(QObject* parent) : QIODevice(parent)
+{
+    QXT_INIT_PRIVATE(QxtSharedMemoryDevice);
+}
+
+/*!
+ * Destroys the device, closing the connection.
+ */
+QxtSharedMemoryDevice::~QxtSharedMemoryDevice()
+{
+    qxt_d().release();
+}
+
+/*!
+ * Connects to the QxtLocalConnectionManager listening as \a name, and asks it for a shared memory segment with a
+ * ring of \a ringSize bytes, rounded up to a power of two, for each direction. The server creates the segment under
+ * a random key and limits the ring size to between 4 KiB and 16 MiB. Waits up to \a msecs milliseconds for the
+ * connection to be set up. Returns \c true on success; otherwise returns \c false.
+ *
+ * The server must have shared memory enabled; see QxtLocalConnectionManager::setSharedMemoryEnabled().
+ */
+bool QxtSharedMemoryDevice::connectToServer(const QString& name, int ringSize, int msecs)
+{
+    if (isOpen())
+    {
+        qWarning() << "QxtSharedMemoryDevice::connectToServer: already connected";
+        return false;
+    }
+
+    QTime timer;
+    timer.start();
+    QLocalSocket* sock = new QLocalSocket(this);
+    sock->connectToServer(name);
+    if (!sock->waitForConnected(msecs))
+    {
+        setErrorString(sock->errorString());
+        delete sock;
+        return false;
+    }
+
+    sock->write(QByteArray(qxt_shm_hello) + QByteArray::number(qMax(ringSize, 0)) + '\n');
+    sock->flush();
+    while (!sock->canReadLine())
+    {
+        const int remaining = msecs < 0 ? -1 : msecs - timer.elapsed();
+        if (sock->bytesAvailable() > qxt_shm_max_hello || (msecs >= 0 && remaining <= 0)
+                || !sock->waitForReadyRead(remaining))
+        {
+            setErrorString(sock->state() == QLocalSocket::ConnectedState
+                           ? tr("No shared memory segment received from the server") : sock->errorString());
+            delete sock;
+            return false;
+        }
+    }
+
+    // The doorbell may already follow the reply; setup() discards it.
+    const QByteArray reply = sock->readLine(qxt_shm_max_hello).trimmed();
+    if (!reply.startsWith(qxt_shm_hello))
+    {
+        setErrorString(tr("Invalid reply from the server"));
+        delete sock;
+        return false;
+    }
+    qxt_d().memory.setKey(QString::fromUtf8(reply.mid(sizeof(qxt_shm_hello) - 1)));
+    if (!qxt_d().memory.attach())
+    {
+        setErrorString(qxt_d().memory.errorString());
+        delete sock;
+        return false;
+    }
+    if (!qxt_d().setup(sock, false))
+    {
+        setErrorString(tr("Invalid shared memory segment"));
+        qxt_d().memory.detach();
+        delete sock;
+        return false;
+    }
+    return true;
+}
+
+bool QxtSharedMemoryDevice::accept(QLocalSocket* sock, quint32 ringSize)
+{
+    quint32 size = qxt_shm_min_ring;
+    while (size < ringSize && size < qxt_shm_max_ring)
+        size <<= 1;
+
+    // A random key keeps other processes on the host from attaching to the segment by guessing it.
+    const int segmentSize = int(sizeof(QxtSharedRingHeader) + 2 * size);
+    bool created = false;
+    for (int attempt = 0; attempt < 8 && !created; attempt++)
+    {
+        qxt_d().memory.setKey("qxt-shm-" + QUuid::createUuid().toString().mid(1, 36));
+        created = qxt_d().memory.create(segmentSize);
+    }
+    if (!created)
+    {
+        setErrorString(qxt_d().memory.errorString());
+        return false;
+    }
+
+    QxtSharedRingHeader* header = reinterpret_cast<QxtSharedRingHeader*>(qxt_d().memory.data());
+    memset(header, 0, sizeof(QxtSharedRingHeader));
+    header->magic = qxt_shm_magic;
+    header->size = size;
+    header->rings[0].readerWaiting = 1;
+    header->rings[1].readerWaiting = 1;
+
+    sock->write(QByteArray(qxt_shm_hello) + qxt_d().memory.key().toUtf8() + '\n');
+    sock->flush();
+    return qxt_d().setup(sock, true);
+}
+
+/*!
+ * Closes the connection. This is the same as close().
+ */
+void QxtSharedMemoryDevice::disconnectFromServer()
+{
+    close();
+}
+
+/*!
+ * Returns the size in bytes of the ring buffer used for each direction, or 0 if not connected.
+ */
+int QxtSharedMemoryDevice::ringSize() const
+{
+    return int(qxt_d().size);
+}
+
+/*!
+ * Returns the local socket used as the doorbell, or 0 if not connected. It must not be read from or written to.
+ */
+QLocalSocket* QxtSharedMemoryDevice::socket() const
+{
+    return qxt_d().socket;
+}
+
+/*!
+ * \reimp
+ */
+bool QxtSharedMemoryDevice::isSequential() const
+{
+    return true;
+}
+
+/*!
+ * \reimp
+ */
+qint64 QxtSharedMemoryDevice::bytesAvailable() const
+{
+    return QIODevice::bytesAvailable() + qxt_d().available();
+}
+
+/*!
+ * Returns the number of bytes written that are waiting for room in the ring buffer.
+ */
+qint64 QxtSharedMemoryDevice::bytesToWrite() const
+{
+    return QIODevice::bytesToWrite() + qxt_d().pending.size();
+}
+
+/*!
+ * Waits up to \a msecs milliseconds for the peer to write. Returns \c true if data is available to read; otherwise
+ * returns \c false. A negative \a msecs waits without a time limit.
+ */
+bool QxtSharedMemoryDevice::waitForReadyRead(int msecs)
+{
+    if (!qxt_d().in)
+        return false;
+    if (qxt_d().available())
+        return true;
+
+    // Anything written by the peer moves the head, even if a slot connected to readyRead() reads it right away.
+    const int head = qxt_d().in->head;
+    QTime timer;
+    timer.start();
+    qxt_d().arm();
+    while (qxt_d().in && int(qxt_d().in->head) == head)
+    {
+        const int remaining = msecs < 0 ? -1 : msecs - timer.elapsed();
+        if ((msecs >= 0 && remaining <= 0) || !qxt_d().socket->waitForReadyRead(remaining))
+            return false;
+    }
+    return qxt_d().in != 0;
+}
+
+/*!
+ * Waits up to \a msecs milliseconds for the peer to make room for data waiting to be written. Returns \c true if
+ * some of it has been moved into the ring buffer; otherwise returns \c false. A negative \a msecs waits without a
+ * time limit.
+ */
+bool QxtSharedMemoryDevice::waitForBytesWritten(int msecs)
+{
+    if (qxt_d().pending.isEmpty() || !qxt_d().out)
+        return false;
+
+    const int waiting = qxt_d().pending.size();
+    QTime timer;
+    timer.start();
+    forever
+    {
+        // doorbell() moves as much as fits whenever the peer rings.
+        const qint64 moved = qxt_d().flush();
+        if (moved)
+            emit bytesWritten(moved);
+        if (qxt_d().pending.size() < waiting)
+            return true;
+        const int remaining = msecs < 0 ? -1 : msecs - timer.elapsed();
+        if ((msecs >= 0 && remaining <= 0) || !qxt_d().socket || !qxt_d().socket->waitForReadyRead(remaining))
+            return false;
+    }
+}
+
+/*!
+ * \reimp
+ */
+void QxtSharedMemoryDevice::close()
+{
+    QIODevice::close();
+    qxt_d().release();
+}
+
+/*!
+ * \reimp
+ */
+qint64 QxtSharedMemoryDevice::readData(char* data, qint64 maxSize)
+{
+    QxtSharedMemoryDevicePrivate& d = qxt_d();
+    if (!d.in)
+        return -1;
+
+    const quint32 tail = quint32(int(d.in->tail));
+    const quint32 used = quint32(d.in->head.fetchAndAddAcquire(0)) - tail;
+    if (used > d.size)
+    {
+        d.protocolViolation();
+        return -1;
+    }
+    const quint32 count = quint32(qMin(qint64(used), maxSize));
+    const quint32 start = tail & (d.size - 1);
+    const quint32 first = qMin(count, d.size - start);
+    memcpy(data, d.inData + start, first);
+    memcpy(data + first, d.inData, count - first);
+
+    // Release the room only after the data has been copied out of it.
+    d.in->tail.fetchAndStoreOrdered(int(tail + count));
+    if (count && d.in->writerWaiting.testAndSetOrdered(1, 0))
+        d.ring();
+    if (!d.available())
+        d.arm();
+    return count;
+}
+
+/*!
+ * \reimp
+ */
+qint64 QxtSharedMemoryDevice::writeData(const char* data, qint64 maxSize)
+{
+    QxtSharedMemoryDevicePrivate& d = qxt_d();
+    if (!d.out)
+        return -1;
+
+    // Nothing may overtake the data that is already waiting.
+    qint64 written = 0;
+    if (d.pending.isEmpty())
+        written = d.push(data, maxSize);
+    if (written < 0)
+        return -1;
+    if (written < maxSize)
+    {
+        const int waiting = d.pending.size();
+        d.pending.resize(waiting + int(maxSize - written));
+        memcpy(d.pending.data() + waiting, data + written, size_t(maxSize - written));
+        d.flush();
+    }
+    return maxSize;
+}
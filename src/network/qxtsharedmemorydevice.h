@@ -0,0 +1,71 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtNetwork module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTSHAREDMEMORYDEVICE_H
+#define QXTSHAREDMEMORYDEVICE_H
+
+#include <qxtglobal.h>
+#include <QIODevice>
+#include <QString>
+QT_FORWARD_DECLARE_CLASS(QLocalSocket)
+
+class QxtSharedMemoryDevicePrivate;
+class QXT_NETWORK_EXPORT QxtSharedMemoryDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    QxtSharedMemoryDevice(QObject* parent = 0);
+    virtual ~QxtSharedMemoryDevice();
+
+    bool connectToServer(const QString& name, int ringSize = 65536, int msecs = 30000);
+    void disconnectFromServer();
+    int ringSize() const;
+    QLocalSocket* socket() const;
+
+    virtual bool isSequential() const;
+    virtual qint64 bytesAvailable() const;
+    virtual qint64 bytesToWrite() const;
+    virtual bool waitForReadyRead(int msecs);
+    virtual bool waitForBytesWritten(int msecs);
+    virtual void close();
+
+Q_SIGNALS:
+    /*!
+     * This signal is emitted when the peer has closed the connection. Data it has written before can still be read
+     * until the device is closed.
+     */
+    void disconnected();
+
+protected:
+    virtual qint64 readData(char* data, qint64 maxSize);
+    virtual qint64 writeData(const char* data, qint64 maxSize);
+
+private:
+    friend class QxtLocalConnectionManagerPrivate;
+    bool accept(QLocalSocket* socket, quint32 ringSize);
+    QXT_DECLARE_PRIVATE(QxtSharedMemoryDevice)
+};
+
+#endif
@@ -0,0 +1,101 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtNetwork module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTSHAREDMEMORYDEVICE_P_H
+#define QXTSHAREDMEMORYDEVICE_P_H
+
+#include "qxtsharedmemorydevice.h"
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QLocalSocket>
+#include <QSharedMemory>
+
+// A client starts the connection by sending this followed by the ring size it asks for and a newline. The server
+// creates the segment under a random key, so that other processes cannot guess it, and answers with this followed by
+// the key and a newline. It limits the ring size to what it is willing to allocate.
+static const char qxt_shm_hello[] = "QXTSHM1 ";
+static const int qxt_shm_max_hello = 256;
+static const quint32 qxt_shm_min_ring = 0x1000;
+static const quint32 qxt_shm_max_ring = 0x1000000;
+static const quint32 qxt_shm_magic = 0x51785352;   // "QxSR"
+
+// One direction of a connection. There is exactly one reader and one writer, so the ring needs no lock: the writer
+// only advances head and the reader only advances tail. Both count bytes and wrap at 2^32; the size of the ring is a
+// power of two. The peer can write anything to the segment, so a distance of more than the size between head and
+// tail ends the connection instead of being trusted. A side that finds the ring empty (or full) sets its waiting
+// flag and sleeps in the event loop until the other side rings the doorbell, which it only does when the flag is set.
+struct QxtSharedRing
+{
+    QAtomicInt head;
+    QAtomicInt tail;
+    QAtomicInt readerWaiting;
+    QAtomicInt writerWaiting;
+    char padding[64 - 4 * sizeof(QAtomicInt)];  // keep the two directions on separate cache lines
+};
+
+// The start of the shared memory segment, followed by the data of both rings.
+struct QxtSharedRingHeader
+{
+    quint32 magic;
+    quint32 size;
+    char padding[56];
+    QxtSharedRing rings[2];     // client to server, server to client
+};
+
+class QxtSharedMemoryDevicePrivate : public QObject, public QxtPrivate<QxtSharedMemoryDevice>
+{
+    Q_OBJECT
+public:
+    QxtSharedMemoryDevicePrivate();
+    QXT_DECLARE_PUBLIC(QxtSharedMemoryDevice)
+
+    QLocalSocket* socket;
+    QSharedMemory memory;
+    QxtSharedRing* in;
+    QxtSharedRing* out;
+    char* inData;
+    char* outData;
+    quint32 size;
+    QByteArray pending;         // written while the outgoing ring was full
+    bool notifyScheduled;
+
+    bool setup(QLocalSocket* sock, bool server);
+    void release();
+    quint32 available() const;
+    bool isValid(QxtSharedRing* ring) const;
+    void protocolViolation();
+    qint64 push(const char* data, qint64 len);
+    qint64 flush();
+    void ring();
+    void arm();
+
+public Q_SLOTS:
+    void doorbell();
+    void notify();
+    void socketDisconnected();
+    void closeBroken();
+};
+
+#endif
@@ -26,6 +26,7 @@
 #include "qxtsslconnectionmanager.h"
 #include "qxttcpconnectionmanager_p.h"
 #include <QSslKey>
+#include <QMutexLocker>
 
 /*!
  * \class QxtSslConnectionManager
@@ -59,11 +60,13 @@ QxtSslConnectionManager::QxtSslConnectionManager(QObject* parent) : QxtTcpConnec
 
 void QxtSslConnectionManager::setLocalCertificate(const QSslCertificate& cert)
 {
+    QMutexLocker locker(&qxt_d().configLock);
     qxt_d().setLocalCertificate(cert);
 }
 
 void QxtSslConnectionManager::setLocalCertificate(const QString& path, QSsl::EncodingFormat format)
 {
+    QMutexLocker locker(&qxt_d().configLock);
     qxt_d().setLocalCertificate(path, format);
 }
 
@@ -74,11 +77,13 @@ QSslCertificate QxtSslConnectionManager::localCertificate() const
 
 void QxtSslConnectionManager::setPrivateKey(const QSslKey& key)
 {
+    QMutexLocker locker(&qxt_d().configLock);
     qxt_d().setPrivateKey(key);
 }
 
 void QxtSslConnectionManager::setPrivateKey(const QString& path, QSsl::KeyAlgorithm algo, QSsl::EncodingFormat format, const QByteArray& passPhrase)
 {
+    QMutexLocker locker(&qxt_d().configLock);
     qxt_d().setPrivateKey(path, algo, format, passPhrase);
 }
 
@@ -89,6 +94,7 @@ QSslKey QxtSslConnectionManager::privateKey() const
 
 void QxtSslConnectionManager::setAutoEncrypt(bool on)
 {
+    QMutexLocker locker(&qxt_d().configLock);
     qxt_d().setAutoEncrypt(on);
 }
 
@@ -99,7 +105,7 @@ bool QxtSslConnectionManager::autoEncrypt() const
 
 QIODevice* QxtSslConnectionManager::incomingConnection(int socketDescriptor)
 {
-    QSslSocket* socket = new QSslSocket(this);
+    QSslSocket* socket = new QSslSocket;
     if(socket->setSocketDescriptor(socketDescriptor)) {
         socket->setLocalCertificate(qxt_d().localCertificate());
         socket->setPrivateKey(qxt_d().privateKey());
@@ -26,6 +26,7 @@
 #include "qxttcpconnectionmanager.h"
 #include "qxttcpconnectionmanager_p.h"
 #include <QTcpSocket>
+#include <QThread>
 #include <QtDebug>
 
 /*!
@@ -46,6 +47,32 @@
  * is, for instance, where you could create a QSslSocket to encrypt communications
  * (but see QxtSslConnectionManager).
  *
+ * By default every connection is handled by the thread the QxtTcpConnectionManager lives in. With
+ * setIoThreadCount(), accepted sockets are instead distributed among a pool of I/O threads. Each thread has its
+ * own connection manager, returned by shard(), which owns the sockets given to the thread and reports them through
+ * its own newConnection() and disconnected() signals; the QxtTcpConnectionManager itself only accepts connections
+ * and has no clients. Objects that read from the sockets should live in the same thread as the shard, for instance
+ * one QxtRPCService per I/O thread:
+ *
+ * \code
+ * manager->setIoThreadCount(4);
+ * for (int i = 0; i < manager->ioThreadCount(); i++) {
+ *     QxtRPCService* service = new QxtRPCService;
+ *     service->moveToThread(manager->ioThread(i));
+ *     service->setConnectionManager(manager->shard(i));
+ *     services << service;
+ * }
+ * manager->listen(QHostAddress::Any, 4321);
+ * \endcode
+ *
+ * Client IDs are unique across all shards, and shardOf() tells which shard a client belongs to from the ID alone,
+ * so a call can be passed to the thread that owns the client without a shared table:
+ *
+ * \code
+ * QMetaObject::invokeMethod(services.at(QxtTcpConnectionManager::shardOf(id)), "call", Qt::QueuedConnection,
+ *                           Q_ARG(quint64, id), Q_ARG(QString, QString("update")), Q_ARG(QVariant, value));
+ * \endcode
+ *
  * \sa QTcpServer, QxtSslConnectionManager
  */
 
@@ -66,15 +93,58 @@ QxtTcpConnectionManagerPrivate::QxtTcpConnectionManagerPrivate()
 #else
 : QTcpServer(0)
 #endif
+, nextShard(0)
 {
     QObject::connect(&mapper, SIGNAL(mapped(QObject*)), this, SLOT(socketDisconnected(QObject*)));
 }
 
+QxtTcpConnectionManagerPrivate::~QxtTcpConnectionManagerPrivate()
+{
+    stopShards();
+}
+
+void QxtTcpConnectionManagerPrivate::stopShards()
+{
+    // The acceptors are deleted by their threads as they finish, along with the shards that have not been given to
+    // another object.
+    foreach(QxtTcpConnectionAcceptor* acceptor, acceptors)
+        acceptor->deleteLater();
+    foreach(QThread* thread, threads)
+    {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+    threads.clear();
+    acceptors.clear();
+    shards.clear();
+    nextShard = 0;
+}
+
+QIODevice* QxtTcpConnectionManagerPrivate::createDevice(int socketDescriptor)
+{
+    // Called by the shards from their own threads.
+    QMutexLocker locker(&configLock);
+    return qxt_p().incomingConnection(socketDescriptor);
+}
+
 void QxtTcpConnectionManagerPrivate::incomingConnection(int socketDescriptor)
 {
+    if (!acceptors.isEmpty())
+    {
+        // Hand the descriptor to the next I/O thread in turn, which creates the socket itself: a socket created here
+        // would have started reading, or a TLS handshake, in the wrong thread.
+        QxtTcpConnectionAcceptor* acceptor = acceptors.at(nextShard);
+        nextShard = (nextShard + 1) % acceptors.count();
+        QMetaObject::invokeMethod(acceptor, "accept", Qt::QueuedConnection, Q_ARG(int, socketDescriptor));
+        return;
+    }
+
     QIODevice* device = qxt_p().incomingConnection(socketDescriptor);
     if (device)
     {
+        if (!device->parent())
+            device->setParent(&qxt_p());
         qxt_p().addConnection(device, (quint64)static_cast<QObject*>(device));
         mapper.setMapping(device, device);
         QObject::connect(device, SIGNAL(destroyed()), &mapper, SLOT(map()));
@@ -119,6 +189,81 @@ bool QxtTcpConnectionManager::isAcceptingConnections() const
     return qxt_d().isListening();
 }
 
+/*!
+ * Distributes accepted connections among \a count I/O threads. A \a count of 0, the default, handles every
+ * connection in the thread the manager lives in.
+ *
+ * The threads are started immediately, so that objects can be moved to them before listen() is called. Changing the
+ * number of threads stops the previous ones and deletes their shards, so it is refused while listening.
+ * \sa ioThreadCount(), ioThread(), shard()
+ */
+void QxtTcpConnectionManager::setIoThreadCount(int count)
+{
+    if (isAcceptingConnections())
+    {
+        qWarning() << "QxtTcpConnectionManager::setIoThreadCount: cannot change I/O threads while listening";
+        return;
+    }
+    qxt_d().stopShards();
+    for (int i = 0; i < count; i++)
+    {
+        QThread* thread = new QThread;
+        thread->start();
+        QxtTcpConnectionShard* shard = new QxtTcpConnectionShard(&qxt_d(), i);
+        QxtTcpConnectionAcceptor* acceptor = new QxtTcpConnectionAcceptor(shard);
+        acceptor->moveToThread(thread);
+        qxt_d().threads << thread;
+        qxt_d().acceptors << acceptor;
+        qxt_d().shards << shard;
+    }
+}
+
+/*!
+ * Returns the number of I/O threads connections are distributed among, or 0 if they are handled in the thread the
+ * manager lives in.
+ * \sa setIoThreadCount()
+ */
+int QxtTcpConnectionManager::ioThreadCount() const
+{
+    return qxt_d().threads.count();
+}
+
+/*!
+ * Returns the I/O thread with the given \a index.
+ * \sa setIoThreadCount(), shard()
+ */
+QThread* QxtTcpConnectionManager::ioThread(int index) const
+{
+    return qxt_d().threads.value(index);
+}
+
+/*!
+ * Returns the connection manager of the I/O thread with the given \a index. It lives in ioThread(\a index), and
+ * emits newConnection() there for each connection given to the thread.
+ *
+ * The shard may be given to another object living in the same thread, such as a QxtRPCService; otherwise it is
+ * deleted along with the QxtTcpConnectionManager. A shard that has been given away is deleted with its new owner,
+ * after which the pointer returned here is no longer valid, and the connections later accepted for its thread are
+ * dropped. Objects living in the I/O threads should be deleted before the QxtTcpConnectionManager, which stops the
+ * threads.
+ * \sa setIoThreadCount(), shardOf()
+ */
+QxtAbstractConnectionManager* QxtTcpConnectionManager::shard(int index) const
+{
+    return qxt_d().shards.value(index);
+}
+
+/*!
+ * Returns the index of the shard the client with the given \a clientID belongs to, or -1 if it is managed by the
+ * QxtTcpConnectionManager itself. The index is part of the ID, so this needs no lookup and may be called from any
+ * thread.
+ * \sa shard()
+ */
+int QxtTcpConnectionManager::shardOf(quint64 clientID)
+{
+    return int(clientID >> QxtTcpConnectionShard::IndexShift) - 1;
+}
+
 /*!
  * This function is called when a new TCP connection becomes available. The parameter
  * is the native \a socketDescriptor for the connection, suitable for use in
@@ -126,10 +271,20 @@ bool QxtTcpConnectionManager::isAcceptingConnections() const
  *
  * The default implementation returns a new QTcpSocket with the specified descriptor.
  * Subclasses may return QTcpSocket subclasses, such as QSslSocket.
+ *
+ * With setIoThreadCount(), this function is called in the I/O thread that will own the
+ * connection, so that the device is created in that thread. These calls are serialized
+ * with each other and with the functions of QxtSslConnectionManager that change its
+ * certificate, key and encryption mode; a reimplementation that reads other state
+ * which may change while listening has to protect that state itself.
+ *
+ * The returned device must not have a parent; it is owned by the manager, or by the
+ * shard it is given to. With I/O threads the manager lives in another thread, so it
+ * cannot be the parent of the device.
  */
 QIODevice* QxtTcpConnectionManager::incomingConnection(int socketDescriptor)
 {
-    QTcpSocket* device = new QTcpSocket(this);
+    QTcpSocket* device = new QTcpSocket;
     device->setSocketDescriptor(socketDescriptor);
     return device;
 }
@@ -179,3 +334,77 @@ void QxtTcpConnectionManagerPrivate::socketDisconnected(QObject* client)
     }
     qxt_p().disconnect((quint64)(client));
 }
+
+QxtTcpConnectionShard::QxtTcpConnectionShard(QxtTcpConnectionManagerPrivate* listener, int index)
+: QxtAbstractConnectionManager(0), listener(listener), prefix(quint64(index + 1) << IndexShift), serial(0)
+{
+    QObject::connect(&mapper, SIGNAL(mapped(QObject*)), this, SLOT(socketDisconnected(QObject*)));
+}
+
+bool QxtTcpConnectionShard::isAcceptingConnections() const
+{
+    // Connections are handed to a shard for as long as it exists.
+    return true;
+}
+
+void QxtTcpConnectionShard::accept(int socketDescriptor)
+{
+    QIODevice* device = listener->createDevice(socketDescriptor);
+    if (!device)
+        return;
+    device->setParent(this);
+    const quint64 id = prefix | ++serial;
+    ids[device] = id;
+    addConnection(device, id);
+    mapper.setMapping(device, device);
+    QObject::connect(device, SIGNAL(destroyed()), &mapper, SLOT(map()));
+    QTcpSocket* sock = qobject_cast<QTcpSocket*>(device);
+    if (sock)
+    {
+        QObject::connect(sock, SIGNAL(error(QAbstractSocket::SocketError)), &mapper, SLOT(map()));
+        QObject::connect(sock, SIGNAL(disconnected()), &mapper, SLOT(map()));
+    }
+}
+
+QxtTcpConnectionAcceptor::QxtTcpConnectionAcceptor(QxtTcpConnectionShard* shard) : QObject(0), shard(shard)
+{
+    shard->setParent(this);
+}
+
+void QxtTcpConnectionAcceptor::accept(int socketDescriptor)
+{
+    if (!shard)
+    {
+        qWarning() << "QxtTcpConnectionManager: I/O thread shard has been deleted; dropping connection";
+        QTcpSocket discarded;
+        discarded.setSocketDescriptor(socketDescriptor);
+        return;
+    }
+    shard->accept(socketDescriptor);
+}
+
+void QxtTcpConnectionShard::removeConnection(QIODevice* device, quint64 clientID)
+{
+    Q_UNUSED(clientID);
+    if (device)
+    {
+        QAbstractSocket* sock = qobject_cast<QAbstractSocket*>(device);
+        if (sock) sock->disconnectFromHost();
+        device->close();
+        device->deleteLater();
+    }
+}
+
+void QxtTcpConnectionShard::socketDisconnected(QObject* client)
+{
+    QTcpSocket* sock = qobject_cast<QTcpSocket*>(client);
+    if (sock)
+    {
+        QObject::disconnect(sock, SIGNAL(error(QAbstractSocket::SocketError)), &mapper, SLOT(map()));
+        QObject::disconnect(sock, SIGNAL(disconnected()), &mapper, SLOT(map()));
+    }
+    // The device may already have been removed, and be on its way to deletion.
+    const quint64 id = ids.take(client);
+    if (id && this->client(id))
+        disconnect(id);
+}
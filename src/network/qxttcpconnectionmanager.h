@@ -30,6 +30,7 @@
 #include <QObject>
 #include <QNetworkProxy>
 QT_FORWARD_DECLARE_CLASS(QIODevice)
+QT_FORWARD_DECLARE_CLASS(QThread)
 
 class QxtTcpConnectionManagerPrivate;
 class QXT_NETWORK_EXPORT QxtTcpConnectionManager : public QxtAbstractConnectionManager
@@ -45,6 +46,12 @@ public:
     void setProxy(const QNetworkProxy& proxy);
     QNetworkProxy proxy() const;
 
+    void setIoThreadCount(int count);
+    int ioThreadCount() const;
+    QThread* ioThread(int index) const;
+    QxtAbstractConnectionManager* shard(int index) const;
+    static int shardOf(quint64 clientID);
+
 protected:
     virtual QIODevice* incomingConnection(int socketDescriptor);
     virtual void removeConnection(QIODevice* device, quint64 clientID);
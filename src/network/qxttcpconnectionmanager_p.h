@@ -30,6 +30,56 @@
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QSignalMapper>
+#include <QThread>
+#include <QMutex>
+#include <QPointer>
+#include <QList>
+#include <QHash>
+
+// Manages the connections handed to one I/O thread. It lives in that thread, so everything it does for its clients,
+// and everything done by the objects using it, happens there; the sockets are created there too, from the
+// descriptors accepted by the listener. The number of the shard is kept in the upper bits of its client IDs.
+class QxtTcpConnectionManagerPrivate;
+class QxtTcpConnectionShard : public QxtAbstractConnectionManager
+{
+Q_OBJECT
+public:
+    enum { IndexShift = 48 };
+
+    QxtTcpConnectionShard(QxtTcpConnectionManagerPrivate* listener, int index);
+    bool isAcceptingConnections() const;
+    void accept(int socketDescriptor);
+
+protected:
+    void removeConnection(QIODevice* device, quint64 clientID);
+
+private Q_SLOTS:
+    void socketDisconnected(QObject* client);
+
+private:
+    QxtTcpConnectionManagerPrivate* listener;
+    quint64 prefix;
+    quint64 serial;
+    QHash<QObject*, quint64> ids;
+    QSignalMapper mapper;
+};
+
+// Receives the descriptors accepted by the listener for one I/O thread and passes them to the shard of that thread.
+// A shard may be deleted in its thread at any time by the object it has been given to, so the listener never posts
+// to it directly: the acceptor is owned by the listener and outlives the thread's event loop, and only the I/O
+// thread looks at whether the shard still exists. It is also the shard's parent until the shard is given away.
+class QxtTcpConnectionAcceptor : public QObject
+{
+Q_OBJECT
+public:
+    QxtTcpConnectionAcceptor(QxtTcpConnectionShard* shard);
+
+public Q_SLOTS:
+    void accept(int socketDescriptor);
+
+private:
+    QPointer<QxtTcpConnectionShard> shard;
+};
 
 #ifdef QT_NO_OPENSSL
 class QxtTcpConnectionManagerPrivate : public QTcpServer, public QxtPrivate<QxtTcpConnectionManager>
@@ -43,8 +93,23 @@ Q_OBJECT
 friend class QxtSslConnectionManager;
 public:
     QxtTcpConnectionManagerPrivate();
+    ~QxtTcpConnectionManagerPrivate();
     QXT_DECLARE_PUBLIC(QxtTcpConnectionManager)
 
+    // I/O threads, their acceptors and their shards, all only used in the listener's thread. A shard may be deleted
+    // by the object it has been given to; shards only holds it for shard().
+    QList<QThread*> threads;
+    QList<QxtTcpConnectionAcceptor*> acceptors;
+    QList<QxtTcpConnectionShard*> shards;
+    int nextShard;
+    void stopShards();
+
+    // The shards call incomingConnection() through createDevice() from their threads. The calls are serialized with
+    // configLock, which the functions changing what incomingConnection() reads, such as the certificate and key of
+    // QxtSslConnectionManager, hold as well.
+    QMutex configLock;
+    QIODevice* createDevice(int socketDescriptor);
+
 protected:
     void incomingConnection(int socketDescriptor);
 
@@ -42,26 +42,75 @@ implementing canParseRequest(const QByteArray&)), for parsing the request
 headers (by implementing parseRequest(QByteArray&)), and for writing response
 headers (by implementing writeHeaders(QIODevice*, const QHttpResponseHeader&)).
 
+The session manager assembles response headers as raw bytes. The connectors
+provided with Qxt select a headerFormat() that sends that header block with a
+single write; for any other connector it is converted to a
+QHttpResponseHeader and passed to writeHeaders(). A subclass of a provided
+connector that reimplements writeHeaders() must call
+setHeaderFormat(CustomHeaders) in its constructor.
+
+To keep the resources held by each client bounded, the connector limits the
+number of simultaneous connections (setMaxConnections()), the size of request
+headers (setMaxHeaderSize()) and the time a connection may spend sending a
+request or waiting between requests (setReadTimeout(), setIdleTimeout() and
+setKeepAliveTimeout()). All timeouts share a single one-second timer wheel.
+
 \sa QxtHttpSessionManager
 */
 
 #include "qxthttpsessionmanager.h"
+#include "qxthttpheaderbuilder_p.h"
 #include "qxtwebcontent.h"
 #include <QReadWriteLock>
 #include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QTimer>
 #include <QIODevice>
+#include <QTcpSocket>
 #include <QByteArray>
 
 #ifndef QXT_DOXYGEN_RUN
+// Number of one-second slots in the timeout wheel. Deadlines further in the
+// future than this simply survive additional revolutions of the wheel.
+#define QXT_HTTP_WHEEL_SLOTS 64
+
 class QxtAbstractHttpConnectorPrivate : public QxtPrivate<QxtAbstractHttpConnector>
 {
 public:
+    enum ConnectionPhase { Idle, KeepAlive, Reading, Busy };
+
+    struct ConnectionInfo
+    {
+        ConnectionInfo() : phase(Idle), pendingRequests(0), deadline(0) {}
+        QByteArray buffer;
+        ConnectionPhase phase;
+        int pendingRequests;
+        quint32 deadline;   // wheel tick at which the connection expires, 0 for none
+    };
+
+    QxtAbstractHttpConnectorPrivate() : manager(0), nextRequestID(0), maxConnections(0), maxHeaderSize(65536),
+                readTimeout(30000), idleTimeout(30000), keepAliveTimeout(15000), tick(0), timer(0),
+                headerFormat(QxtAbstractHttpConnector::CustomHeaders)
+    {
+        wheel.resize(QXT_HTTP_WHEEL_SLOTS);
+    }
+
     QxtHttpSessionManager* manager;
-    QReadWriteLock bufferLock, requestLock;
-    QHash<QIODevice*, QByteArray> buffers;  // connection->buffer
-    QHash<quint32, QIODevice*> requests;    // requestID->connection
+    mutable QReadWriteLock bufferLock, requestLock;
+    QHash<QIODevice*, ConnectionInfo> connections;  // connection->state and buffer
+    QHash<quint32, QIODevice*> requests;            // requestID->connection
     quint32 nextRequestID;
 
+    int maxConnections, maxHeaderSize;
+    int readTimeout, idleTimeout, keepAliveTimeout;
+
+    QVector<QSet<QIODevice*> > wheel;
+    quint32 tick;
+    QTimer* timer;
+
+    QxtAbstractHttpConnector::HeaderFormat headerFormat;
+
     inline quint32 getNextRequestID(QIODevice* connection)
     {
         QWriteLocker locker(&requestLock);
@@ -86,6 +135,38 @@ public:
         QReadLocker locker(&requestLock);
         return requests[requestID];
     }
+
+    inline int timeoutFor(ConnectionPhase phase) const
+    {
+        switch (phase)
+        {
+        case Idle:
+            return idleTimeout;
+        case KeepAlive:
+            return keepAliveTimeout;
+        case Reading:
+            return readTimeout;
+        default:
+            return 0;
+        }
+    }
+
+    // Must be called with bufferLock held for writing.
+    void setPhase(QIODevice* device, ConnectionInfo& info, ConnectionPhase phase)
+    {
+        info.phase = phase;
+        int msecs = timeoutFor(phase);
+        if (msecs <= 0)
+        {
+            info.deadline = 0;
+            return;
+        }
+        quint32 ticks = (msecs + 999) / 1000;
+        info.deadline = tick + ticks;
+        if (info.deadline == 0) info.deadline = 1; // 0 means "no deadline"
+        wheel[info.deadline % QXT_HTTP_WHEEL_SLOTS].insert(device);
+        if (!timer->isActive()) timer->start();
+    }
 };
 #endif
 
@@ -97,7 +178,9 @@ public:
 QxtAbstractHttpConnector::QxtAbstractHttpConnector(QObject* parent) : QObject(parent)
 {
     QXT_INIT_PRIVATE(QxtAbstractHttpConnector);
-    qxt_d().nextRequestID = 0;
+    qxt_d().timer = new QTimer(this);
+    qxt_d().timer->setInterval(1000);
+    QObject::connect(qxt_d().timer, SIGNAL(timeout()), this, SLOT(checkTimeouts()));
 }
 
 /*!
@@ -118,6 +201,204 @@ QxtHttpSessionManager* QxtAbstractHttpConnector::sessionManager() const
     return qxt_d().manager;
 }
 
+/*!
+ * Returns the maximum number of simultaneous connections accepted by the
+ * connector. A value of 0 means that the number of connections is not limited.
+ *
+ * \sa setMaxConnections
+ */
+int QxtAbstractHttpConnector::maxConnections() const
+{
+    return qxt_d().maxConnections;
+}
+
+/*!
+ * Sets the maximum number of simultaneous connections to \a max.
+ *
+ * While the limit is reached, the built-in connectors leave new connections
+ * pending in their QTcpServer; once its maxPendingConnections() is exhausted
+ * the operating system holds further clients in the listen backlog. Pending
+ * connections are accepted as soon as existing connections are closed.
+ *
+ * The default value is 0, which does not limit the number of connections.
+ *
+ * \sa maxConnections, canAcceptConnection
+ */
+void QxtAbstractHttpConnector::setMaxConnections(int max)
+{
+    qxt_d().maxConnections = qMax(0, max);
+    resumeAccepting();
+}
+
+/*!
+ * Returns the number of connections currently managed by the connector.
+ */
+int QxtAbstractHttpConnector::connectionCount() const
+{
+    QReadLocker locker(&qxt_d().bufferLock);
+    return qxt_d().connections.count();
+}
+
+/*!
+ * Returns the maximum size in bytes of the request headers accepted by the
+ * connector.
+ *
+ * \sa setMaxHeaderSize
+ */
+int QxtAbstractHttpConnector::maxHeaderSize() const
+{
+    return qxt_d().maxHeaderSize;
+}
+
+/*!
+ * Sets the maximum size in bytes of the request headers to \a bytes.
+ *
+ * Clients sending larger request headers receive a "431 Request Header Fields
+ * Too Large" response and are disconnected. A value of 0 disables the check.
+ *
+ * The default value is 65536.
+ */
+void QxtAbstractHttpConnector::setMaxHeaderSize(int bytes)
+{
+    qxt_d().maxHeaderSize = qMax(0, bytes);
+}
+
+/*!
+ * \enum QxtAbstractHttpConnector::HeaderFormat
+ *
+ * Describes how response headers are written to a connection.
+ *
+ * \value CustomHeaders  The headers are passed to writeHeaders() as a QHttpResponseHeader.
+ * \value HttpHeaders    The headers are written as an HTTP/1.x status line and header block.
+ * \value CgiHeaders     The headers are written as a CGI response, with a Status header and no Date header.
+ */
+
+/*!
+ * Returns the format in which response headers are written.
+ *
+ * QxtHttpServerConnector and QxtHttpsServerConnector use HttpHeaders and
+ * QxtScgiServerConnector uses CgiHeaders. Other connectors use CustomHeaders.
+ *
+ * \sa setHeaderFormat
+ */
+QxtAbstractHttpConnector::HeaderFormat QxtAbstractHttpConnector::headerFormat() const
+{
+    return qxt_d().headerFormat;
+}
+
+/*!
+ * Sets the \a format in which response headers are written. Call this in the
+ * constructor of a subclass; it must not change while connections are open.
+ *
+ * With CustomHeaders the headers are passed to writeHeaders(). The other
+ * formats write the header block assembled by the session manager directly,
+ * with a single write and without calling writeHeaders().
+ */
+void QxtAbstractHttpConnector::setHeaderFormat(HeaderFormat format)
+{
+    qxt_d().headerFormat = format;
+}
+
+/*!
+ * Returns the number of milliseconds a client may take to finish sending its
+ * request headers once it has started.
+ *
+ * \sa setReadTimeout
+ */
+int QxtAbstractHttpConnector::readTimeout() const
+{
+    return qxt_d().readTimeout;
+}
+
+/*!
+ * Sets the number of milliseconds a client may take to finish sending its
+ * request headers to \a msecs.
+ *
+ * Clients that exceed this time receive a "408 Request Timeout" response and
+ * are disconnected. A value of 0 disables the timeout. The default value is
+ * 30000. Timeouts are checked once per second.
+ */
+void QxtAbstractHttpConnector::setReadTimeout(int msecs)
+{
+    qxt_d().readTimeout = qMax(0, msecs);
+}
+
+/*!
+ * Returns the number of milliseconds a new connection may stay open without
+ * sending any data.
+ *
+ * \sa setIdleTimeout
+ */
+int QxtAbstractHttpConnector::idleTimeout() const
+{
+    return qxt_d().idleTimeout;
+}
+
+/*!
+ * Sets the number of milliseconds a new connection may stay open without
+ * sending any data to \a msecs. Such connections are closed silently.
+ *
+ * A value of 0 disables the timeout. The default value is 30000.
+ */
+void QxtAbstractHttpConnector::setIdleTimeout(int msecs)
+{
+    qxt_d().idleTimeout = qMax(0, msecs);
+}
+
+/*!
+ * Returns the number of milliseconds a keep-alive connection is held open
+ * while waiting for the next request.
+ *
+ * \sa setKeepAliveTimeout
+ */
+int QxtAbstractHttpConnector::keepAliveTimeout() const
+{
+    return qxt_d().keepAliveTimeout;
+}
+
+/*!
+ * Sets the number of milliseconds a keep-alive connection is held open while
+ * waiting for the next request to \a msecs. Such connections are closed
+ * silently.
+ *
+ * A value of 0 disables the timeout. The default value is 15000.
+ */
+void QxtAbstractHttpConnector::setKeepAliveTimeout(int msecs)
+{
+    qxt_d().keepAliveTimeout = qMax(0, msecs);
+}
+
+/*!
+ * Returns true if the connector is below its connection limit and may accept
+ * another connection.
+ *
+ * Subclasses should consult this function before invoking addConnection().
+ * A subclass that leaves connections pending while the limit is reached can
+ * provide a slot named acceptConnection(), which is invoked whenever a
+ * connection closes or the limit is raised.
+ *
+ * \sa setMaxConnections
+ */
+bool QxtAbstractHttpConnector::canAcceptConnection() const
+{
+    if (qxt_d().maxConnections <= 0) return true;
+    QReadLocker locker(&qxt_d().bufferLock);
+    return qxt_d().connections.count() < qxt_d().maxConnections;
+}
+
+/*!
+ * \internal
+ * Invoked when a connection has been closed or the connection limit has been
+ * raised, so that connections left pending while the limit was reached can be
+ * accepted. The built-in connectors accept their pending connections in a
+ * private acceptConnection() slot, which is called by name here.
+ */
+void QxtAbstractHttpConnector::resumeAccepting()
+{
+    if (metaObject()->indexOfSlot("acceptConnection()") >= 0)
+        QMetaObject::invokeMethod(this, "acceptConnection");
+}
+
 /*!
  * \internal
  * Returns the QIODevice associated with a \a requestID.
@@ -139,7 +420,9 @@ void QxtAbstractHttpConnector::addConnection(QIODevice* device)
 {
     if(!device) return;
     QWriteLocker locker(&qxt_d().bufferLock);
-    qxt_d().buffers[device] = QByteArray();
+    QxtAbstractHttpConnectorPrivate::ConnectionInfo& info = qxt_d().connections[device];
+    info = QxtAbstractHttpConnectorPrivate::ConnectionInfo();
+    qxt_d().setPhase(device, info, QxtAbstractHttpConnectorPrivate::Idle);
     QObject::connect(device, SIGNAL(readyRead()), this, SLOT(incomingData()));
     QObject::connect(device, SIGNAL(aboutToClose()), this, SLOT(disconnected()));
     QObject::connect(device, SIGNAL(disconnected()), this, SLOT(disconnected()));
@@ -156,11 +439,36 @@ void QxtAbstractHttpConnector::incomingData(QIODevice* device)
         device = qobject_cast<QIODevice*>(sender());
         if (!device) return;
     }
-    QReadLocker locker(&qxt_d().bufferLock);
-    QByteArray& buffer = qxt_d().buffers[device];
+    QWriteLocker locker(&qxt_d().bufferLock);
+    if (!qxt_d().connections.contains(device)) return;
+    QxtAbstractHttpConnectorPrivate::ConnectionInfo& info = qxt_d().connections[device];
+    // While a request is being served, its QxtWebContent reads the body from
+    // the device. Pipelined requests are picked up by requestFinished(), so
+    // only header bytes ever reach the buffer and count against maxHeaderSize.
+    if (info.pendingRequests > 0) return;
+    QByteArray& buffer = info.buffer;
     buffer.append(device->readAll());
-    if (!canParseRequest(buffer)) return;
+    int maxHeaderSize = qxt_d().maxHeaderSize;
+    if (!canParseRequest(buffer))
+    {
+        if (maxHeaderSize > 0 && buffer.size() > maxHeaderSize)
+        {
+            locker.unlock();
+            rejectConnection(device, 431);
+            return;
+        }
+        if (!buffer.isEmpty() && info.phase != QxtAbstractHttpConnectorPrivate::Reading)
+            qxt_d().setPhase(device, info, QxtAbstractHttpConnectorPrivate::Reading);
+        return;
+    }
+    int bufferSize = buffer.size();
     QHttpRequestHeader header = parseRequest(buffer);
+    if (maxHeaderSize > 0 && bufferSize - buffer.size() > maxHeaderSize)
+    {
+        locker.unlock();
+        rejectConnection(device, 431);
+        return;
+    }
     QxtWebContent* content = 0;
     QByteArray start;
     if (header.contentLength() > 0)
@@ -175,10 +483,138 @@ void QxtAbstractHttpConnector::incomingData(QIODevice* device)
         buffer.clear();
         content = new QxtWebContent(header.contentLength(), start, device);
     } // else no content
+    info.pendingRequests++;
+    qxt_d().setPhase(device, info, QxtAbstractHttpConnectorPrivate::Busy);
+    locker.unlock();
     quint32 requestID = qxt_d().getNextRequestID(device);
     sessionManager()->incomingRequest(requestID, header, content);
 }
 
+/*!
+ * \internal
+ * Invoked by the session manager when the response on a keep-alive \a device
+ * has been sent completely. Starts the keep-alive timeout and processes any
+ * pipelined data that has already been received.
+ */
+void QxtAbstractHttpConnector::requestFinished(QIODevice* device)
+{
+    {
+        QWriteLocker locker(&qxt_d().bufferLock);
+        if (!qxt_d().connections.contains(device)) return;
+        QxtAbstractHttpConnectorPrivate::ConnectionInfo& info = qxt_d().connections[device];
+        if (info.pendingRequests > 0) info.pendingRequests--;
+        if (info.pendingRequests == 0)
+            qxt_d().setPhase(device, info, QxtAbstractHttpConnectorPrivate::KeepAlive);
+    }
+    incomingData(device);
+}
+
+/*!
+ * \internal
+ * Sends a minimal error response with the given \a status to \a device and
+ * closes the connection.
+ */
+void QxtAbstractHttpConnector::rejectConnection(QIODevice* device, int status)
+{
+    {
+        QWriteLocker locker(&qxt_d().bufferLock);
+        if (!qxt_d().connections.contains(device)) return;
+        QxtAbstractHttpConnectorPrivate::ConnectionInfo& info = qxt_d().connections[device];
+        info.buffer.clear();
+        info.deadline = 0;
+    }
+    QObject::disconnect(device, SIGNAL(readyRead()), this, SLOT(incomingData()));
+
+    QByteArray reason = QxtHttpHeaderBuilder::standardReasonPhrase(status);
+    QByteArray body = "<html><body><h1>" + reason + "</h1></body></html>\r\n";
+    QxtHttpHeaderBuilder header;
+    header.setStatusLine(status, reason, 1, 1);
+    header.setValue("content-type", "text/html");
+    header.setValue("content-length", QByteArray::number(body.size()));
+    header.setValue("connection", "close");
+    writeResponseHeaders(device, header);
+    device->write(body);
+
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(device);
+    if (socket)
+        socket->disconnectFromHost();
+    else
+        device->close();
+}
+
+/*!
+ * \internal
+ * Advances the timeout wheel by one second and expires connections whose
+ * deadline has passed. Connections that were in the middle of sending a
+ * request receive "408 Request Timeout"; idle connections are closed silently.
+ */
+void QxtAbstractHttpConnector::checkTimeouts()
+{
+    QList<QIODevice*> expiredReading, expiredIdle;
+    {
+        QWriteLocker locker(&qxt_d().bufferLock);
+        QxtAbstractHttpConnectorPrivate& d = qxt_d();
+        d.tick++;
+        if (d.tick == 0) d.tick = 1;
+        int slot = d.tick % QXT_HTTP_WHEEL_SLOTS;
+        QSet<QIODevice*> due = d.wheel[slot];
+        d.wheel[slot].clear();
+        foreach(QIODevice* device, due)
+        {
+            QHash<QIODevice*, QxtAbstractHttpConnectorPrivate::ConnectionInfo>::iterator it = d.connections.find(device);
+            if (it == d.connections.end()) continue;
+            QxtAbstractHttpConnectorPrivate::ConnectionInfo& info = it.value();
+            if (info.deadline == 0 || int(info.deadline % QXT_HTTP_WHEEL_SLOTS) != slot) continue; // rescheduled
+            if (info.deadline > d.tick)
+            {
+                d.wheel[slot].insert(device); // due on a later revolution
+                continue;
+            }
+            info.deadline = 0;
+            if (info.phase == QxtAbstractHttpConnectorPrivate::Reading)
+                expiredReading.append(device);
+            else
+                expiredIdle.append(device);
+        }
+        if (d.connections.isEmpty()) d.timer->stop();
+    }
+
+    foreach(QIODevice* device, expiredReading)
+    {
+        rejectConnection(device, 408);
+    }
+    foreach(QIODevice* device, expiredIdle)
+    {
+        QTcpSocket* socket = qobject_cast<QTcpSocket*>(device);
+        if (socket)
+            socket->disconnectFromHost();
+        else
+            device->close();
+    }
+}
+
+/*!
+ * \internal
+ * Writes the response \a header assembled by the session manager to the
+ * specified \a device in the connector's headerFormat().
+ */
+void QxtAbstractHttpConnector::writeResponseHeaders(QIODevice* device, const QxtHttpHeaderBuilder& header)
+{
+    switch (qxt_d().headerFormat)
+    {
+    case HttpHeaders:
+        if (header.majorVersion() == 0) return; // 0.9 doesn't have headers
+        device->write(header.toHttp());
+        break;
+    case CgiHeaders:
+        device->write(header.toCgi());
+        break;
+    default:
+        writeHeaders(device, header.toResponseHeader());
+        break;
+    }
+}
+
 /*!
  * \internal
  */
@@ -186,9 +622,12 @@ void QxtAbstractHttpConnector::disconnected()
 {
     QIODevice* device = qobject_cast<QIODevice*>(sender());
     if (!device) return;
-    QWriteLocker locker(&qxt_d().bufferLock);
-    qxt_d().buffers.remove(device);
+    {
+        QWriteLocker locker(&qxt_d().bufferLock);
+        if (!qxt_d().connections.remove(device)) return;
+    }
     sessionManager()->disconnected(device);
+    resumeAccepting();
 }
 
 /*!
@@ -35,6 +35,7 @@ QT_FORWARD_DECLARE_CLASS(QIODevice)
 QT_FORWARD_DECLARE_CLASS(QTcpServer)
 class QxtHttpSessionManager;
 class QxtSslServer;
+class QxtHttpHeaderBuilder;
 
 class QxtAbstractHttpConnectorPrivate;
 class QXT_WEB_EXPORT QxtAbstractHttpConnector : public QObject
@@ -45,11 +46,35 @@ public:
     QxtAbstractHttpConnector(QObject* parent = 0);
     virtual bool listen(const QHostAddress& iface, quint16 port) = 0;
 
+    enum HeaderFormat
+    {
+        CustomHeaders,
+        HttpHeaders,
+        CgiHeaders
+    };
+    HeaderFormat headerFormat() const;
+
+    int maxConnections() const;
+    void setMaxConnections(int max);
+    int connectionCount() const;
+
+    int maxHeaderSize() const;
+    void setMaxHeaderSize(int bytes);
+
+    int readTimeout() const;
+    void setReadTimeout(int msecs);
+    int idleTimeout() const;
+    void setIdleTimeout(int msecs);
+    int keepAliveTimeout() const;
+    void setKeepAliveTimeout(int msecs);
+
 protected:
     QxtHttpSessionManager* sessionManager() const;
 
+    bool canAcceptConnection() const;
     void addConnection(QIODevice* device);
     QIODevice* getRequestConnection(quint32 requestID);
+    void setHeaderFormat(HeaderFormat format);
     virtual bool canParseRequest(const QByteArray& buffer) = 0;
     virtual QHttpRequestHeader parseRequest(QByteArray& buffer) = 0;
     virtual void writeHeaders(QIODevice* device, const QHttpResponseHeader& header) = 0;
@@ -57,9 +82,14 @@ protected:
 private Q_SLOTS:
     void incomingData(QIODevice* device = 0);
     void disconnected();
+    void checkTimeouts();
 
 private:
     void setSessionManager(QxtHttpSessionManager* manager);
+    void requestFinished(QIODevice* device);
+    void resumeAccepting();
+    void rejectConnection(QIODevice* device, int status);
+    void writeResponseHeaders(QIODevice* device, const QxtHttpHeaderBuilder& header);
     QXT_DECLARE_PRIVATE(QxtAbstractHttpConnector)
 };
 
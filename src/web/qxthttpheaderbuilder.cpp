@@ -0,0 +1,349 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtWeb module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+/*
+ * \internal
+ * QxtHttpHeaderBuilder assembles HTTP response headers directly as bytes.
+ *
+ * It replaces the QHttpResponseHeader round-trip used by the session manager:
+ * status lines for the common status codes are rendered once, the Date header
+ * is refreshed at most once per second and cookie expiration dates are
+ * formatted without going through QDateTime::toString(). The result is
+ * returned as a single QByteArray so that connectors can emit the complete
+ * header block with one write.
+ */
+
+#include "qxthttpheaderbuilder_p.h"
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <ctime>
+
+#ifndef QXT_DOXYGEN_RUN
+static const char* const qxt_http_days[] = { "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun" };
+static const char* const qxt_http_months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+struct QxtHttpStatusEntry
+{
+    int code;
+    const char* reason;
+};
+
+static const QxtHttpStatusEntry qxt_http_status[] =
+{
+    { 100, "Continue" }, { 101, "Switching Protocols" },
+    { 200, "OK" }, { 201, "Created" }, { 202, "Accepted" }, { 203, "Non-Authoritative Information" },
+    { 204, "No Content" }, { 205, "Reset Content" }, { 206, "Partial Content" },
+    { 300, "Multiple Choices" }, { 301, "Moved Permanently" }, { 302, "Found" }, { 303, "See Other" },
+    { 304, "Not Modified" }, { 305, "Use Proxy" }, { 307, "Temporary Redirect" },
+    { 400, "Bad Request" }, { 401, "Unauthorized" }, { 402, "Payment Required" }, { 403, "Forbidden" },
+    { 404, "Not Found" }, { 405, "Method Not Allowed" }, { 406, "Not Acceptable" },
+    { 407, "Proxy Authentication Required" }, { 408, "Request Timeout" }, { 409, "Conflict" },
+    { 410, "Gone" }, { 411, "Length Required" }, { 412, "Precondition Failed" },
+    { 413, "Request Entity Too Large" }, { 414, "Request-URI Too Long" }, { 415, "Unsupported Media Type" },
+    { 416, "Requested Range Not Satisfiable" }, { 417, "Expectation Failed" },
+    { 431, "Request Header Fields Too Large" },
+    { 500, "Internal Server Error" }, { 501, "Not Implemented" }, { 502, "Bad Gateway" },
+    { 503, "Service Unavailable" }, { 504, "Gateway Timeout" }, { 505, "HTTP Version Not Supported" },
+    { 0, 0 }
+};
+
+class QxtHttpStatusTable
+{
+public:
+    QxtHttpStatusTable()
+    {
+        for (int i = 0; qxt_http_status[i].code; i++)
+        {
+            const QxtHttpStatusEntry& entry = qxt_http_status[i];
+            QByteArray tail = ' ' + QByteArray::number(entry.code) + ' ' + QByteArray(entry.reason) + "\r\n";
+            reasons[entry.code] = QByteArray(entry.reason);
+            http10[entry.code] = "HTTP/1.0" + tail;
+            http11[entry.code] = "HTTP/1.1" + tail;
+            cgi[entry.code] = "Status:" + tail;
+        }
+    }
+
+    QHash<int, QByteArray> reasons, http10, http11, cgi;
+};
+Q_GLOBAL_STATIC(QxtHttpStatusTable, qxt_http_status_table)
+
+struct QxtHttpDateCache
+{
+    QxtHttpDateCache() : second(0) {}
+    QMutex lock;
+    time_t second;
+    QByteArray value;
+};
+Q_GLOBAL_STATIC(QxtHttpDateCache, qxt_http_date_cache)
+
+static inline char* qxt_append_digits(char* p, int value, int digits)
+{
+    for (int i = digits - 1; i >= 0; i--)
+    {
+        p[i] = '0' + (value % 10);
+        value /= 10;
+    }
+    return p + digits;
+}
+
+static inline bool qxt_header_key_equals(const QByteArray& a, const QByteArray& b)
+{
+    if (a.size() != b.size()) return false;
+    for (int i = 0; i < a.size(); i++)
+    {
+        char ca = a.at(i), cb = b.at(i);
+        if (ca >= 'A' && ca <= 'Z') ca += 'a' - 'A';
+        if (cb >= 'A' && cb <= 'Z') cb += 'a' - 'A';
+        if (ca != cb) return false;
+    }
+    return true;
+}
+
+QxtHttpHeaderBuilder::QxtHttpHeaderBuilder() : m_status(200), m_major(1), m_minor(1), m_reason("OK")
+{
+    // initializers only
+}
+
+void QxtHttpHeaderBuilder::setStatusLine(int code, const QByteArray& reasonPhrase, int majorVersion, int minorVersion)
+{
+    m_status = code;
+    m_reason = reasonPhrase;
+    m_major = majorVersion;
+    m_minor = minorVersion;
+}
+
+void QxtHttpHeaderBuilder::setValue(const QByteArray& key, const QByteArray& value)
+{
+    for (int i = m_fields.count() - 1; i >= 0; i--)
+    {
+        if (qxt_header_key_equals(m_fields.at(i).first, key))
+            m_fields.removeAt(i);
+    }
+    m_fields.append(qMakePair(key, value));
+}
+
+void QxtHttpHeaderBuilder::addValue(const QByteArray& key, const QByteArray& value)
+{
+    m_fields.append(qMakePair(key, value));
+}
+
+bool QxtHttpHeaderBuilder::hasKey(const QByteArray& key) const
+{
+    for (int i = 0; i < m_fields.count(); i++)
+    {
+        if (qxt_header_key_equals(m_fields.at(i).first, key))
+            return true;
+    }
+    return false;
+}
+
+void QxtHttpHeaderBuilder::addCookie(const QString& name, const QString& data, const QDateTime& expiration)
+{
+    QByteArray cookie;
+    cookie.reserve(name.size() + data.size() + 64);
+    cookie += name.toUtf8();
+    cookie += '=';
+    cookie += data.toUtf8();
+    if (expiration.isValid())
+    {
+        cookie += "; max-age=";
+        cookie += QByteArray::number(QDateTime::currentDateTime().secsTo(expiration));
+        cookie += "; expires=";
+        appendHttpDate(cookie, expiration, true);
+    }
+    addValue("set-cookie", cookie);
+}
+
+void QxtHttpHeaderBuilder::addRemoveCookie(const QString& name)
+{
+    addValue("set-cookie", name.toUtf8() + "=; max-age=0; expires=Thu, 01-Jan-1970 00:00:00 GMT");
+}
+
+int QxtHttpHeaderBuilder::fieldsSize() const
+{
+    int size = 2;
+    for (int i = 0; i < m_fields.count(); i++)
+        size += m_fields.at(i).first.size() + m_fields.at(i).second.size() + 4;
+    return size;
+}
+
+void QxtHttpHeaderBuilder::appendFields(QByteArray& out) const
+{
+    for (int i = 0; i < m_fields.count(); i++)
+    {
+        out += m_fields.at(i).first;
+        out += ": ";
+        out += m_fields.at(i).second;
+        out += "\r\n";
+    }
+    out += "\r\n";
+}
+
+/*
+ * Renders the header block for an HTTP/1.x response, including the status
+ * line and a Date header.
+ */
+QByteArray QxtHttpHeaderBuilder::toHttp() const
+{
+    const QxtHttpStatusTable* table = qxt_http_status_table();
+    QByteArray date = currentHttpDate();
+    QByteArray out;
+    out.reserve(fieldsSize() + m_reason.size() + date.size() + 32);
+
+    const QHash<int, QByteArray>* lines = 0;
+    if (m_major == 1 && m_minor == 1)
+        lines = &table->http11;
+    else if (m_major == 1 && m_minor == 0)
+        lines = &table->http10;
+    if (lines && lines->contains(m_status) && table->reasons.value(m_status) == m_reason)
+    {
+        out += lines->value(m_status);
+    }
+    else
+    {
+        out += "HTTP/";
+        out += QByteArray::number(m_major);
+        out += '.';
+        out += QByteArray::number(m_minor);
+        out += ' ';
+        out += QByteArray::number(m_status);
+        out += ' ';
+        out += m_reason;
+        out += "\r\n";
+    }
+    if (!hasKey("date"))
+    {
+        out += "Date: ";
+        out += date;
+        out += "\r\n";
+    }
+    appendFields(out);
+    return out;
+}
+
+/*
+ * Renders the header block for a CGI-style response as used by SCGI, where
+ * the status is sent as a "Status:" header and the web server supplies the
+ * protocol version and Date header.
+ */
+QByteArray QxtHttpHeaderBuilder::toCgi() const
+{
+    const QxtHttpStatusTable* table = qxt_http_status_table();
+    QByteArray out;
+    out.reserve(fieldsSize() + m_reason.size() + 16);
+    if (table->cgi.contains(m_status) && table->reasons.value(m_status) == m_reason)
+    {
+        out += table->cgi.value(m_status);
+    }
+    else
+    {
+        out += "Status: ";
+        out += QByteArray::number(m_status);
+        out += ' ';
+        out += m_reason;
+        out += "\r\n";
+    }
+    appendFields(out);
+    return out;
+}
+
+/*
+ * Converts the header into a QHttpResponseHeader for connectors that only
+ * implement QxtAbstractHttpConnector::writeHeaders(), adding the same Date
+ * header as toHttp().
+ */
+QHttpResponseHeader QxtHttpHeaderBuilder::toResponseHeader() const
+{
+    QHttpResponseHeader header(m_status, QString::fromUtf8(m_reason), m_major, m_minor);
+    if (!hasKey("date"))
+        header.addValue("Date", QString::fromLatin1(currentHttpDate()));
+    for (int i = 0; i < m_fields.count(); i++)
+        header.addValue(QString::fromLatin1(m_fields.at(i).first), QString::fromUtf8(m_fields.at(i).second));
+    return header;
+}
+
+/*
+ * Returns the standard reason phrase for the HTTP status \a code, or an empty
+ * QByteArray if the code is not known.
+ */
+QByteArray QxtHttpHeaderBuilder::standardReasonPhrase(int code)
+{
+    return qxt_http_status_table()->reasons.value(code);
+}
+
+/*
+ * Returns the current time formatted as an RFC 1123 date. The rendered value
+ * is cached and only regenerated when the wall clock moves to a new second.
+ */
+QByteArray QxtHttpHeaderBuilder::currentHttpDate()
+{
+    QxtHttpDateCache* cache = qxt_http_date_cache();
+    time_t now = ::time(0);
+    QMutexLocker locker(&cache->lock);
+    if (now != cache->second || cache->value.isEmpty())
+    {
+        QByteArray value;
+        appendHttpDate(value, QDateTime::fromTime_t(uint(now)));
+        cache->value = value;
+        cache->second = now;
+    }
+    return cache->value;
+}
+
+/*
+ * Appends \a dateTime to \a out in GMT. The RFC 1123 form ("Sun, 06 Nov 1994
+ * 08:49:37 GMT") is used for HTTP headers; if \a cookieStyle is true the
+ * dash-separated Netscape cookie form ("Sun, 06-Nov-1994 08:49:37 GMT") is
+ * used instead.
+ */
+void QxtHttpHeaderBuilder::appendHttpDate(QByteArray& out, const QDateTime& dateTime, bool cookieStyle)
+{
+    QDateTime utc = dateTime.toUTC();
+    QDate date = utc.date();
+    QTime time = utc.time();
+    const char separator = cookieStyle ? '-' : ' ';
+
+    char buffer[29];
+    char* p = buffer;
+    const char* day = qxt_http_days[date.dayOfWeek() - 1];
+    const char* month = qxt_http_months[date.month() - 1];
+    *p++ = day[0]; *p++ = day[1]; *p++ = day[2];
+    *p++ = ','; *p++ = ' ';
+    p = qxt_append_digits(p, date.day(), 2);
+    *p++ = separator;
+    *p++ = month[0]; *p++ = month[1]; *p++ = month[2];
+    *p++ = separator;
+    p = qxt_append_digits(p, date.year(), 4);
+    *p++ = ' ';
+    p = qxt_append_digits(p, time.hour(), 2);
+    *p++ = ':';
+    p = qxt_append_digits(p, time.minute(), 2);
+    *p++ = ':';
+    p = qxt_append_digits(p, time.second(), 2);
+    *p++ = ' '; *p++ = 'G'; *p++ = 'M'; *p++ = 'T';
+    out.append(QByteArray::fromRawData(buffer, int(p - buffer)));
+}
+#endif // QXT_DOXYGEN_RUN
@@ -0,0 +1,75 @@
+/****************************************************************************
+ **
+ ** Copyright (C) Qxt Foundation. Some rights reserved.
+ **
+ ** This file is part of the QxtWeb module of the Qxt library.
+ **
+ ** This library is free software; you can redistribute it and/or modify it
+ ** under the terms of the Common Public License, version 1.0, as published
+ ** by IBM, and/or under the terms of the GNU Lesser General Public License,
+ ** version 2.1, as published by the Free Software Foundation.
+ **
+ ** This file is provided "AS IS", without WARRANTIES OR CONDITIONS OF ANY
+ ** KIND, EITHER EXPRESS OR IMPLIED INCLUDING, WITHOUT LIMITATION, ANY
+ ** WARRANTIES OR CONDITIONS OF TITLE, NON-INFRINGEMENT, MERCHANTABILITY OR
+ ** FITNESS FOR A PARTICULAR PURPOSE.
+ **
+ ** You should have received a copy of the CPL and the LGPL along with this
+ ** file. See the LICENSE file and the cpl1.0.txt/lgpl-2.1.txt files
+ ** included with the source distribution for more information.
+ ** If you did not receive a copy of the licenses, contact the Qxt Foundation.
+ **
+ ** <http://libqxt.org>  <foundation@libqxt.org>
+ **
+ ****************************************************************************/
+
+#ifndef QXTHTTPHEADERBUILDER_P_H
+#define QXTHTTPHEADERBUILDER_P_H
+
+#include <qxtglobal.h>
+#include <QByteArray>
+#include <QString>
+#include <QList>
+#include <QPair>
+#include <QDateTime>
+#include <QHttpHeader>
+
+#ifndef QXT_DOXYGEN_RUN
+class QxtHttpHeaderBuilder
+{
+public:
+    QxtHttpHeaderBuilder();
+
+    void setStatusLine(int code, const QByteArray& reasonPhrase, int majorVersion = 1, int minorVersion = 1);
+    inline int statusCode() const { return m_status; }
+    inline QByteArray reasonPhrase() const { return m_reason; }
+    inline int majorVersion() const { return m_major; }
+    inline int minorVersion() const { return m_minor; }
+
+    void setValue(const QByteArray& key, const QByteArray& value);
+    void addValue(const QByteArray& key, const QByteArray& value);
+    bool hasKey(const QByteArray& key) const;
+
+    void addCookie(const QString& name, const QString& data, const QDateTime& expiration = QDateTime());
+    void addRemoveCookie(const QString& name);
+
+    QByteArray toHttp() const;
+    QByteArray toCgi() const;
+    QHttpResponseHeader toResponseHeader() const;
+
+    static QByteArray standardReasonPhrase(int code);
+    static QByteArray currentHttpDate();
+    static void appendHttpDate(QByteArray& out, const QDateTime& dateTime, bool cookieStyle = false);
+
+private:
+    int fieldsSize() const;
+    void appendFields(QByteArray& out) const;
+
+    int m_status;
+    int m_major, m_minor;
+    QByteArray m_reason;
+    QList<QPair<QByteArray, QByteArray> > m_fields;
+};
+#endif // QXT_DOXYGEN_RUN
+
+#endif // QXTHTTPHEADERBUILDER_P_H
@@ -95,6 +95,7 @@ QxtHttpServerConnector::QxtHttpServerConnector(QObject* parent, QTcpServer* serv
     else
         qxt_d().server = new QTcpServer(this);
     QObject::connect(qxt_d().server, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+    setHeaderFormat(HttpHeaders);
 }
 
 /*!
@@ -120,8 +121,12 @@ QTcpServer* QxtHttpServerConnector::tcpServer() const
  */
 void QxtHttpServerConnector::acceptConnection()
 {
-    QTcpSocket* socket = qxt_d().server->nextPendingConnection();
-    addConnection(socket);
+    // Connections beyond maxConnections() stay pending in the QTcpServer
+    while (qxt_d().server->hasPendingConnections() && canAcceptConnection())
+    {
+        QTcpSocket* socket = qxt_d().server->nextPendingConnection();
+        addConnection(socket);
+    }
 }
 
 /*!
@@ -48,6 +48,7 @@ posting events. It is reentrant for all other functionality.
 */
 
 #include "qxthttpsessionmanager.h"
+#include "qxthttpheaderbuilder_p.h"
 #include "qxtwebevent.h"
 #include "qxtwebcontent.h"
 #include "qxtabstractwebservice.h"
@@ -73,6 +74,8 @@ public:
     struct ConnectionState
     {
         QxtBoundFunction* onBytesWritten;
+        QxtBoundFunction* onReadyRead;
+        QxtBoundFunction* onAboutToClose;
         bool readyRead;
         bool finishedTransfer;
         bool keepAlive;
@@ -101,6 +104,17 @@ public:
     QHash<QIODevice*, ConnectionState> connectionState; // connection->state
 
     Qt::HANDLE mainThread;
+
+    // The data source bindings of a finished response are released when the
+    // connection is reused or closed instead of accumulating for the lifetime
+    // of the session manager. They may be on the call stack, so defer deletion.
+    static void releaseSourceBindings(ConnectionState& state)
+    {
+        if (state.onReadyRead) state.onReadyRead->deleteLater();
+        if (state.onAboutToClose) state.onAboutToClose->deleteLater();
+        state.onReadyRead = 0;
+        state.onAboutToClose = 0;
+    }
 };
 #endif
 
@@ -414,7 +428,10 @@ void QxtHttpSessionManager::disconnected(QIODevice* device)
 {
     QMutexLocker locker(&qxt_d().sessionLock);
     if (qxt_d().connectionState.contains(device))
+    {
         delete qxt_d().connectionState[device].onBytesWritten;
+        QxtHttpSessionManagerPrivate::releaseSourceBindings(qxt_d().connectionState[device]);
+    }
     qxt_d().connectionState.remove(device);
 }
 
@@ -450,7 +467,7 @@ void QxtHttpSessionManager::processEvents()
     }
     if (pagePos == -1) return; // no pages to send yet
 
-    QHttpResponseHeader header;
+    QxtHttpHeaderBuilder header;
     QList<int> removeIDs;
     QxtWebEvent* e = 0;
     for (int i = 0; i < pagePos; i++)
@@ -460,19 +477,13 @@ void QxtHttpSessionManager::processEvents()
         if (e->type() == QxtWebEvent::StoreCookie)
         {
             QxtWebStoreCookieEvent* ce = static_cast<QxtWebStoreCookieEvent*>(e);
-            QString cookie = ce->name + '=' + ce->data;
-            if (ce->expiration.isValid())
-            {
-                cookie += "; max-age=" + QString::number(QDateTime::currentDateTime().secsTo(ce->expiration))
-                          + "; expires=" + ce->expiration.toUTC().toString("ddd, dd-MMM-YYYY hh:mm:ss GMT");
-            }
-            header.addValue("set-cookie", cookie);
+            header.addCookie(ce->name, ce->data, ce->expiration);
             removeIDs.push_front(i);
         }
         else if (e->type() == QxtWebEvent::RemoveCookie)
         {
             QxtWebRemoveCookieEvent* ce = static_cast<QxtWebRemoveCookieEvent*>(e);
-            header.addValue("set-cookie", ce->name + "=; max-age=0; expires=" + QDateTime(QDate(1970, 1, 1)).toString("ddd, dd-MMM-YYYY hh:mm:ss GMT"));
+            header.addRemoveCookie(ce->name);
             removeIDs.push_front(i);
         }
     }
@@ -490,16 +501,16 @@ void QxtHttpSessionManager::processEvents()
 
     if (re)
     {
-        header.setValue("location", re->destination);
+        header.setValue("location", re->destination.toUtf8());
     }
 
     // Set custom header values
     for (QMultiHash<QString, QString>::iterator it = pe->headers.begin(); it != pe->headers.end(); ++it)
     {
-        header.setValue(it.key(), it.value());
+        header.setValue(it.key().toLatin1(), it.value().toUtf8());
     }
 
-    header.setContentType(pe->contentType);
+    header.setValue("content-type", pe->contentType);
     if (state.httpMajorVersion == 0 || (state.httpMajorVersion == 1 && state.httpMinorVersion == 0))
         pe->chunked = false;
 
@@ -512,27 +523,30 @@ void QxtHttpSessionManager::processEvents()
     if (emptyContent)
     {
         header.setValue("connection", "close");
-        connector()->writeHeaders(device, header);
+        connector()->writeResponseHeaders(device, header);
         closeConnection(requestID);
     }
     else
     {
         pe->dataSource = 0; // so that it isn't destroyed when the event is deleted
         if (state.onBytesWritten) delete state.onBytesWritten;  // disconnect old handler
+        QxtHttpSessionManagerPrivate::releaseSourceBindings(state);
         if (!pe->chunked)
         {
             state.keepAlive = false;
             state.onBytesWritten = QxtMetaObject::bind(this, SLOT(sendNextBlock(int, QObject*)), Q_ARG(int, requestID), Q_ARG(QObject*, source));
-            QxtMetaObject::connect(source, SIGNAL(readyRead()), QxtMetaObject::bind(this, SLOT(blockReadyRead(int, QObject*)), Q_ARG(int, requestID), Q_ARG(QObject*, source)), Qt::QueuedConnection);
-            QxtMetaObject::connect(source, SIGNAL(aboutToClose()), QxtMetaObject::bind(this, SLOT(closeConnection(int)), Q_ARG(int, requestID)), Qt::QueuedConnection);
+            state.onReadyRead = QxtMetaObject::bind(this, SLOT(blockReadyRead(int, QObject*)), Q_ARG(int, requestID), Q_ARG(QObject*, source));
+            state.onAboutToClose = QxtMetaObject::bind(this, SLOT(closeConnection(int)), Q_ARG(int, requestID));
         }
         else
         {
             header.setValue("transfer-encoding", "chunked");
             state.onBytesWritten = QxtMetaObject::bind(this, SLOT(sendNextChunk(int, QObject*)), Q_ARG(int, requestID), Q_ARG(QObject*, source));
-            QxtMetaObject::connect(source, SIGNAL(readyRead()), QxtMetaObject::bind(this, SLOT(chunkReadyRead(int, QObject*)), Q_ARG(int, requestID), Q_ARG(QObject*, source)), Qt::QueuedConnection);
-            QxtMetaObject::connect(source, SIGNAL(aboutToClose()), QxtMetaObject::bind(this, SLOT(sendEmptyChunk(int, QObject*)), Q_ARG(int, requestID), Q_ARG(QObject*, source)), Qt::QueuedConnection);
+            state.onReadyRead = QxtMetaObject::bind(this, SLOT(chunkReadyRead(int, QObject*)), Q_ARG(int, requestID), Q_ARG(QObject*, source));
+            state.onAboutToClose = QxtMetaObject::bind(this, SLOT(sendEmptyChunk(int, QObject*)), Q_ARG(int, requestID), Q_ARG(QObject*, source));
         }
+        QxtMetaObject::connect(source, SIGNAL(readyRead()), state.onReadyRead, Qt::QueuedConnection);
+        QxtMetaObject::connect(source, SIGNAL(aboutToClose()), state.onAboutToClose, Qt::QueuedConnection);
         QxtMetaObject::connect(device, SIGNAL(bytesWritten(qint64)), state.onBytesWritten, Qt::QueuedConnection);
 
         if (state.keepAlive)
@@ -543,7 +557,7 @@ void QxtHttpSessionManager::processEvents()
         {
             header.setValue("connection", "close");
         }
-        connector()->writeHeaders(device, header);
+        connector()->writeResponseHeaders(device, header);
         if (state.readyRead)
         {
             if (pe->chunked)
@@ -622,7 +636,7 @@ void QxtHttpSessionManager::sendEmptyChunk(int requestID, QObject* dataSource)
     {
         delete state.onBytesWritten;
         state.onBytesWritten = 0;
-        connector()->incomingData(device);
+        connector()->requestFinished(device);
     }
     else
     {
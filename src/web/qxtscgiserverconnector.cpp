@@ -60,6 +60,7 @@ QxtScgiServerConnector::QxtScgiServerConnector(QObject* parent) : QxtAbstractHtt
     QXT_INIT_PRIVATE(QxtScgiServerConnector);
     qxt_d().server = new QTcpServer(this);
     QObject::connect(qxt_d().server, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+    setHeaderFormat(CgiHeaders);
 }
 
 /*!
@@ -75,8 +76,12 @@ bool QxtScgiServerConnector::listen(const QHostAddress& iface, quint16 port)
  */
 void QxtScgiServerConnector::acceptConnection()
 {
-    QTcpSocket* socket = qxt_d().server->nextPendingConnection();
-    addConnection(socket);
+    // Connections beyond maxConnections() stay pending in the QTcpServer
+    while (qxt_d().server->hasPendingConnections() && canAcceptConnection())
+    {
+        QTcpSocket* socket = qxt_d().server->nextPendingConnection();
+        addConnection(socket);
+    }
 }
 
 /*!
@@ -180,12 +185,12 @@ QHttpRequestHeader QxtScgiServerConnector::parseRequest(QByteArray& buffer)
  */
 void QxtScgiServerConnector::writeHeaders(QIODevice* device, const QHttpResponseHeader& response_m)
 {
-
-    device->write(("Status:" + QString::number(response_m.statusCode()) + ' ' + response_m.reasonPhrase() + "\r\n").toAscii());
-
-    foreach(const QString& key, response_m.keys())
+    QByteArray data = "Status:" + QByteArray::number(response_m.statusCode()) + ' ' + response_m.reasonPhrase().toAscii() + "\r\n";
+    typedef QPair<QString, QString> StringPair;
+    foreach(const StringPair& line, response_m.values())
     {
-        device->write((key + ':' + response_m.value(key) + "\r\n").toAscii());
+        data += (line.first + ':' + line.second + "\r\n").toAscii();
     }
-    device->write("\r\n");
+    data += "\r\n";
+    device->write(data);
 }
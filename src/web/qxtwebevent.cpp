@@ -26,6 +26,111 @@
 #include "qxtwebevent.h"
 #include "qxtwebcontent.h"
 #include <QBuffer>
+#include <QThreadStorage>
+#include <new>
+
+#ifndef QXT_DOXYGEN_RUN
+#define QXT_WEB_EVENT_POOL_GRANULE 16
+#define QXT_WEB_EVENT_POOL_CLASSES 32   // blocks of up to 512 bytes are pooled
+#define QXT_WEB_EVENT_POOL_DEPTH 128    // free blocks kept per size class
+
+/*
+ * Recycles the memory of QxtWebEvent objects. Every request allocates at least
+ * a request event and a page event that are destroyed again within a few
+ * milliseconds, so freed blocks are kept on per-size free lists and handed
+ * out again instead of going back to the heap.
+ *
+ * Each thread has its own pool, so no lock is needed. A block goes to the pool
+ * of the thread that releases it; blocks in the pool are always of the full
+ * size of their class, so any of them can serve any allocation of that class.
+ */
+class QxtWebEventPool
+{
+public:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    QxtWebEventPool()
+    {
+        for (int i = 0; i < QXT_WEB_EVENT_POOL_CLASSES; i++)
+        {
+            heads[i] = 0;
+            counts[i] = 0;
+        }
+    }
+
+    ~QxtWebEventPool()
+    {
+        for (int i = 0; i < QXT_WEB_EVENT_POOL_CLASSES; i++)
+        {
+            while (heads[i])
+            {
+                FreeBlock* block = heads[i];
+                heads[i] = block->next;
+                ::operator delete(block);
+            }
+        }
+    }
+
+    static inline int sizeClass(size_t size)
+    {
+        return int((size + QXT_WEB_EVENT_POOL_GRANULE - 1) / QXT_WEB_EVENT_POOL_GRANULE) - 1;
+    }
+
+    // Blocks that are not taken from the free lists come from the global
+    // operator new, rounded up to the size of their class.
+    void* allocate(size_t size, bool nothrow)
+    {
+        int index = sizeClass(size);
+        if (index >= 0 && index < QXT_WEB_EVENT_POOL_CLASSES)
+        {
+            FreeBlock* block = heads[index];
+            if (block)
+            {
+                heads[index] = block->next;
+                counts[index]--;
+                return block;
+            }
+            size = (index + 1) * QXT_WEB_EVENT_POOL_GRANULE;
+        }
+        if (nothrow)
+            return ::operator new(size, std::nothrow);
+        return ::operator new(size);
+    }
+
+    void release(void* ptr, size_t size)
+    {
+        int index = sizeClass(size);
+        if (index >= 0 && index < QXT_WEB_EVENT_POOL_CLASSES && counts[index] < QXT_WEB_EVENT_POOL_DEPTH)
+        {
+            FreeBlock* block = static_cast<FreeBlock*>(ptr);
+            block->next = heads[index];
+            heads[index] = block;
+            counts[index]++;
+            return;
+        }
+        ::operator delete(ptr);
+    }
+
+private:
+    FreeBlock* heads[QXT_WEB_EVENT_POOL_CLASSES];
+    int counts[QXT_WEB_EVENT_POOL_CLASSES];
+};
+Q_GLOBAL_STATIC(QThreadStorage<QxtWebEventPool*>, qxt_web_event_pools)
+
+// Returns the pool of the calling thread, or 0 once the pools have been
+// destroyed at exit.
+static QxtWebEventPool* qxt_web_event_pool()
+{
+    QThreadStorage<QxtWebEventPool*>* pools = qxt_web_event_pools();
+    if (!pools) return 0;
+    if (!pools->hasLocalData())
+        pools->setLocalData(new QxtWebEventPool);
+    return pools->localData();
+}
+#endif
 
 /*!
 \class QxtWebEvent
@@ -65,6 +170,60 @@ QxtWebEvent::QxtWebEvent(EventType type, int sessionID)
  */
 QxtWebEvent::~QxtWebEvent() {}
 
+/*!
+ * \internal
+ * Allocates storage for an event of \a size bytes.
+ *
+ * Events are allocated and destroyed for every request, so their memory is
+ * taken from a recycling pool rather than directly from the heap. Subclasses
+ * inherit this behavior automatically.
+ */
+void* QxtWebEvent::operator new(size_t size)
+{
+    QxtWebEventPool* pool = qxt_web_event_pool();
+    if (!pool) return ::operator new(size);
+    return pool->allocate(size, false);
+}
+
+/*!
+ * \internal
+ * Allocates storage for an event of \a size bytes like the ordinary
+ * operator new, but returns 0 instead of throwing if no memory is available.
+ */
+void* QxtWebEvent::operator new(size_t size, const std::nothrow_t&) throw()
+{
+    QxtWebEventPool* pool = qxt_web_event_pool();
+    if (!pool) return ::operator new(size, std::nothrow);
+    return pool->allocate(size, true);
+}
+
+/*!
+ * \internal
+ * Returns the storage at \a ptr of \a size bytes to the recycling pool.
+ */
+void QxtWebEvent::operator delete(void* ptr, size_t size)
+{
+    if (!ptr) return;
+    QxtWebEventPool* pool = qxt_web_event_pool();
+    if (!pool)
+    {
+        ::operator delete(ptr);
+        return;
+    }
+    pool->release(ptr, size);
+}
+
+/*!
+ * \internal
+ * Frees the storage at \a ptr if the constructor of an event allocated with
+ * the nothrow operator new throws. The storage always comes from the global
+ * operator new, so it is returned there.
+ */
+void QxtWebEvent::operator delete(void* ptr, const std::nothrow_t&) throw()
+{
+    ::operator delete(ptr);
+}
+
 /*!
  * \fn EventType QxtWebEvent::type() const
  * Returns the event type.
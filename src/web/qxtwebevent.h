@@ -34,6 +34,7 @@
 #include <QUrl>
 #include <QMultiHash>
 #include <QDateTime>
+#include <new>
 #ifndef QT_NO_OPENSSL
 #include <QSslCertificate>
 #endif
@@ -57,6 +58,16 @@ public:
     QxtWebEvent(EventType type, int sessionID);
     virtual ~QxtWebEvent();
 
+    static void* operator new(size_t size);
+    static void* operator new(size_t size, const std::nothrow_t&) throw();
+    static inline void* operator new(size_t, void* place) throw()
+    {
+        return place;
+    }
+    static void operator delete(void* ptr, size_t size);
+    static void operator delete(void* ptr, const std::nothrow_t&) throw();
+    static inline void operator delete(void*, void*) throw() {}
+
     inline EventType type() const
     {
         return m_type;
@@ -5,6 +5,7 @@ SOURCES += qxtabstracthttpconnector.cpp
 SOURCES += qxtabstractwebservice.cpp
 SOURCES += qxtabstractwebsessionmanager.cpp
 SOURCES += qxthtmltemplate.cpp
+SOURCES += qxthttpheaderbuilder.cpp
 SOURCES += qxthttpserverconnector.cpp
 SOURCES += qxthttpsessionmanager.cpp
 SOURCES += qxtscgiserverconnector.cpp
@@ -19,6 +20,7 @@ HEADERS += qxtabstractwebservice.h
 HEADERS += qxtabstractwebsessionmanager.h
 HEADERS += qxtabstractwebsessionmanager_p.h
 HEADERS += qxthtmltemplate.h
+HEADERS += qxthttpheaderbuilder_p.h
 HEADERS += qxthttpsessionmanager.h
 HEADERS += qxtweb.h
 HEADERS += qxtwebcontent.h
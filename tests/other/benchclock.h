@@ -0,0 +1,46 @@
+#ifndef BENCHCLOCK_H
+#define BENCHCLOCK_H
+
+/*
+    Clock shared by the benchmarks in tests/other. Uses QElapsedTimer where
+    available; older Qt versions only have QTime, with millisecond
+    resolution.
+*/
+
+#include <QtGlobal>
+#if QT_VERSION >= 0x040800
+#include <QElapsedTimer>
+#else
+#include <QTime>
+#endif
+
+class BenchClock
+{
+public:
+    void start()
+    {
+#if QT_VERSION >= 0x040800
+        timer.start();
+#else
+        time.start();
+#endif
+    }
+
+    qint64 nsecsElapsed() const
+    {
+#if QT_VERSION >= 0x040800
+        return timer.nsecsElapsed();
+#else
+        return qint64(time.elapsed()) * 1000000;
+#endif
+    }
+
+private:
+#if QT_VERSION >= 0x040800
+    QElapsedTimer timer;
+#else
+    QTime time;
+#endif
+};
+
+#endif
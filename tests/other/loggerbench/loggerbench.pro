@@ -0,0 +1,13 @@
+TEMPLATE = app
+TARGET = loggerbench
+DEPENDPATH += . ..
+INCLUDEPATH += . ..
+CONFIG += console
+CONFIG -= app_bundle
+QT = core
+QXT = core
+include($$QXT_SOURCE_TREE/src/qxtlibs.pri)
+
+# Input
+HEADERS += ../benchclock.h
+SOURCES += main.cpp
@@ -1,2 +1,2 @@
 TEMPLATE = subdirs
-SUBDIRS += app no_keywords QxtFileLock QxtScheduleView slotjob
+SUBDIRS += app loggerbench no_keywords QxtFileLock QxtScheduleView rpcbench slotjob webeventbench
@@ -0,0 +1,426 @@
+/*
+    RPC throughput and latency benchmark.
+
+    Every run sets up the transport with a fresh pair of services, then runs
+    each scenario with each payload on it. The output is the rate of
+    delivered messages, the round-trip latency where the scenario measures
+    it, and the bytes written to the devices on both ends per message, for
+    every combination of transport, serializer and client count.
+
+    Transports:
+      fifo        one QxtRPCService on a QxtFifo, calling itself; 1 client only
+      tcp         a listening QxtRPCPeer and its QxtRPCPeer clients on loopback
+
+    Scenarios:
+      throughput  the clients call the server without expecting a reply
+      latency     the clients take turns making callWithReply() calls and
+                  waiting for them; the server echoes the first argument
+      broadcast   the server calls every client at once, so the fan-out of
+                  each call is the client count; not available on fifo
+
+    Payloads:
+      int         one int
+      ints        eight ints
+      bytes       a 1 KB QByteArray
+      map         a QVariantMap nesting another map and a list
+
+    Everything runs in one thread, so the figures include both ends of the
+    connection. The calls are paced so that at most --window messages are
+    in flight. Large client counts need a high enough open file limit.
+*/
+
+#include "benchclock.h"
+#include <QxtAbstractConnectionManager>
+#include <QxtCommandOptions>
+#include <QxtCompactSignalSerializer>
+#include <QxtDataStreamSignalSerializer>
+#include <QxtFifo>
+#include <QxtRPCPeer>
+#include <QxtRPCReply>
+#include <QxtRPCService>
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <QtAlgorithms>
+
+enum Scenario { ThroughputScenario, LatencyScenario, BroadcastScenario };
+
+static const char* scenarioNames[] = { "throughput", "latency", "broadcast" };
+
+enum Payload { IntPayload, IntsPayload, BytesPayload, MapPayload };
+
+static const char* payloadNames[] = { "int", "ints", "bytes", "map" };
+
+static QVariantMap mapPayload()
+{
+    QVariantMap address;
+    address["street"] = "Main Street 1";
+    address["city"] = "Springfield";
+    address["zip"] = 12345;
+
+    QVariantMap map;
+    map["user"] = "alice";
+    map["id"] = 4711;
+    map["ok"] = true;
+    map["ratio"] = 0.25;
+    map["tags"] = QStringList() << "alpha" << "beta" << "gamma";
+    map["address"] = address;
+    return map;
+}
+
+// Fills the eight arguments of a call; the unused ones stay invalid and are not sent.
+static void fillArguments(Payload payload, QVariant* args)
+{
+    static const QByteArray bytes(1024, 'x');
+    static const QVariantMap map = mapPayload();
+
+    for (int i = 0; i < 8; i++)
+        args[i] = QVariant();
+    switch (payload)
+    {
+    case IntPayload: args[0] = 42; break;
+    case IntsPayload: for (int i = 0; i < 8; i++) args[i] = i * 1000 + 42; break;
+    case BytesPayload: args[0] = bytes; break;
+    case MapPayload: args[0] = map; break;
+    }
+}
+
+static QxtAbstractSignalSerializer* createSerializer(const QString& kind)
+{
+    if (kind == "datastream") return new QxtDataStreamSignalSerializer;
+    if (kind == "compact") return new QxtCompactSignalSerializer;
+    return 0;
+}
+
+struct Result
+{
+    double messagesPerSecond;
+    qint64 p50, p99;            // round-trip latency in ns, or -1
+    double bytesPerMessage;
+};
+
+class Benchmark : public QObject
+{
+    Q_OBJECT
+public:
+    Benchmark() : messages(20000), calls(2000), window(256), port(23460), corked(false), timeout(60000),
+            server(0), received(0), connected(0), bytes(0) {}
+
+    bool setUp(const QString& transport, const QString& serializer, int clients);
+    void tearDown();
+    bool run(Scenario scenario, Payload payload, Result* result);
+    bool canRun(Scenario scenario) const { return scenario != BroadcastScenario || !peers.isEmpty(); }
+
+    int messages;
+    int calls;
+    int window;
+    int port;
+    bool corked;
+    int timeout;
+
+public Q_SLOTS:
+    void sink() { received++; }
+    QVariant echo(const QVariant& value) { return value; }
+    QVariant echoClient(quint64, const QVariant& value) { return value; }
+    void written(qint64 count) { bytes += count; }
+    void clientConnected(quint64 id);
+
+private:
+    void meter(QIODevice* device);
+    bool waitFor(const qint64* counter, qint64 target);
+
+    QxtRPCService* server;
+    QList<QxtRPCService*> peers;    // the clients connected to server, if any
+    QList<QxtRPCService*> callers;  // the services making the calls to server
+    qint64 received;
+    qint64 connected;
+    qint64 bytes;
+};
+
+void Benchmark::clientConnected(quint64 id)
+{
+    meter(server->connectionManager()->client(id));
+    connected++;
+}
+
+void Benchmark::meter(QIODevice* device)
+{
+    if (device) connect(device, SIGNAL(bytesWritten(qint64)), this, SLOT(written(qint64)));
+}
+
+bool Benchmark::waitFor(const qint64* counter, qint64 target)
+{
+    BenchClock clock;
+    clock.start();
+    while (*counter < target)
+    {
+        QCoreApplication::processEvents();
+        if (clock.nsecsElapsed() > qint64(timeout) * 1000000) return false;
+    }
+    return true;
+}
+
+bool Benchmark::setUp(const QString& transport, const QString& serializer, int clients)
+{
+    QxtAbstractSignalSerializer* format = createSerializer(serializer);
+    if (!format) return false;
+
+    if (transport == "fifo")
+    {
+        if (clients != 1)
+        {
+            delete format;
+            return false;
+        }
+        server = new QxtRPCService;
+        server->setSerializer(format);
+        QxtFifo* fifo = new QxtFifo;
+        meter(fifo);
+        server->setDevice(fifo);
+        server->attachSlot("sink", this, SLOT(sink()));
+        server->attachSlot("echo", this, SLOT(echo(QVariant)));
+        server->setCorked(corked);
+        callers << server;
+        return true;
+    }
+    if (transport != "tcp")
+    {
+        delete format;
+        return false;
+    }
+
+    QxtRPCPeer* listener = new QxtRPCPeer;
+    server = listener;
+    server->setSerializer(format);
+    server->attachSlot("sink", this, SLOT(sink()));
+    server->attachSlot("echo", this, SLOT(echoClient(quint64,QVariant)));
+    server->setCorked(corked);
+    connect(server, SIGNAL(clientConnected(quint64)), this, SLOT(clientConnected(quint64)));
+    if (!listener->listen(QHostAddress::LocalHost, port)) return false;
+
+    // Connect in batches, so that the listen backlog does not overflow.
+    connected = 0;
+    for (int i = 0; i < clients; i++)
+    {
+        QxtRPCPeer* peer = new QxtRPCPeer;
+        peer->setSerializer(createSerializer(serializer));
+        peer->attachSlot("sink", this, SLOT(sink()));
+        peer->setCorked(corked);
+        peer->connect(QHostAddress::LocalHost, port);
+        meter(peer->device());
+        peers << peer;
+        if ((i + 1) % 32 == 0 && !waitFor(&connected, i + 1)) return false;
+    }
+    callers = peers;
+    return waitFor(&connected, clients);
+}
+
+void Benchmark::tearDown()
+{
+    qDeleteAll(peers);
+    peers.clear();
+    callers.clear();
+    delete server;
+    server = 0;
+    for (int i = 0; i < 4; i++)
+        QCoreApplication::processEvents();
+}
+
+bool Benchmark::run(Scenario scenario, Payload payload, Result* result)
+{
+    QVariant a[8];
+    fillArguments(payload, a);
+
+    // Let the previous run settle, so that its bytes are not counted.
+    for (int i = 0; i < 4; i++)
+        QCoreApplication::processEvents();
+    received = 0;
+    bytes = 0;
+
+    QVector<qint64> latencies;
+    qint64 total = 0;
+    BenchClock clock;
+    clock.start();
+    switch (scenario)
+    {
+    case ThroughputScenario:
+    {
+        const int rounds = qMax(1, messages / callers.count());
+        for (int i = 0; i < rounds; i++)
+        {
+            Q_FOREACH(QxtRPCService* caller, callers)
+                caller->call("sink", a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+            total += callers.count();
+            if (!waitFor(&received, total - window)) return false;
+        }
+        if (!waitFor(&received, total)) return false;
+        break;
+    }
+    case LatencyScenario:
+        latencies.resize(calls);
+        for (int i = 0; i < calls; i++)
+        {
+            QxtRPCService* caller = callers.at(i % callers.count());
+            const qint64 start = clock.nsecsElapsed();
+            QxtRPCReply* reply = caller->callWithReply("echo", a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+            caller->flush();
+            const bool ok = reply->waitForFinished(timeout) && reply->error() == QxtRPCReply::NoError;
+            latencies[i] = clock.nsecsElapsed() - start;
+            delete reply;
+            if (!ok) return false;
+        }
+        total = calls;
+        break;
+    case BroadcastScenario:
+    {
+        const int rounds = qMax(1, messages / peers.count());
+        for (int i = 0; i < rounds; i++)
+        {
+            server->call("sink", a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+            total += peers.count();
+            if (!waitFor(&received, total - window)) return false;
+        }
+        if (!waitFor(&received, total)) return false;
+        break;
+    }
+    }
+    const qint64 elapsed = clock.nsecsElapsed();
+
+    // QxtFifo reports written bytes through a queued signal.
+    for (int i = 0; i < 4; i++)
+        QCoreApplication::processEvents();
+
+    qSort(latencies);
+    result->messagesPerSecond = elapsed > 0 ? double(total) * 1e9 / elapsed : 0;
+    result->p50 = latencies.isEmpty() ? -1 : latencies.at(latencies.count() / 2);
+    result->p99 = latencies.isEmpty() ? -1 : latencies.at(latencies.count() * 99 / 100);
+    result->bytesPerMessage = total > 0 ? double(bytes) / total : 0;
+    return true;
+}
+
+static QString latency(qint64 nsecs)
+{
+    return nsecs < 0 ? QString("-") : QString::number(nsecs / 1000);
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QxtCommandOptions options;
+    options.add("messages", "messages per throughput or broadcast run, shared by the clients (default 20000)", QxtCommandOptions::ValueRequired);
+    options.add("calls", "calls per latency run, shared by the clients (default 2000)", QxtCommandOptions::ValueRequired);
+    options.add("clients", "comma separated client counts, 1 to 1000 (default 1,10,100)", QxtCommandOptions::ValueRequired);
+    options.add("transports", "comma separated transports: fifo, tcp (default fifo,tcp)", QxtCommandOptions::ValueRequired);
+    options.add("serializers", "comma separated serializers: datastream, compact (default datastream,compact)", QxtCommandOptions::ValueRequired);
+    options.add("scenarios", "comma separated scenarios: throughput, latency, broadcast (default all)", QxtCommandOptions::ValueRequired);
+    options.add("payloads", "comma separated payloads: int, ints, bytes, map (default all)", QxtCommandOptions::ValueRequired);
+    options.add("window", "messages in flight before the senders wait (default 256)", QxtCommandOptions::ValueRequired);
+    options.add("port", "loopback port for the tcp transport (default 23460)", QxtCommandOptions::ValueRequired);
+    options.add("cork", "coalesce the writes of every service");
+    options.add("help", "show this help text");
+    options.alias("help", "h");
+    options.parse(QCoreApplication::arguments());
+
+    if (options.count("help") || options.showUnrecognizedWarning())
+    {
+        out << "usage: rpcbench [options]" << endl;
+        options.showUsage();
+        return options.count("help") ? 0 : 1;
+    }
+
+    Benchmark bench;
+    if (options.value("messages").toInt() > 0) bench.messages = options.value("messages").toInt();
+    if (options.value("calls").toInt() > 0) bench.calls = options.value("calls").toInt();
+    if (options.value("window").toInt() > 0) bench.window = options.value("window").toInt();
+    if (options.value("port").toInt() > 0) bench.port = options.value("port").toInt();
+    bench.corked = options.count("cork");
+
+    QList<int> clientCounts;
+    Q_FOREACH(const QString& count, options.value("clients").toString().split(',', QString::SkipEmptyParts))
+    {
+        if (count.toInt() > 0 && count.toInt() <= 1000) clientCounts += count.toInt();
+    }
+    if (clientCounts.isEmpty()) clientCounts << 1 << 10 << 100;
+
+    QStringList transports = options.value("transports").toString().split(',', QString::SkipEmptyParts);
+    if (transports.isEmpty()) transports << "fifo" << "tcp";
+
+    QStringList serializers = options.value("serializers").toString().split(',', QString::SkipEmptyParts);
+    if (serializers.isEmpty()) serializers << "datastream" << "compact";
+
+    QList<Scenario> scenarios;
+    Q_FOREACH(const QString& name, options.value("scenarios").toString().split(',', QString::SkipEmptyParts))
+    {
+        for (int i = 0; i <= BroadcastScenario; i++)
+        {
+            if (name == scenarioNames[i]) scenarios += Scenario(i);
+        }
+    }
+    if (scenarios.isEmpty()) scenarios << ThroughputScenario << LatencyScenario << BroadcastScenario;
+
+    QList<Payload> payloads;
+    Q_FOREACH(const QString& name, options.value("payloads").toString().split(',', QString::SkipEmptyParts))
+    {
+        for (int i = 0; i <= MapPayload; i++)
+        {
+            if (name == payloadNames[i]) payloads += Payload(i);
+        }
+    }
+    if (payloads.isEmpty()) payloads << IntPayload << IntsPayload << BytesPayload << MapPayload;
+
+    out << QString("%1 messages, %2 calls per run, window %3%4\n")
+        .arg(bench.messages).arg(bench.calls).arg(bench.window).arg(bench.corked ? ", corked" : "");
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+        .arg("transport", -9).arg("serializer", -10).arg("scenario", -10).arg("payload", -7).arg("clients", 7)
+        .arg("msgs/s", 10).arg("p50 us", 8).arg("p99 us", 8).arg("bytes/msg", 9);
+    out.flush();
+
+    int status = 0;
+    Q_FOREACH(const QString& transport, transports)
+    {
+        Q_FOREACH(const QString& serializer, serializers)
+        {
+            Q_FOREACH(int clients, clientCounts)
+            {
+                if (transport == "fifo" && clients != 1) continue;
+                if (!bench.setUp(transport, serializer, clients))
+                {
+                    err << "cannot set up " << transport << " with " << serializer << " for " << clients << " clients" << endl;
+                    bench.tearDown();
+                    status = 1;
+                    continue;
+                }
+                Q_FOREACH(Scenario scenario, scenarios)
+                {
+                    if (!bench.canRun(scenario)) continue;
+                    Q_FOREACH(Payload payload, payloads)
+                    {
+                        Result result;
+                        if (!bench.run(scenario, payload, &result))
+                        {
+                            err << "timed out: " << transport << " " << serializer << " " << scenarioNames[scenario]
+                                << " " << payloadNames[payload] << " with " << clients << " clients" << endl;
+                            status = 1;
+                            continue;
+                        }
+                        out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+                            .arg(transport, -9).arg(serializer, -10).arg(scenarioNames[scenario], -10)
+                            .arg(payloadNames[payload], -7).arg(clients, 7)
+                            .arg(qint64(result.messagesPerSecond), 10).arg(latency(result.p50), 8)
+                            .arg(latency(result.p99), 8).arg(result.bytesPerMessage, 9, 'f', 1);
+                        out.flush();
+                    }
+                }
+                bench.tearDown();
+            }
+        }
+    }
+    return status;
+}
+
+#include "main.moc"
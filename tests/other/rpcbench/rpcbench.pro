@@ -0,0 +1,13 @@
+TEMPLATE = app
+TARGET = rpcbench
+DEPENDPATH += . ..
+INCLUDEPATH += . ..
+CONFIG += console
+CONFIG -= app_bundle
+QT = core network
+QXT = core network
+include($$QXT_SOURCE_TREE/src/qxtlibs.pri)
+
+# Input
+HEADERS += ../benchclock.h
+SOURCES += main.cpp
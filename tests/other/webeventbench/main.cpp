@@ -0,0 +1,133 @@
+/*
+    Web event allocation benchmark.
+
+    Every request handled by QxtHttpSessionManager creates and destroys at
+    least a request event and a page event. This measures how many request
+    events per second the producer threads can create and destroy, in
+    batches of a few outstanding events, with the recycling pool of
+    QxtWebEvent::operator new and with storage taken directly from the
+    global heap through placement new.
+
+    Allocators:
+      pool    new QxtWebRequestEvent / delete
+      heap    ::operator new + placement new / destructor + ::operator delete
+*/
+
+#include <QxtCommandOptions>
+#include <QxtWebEvent>
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+#include <QTime>
+#include <QUrl>
+
+enum Allocator { PoolAllocator, HeapAllocator };
+
+static const char* allocatorNames[] = { "pool", "heap" };
+
+enum { Batch = 16 };
+
+class Producer : public QThread
+{
+public:
+    Producer(Allocator allocator, int count, QAtomicInt* gate) : allocator(allocator), count(count), gate(gate) {}
+
+    Allocator allocator;
+    int count;
+    QAtomicInt* gate;
+
+protected:
+    void run()
+    {
+        const QUrl url("/");
+        QxtWebEvent* events[Batch];
+        while (!gate->fetchAndAddAcquire(0))
+            QThread::yieldCurrentThread();
+        for (int i = 0; i < count; i += Batch)
+        {
+            if (allocator == PoolAllocator)
+            {
+                for (int j = 0; j < Batch; j++)
+                    events[j] = new QxtWebRequestEvent(0, i + j, url);
+                for (int j = 0; j < Batch; j++)
+                    delete events[j];
+            }
+            else
+            {
+                for (int j = 0; j < Batch; j++)
+                    events[j] = new(::operator new(sizeof(QxtWebRequestEvent))) QxtWebRequestEvent(0, i + j, url);
+                for (int j = 0; j < Batch; j++)
+                {
+                    events[j]->~QxtWebEvent();
+                    ::operator delete(events[j]);
+                }
+            }
+        }
+    }
+};
+
+// Returns the number of events created and destroyed per second.
+static qint64 run(Allocator allocator, int events, int threads)
+{
+    QAtomicInt gate(0);
+    QList<Producer*> producers;
+    for (int i = 0; i < threads; i++)
+    {
+        producers += new Producer(allocator, events / threads, &gate);
+        producers.last()->start();
+    }
+    QTime time;
+    time.start();
+    gate.fetchAndStoreRelease(1);
+    Q_FOREACH(Producer* producer, producers)
+        producer->wait();
+    const int elapsed = time.elapsed();
+    qDeleteAll(producers);
+    return elapsed > 0 ? qint64(events) * 1000 / elapsed : 0;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QxtCommandOptions options;
+    options.add("events", "events created per run, shared by the threads (default 4000000)", QxtCommandOptions::ValueRequired);
+    options.add("threads", "comma separated producer thread counts (default 1,4,16)", QxtCommandOptions::ValueRequired);
+    options.add("help", "show this help text");
+    options.alias("help", "h");
+    options.parse(QCoreApplication::arguments());
+
+    if (options.count("help") || options.showUnrecognizedWarning())
+    {
+        out << "usage: webeventbench [options]" << endl;
+        options.showUsage();
+        return options.count("help") ? 0 : 1;
+    }
+
+    int events = options.value("events").toInt();
+    if (events <= 0) events = 4000000;
+
+    QList<int> threadCounts;
+    Q_FOREACH(const QString& count, options.value("threads").toString().split(',', QString::SkipEmptyParts))
+    {
+        if (count.toInt() > 0) threadCounts += count.toInt();
+    }
+    if (threadCounts.isEmpty()) threadCounts << 1 << 4 << 16;
+
+    out << QString("%1 events per run, %2 outstanding per thread\n").arg(events).arg(int(Batch));
+    out << QString("%1 %2 %3\n").arg("allocator", -9).arg("threads", 7).arg("events/s", 12);
+    out.flush();
+
+    Q_FOREACH(int threads, threadCounts)
+    {
+        for (int allocator = PoolAllocator; allocator <= HeapAllocator; allocator++)
+        {
+            out << QString("%1 %2 %3\n").arg(allocatorNames[allocator], -9).arg(threads, 7)
+                .arg(run(Allocator(allocator), events, threads), 12);
+            out.flush();
+        }
+    }
+    return 0;
+}
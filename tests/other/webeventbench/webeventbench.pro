@@ -0,0 +1,12 @@
+TEMPLATE = app
+TARGET = webeventbench
+DEPENDPATH += .
+INCLUDEPATH += .
+CONFIG += console
+CONFIG -= app_bundle
+QT = core network
+QXT = core web
+include($$QXT_SOURCE_TREE/src/qxtlibs.pri)
+
+# Input
+SOURCES += main.cpp
@@ -1,5 +1,5 @@
 TEMPLATE = subdirs
-SUBDIRS += bind fifo json job modelserializer pipe sharedprivate slotmapper tempdir
+SUBDIRS += bind fifo json job logger modelserializer pipe sharedprivate slotmapper tempdir
 SUBDIRS += filelock #permfail
 
 test.CONFIG += recursive
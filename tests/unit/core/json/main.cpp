@@ -1,5 +1,7 @@
 #include <QxtJSON>
 #include <QTest>
+#include <QBuffer>
+#include <qnumeric.h>
 #include <QDebug>
 
 class QxtJSONTest: public QObject{
@@ -61,6 +63,137 @@ private slots:
         QVERIFY(!e.isNull());
     }
 
+    void stringifyEscapes(){
+        QCOMPARE(QxtJSON::stringify("a\"b\\c\n\x01"),QString("\"a\\\"b\\\\c\\n\\u0001\""));
+        QCOMPARE(QxtJSON::stringifyUtf8(QString::fromUtf8("\xc3\xa9\xf0\x9d\x84\x9e")),QByteArray("\"\xc3\xa9\xf0\x9d\x84\x9e\""));
+        QCOMPARE(QxtJSON::stringifyUtf8(QString(QChar(0xd834))),QByteArray("\"\\ud834\""));
+        QVariantMap e;
+        e["quote\""]=QStringList()<<"x\ty";
+        QCOMPARE(QxtJSON::stringify(e),QString("{\"quote\\\"\":[\"x\\ty\"]}"));
+    }
+
+    void stringifyNumbers(){
+        QCOMPARE(QxtJSON::stringify(Q_INT64_C(-9223372036854775807) - 1),QString("-9223372036854775808"));
+        QCOMPARE(QxtJSON::stringify(Q_UINT64_C(18446744073709551615)),QString("18446744073709551615"));
+        QCOMPARE(QxtJSON::stringify(0.1),QString("0.1"));
+        QCOMPARE(QxtJSON::stringify(1e300),QString("1e+300"));
+        QCOMPARE(QxtJSON::parse(QxtJSON::stringify(1.0/3)).toDouble(),1.0/3);
+        QCOMPARE(QxtJSON::stringify(QVariantList()<<qQNaN()<<qInf()),QString("[null,null]"));
+    }
+
+    void stringifyIndented(){
+        QVariantMap e;
+        e["a"]=QVariantList()<<1<<QVariantMap();
+        e["b"]=QVariantList();
+        QCOMPARE(QxtJSON::stringifyUtf8(e,QxtJSON::Indented),QByteArray("{\n    \"a\": [\n        1,\n        {}\n    ],\n    \"b\": []\n}"));
+        QCOMPARE(QxtJSON::parseUtf8(QxtJSON::stringifyUtf8(e,QxtJSON::Indented)),QVariant(e));
+    }
+
+    void writeDevice(){
+        QVariantList e;
+        for(int i=0;i<5000;i++)
+            e<<QString("item %1").arg(i)<<i;
+        QByteArray appended("prefix");
+        QxtJSON::write(e,&appended);
+        QCOMPARE(appended,"prefix"+QxtJSON::stringifyUtf8(e));
+
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(QxtJSON::write(e,&buffer));
+        QCOMPARE(buffer.data(),QxtJSON::stringifyUtf8(e));
+        QCOMPARE(QxtJSON::parseUtf8(buffer.data()),QVariant(e));
+    }
+
+    void stringifyLong(){
+        // A surrogate pair that straddles the writer's chunks of UTF-16 units.
+        for(int n=2720;n<2740;n++){
+            QString text=QString(n,'x')+QString::fromUtf8("\xf0\x9d\x84\x9e")+"\n";
+            QCOMPARE(QxtJSON::stringifyUtf8(text),"\""+QByteArray(n,'x')+"\xf0\x9d\x84\x9e\\n\"");
+        }
+    }
+
+    void stringifyTooDeep(){
+        QVariant v;
+        for(int i=0;i<1100;i++)
+            v=QVariantList()<<v;
+        QByteArray json=QxtJSON::stringifyUtf8(v);
+        QVERIFY(json.startsWith(QByteArray(1024,'[')+"null]"));
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(!QxtJSON::write(v,&buffer));
+        QCOMPARE(buffer.data(),json);
+    }
+
+    void parseNumbers(){
+        QCOMPARE(QxtJSON::parse("-2147483648").type(),QVariant::Int);
+        QCOMPARE(QxtJSON::parse("-2147483648").toInt(),int(-2147483647 - 1));
+        QCOMPARE(QxtJSON::parse("2147483648").type(),QVariant::LongLong);
+        QCOMPARE(QxtJSON::parse("9223372036854775807").toLongLong(),Q_INT64_C(9223372036854775807));
+        QCOMPARE(QxtJSON::parse("-9223372036854775808").toLongLong(),Q_INT64_C(-9223372036854775807) - 1);
+        QCOMPARE(QxtJSON::parse("18446744073709551616").type(),QVariant::Double);
+        QCOMPARE(QxtJSON::parse("1e3").toDouble(),1000.0);
+        QCOMPARE(QxtJSON::parse("-0.25E-2").toDouble(),-0.0025);
+        QVERIFY(QxtJSON::parse("012").isNull());
+        QVERIFY(QxtJSON::parse("1.").isNull());
+        QVERIFY(QxtJSON::parse("-").isNull());
+    }
+
+    void parseStrings(){
+        QCOMPARE(QxtJSON::parse("\"a\\\"b\\\\c\\/d\\n\"").toString(),QString("a\"b\\c/d\n"));
+        QCOMPARE(QxtJSON::parse("\"\\u00e9\\u20AC\"").toString(),QString::fromUtf8("\xc3\xa9\xe2\x82\xac"));
+        QCOMPARE(QxtJSON::parse("\"\\ud834\\udd1e\"").toString(),QString::fromUtf8("\xf0\x9d\x84\x9e"));
+        QCOMPARE(QxtJSON::parseUtf8("\"gr\xc3\xbc\xc3\x9f dich\"").toString(),QString::fromUtf8("gr\xc3\xbc\xc3\x9f dich"));
+        QCOMPARE(QxtJSON::parse("\"\\ud834\"").toString(),QString(QChar(0xd834)));
+        QVERIFY(QxtJSON::parse("\"\\x\"").isNull());
+        QVERIFY(QxtJSON::parse("\"a\nb\"").isNull());
+
+        // Long enough for the wide scan, with the special characters at every position.
+        for(int i=0;i<40;i++){
+            QByteArray plain(40,'x');
+            QByteArray json="\""+plain.left(i)+"\\t"+plain.mid(i)+"\"";
+            QCOMPARE(QxtJSON::parseUtf8(json).toString(),QString(plain.left(i)+"\t"+plain.mid(i)));
+            json="\""+plain.left(i)+"\xc3\xa4"+plain.mid(i)+"\"";
+            QCOMPARE(QxtJSON::parseUtf8(json).toString(),QString::fromUtf8(plain.left(i)+"\xc3\xa4"+plain.mid(i)));
+        }
+    }
+
+    void parseNested(){
+        QVariant v=QxtJSON::parseUtf8("{\"a\":[1,{\"b\":[]},{}],\"c\":{\"d\":null},\"e\":[[\"f\"]]}");
+        QVariantMap m=v.toMap();
+        QCOMPARE(m.count(),3);
+        QCOMPARE(m["a"].toList().count(),3);
+        QCOMPARE(m["a"].toList().at(1).toMap()["b"].toList(),QVariantList());
+        QVERIFY(m["c"].toMap().contains("d"));
+        QCOMPARE(m["e"].toList().at(0).toList().at(0).toString(),QString("f"));
+        QVERIFY(!QxtJSON::parseUtf8(QByteArray(1000,'[')+QByteArray(1000,']')).isNull());
+        QVERIFY(QxtJSON::parseUtf8(QByteArray(100000,'[')+QByteArray(100000,']')).isNull());
+    }
+
+    void parseErrors(){
+        int offset=0;
+        QString error;
+        QVERIFY(QxtJSON::parseUtf8("{\"a\":1,\n \"b\" 2}",&offset,&error).isNull());
+        QCOMPARE(offset,13);
+        QCOMPARE(error,QString("expected ':' after member name at line 2, column 6"));
+
+        QVERIFY(QxtJSON::parseUtf8("[1,2",&offset,&error).isNull());
+        QCOMPARE(offset,4);
+        QVERIFY(error.startsWith("unexpected end of input"));
+
+        QVERIFY(QxtJSON::parseUtf8("[1,]",&offset).isNull());
+        QCOMPARE(offset,3);
+        QVERIFY(QxtJSON::parseUtf8("{\"a\":1,}",&offset).isNull());
+        QCOMPARE(offset,7);
+        QVERIFY(QxtJSON::parseUtf8("[1] 2",&offset).isNull());
+        QCOMPARE(offset,4);
+        QVERIFY(QxtJSON::parseUtf8("tru",&offset).isNull());
+        QCOMPARE(offset,0);
+
+        QCOMPARE(QxtJSON::parseUtf8(" [true] ",&offset,&error),QVariant(QVariantList()<<true));
+        QCOMPARE(offset,-1);
+        QVERIFY(error.isNull());
+    }
+
 
 };
 
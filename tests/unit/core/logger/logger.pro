@@ -0,0 +1,8 @@
+TEMPLATE = app
+TARGET = 
+DEPENDPATH += .
+INCLUDEPATH += .
+QT = core
+QXT = core
+SOURCES += main.cpp
+include(../../unit.pri)
@@ -0,0 +1,480 @@
+#include <QxtLogger>
+#include <QxtLoggerEngine>
+#include <QxtBasicFileLoggerEngine>
+#include <QxtBinaryFileLoggerEngine>
+#include <QxtBinaryLogReader>
+#include <QxtFlightRecorderLoggerEngine>
+#include <QxtJsonFileLoggerEngine>
+#include <QxtJSON>
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QxtBufferedFileLoggerEngine>
+#include <QxtTemporaryDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QTest>
+#include <QThread>
+
+class RecordingEngine : public QxtLoggerEngine, public QxtLoggerEngineExtension
+{
+public:
+    RecordingEngine() : count(0) {}
+
+    void initLoggerEngine() {}
+    void killLoggerEngine() {}
+    bool isInitialized() const { return true; }
+    void writeFormatted(QxtLogger::LogLevel level, const QList<QVariant>& messages)
+    {
+        count++;
+        lastLevel = level;
+        lastMessages = messages;
+    }
+    void writeRecord(const QxtLogRecord& record)
+    {
+        writeFormatted(record.level, record.messages);
+        lastThread = record.threadTag();
+        lastTime = record.time;
+    }
+
+    int count;
+    QxtLogger::LogLevel lastLevel;
+    QList<QVariant> lastMessages;
+    QString lastThread;
+    qint64 lastTime;
+};
+
+static void writeAt(QxtLoggerEngineExtension* engine, qint64 time, int value)
+{
+    QxtLogRecord record;
+    record.level = QxtLogger::WarningLevel;
+    record.messages << value;
+    record.time = time;
+    engine->writeRecord(record);
+}
+
+class LoggingThread : public QThread
+{
+public:
+    LoggingThread() { setObjectName("worker"); }
+
+protected:
+    void run()
+    {
+        qxtLog->debug("batched");
+        qxtLog->warning() << "from" << "worker";
+    }
+};
+
+class FloodThread : public QThread
+{
+public:
+    FloodThread(int count) : count(count) {}
+
+    int count;
+
+protected:
+    void run()
+    {
+        for (int i = 0; i < count; i++)
+            qxtLog->warning(i);
+    }
+};
+
+static int evaluations = 0;
+
+static QString expensive()
+{
+    evaluations++;
+    return "expensive";
+}
+
+class QxtLoggerTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase()
+    {
+        qxtLog->disableLoggerEngine("DEFAULT");
+        engine = new RecordingEngine;
+        engine->disableAllLogLevels();
+        engine->enableLogLevels(QxtLogger::WarningLevel | QxtLogger::ErrorLevel);
+        qxtLog->addLoggerEngine("recorder", engine);
+    }
+
+    void enabledLevels()
+    {
+        QVERIFY(qxtLog->isLevelEnabled(QxtLogger::WarningLevel));
+        QVERIFY(!qxtLog->isLevelEnabled(QxtLogger::DebugLevel));
+
+        engine->enableLogLevels(QxtLogger::DebugLevel);
+        QVERIFY(qxtLog->isLevelEnabled(QxtLogger::DebugLevel));
+        engine->disableLogLevels(QxtLogger::DebugLevel);
+        QVERIFY(!qxtLog->isLevelEnabled(QxtLogger::DebugLevel));
+
+        qxtLog->disableLoggerEngine("recorder");
+        QVERIFY(!qxtLog->isLevelEnabled(QxtLogger::WarningLevel));
+        qxtLog->enableLoggerEngine("recorder");
+        QVERIFY(qxtLog->isLevelEnabled(QxtLogger::WarningLevel));
+    }
+
+    void filtering()
+    {
+        engine->count = 0;
+        qxtLog->debug("hidden");
+        qxtLog->debug() << "hidden";
+        qxtLog->warning("shown", 1);
+        QCOMPARE(engine->count, 1);
+        QCOMPARE(engine->lastLevel, QxtLogger::WarningLevel);
+        QCOMPARE(engine->lastMessages.count(), 2);
+
+        qxtLog->error() << "streamed" << 2;
+        QCOMPARE(engine->count, 2);
+        QCOMPARE(engine->lastMessages.count(), 2);
+    }
+
+    void macros()
+    {
+        evaluations = 0;
+        engine->count = 0;
+        qxtLogDebug() << expensive();
+        QCOMPARE(evaluations, 0);
+        QCOMPARE(engine->count, 0);
+
+        if (true)
+            qxtLogWarning() << expensive();
+        else
+            QFAIL("qxtLogWarning() captured the else branch");
+        QCOMPARE(evaluations, 1);
+        QCOMPARE(engine->count, 1);
+    }
+
+    void asynchronous()
+    {
+        engine->count = 0;
+        qxtLog->setAsynchronous(true, 16);
+        QVERIFY(qxtLog->isAsynchronous());
+        for (int i = 0; i < 1000; i++)
+            qxtLog->warning(i);
+        qxtLog->flush();
+        QCOMPARE(engine->count, 1000);
+        QCOMPARE(engine->lastMessages.value(0).toInt(), 999);
+
+        qxtLog->warning("last");
+        qxtLog->setAsynchronous(false);
+        QVERIFY(!qxtLog->isAsynchronous());
+        QCOMPARE(engine->count, 1001);
+    }
+
+    void switchingWhileLogging()
+    {
+        // no message may be lost while other threads keep logging
+        engine->count = 0;
+        QList<FloodThread*> threads;
+        for (int i = 0; i < 4; i++)
+        {
+            threads += new FloodThread(5000);
+            threads.last()->start();
+        }
+        for (int i = 0; i < 20; i++)
+        {
+            qxtLog->setAsynchronous(i % 2 == 0, 16);
+            QTest::qWait(1);
+        }
+        qxtLog->setAsynchronous(false);
+        Q_FOREACH(FloodThread* thread, threads)
+        {
+            QVERIFY(thread->wait(30000));
+            delete thread;
+        }
+        // messages logged synchronously from the threads reach the engine through the event loop
+        for (int i = 0; i < 500 && engine->count < 20000; i++)
+            QTest::qWait(10);
+        QCOMPARE(engine->count, 20000);
+    }
+
+    void basicFileFormat()
+    {
+        QxtTemporaryDir dir;
+        const QString name = dir.path() + "/basic.log";
+        QxtBasicFileLoggerEngine* file = new QxtBasicFileLoggerEngine(name);
+        qxtLog->addLoggerEngine("basic", file);
+        qxtLog->warning("first", 2);
+        file->setDateFormat("'at' ss 'z' z");
+        qxtLog->warning(true);
+        file->setDateFormat("hh:mm:ss.zzz AP");
+        qxtLog->warning("twelve hours");
+        qxtLog->removeLoggerEngine("basic");
+
+        QFile log(name);
+        QVERIFY(log.open(QIODevice::ReadOnly));
+        const QString text = QString::fromUtf8(log.readAll());
+        QRegExp expected("\\[\\d\\d:\\d\\d:\\d\\d\\.\\d{3}\\] \\[Warning\\] first\n {25}2\n"
+                         "\\[at \\d\\d z \\d{1,3}\\] \\[Warning\\] true\n"
+                         "\\[(0[1-9]|1[0-2]):\\d\\d:\\d\\d\\.\\d{3} [^\\]]+\\] \\[Warning\\] twelve hours\n");
+        QVERIFY2(expected.exactMatch(text), qPrintable(text));
+    }
+
+    void bufferedFile()
+    {
+        QxtTemporaryDir dir;
+        const QString name = dir.path() + "/test.log";
+        QxtBufferedFileLoggerEngine* file = new QxtBufferedFileLoggerEngine(name);
+        file->setFlushInterval(0);
+        qxtLog->addLoggerEngine("buffered", file);
+
+        qxtLog->warning("buffered");
+        QCOMPARE(QFileInfo(name).size(), qint64(0));
+        file->flush();
+        const qint64 size = QFileInfo(name).size();
+        QVERIFY(size > 0);
+        qxtLog->error("written at once");
+        QVERIFY(QFileInfo(name).size() > size);
+
+        file->setMaximumFileSize(256);
+        file->setBackupCount(2);
+        for (int i = 0; i < 100; i++)
+            qxtLog->warning("rotated message", i);
+        file->flush();
+        QVERIFY(QFile::exists(name + ".1"));
+        QVERIFY(QFile::exists(name + ".2"));
+        QVERIFY(!QFile::exists(name + ".3"));
+        QVERIFY(QFileInfo(name).size() <= 256 + 64);
+
+        file->setCompressBackups(true);
+        file->rotate();
+        qxtLog->removeLoggerEngine("buffered");   // waits for the compressor
+        QFile gz(name + ".1.gz");
+        QVERIFY(gz.open(QIODevice::ReadOnly));
+        QCOMPARE(gz.read(2), QByteArray("\x1f\x8b"));
+        QVERIFY(!QFile::exists(name + ".1"));
+    }
+
+    void binaryLog()
+    {
+        QxtTemporaryDir dir;
+        const QString name = dir.path() + "/test.blog";
+        QxtBinaryFileLoggerEngine* file = new QxtBinaryFileLoggerEngine(name);
+        file->setBlockSize(4);
+        qxtLog->addLoggerEngine("binary", file);
+        for (int i = 0; i < 20; i++)
+            qxtLog->warning("repeated", i, 1.5);
+        qxtLog->error(QString(300, 'x'));
+        qxtLog->removeLoggerEngine("binary");
+
+        QxtBinaryLogReader reader(name);
+        QVERIFY2(reader.isOpen(), qPrintable(reader.errorString()));
+        for (int i = 0; i < 20; i++)
+        {
+            QVERIFY(reader.readNext());
+            QCOMPARE(reader.level(), QxtLogger::WarningLevel);
+            QCOMPARE(reader.messages(), QList<QVariant>() << QString("repeated") << i << 1.5);
+        }
+        QVERIFY(reader.readNext());
+        QCOMPARE(reader.level(), QxtLogger::ErrorLevel);
+        QCOMPARE(reader.messages().value(0).toString(), QString(300, 'x'));
+        QVERIFY(!reader.readNext());
+
+        QVERIFY(reader.seek(reader.timestamp()));
+        QVERIFY(reader.readNext());
+        QVERIFY(reader.timestamp().isValid());
+        QVERIFY(!reader.seek(reader.timestamp().addSecs(60)));
+
+        // without the index file the reader finds the blocks itself
+        QVERIFY(QFile::remove(name + ".idx"));
+        QVERIFY(reader.open(name));
+        QVERIFY(reader.seek(QDateTime::currentDateTime().addSecs(-60)));
+        QVERIFY(reader.readNext());
+        QCOMPARE(reader.messages().value(1).toInt(), 0);
+    }
+
+    void binaryLogOutOfOrder()
+    {
+        // messages written after later ones, as from a batch, are still found by seek()
+        QxtTemporaryDir dir;
+        const QString name = dir.path() + "/order.blog";
+        QxtBinaryFileLoggerEngine* file = new QxtBinaryFileLoggerEngine(name);
+        file->setBlockSize(2);
+        file->initLoggerEngine();
+        const qint64 times[] = { 1000, 5000, 2000, 3000, 4000, 6000 };
+        for (int i = 0; i < 6; i++)
+            writeAt(file, times[i], i);
+        delete file;
+
+        // an engine appending to the log knows the latest time already in it
+        file = new QxtBinaryFileLoggerEngine(name);
+        file->setBlockSize(2);
+        file->initLoggerEngine();
+        writeAt(file, 4500, 6);
+        delete file;
+
+        QxtBinaryLogReader reader(name);
+        QVERIFY2(reader.isOpen(), qPrintable(reader.errorString()));
+        QVERIFY(reader.seek(QDateTime::fromTime_t(4).addMSecs(500)));
+        QVERIFY(reader.readNext());
+        QCOMPARE(reader.msecsSinceEpoch(), qint64(5000));
+        QVERIFY(reader.seek(QDateTime::fromTime_t(5).addMSecs(500)));
+        QVERIFY(reader.readNext());
+        QCOMPARE(reader.msecsSinceEpoch(), qint64(6000));
+        QVERIFY(reader.readNext());
+        QCOMPARE(reader.msecsSinceEpoch(), qint64(4500));
+        QVERIFY(!reader.readNext());
+    }
+
+    void flightRecorder()
+    {
+        QxtTemporaryDir dir;
+        const QString name = dir.path() + "/test.flight";
+        QxtFlightRecorderLoggerEngine* recorder = new QxtFlightRecorderLoggerEngine(name, 4096);
+        qxtLog->addLoggerEngine("flight", recorder);
+        QVERIFY(recorder->isInitialized());
+        QVERIFY(qxtLog->isLevelEnabled(QxtLogger::TraceLevel));
+        for (int i = 0; i < 500; i++)
+            qxtLog->trace("step", i);
+        qxtLog->removeLoggerEngine("flight");
+
+        QVERIFY(QxtFlightRecorderLoggerEngine::isFlightRecorderFile(name));
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(QxtFlightRecorderLoggerEngine::dump(name, &buffer));
+        const QList<QByteArray> lines = buffer.data().split('\n');
+        QVERIFY(lines.count() > 10);
+        QVERIFY(lines.count() < 500);
+        QVERIFY(lines.at(lines.count() - 2).endsWith(" step 499"));
+        QVERIFY(lines.at(0).contains("[Trace]"));
+
+        // a new engine continues the same ring
+        recorder = new QxtFlightRecorderLoggerEngine(name, 4096);
+        qxtLog->addLoggerEngine("flight", recorder);
+        qxtLog->trace("restarted");
+        qxtLog->removeLoggerEngine("flight");
+        buffer.close();
+        buffer.setData(QByteArray());
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(QxtFlightRecorderLoggerEngine::dump(name, &buffer));
+        QVERIFY(buffer.data().contains(" step 499\n"));
+        QVERIFY(buffer.data().endsWith(" restarted\n"));
+    }
+
+    void jsonFile()
+    {
+        QxtTemporaryDir dir;
+        const QString name = dir.path() + "/test.jsonl";
+        qxtLog->addLoggerEngine("json", new QxtJsonFileLoggerEngine(name));
+        QVariantMap fields;
+        fields["id"] = 7;
+        fields["path"] = "C:\\tmp";
+        qxtLog->setThreadName("main");
+        qxtLog->warning(QString::fromUtf8("quote \" tab \t \xc3\xa9 \xf0\x9f\x98\x80"), -42, 0.1, true, fields);
+        qxtLog->error(QVariant(), QStringList() << "a" << "b");
+        qxtLog->removeLoggerEngine("json");
+
+        QFile log(name);
+        QVERIFY(log.open(QIODevice::ReadOnly));
+        const QList<QByteArray> lines = log.readAll().split('\n');
+        QCOMPARE(lines.count(), 3);
+        QVERIFY(lines.at(2).isEmpty());
+        QVERIFY2(lines.at(0).endsWith("\"level\":\"Warning\",\"thread\":\"main\",\"messages\":[\"quote \\\" tab \\t \xc3\xa9 \xf0\x9f\x98\x80\","
+                                      "-42,0.1,true,{\"id\":7,\"path\":\"C:\\\\tmp\"}]}"), lines.at(0).constData());
+        QVERIFY(QRegExp("\\{\"time\":\"\\d{4}-\\d\\d-\\d\\dT\\d\\d:\\d\\d:\\d\\d\\.\\d{3}Z\",.*").exactMatch(lines.at(0)));
+
+        const QVariantMap record = QxtJSON::parse(QString::fromUtf8(lines.at(1))).toMap();
+        QCOMPARE(record.value("level").toString(), QString("Error"));
+        QCOMPARE(record.value("messages").toList().count(), 2);
+        QVERIFY(record.value("messages").toList().at(0).isNull());
+        QCOMPARE(record.value("messages").toList().at(1).toStringList(), QStringList() << "a" << "b");
+    }
+
+    void threadIdentity()
+    {
+        LoggingThread thread;
+        qxtLog->setAsynchronous(true, 16);
+        thread.start();
+        thread.wait();
+        qxtLog->flush();
+        QCOMPARE(engine->lastThread, QString("worker"));
+
+        qxtLog->setThreadName("main");
+        qxtLog->warning("here");
+        qxtLog->setAsynchronous(false);
+        QCOMPARE(engine->lastThread, QString("main"));
+        QCOMPARE(qxtLog->threadName(), QString("main"));
+    }
+
+    void batching()
+    {
+        engine->enableLogLevels(QxtLogger::DebugLevel);
+        engine->count = 0;
+        qxtLog->setBatchSize(3);
+        qxtLog->debug() << 1;
+        qxtLog->debug() << 2;
+        QCOMPARE(engine->count, 0);
+        qxtLog->debug() << 3;
+        QCOMPARE(engine->count, 3);
+
+        qxtLog->debug("staged");
+        qxtLog->warning("in order");
+        QCOMPARE(engine->count, 5);
+        QCOMPARE(engine->lastLevel, QxtLogger::WarningLevel);
+
+        // staged records keep the time they were logged at
+        const QDateTime before = QDateTime::currentDateTime();
+        qxtLog->debug("staged");
+        QTest::qWait(50);
+        qxtLog->flush();
+        QCOMPARE(engine->count, 6);
+        QVERIFY(engine->lastTime - (before.toTime_t() * qint64(1000) + before.time().msec()) < 50);
+
+        // a finished thread hands over what it staged
+        LoggingThread thread;
+        thread.start();
+        thread.wait();
+        QCoreApplication::processEvents();  // synchronous logging from another thread is queued
+        QCOMPARE(engine->count, 8);
+
+        // an idle thread's records are submitted after the batch interval
+        qxtLog->setBatchInterval(20);
+        qxtLog->debug("idle");
+        QCOMPARE(engine->count, 8);
+        QTest::qWait(200);
+        QCOMPARE(engine->count, 9);
+        qxtLog->setBatchInterval(1000);
+
+        qxtLog->setBatchSize(1);
+        engine->disableLogLevels(QxtLogger::DebugLevel);
+    }
+
+    void rateLimiting()
+    {
+        engine->count = 0;
+        evaluations = 0;
+        for (int i = 0; i < 100; i++)
+            qxtLogStreamLimited(QxtLogger::WarningLevel, 1, 5) << expensive();
+        QCOMPARE(engine->count, 5);
+        QCOMPARE(evaluations, 5);
+
+        QxtLogRateLimiter limiter(QxtLogger::WarningLevel, 1000, 2);
+        QVERIFY(limiter.tryAcquire());
+        QVERIFY(limiter.tryAcquire());
+        QVERIFY(!limiter.tryAcquire());
+        QCOMPARE(limiter.suppressedCount(), 1);
+        QTest::qWait(20);
+        engine->count = 0;
+        QVERIFY(limiter.tryAcquire());
+        QCOMPARE(engine->count, 1);
+        QVERIFY(engine->lastMessages.value(0).toString().contains("suppressed 1 messages"));
+        QCOMPARE(limiter.suppressedCount(), 0);
+    }
+
+    void cleanupTestCase()
+    {
+        qxtLog->removeLoggerEngine("recorder");
+        qxtLog->enableLoggerEngine("DEFAULT");
+    }
+
+private:
+    RecordingEngine* engine;
+};
+
+QTEST_MAIN(QxtLoggerTest)
+#include "main.moc"
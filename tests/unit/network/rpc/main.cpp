@@ -4,11 +4,76 @@
 #include <QCoreApplication>
 #include <QTest>
 #include <QThread>
+#include <QTime>
 #include <QSignalSpy>
 #include <QBuffer>
 #include <QDebug>
 #include <QByteArray>
 #include <QTcpSocket>
+#include <QSet>
+#include <QxtTcpConnectionManager>
+#include <QxtLocalConnectionManager>
+#include <QxtSharedMemoryDevice>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPoint>
+#include <QxtDataStreamSignalSerializer>
+#include <QxtCompactSignalSerializer>
+#include <QxtRPCReply>
+
+// Holds everything written to it until drain() is called, like a socket whose peer reads slowly. A stalled device
+// does not drain while it is waited for, like a socket whose peer has stopped reading.
+class SlowDevice : public QIODevice
+{
+public:
+    QByteArray waiting;
+    QByteArray written;
+    bool stalled;
+
+    SlowDevice() : stalled(false) { open(QIODevice::ReadWrite); }
+    bool isSequential() const { return true; }
+    qint64 bytesToWrite() const { return waiting.size(); }
+    bool waitForBytesWritten(int msecs)
+    {
+        if (stalled) {
+            QTest::qSleep(msecs < 0 ? 1000 : msecs);
+            return false;
+        }
+        drain();
+        return true;
+    }
+
+    void drain()
+    {
+        const qint64 count = waiting.size();
+        written += waiting;
+        waiting.clear();
+        if (count)
+            emit bytesWritten(count);
+    }
+
+    // The first argument of every "data" call that reached the peer.
+    QList<int> received() const
+    {
+        QxtDataStreamSignalSerializer serializer;
+        QList<int> rv;
+        int offset = 0;
+        while (serializer.canDeserialize(written, offset)) {
+            QxtAbstractSignalSerializer::DeserializedData data = serializer.deserialize(written, offset);
+            if (data.first == "data")
+                rv << data.second.at(0).toInt();
+        }
+        return rv;
+    }
+
+protected:
+    qint64 readData(char*, qint64) { return 0; }
+    qint64 writeData(const char* data, qint64 len)
+    {
+        waiting.append(QByteArray(data, int(len)));
+        return len;
+    }
+};
 
 class RPCTest: public QObject
 {
@@ -19,10 +84,33 @@ public:
 private:
     quint64 client_id;
 
+public slots:
+    int add(int a, int b)
+    {
+        return a + b;
+    }
+
+    QVariant echo(const QVariant& value)
+    {
+        return value;
+    }
+
+    // The same slots as attached on a server, which passes the client ID first.
+    int add(quint64, int a, int b)
+    {
+        return a + b;
+    }
+
+    QVariant echo(quint64, const QVariant& value)
+    {
+        return value;
+    }
+
 signals:
     void wave(QString);
     void counterwave(QString);
     void networkedwave(quint64,QString);
+    void payload(QByteArray);
 
 
 private slots:
@@ -88,6 +176,430 @@ private slots:
         QVERIFY2(arguments.at(0).toString()=="world","argument missmatch");
     }
 
+    void serializerCursor()
+    {
+        QxtDataStreamSignalSerializer serializer;
+        QByteArray buffer;
+        for (int i = 0; i < 100; i++)
+            buffer += serializer.serialize("wave(QString)", QString::number(i));
+        const QByteArray copy = buffer;
+
+        int offset = 0;
+        for (int i = 0; i < 100; i++)
+        {
+            QVERIFY(serializer.canDeserialize(buffer, offset));
+            QxtAbstractSignalSerializer::DeserializedData data = serializer.deserialize(buffer, offset);
+            QCOMPARE(data.first, QString("wave(QString)"));
+            QCOMPARE(data.second.value(0).toString(), QString::number(i));
+        }
+        QCOMPARE(offset, buffer.size());
+        QVERIFY(!serializer.canDeserialize(buffer, offset));
+        QVERIFY(buffer == copy);
+
+        // a partial length header is not a message
+        QVERIFY(!serializer.canDeserialize(QByteArray("\x05\x00", 2)));
+        QVERIFY(!serializer.canDeserialize(copy.left(copy.size() / 100 - 1)));
+
+        // the consuming overload still works
+        QByteArray consumed = copy;
+        serializer.deserialize(consumed);
+        QCOMPARE(consumed.size(), copy.size() / 100 * 99);
+    }
+
+    void burst()
+    {
+        QxtFifo* fifo = new QxtFifo;
+        QxtRPCService peer(fifo, 0);
+        QVERIFY2(peer.attachSlot (SIGNAL(wave(QString)), this, SIGNAL(counterwave(QString))), "cannot attach slot");
+        QSignalSpy spy(this, SIGNAL(counterwave(QString)));
+
+        QByteArray burst;
+        QxtDataStreamSignalSerializer serializer;
+        for (int i = 0; i < 1000; i++)
+            burst += serializer.serialize("wave(QString)", QString::number(i));
+        // deliver the burst in pieces that split messages and headers
+        for (int pos = 0; pos < burst.size(); pos += 333)
+        {
+            fifo->write(burst.mid(pos, 333));
+            QCoreApplication::processEvents();
+        }
+        QCoreApplication::processEvents();
+
+        QCOMPARE(spy.count(), 1000);
+        QCOMPARE(spy.at(999).at(0).toString(), QString("999"));
+    }
+
+    void methodIds()
+    {
+        QxtDataStreamSignalSerializer serializer;
+        QVERIFY(serializer.supportsMethodIds());
+        const QByteArray numbered = serializer.serialize(quint32(70000), QString("world"));
+        QVERIFY(numbered.size() < serializer.serialize("wave(QString)", QString("world")).size());
+        int offset = 0;
+        quint32 methodId = 0;
+        QxtAbstractSignalSerializer::DeserializedData data = serializer.deserialize(numbered, offset, &methodId);
+        QCOMPARE(methodId, quint32(70000));
+        QVERIFY(data.first.isNull());
+        QCOMPARE(data.second.value(0).toString(), QString("world"));
+        QCOMPARE(offset, numbered.size());
+        offset = 0;
+        data = serializer.deserialize(serializer.serialize("wave(QString)"), offset, &methodId);
+        QCOMPARE(methodId, quint32(QxtSignalSerializerExtension::NoMethodId));
+        QCOMPARE(data.first, QString("wave(QString)"));
+
+        // callers that do not ask for numbered messages cannot receive them
+        QByteArray buffer = numbered;
+        QVERIFY(serializer.isProtocolError(serializer.deserialize(buffer)));
+        offset = 0;
+        QVERIFY(serializer.isProtocolError(serializer.deserialize(numbered, offset)));
+
+        // the peer talks to itself, so it negotiates IDs with itself and later calls are numbered
+        QxtRPCService peer(new QxtFifo, 0);
+        QVERIFY2(peer.attachSlot (SIGNAL(wave(QString)), this, SIGNAL(counterwave(QString))), "cannot attach slot");
+        QSignalSpy spy(this, SIGNAL(counterwave(QString)));
+        QCoreApplication::processEvents();
+        for (int i = 0; i < 10; i++)
+        {
+            peer.call(SIGNAL(wave(QString)), QString::number(i));
+            QCoreApplication::processEvents();
+        }
+        QCoreApplication::processEvents();
+        QCOMPARE(spy.count(), 10);
+        QCOMPARE(spy.at(9).at(0).toString(), QString("9"));
+
+        // IDs of functions without slots are only marked, and a peer cannot define more IDs than there are functions
+        QxtFifo* fifo = new QxtFifo;
+        QxtRPCService target(fifo, 0);
+        QVERIFY2(target.attachSlot (SIGNAL(wave(QString)), this, SIGNAL(counterwave(QString))), "cannot attach slot");
+        for (int i = 0; i < 100; i++)
+            fifo->write(serializer.serialize("_qxt_rpc_define_method", quint32(i), QString("unknown%1").arg(i)));
+        fifo->write(serializer.serialize(quint32(50), QString("ignored")));
+        fifo->write(serializer.serialize("_qxt_rpc_define_method", quint32(100), QString("wave(QString)")));
+        fifo->write(serializer.serialize(quint32(100), QString("numbered")));
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+        QVERIFY(target.isClient());
+        QCOMPARE(spy.count(), 11);
+        QCOMPARE(spy.at(10).at(0).toString(), QString("numbered"));
+        fifo->write(serializer.serialize("_qxt_rpc_define_method", quint32(101), QString("wave(QString)")));
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+        QVERIFY(!target.isClient());
+    }
+
+    void corked()
+    {
+        QxtRPCService peer(new QxtFifo, 0);
+        QVERIFY2(peer.attachSlot (SIGNAL(wave(QString)), this, SIGNAL(counterwave(QString))), "cannot attach slot");
+        QSignalSpy spy(this, SIGNAL(counterwave(QString)));
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+        QCOMPARE(peer.device()->bytesAvailable(), qint64(0));
+
+        peer.setCorked(true);
+        QVERIFY(peer.isCorked());
+        for (int i = 0; i < 100; i++)
+            peer.call(SIGNAL(wave(QString)), QString::number(i));
+        QCOMPARE(peer.device()->bytesAvailable(), qint64(0));
+
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+        QCOMPARE(spy.count(), 100);
+        QCOMPARE(spy.at(99).at(0).toString(), QString("99"));
+
+        // flush() and the threshold do not wait for the event loop
+        peer.call(SIGNAL(wave(QString)), QString("now"));
+        QCOMPARE(peer.device()->bytesAvailable(), qint64(0));
+        peer.flush();
+        QVERIFY(peer.device()->bytesAvailable() > 0);
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+        QCOMPARE(spy.count(), 101);
+
+        peer.setCorkThreshold(1);
+        peer.call(SIGNAL(wave(QString)), QString("small"));
+        QVERIFY(peer.device()->bytesAvailable() > 0);
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+        QCOMPARE(spy.count(), 102);
+    }
+
+    void compactSerializer()
+    {
+        QxtCompactSignalSerializer serializer;
+        QxtDataStreamSignalSerializer reference;
+        const QByteArray named = serializer.serialize("wave(QString)", QString("world"), -5, qlonglong(1) << 40,
+                2.5, QByteArray("bytes"), QString(), true, QVariant(QPoint(3, 4)));
+        QVERIFY(named.size() < reference.serialize("wave(QString)", QString("world"), -5, qlonglong(1) << 40,
+                2.5, QByteArray("bytes"), QString(), true, QVariant(QPoint(3, 4))).size());
+
+        QByteArray buffer = named + serializer.serialize(quint32(300), 1u);
+        QVERIFY(serializer.canDeserialize(buffer));
+        QVERIFY(!serializer.canDeserialize(named.left(named.size() - 1)));
+
+        int offset = 0;
+        QxtAbstractSignalSerializer::DeserializedData data = serializer.deserialize(buffer, offset);
+        QCOMPARE(offset, named.size());
+        QCOMPARE(data.first, QString("wave(QString)"));
+        QCOMPARE(data.second.count(), 8);
+        QCOMPARE(data.second.at(0), QVariant(QString("world")));
+        QCOMPARE(data.second.at(1), QVariant(-5));
+        QCOMPARE(data.second.at(2), QVariant(qlonglong(1) << 40));
+        QCOMPARE(data.second.at(3), QVariant(2.5));
+        QCOMPARE(data.second.at(4), QVariant(QByteArray("bytes")));
+        QVERIFY(data.second.at(5).toString().isNull());
+        QCOMPARE(data.second.at(6), QVariant(true));
+        QCOMPARE(data.second.at(7), QVariant(QPoint(3, 4)));
+
+        quint32 methodId = 0;
+        data = serializer.deserialize(buffer, offset, &methodId);
+        QVERIFY(data.first.isNull());
+        QCOMPARE(methodId, quint32(300));
+        QCOMPARE(data.second.value(0), QVariant(1u));
+        QCOMPARE(offset, buffer.size());
+
+        // a truncated frame is an error, not a crash
+        QByteArray broken = named;
+        broken[0] = char(named.size() - 3);
+        broken.chop(2);
+        QVERIFY(serializer.isProtocolError(serializer.deserialize(broken)));
+
+        QxtRPCService peer;
+        peer.setSerializer(new QxtCompactSignalSerializer);
+        peer.setDevice(new QxtFifo);
+        QVERIFY2(peer.attachSlot (SIGNAL(wave(QString)), this, SIGNAL(counterwave(QString))), "cannot attach slot");
+        QSignalSpy spy(this, SIGNAL(counterwave(QString)));
+        QCoreApplication::processEvents();
+        for (int i = 0; i < 3; i++)
+        {
+            peer.call(SIGNAL(wave(QString)), QString::number(i));
+            QCoreApplication::processEvents();
+        }
+        QCOMPARE(spy.count(), 3);
+
+        // nothing is written before the first call, so the serializer can be set after the device
+        QxtRPCService late(new QxtFifo, 0);
+        late.setSerializer(new QxtCompactSignalSerializer);
+        QVERIFY2(late.attachSlot (SIGNAL(wave(QString)), this, SIGNAL(counterwave(QString))), "cannot attach slot");
+        QCoreApplication::processEvents();
+        QCOMPARE(late.device()->bytesAvailable(), qint64(0));
+        late.call(SIGNAL(wave(QString)), QString("late"));
+        QCoreApplication::processEvents();
+        QCOMPARE(spy.count(), 4);
+        QVERIFY(late.device() != 0);
+    }
+
+    void compression()
+    {
+        QxtRPCService peer(new QxtFifo, 0);
+        QVERIFY2(peer.attachSlot (SIGNAL(payload(QByteArray)), this, SIGNAL(payload(QByteArray))), "cannot attach slot");
+        QSignalSpy spy(this, SIGNAL(payload(QByteArray)));
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+
+        // measure the messages by holding them back until flush()
+        peer.setCorked(true);
+        const QByteArray large(100000, 'x');
+        peer.call(SIGNAL(payload(QByteArray)), large);
+        peer.flush();
+        const qint64 plain = peer.device()->bytesAvailable();
+        QVERIFY(plain > 100000);
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+
+        peer.setCompressionEnabled(true);
+        QVERIFY(peer.isCompressionEnabled());
+        peer.call(SIGNAL(payload(QByteArray)), large);
+        peer.flush();
+        QVERIFY(peer.device()->bytesAvailable() < plain / 10);
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+
+        // below the threshold nothing changes
+        peer.call(SIGNAL(payload(QByteArray)), QByteArray("small"));
+        QCoreApplication::processEvents();
+        QCoreApplication::processEvents();
+
+        QCOMPARE(spy.count(), 3);
+        QVERIFY(spy.at(0).at(0).toByteArray() == large);
+        QVERIFY(spy.at(1).at(0).toByteArray() == large);
+        QCOMPARE(spy.at(2).at(0).toByteArray(), QByteArray("small"));
+    }
+
+    void replies()
+    {
+        QxtRPCService peer(new QxtFifo, 0);
+        QVERIFY2(peer.attachSlot("add", this, SLOT(add(int, int))), "cannot attach slot");
+
+        // several calls are outstanding at once
+        QxtRPCReply* first = peer.callWithReply("add", 1, 2);
+        QxtRPCReply* second = peer.callWithReply("add", 40, 2);
+        QxtRPCReply* missing = peer.callWithReply("subtract", 1, 2);
+        QVERIFY(first->correlationId() != second->correlationId());
+        QVERIFY(!first->isFinished());
+
+        QVERIFY(missing->waitForFinished(5000));
+        QVERIFY(first->isFinished());
+        QVERIFY(second->isFinished());
+        QCOMPARE(first->error(), QxtRPCReply::NoError);
+        QCOMPARE(first->result().toInt(), 3);
+        QCOMPARE(second->result().toInt(), 42);
+        QCOMPARE(missing->error(), QxtRPCReply::NotHandledError);
+
+        // nobody answers on a plain buffer
+        QBuffer* buffer = new QBuffer;
+        buffer->open(QIODevice::ReadWrite);
+        QxtRPCService silent(buffer, 0);
+        silent.setReplyTimeout(10);
+        QxtRPCReply* late = silent.callWithReply("add", 1, 2);
+        QSignalSpy timedOut(late, SIGNAL(timedOut()));
+        QVERIFY(late->waitForFinished(5000));
+        QCOMPARE(late->error(), QxtRPCReply::TimeoutError);
+        QCOMPARE(timedOut.count(), 1);
+
+        // a reply that cannot be sent fails, and so does one whose connection goes away
+        QxtRPCService unconnected;
+        QxtRPCReply* nowhere = unconnected.callWithReply("add", 1, 2);
+        QVERIFY(!nowhere->isFinished());
+        QVERIFY(nowhere->waitForFinished(5000));
+        QCOMPARE(nowhere->error(), QxtRPCReply::DisconnectedError);
+
+        silent.setReplyTimeout(0);
+        QxtRPCReply* dropped = silent.callWithReply("add", 1, 2);
+        delete silent.takeDevice();
+        QVERIFY(dropped->isFinished());
+        QCOMPARE(dropped->error(), QxtRPCReply::DisconnectedError);
+    }
+
+    void directDispatch()
+    {
+        QxtRPCService peer(new QxtFifo, 0);
+        QVERIFY2(peer.attachSlot("add", this, SLOT(add(int, int))), "cannot attach slot");
+        QVERIFY2(peer.attachSlot("echo", this, SLOT(echo(QVariant))), "cannot attach slot");
+        QVERIFY2(!peer.attachSlot("missing", this, SLOT(missing(int))), "attached a missing slot");
+
+        // arguments of another type are converted to the parameter type
+        QxtRPCReply* converted = peer.callWithReply("add", QString("20"), qlonglong(22));
+        // QVariant parameters and return values pass the value as it is
+        QxtRPCReply* echoed = peer.callWithReply("echo", QByteArray("raw"));
+        QVERIFY(echoed->waitForFinished(5000));
+        QVERIFY(converted->isFinished());
+        QCOMPARE(converted->result(), QVariant(42));
+        QCOMPARE(echoed->result(), QVariant(QByteArray("raw")));
+
+        // a call that no attached slot accepts is not handled
+        QxtRPCReply* mismatched = peer.callWithReply("add", QPoint(1, 2), 3);
+        QVERIFY(mismatched->waitForFinished(5000));
+        QCOMPARE(mismatched->error(), QxtRPCReply::NotHandledError);
+    }
+
+    void backpressure()
+    {
+        const QByteArray filler(300, 'x');
+        SlowDevice* dev = new SlowDevice;
+        QxtRPCService peer(dev, 0);
+        peer.setWatermarks(100, 2000);
+        peer.setCongestionPolicy(QxtRPCService::DropOldest);
+        QSignalSpy congested(&peer, SIGNAL(congested(quint64)));
+        QSignalSpy decongested(&peer, SIGNAL(decongested(quint64)));
+
+        for (int i = 0; i < 20; i++)
+            peer.call("data", i, filler);
+        QVERIFY(peer.isCongested());
+        QVERIFY(dev->bytesToWrite() <= 2000);
+
+        // congested connections are left out of broadcasts on request
+        peer.setSkipCongested(true);
+        peer.call("data", 100, filler);
+
+        // what has been held back goes out once the device has drained
+        dev->drain();
+        QVERIFY(!peer.isCongested());
+        dev->drain();
+        QList<int> received = dev->received();
+        QVERIFY(received.count() < 20);
+        QCOMPARE(received.last(), 19);
+        for (int i = 1; i < received.count(); i++)
+            QVERIFY(received.at(i - 1) < received.at(i));
+        peer.call("data", 101, filler);
+        QVERIFY(dev->bytesToWrite() > 0);
+        dev->drain();
+        QCOMPARE(dev->received().last(), 101);
+
+        QCoreApplication::processEvents();
+        QCOMPARE(congested.count(), 1);
+        QCOMPARE(decongested.count(), 1);
+        QCOMPARE(congested.at(0).at(0).value<quint64>(), quint64(0));
+
+        // a dropped call finishes its reply instead of leaving it to time out
+        SlowDevice* replying = new SlowDevice;
+        QxtRPCService caller(replying, 0);
+        caller.setWatermarks(100, 2000);
+        caller.setCongestionPolicy(QxtRPCService::DropOldest);
+        caller.setReplyTimeout(0);
+        QList<QxtRPCReply*> calls;
+        for (int i = 0; i < 20; i++)
+            calls << caller.callWithReply("data", i, filler);
+        QCoreApplication::processEvents();
+        int droppedCalls = 0;
+        foreach (QxtRPCReply* reply, calls) {
+            if (reply->isFinished()) {
+                QCOMPARE(reply->error(), QxtRPCReply::DroppedError);
+                droppedCalls++;
+            }
+        }
+        QVERIFY(droppedCalls > 0);
+        QVERIFY(!calls.last()->isFinished());
+
+        // blocking waits for the device instead of dropping anything
+        SlowDevice* blocking = new SlowDevice;
+        QxtRPCService waiting(blocking, 0);
+        waiting.setWatermarks(100, 2000);
+        for (int i = 0; i < 20; i++) {
+            waiting.call("data", i, filler);
+            QVERIFY(blocking->bytesToWrite() <= 2000 + 400);
+        }
+        blocking->drain();
+        QCOMPARE(blocking->received().count(), 20);
+
+        // a peer that stops reading holds up one call for the timeout, and calls to it are held back afterwards
+        SlowDevice* stalled = new SlowDevice;
+        stalled->stalled = true;
+        QxtRPCService stuck(stalled, 0);
+        stuck.setWatermarks(100, 2000);
+        stuck.setCongestionTimeout(50);
+        QCOMPARE(stuck.congestionTimeout(), 50);
+        QSignalSpy stuckCongested(&stuck, SIGNAL(congested(quint64)));
+        QSignalSpy stuckDecongested(&stuck, SIGNAL(decongested(quint64)));
+        QTime clock;
+        clock.start();
+        for (int i = 0; i < 20; i++)
+            stuck.call("data", i, filler);
+        QVERIFY(clock.elapsed() < 1000);
+        QVERIFY(stuck.isCongested());
+        QVERIFY(stalled->bytesToWrite() <= 2000 + 400);
+        stalled->drain();
+        QVERIFY(!stuck.isCongested());
+        stalled->drain();
+        QList<int> stuckReceived = stalled->received();
+        QVERIFY(stuckReceived.count() < 20);
+        QCOMPARE(stuckReceived.last(), 19);
+        QCoreApplication::processEvents();
+        QCOMPARE(stuckCongested.count(), 1);
+        QCOMPARE(stuckDecongested.count(), 1);
+
+        // a congested connection can be closed instead
+        SlowDevice* closing = new SlowDevice;
+        QxtRPCService closer(closing, 0);
+        closer.setWatermarks(100, 2000);
+        closer.setCongestionPolicy(QxtRPCService::Disconnect);
+        for (int i = 0; i < 20; i++)
+            closer.call("data", i, filler);
+        QVERIFY(closer.isCongested());
+        QCoreApplication::processEvents();
+        QVERIFY(!closer.isClient());
+    }
+
     void TcpServerIo()
     {
         QxtRPCPeer server;
@@ -166,6 +678,128 @@ private slots:
         QVERIFY(!client.isClient());
     }
 
+    void ShardedTcpServer()
+    {
+        QxtTcpConnectionManager* manager = new QxtTcpConnectionManager(0);
+        manager->setIoThreadCount(2);
+        QCOMPARE(manager->ioThreadCount(), 2);
+
+        // one service per I/O thread
+        QList<QxtRPCService*> services;
+        for (int i = 0; i < manager->ioThreadCount(); i++) {
+            QxtRPCService* service = new QxtRPCService;
+            service->moveToThread(manager->ioThread(i));
+            service->setConnectionManager(manager->shard(i));
+            QVERIFY2(service->attachSlot(SIGNAL(wave(QString)), this, SIGNAL(networkedwave(quint64,QString))),
+                     "cannot attach slot");
+            services << service;
+        }
+        QVERIFY(manager->listen(QHostAddress::LocalHost, 23445));
+
+        QSignalSpy spy(this, SIGNAL(networkedwave(quint64,QString)));
+        QSignalSpy back(this, SIGNAL(counterwave(QString)));
+        QList<QxtRPCService*> clients;
+        for (int i = 0; i < 4; i++) {
+            QTcpSocket* socket = new QTcpSocket;
+            socket->connectToHost(QHostAddress::LocalHost, 23445);
+            QVERIFY(socket->waitForConnected(30000));
+            QxtRPCService* client = new QxtRPCService(socket, 0);
+            QVERIFY2(client->attachSlot("back", this, SIGNAL(counterwave(QString))), "cannot attach slot");
+            client->call(SIGNAL(wave(QString)), QString::number(i));
+            clients << client;
+        }
+        for (int i = 0; i < 500 && spy.count() < 4; i++)
+            QTest::qWait(10);
+        QCOMPARE(spy.count(), 4);
+
+        // client IDs are unique, and the connections are spread over both threads
+        QSet<quint64> ids;
+        QSet<int> shards;
+        for (int i = 0; i < spy.count(); i++) {
+            const quint64 id = spy.at(i).at(0).value<quint64>();
+            ids << id;
+            shards << QxtTcpConnectionManager::shardOf(id);
+        }
+        QCOMPARE(ids.count(), 4);
+        QVERIFY(shards == QSet<int>() << 0 << 1);
+
+        // a call is routed to the thread owning the client by its ID
+        const quint64 id = spy.at(0).at(0).value<quint64>();
+        QMetaObject::invokeMethod(services.at(QxtTcpConnectionManager::shardOf(id)), "call", Qt::QueuedConnection,
+                                  Q_ARG(quint64, id), Q_ARG(QString, QString("back")),
+                                  Q_ARG(QVariant, QVariant(QString("hello"))));
+        for (int i = 0; i < 500 && back.count() < 1; i++)
+            QTest::qWait(10);
+        QCOMPARE(back.count(), 1);
+        QCOMPARE(back.at(0).at(0).toString(), QString("hello"));
+
+        qDeleteAll(clients);
+        foreach (QxtRPCService* service, services)
+            service->deleteLater();
+        // stops the I/O threads, which delete the services as they finish
+        delete manager;
+    }
+
+    void LocalServerIo()
+    {
+        const QString name = QString("qxt-rpc-test-%1").arg(QCoreApplication::applicationPid());
+        QLocalServer::removeServer(name);
+        QxtRPCService server;
+        QxtLocalConnectionManager* manager = new QxtLocalConnectionManager(0);
+        server.setConnectionManager(manager);
+        QVERIFY2(server.attachSlot(SIGNAL(wave(QString)), this, SIGNAL(networkedwave(quint64,QString))),
+                 "cannot attach slot");
+        QVERIFY(manager->listen(name));
+
+        QSignalSpy spy(this, SIGNAL(networkedwave(quint64,QString)));
+        QLocalSocket* socket = new QLocalSocket;
+        socket->connectToServer(name);
+        QVERIFY(socket->waitForConnected(30000));
+        QxtRPCService client(socket, 0);
+        client.call(SIGNAL(wave(QString)), QString("local"));
+        for (int i = 0; i < 500 && spy.count() < 1; i++)
+            QTest::qWait(10);
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(spy.at(0).at(1).toString(), QString("local"));
+    }
+
+    void SharedMemoryIo()
+    {
+        const QString name = QString("qxt-rpc-shm-test-%1").arg(QCoreApplication::applicationPid());
+        QLocalServer::removeServer(name);
+        QxtRPCService server;
+        QxtLocalConnectionManager* manager = new QxtLocalConnectionManager(0);
+        manager->setSharedMemoryEnabled(true);
+        server.setConnectionManager(manager);
+        QVERIFY2(server.attachSlot("add", this, SLOT(add(quint64, int, int))), "cannot attach slot");
+        QVERIFY2(server.attachSlot("echo", this, SLOT(echo(quint64, QVariant))), "cannot attach slot");
+        QVERIFY(manager->listen(name));
+
+        QxtSharedMemoryDevice* device = new QxtSharedMemoryDevice;
+        QVERIFY2(device->connectToServer(name, 4096), qPrintable(device->errorString()));
+        QCOMPARE(device->ringSize(), 4096);
+        QxtRPCService client(device, 0);
+
+        QxtRPCReply* sum = client.callWithReply("add", 2, 40);
+        QVERIFY(sum->waitForFinished(5000));
+        QCOMPARE(sum->result(), QVariant(42));
+
+        // messages larger than the rings wait for room in both directions
+        const QByteArray big(20000, 'x');
+        QxtRPCReply* echoed = client.callWithReply("echo", big);
+        QVERIFY(device->bytesToWrite() > 0);
+        QVERIFY(echoed->waitForFinished(5000));
+        QCOMPARE(echoed->result().toByteArray(), big);
+        QCOMPARE(device->bytesToWrite(), qint64(0));
+
+        // the server notices when the client goes away
+        QSignalSpy gone(&server, SIGNAL(clientDisconnected(quint64)));
+        client.disconnectServer();
+        for (int i = 0; i < 500 && gone.count() < 1; i++)
+            QTest::qWait(10);
+        QCOMPARE(gone.count(), 1);
+    }
+
     void cleanupTestCase()
     {}
 };
@@ -0,0 +1,251 @@
+#include <QTest>
+#include <QTcpSocket>
+#include <QTcpServer>
+#include <QTime>
+#include <QRegExp>
+#include <QxtHttpSessionManager>
+#include <QxtHttpServerConnector>
+#include <QxtAbstractWebService>
+#include <QxtWebEvent>
+#include <QxtWebContent>
+
+// Answers every request with the size of its body, once the body is complete.
+class SizeService : public QxtAbstractWebService
+{
+Q_OBJECT
+public:
+    SizeService(QxtAbstractWebSessionManager* manager) : QxtAbstractWebService(manager, manager), event(0), requests(0) {}
+    ~SizeService() { delete event; }
+
+    QxtWebRequestEvent* event;
+    QByteArray body;
+    int requests;
+
+    void pageRequestedEvent(QxtWebRequestEvent* e)
+    {
+        delete event;
+        event = e;
+        body.clear();
+        requests++;
+        if (!event->content)
+        {
+            reply();
+            return;
+        }
+        connect(event->content, SIGNAL(readyRead()), this, SLOT(readContent()));
+        readContent();
+    }
+
+private slots:
+    void readContent()
+    {
+        body += event->content->readAll();
+        if (event->content->unreadBytes() == 0)
+            reply();
+    }
+
+private:
+    void reply()
+    {
+        postEvent(new QxtWebPageEvent(event->sessionID, event->requestID, QByteArray::number(body.size())));
+    }
+};
+
+// A connector that writes its response headers itself.
+class CustomConnector : public QxtHttpServerConnector
+{
+public:
+    CustomConnector(QObject* parent) : QxtHttpServerConnector(parent), writes(0) { setHeaderFormat(CustomHeaders); }
+
+    int writes;
+    QHttpResponseHeader last;
+
+protected:
+    void writeHeaders(QIODevice* device, const QHttpResponseHeader& header)
+    {
+        writes++;
+        last = header;
+        QxtHttpServerConnector::writeHeaders(device, header);
+    }
+};
+
+class Test : public QObject
+{
+Q_OBJECT
+private:
+    QxtHttpSessionManager* manager;
+    QxtHttpServerConnector* connector;
+    SizeService* service;
+    quint16 port;
+
+    // Processes events until the client has been disconnected by the server, and returns what it received.
+    static QByteArray response(QTcpSocket& client, int msecs = 5000)
+    {
+        QByteArray data;
+        QTime timer;
+        timer.start();
+        while (client.state() != QAbstractSocket::UnconnectedState && timer.elapsed() < msecs)
+        {
+            QTest::qWait(10);
+            data += client.readAll();
+        }
+        return data + client.readAll();
+    }
+
+    bool waitForConnections(int count, int msecs = 5000)
+    {
+        QTime timer;
+        timer.start();
+        while (connector->connectionCount() != count && timer.elapsed() < msecs)
+            QTest::qWait(10);
+        return connector->connectionCount() == count;
+    }
+
+private slots:
+    void init()
+    {
+        manager = new QxtHttpSessionManager;
+        connector = new QxtHttpServerConnector(manager);
+        manager->setConnector(connector);
+        service = new SizeService(manager);
+        manager->setStaticContentService(service);
+        manager->setListenInterface(QHostAddress::LocalHost);
+        manager->setPort(0);
+        QVERIFY(manager->start());
+        port = connector->tcpServer()->serverPort();
+    }
+
+    void cleanup()
+    {
+        delete manager;
+    }
+
+    void request()
+    {
+        QTcpSocket client;
+        client.connectToHost(QHostAddress::LocalHost, port);
+        QVERIFY(client.waitForConnected(5000));
+        client.write("GET / HTTP/1.0\r\n\r\n");
+        QByteArray data = response(client);
+        QVERIFY(data.startsWith("HTTP/1.0 200"));
+        QVERIFY(data.endsWith("\r\n\r\n0"));
+    }
+
+    void dateHeader()
+    {
+        QCOMPARE(connector->headerFormat(), QxtAbstractHttpConnector::HttpHeaders);
+        QTcpSocket client;
+        client.connectToHost(QHostAddress::LocalHost, port);
+        QVERIFY(client.waitForConnected(5000));
+        client.write("GET / HTTP/1.0\r\n\r\n");
+        QByteArray data = response(client);
+        QRegExp date("\r\nDate: \\w{3}, \\d\\d \\w{3} \\d{4} \\d\\d:\\d\\d:\\d\\d GMT\r\n");
+        QVERIFY2(date.indexIn(QString::fromLatin1(data)) > 0, data.constData());
+    }
+
+    void customHeaders()
+    {
+        // a connector with its own writeHeaders() receives the same Date header
+        QxtHttpSessionManager custom;
+        CustomConnector* customConnector = new CustomConnector(&custom);
+        custom.setConnector(customConnector);
+        custom.setStaticContentService(new SizeService(&custom));
+        custom.setListenInterface(QHostAddress::LocalHost);
+        custom.setPort(0);
+        QVERIFY(custom.start());
+
+        QTcpSocket client;
+        client.connectToHost(QHostAddress::LocalHost, customConnector->tcpServer()->serverPort());
+        QVERIFY(client.waitForConnected(5000));
+        client.write("GET / HTTP/1.0\r\n\r\n");
+        QByteArray data = response(client);
+        QVERIFY(data.startsWith("HTTP/1.0 200"));
+        QCOMPARE(customConnector->writes, 1);
+        QVERIFY(customConnector->last.hasKey("Date"));
+        QVERIFY(customConnector->last.value("Date").endsWith(" GMT"));
+    }
+
+    void headerTooLarge()
+    {
+        connector->setMaxHeaderSize(1024);
+        QTcpSocket client;
+        client.connectToHost(QHostAddress::LocalHost, port);
+        QVERIFY(client.waitForConnected(5000));
+        client.write("GET / HTTP/1.0\r\nX-Padding: " + QByteArray(2048, 'x'));
+        QByteArray data = response(client);
+        QVERIFY(data.startsWith("HTTP/1.1 431"));
+        QCOMPARE(service->requests, 0);
+    }
+
+    void bodyNotCountedAsHeader()
+    {
+        // The body arrives after the request has been dispatched, and is larger than the header limit.
+        connector->setMaxHeaderSize(1024);
+        QTcpSocket client;
+        client.connectToHost(QHostAddress::LocalHost, port);
+        QVERIFY(client.waitForConnected(5000));
+        client.write("POST / HTTP/1.0\r\nContent-Length: 4096\r\n\r\n" + QByteArray(16, 'x'));
+        QTime timer;
+        timer.start();
+        while (!service->requests && timer.elapsed() < 5000)
+            QTest::qWait(10);
+        QCOMPARE(service->requests, 1);
+        client.write(QByteArray(4096 - 16, 'x'));
+        QByteArray data = response(client);
+        QVERIFY(data.startsWith("HTTP/1.0 200"));
+        QVERIFY(data.endsWith("\r\n\r\n4096"));
+    }
+
+    void readTimeout()
+    {
+        connector->setReadTimeout(1000);
+        QTcpSocket client;
+        client.connectToHost(QHostAddress::LocalHost, port);
+        QVERIFY(client.waitForConnected(5000));
+        client.write("GET / HTTP/1.0\r\n");
+        QTime timer;
+        timer.start();
+        QByteArray data = response(client);
+        QVERIFY(timer.elapsed() < 5000);
+        QVERIFY(data.startsWith("HTTP/1.1 408"));
+        QCOMPARE(service->requests, 0);
+    }
+
+    void idleTimeout()
+    {
+        connector->setIdleTimeout(1000);
+        QTcpSocket client;
+        client.connectToHost(QHostAddress::LocalHost, port);
+        QVERIFY(client.waitForConnected(5000));
+        QTime timer;
+        timer.start();
+        QByteArray data = response(client);
+        QVERIFY(timer.elapsed() < 5000);
+        QVERIFY(data.isEmpty());
+        QVERIFY(waitForConnections(0));
+    }
+
+    void maxConnections()
+    {
+        connector->setMaxConnections(1);
+        QTcpSocket first, second;
+        first.connectToHost(QHostAddress::LocalHost, port);
+        QVERIFY(first.waitForConnected(5000));
+        QVERIFY(waitForConnections(1));
+        second.connectToHost(QHostAddress::LocalHost, port);
+        QVERIFY(second.waitForConnected(5000));
+        second.write("GET / HTTP/1.0\r\n\r\n");
+        QTest::qWait(200);
+        QCOMPARE(connector->connectionCount(), 1);
+        QCOMPARE(service->requests, 0);
+
+        // The pending connection is accepted once the first one is closed.
+        first.disconnectFromHost();
+        QByteArray data = response(second);
+        QVERIFY(data.startsWith("HTTP/1.0 200"));
+        QCOMPARE(service->requests, 1);
+    }
+};
+
+QTEST_MAIN(Test)
+#include "main.moc"
@@ -0,0 +1,10 @@
+TARGET = binlog-tool
+DEPENDPATH += .
+INCLUDEPATH += .
+CONFIG += qxt console
+CONFIG -= app_bundle
+QT = core
+QXT = core
+
+# Input
+SOURCES += main.cpp
@@ -0,0 +1,129 @@
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QStringList>
+#include <QTextStream>
+#include <QxtBinaryLogReader>
+#include <QxtCommandOptions>
+#include <QxtFlightRecorderLoggerEngine>
+#include <QxtLogger>
+
+/*
+    binlog-tool: prints logs written by QxtBinaryFileLoggerEngine and
+    QxtFlightRecorderLoggerEngine as text.
+
+    binlog-tool [--level=warning,error] [--from=2009-05-14T22:00:00] [--to=...] file...
+
+    Messages are not always written in the order of their times, so the time
+    range is checked for every message up to the end of the log.
+*/
+
+static QxtLogger::LogLevels parseLevels(const QString& list, bool* ok)
+{
+    QxtLogger::LogLevels levels;
+    *ok = true;
+    Q_FOREACH(const QString& name, list.split(',', QString::SkipEmptyParts))
+    {
+        const QString level = name.trimmed().toLower();
+        if (level == "trace") levels |= QxtLogger::TraceLevel;
+        else if (level == "debug") levels |= QxtLogger::DebugLevel;
+        else if (level == "info") levels |= QxtLogger::InfoLevel;
+        else if (level == "warning") levels |= QxtLogger::WarningLevel;
+        else if (level == "error") levels |= QxtLogger::ErrorLevel;
+        else if (level == "critical") levels |= QxtLogger::CriticalLevel;
+        else if (level == "fatal") levels |= QxtLogger::FatalLevel;
+        else if (level == "write") levels |= QxtLogger::WriteLevel;
+        else *ok = false;
+    }
+    return levels;
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QxtCommandOptions options;
+    options.add("level", "comma separated levels to print: trace, debug, info, warning, error, critical, fatal, write", QxtCommandOptions::ValueRequired);
+    options.add("from", "print messages logged at or after this time (yyyy-MM-ddThh:mm:ss)", QxtCommandOptions::ValueRequired);
+    options.add("to", "print messages logged before this time (yyyy-MM-ddThh:mm:ss)", QxtCommandOptions::ValueRequired);
+    options.add("help", "show this help text");
+    options.alias("help", "h");
+    options.parse(QCoreApplication::arguments());
+
+    if (options.count("help") || options.positional().isEmpty() || options.showUnrecognizedWarning())
+    {
+        out << "usage: binlog-tool [options] file..." << endl;
+        options.showUsage();
+        return options.count("help") ? 0 : 1;
+    }
+
+    QxtLogger::LogLevels levels = QxtLogger::AllLevels;
+    if (options.count("level"))
+    {
+        bool ok;
+        levels = parseLevels(options.value("level").toString(), &ok);
+        if (!ok)
+        {
+            err << "invalid level list: " << options.value("level").toString() << endl;
+            return 1;
+        }
+    }
+
+    QDateTime from, to;
+    if (options.count("from"))
+    {
+        from = QDateTime::fromString(options.value("from").toString(), Qt::ISODate);
+        if (!from.isValid())
+        {
+            err << "invalid time: " << options.value("from").toString() << endl;
+            return 1;
+        }
+    }
+    if (options.count("to"))
+    {
+        to = QDateTime::fromString(options.value("to").toString(), Qt::ISODate);
+        if (!to.isValid())
+        {
+            err << "invalid time: " << options.value("to").toString() << endl;
+            return 1;
+        }
+    }
+
+    int status = 0;
+    QxtBinaryLogReader reader;
+    Q_FOREACH(const QString& fileName, options.positional())
+    {
+        if (QxtFlightRecorderLoggerEngine::isFlightRecorderFile(fileName))
+        {
+            // the ring is small; time filters do not apply
+            QBuffer output;
+            output.open(QIODevice::WriteOnly);
+            if (!QxtFlightRecorderLoggerEngine::dump(fileName, &output, levels))
+            {
+                err << fileName << ": damaged flight recorder file" << endl;
+                status = 1;
+            }
+            out << QString::fromUtf8(output.data());
+            out.flush();
+            continue;
+        }
+        if (!reader.open(fileName))
+        {
+            err << fileName << ": " << reader.errorString() << endl;
+            status = 1;
+            continue;
+        }
+        if (from.isValid() && !reader.seek(from)) continue;
+        while (reader.readNext())
+        {
+            if (from.isValid() && reader.timestamp() < from) continue;
+            if (to.isValid() && reader.timestamp() >= to) continue;
+            if (levels & reader.level())
+                out << reader.toString() << '\n';
+        }
+        out.flush();
+    }
+    return status;
+}